@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "benchmark.h"
+
+#include <QTest>
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::uint64_t> sAllocations{0};
+std::atomic<std::uint64_t> sAllocatedBytes{0};
+
+double perOperation(std::uint64_t count, std::uint64_t operations) {
+    return static_cast<double>(count) / static_cast<double>(operations);
+}
+
+} // namespace
+
+// The replaceable allocation functions count all allocations done by the benchmarks,
+// including the coroutine frames that don't fit into the QCoro frame pool. The array
+// and sized variants end up calling these.
+void *operator new(std::size_t size) {
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    sAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto *ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace QCoro::Bench {
+
+AllocationCount allocationCount() noexcept {
+    return {sAllocations.load(std::memory_order_relaxed),
+            sAllocatedBytes.load(std::memory_order_relaxed)};
+}
+
+void AllocationCounter::report() const {
+    if (mOperations == 0) {
+        return;
+    }
+
+    const char *tag = QTest::currentDataTag();
+    qInfo("%s(%s): %.2f allocations (%.1f bytes) per operation, coroutine frames: %.2f pooled, "
+          "%.2f allocated",
+          QTest::currentTestFunction(), tag ? tag : "", perOperation(mAllocations, mOperations),
+          perOperation(mBytes, mOperations), perOperation(mPooledFrames, mOperations),
+          perOperation(mAllocatedFrames, mOperations));
+}
+
+} // namespace QCoro::Bench
@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "qcoro/impl/frameallocator.h"
+#include "qcoro/task.h"
+
+#include <QEventLoop>
+
+#include <cstdint>
+
+namespace QCoro::Bench {
+
+//! Allocations done using the global `operator new` by the whole process.
+struct AllocationCount {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+//! Returns the number of allocations done so far.
+AllocationCount allocationCount() noexcept;
+
+//! Counts allocations done by the benchmarked code.
+/*!
+ * QBENCHMARK runs its block as many times as needed for a stable measurement, so the
+ * counter accumulates allocations of all the runs and reports them per operation:
+ *
+ * ```cpp
+ * QCoro::Bench::AllocationCounter allocations;
+ * QBENCHMARK {
+ *     allocations.measure([]() { ... });
+ * }
+ * allocations.report();
+ * ```
+ *
+ * Only allocations done by the measured code are counted, not those done by QTest itself
+ * between the runs.
+ */
+class AllocationCounter {
+public:
+    //! Runs \c fn, which performs \c operations benchmarked operations, and counts its allocations.
+    template<typename Fn>
+    void measure(Fn &&fn, std::uint64_t operations = 1) {
+        const auto start = allocationCount();
+        const auto framesStart = QCoro::frameAllocatorStats();
+        fn();
+        const auto end = allocationCount();
+        const auto framesEnd = QCoro::frameAllocatorStats();
+
+        mAllocations += end.allocations - start.allocations;
+        mBytes += end.bytes - start.bytes;
+        mPooledFrames += framesEnd.hits - framesStart.hits;
+        mAllocatedFrames += framesEnd.misses - framesStart.misses;
+        mOperations += operations;
+    }
+
+    //! Prints the average number of allocations and coroutine frames per operation.
+    void report() const;
+
+private:
+    std::uint64_t mAllocations = 0;
+    std::uint64_t mBytes = 0;
+    std::uint64_t mPooledFrames = 0;
+    std::uint64_t mAllocatedFrames = 0;
+    std::uint64_t mOperations = 0;
+};
+
+//! Runs an event loop until the \c task finishes.
+inline void waitFor(QCoro::Task<> task) {
+    if (task.isReady()) {
+        return;
+    }
+
+    QEventLoop loop;
+    auto watcher = [](QCoro::Task<> task, QEventLoop &loop) -> QCoro::Task<> {
+        co_await task;
+        loop.quit();
+    }(std::move(task), loop);
+    loop.exec();
+}
+
+} // namespace QCoro::Bench
@@ -0,0 +1,215 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "loadserver.h"
+
+#include "qcoro/coro.h"
+#include "qcoro/event.h"
+#include "qcoro/semaphore.h"
+#include "qcoro/task.h"
+#include "qcoro/timeout.h"
+
+#include <QHostAddress>
+#include <QLocalSocket>
+#include <QTcpSocket>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace LoadTest {
+
+struct ClientOptions {
+    Transport transport = Transport::Tcp;
+    Protocol protocol = Protocol::Echo;
+    //! Number of connections open at the same time.
+    int connections = 1000;
+    //! Number of requests sent over each connection, one after another.
+    int requests = 100;
+    //! Size of echo requests, or expected size of the body of HTTP responses.
+    qint64 payloadSize = 64;
+    //! Maximum number of connections being established at the same time.
+    int connectConcurrency = 128;
+    //! How long to wait for a connection to be established or for a response.
+    std::chrono::milliseconds timeout = std::chrono::seconds{10};
+    QHostAddress address{QHostAddress::LocalHost};
+    //! TCP ports of the server, the connections are distributed evenly among them.
+    std::vector<quint16> ports;
+    //! Name of the local server.
+    QString name;
+};
+
+struct ClientReport {
+    //! Latencies of all successful requests.
+    std::vector<std::chrono::nanoseconds> latencies;
+    int connected = 0;
+    int failedConnections = 0;
+    int failedRequests = 0;
+    std::int64_t bytesSent = 0;
+    std::int64_t bytesReceived = 0;
+    //! Time until all the connections have been established (or have failed).
+    std::chrono::nanoseconds connectTime{};
+    //! Time it took to send all the requests once all connections have been established.
+    std::chrono::nanoseconds requestTime{};
+};
+
+//! Opens many concurrent connections to a LoadServer and sends requests over each of them.
+/*!
+ * Every connection is handled by its own coroutine. The requests are only sent once all the
+ * connections are established, so that the measured latencies reflect the server and the
+ * client handling all the connections concurrently. Each connection has at most one request
+ * in flight.
+ */
+class LoadClient {
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit LoadClient(ClientOptions options)
+        : mOptions(std::move(options)),
+          mConnectSlots(static_cast<std::size_t>(std::max(mOptions.connectConcurrency, 1))) {
+        if (mOptions.protocol == Protocol::Echo) {
+            mRequest = QByteArray(static_cast<int>(mOptions.payloadSize), 'x') + "\n";
+        } else {
+            mRequest = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+        }
+    }
+
+    QCoro::Task<ClientReport> run() {
+        mReport.latencies.reserve(static_cast<std::size_t>(mOptions.connections) *
+                                  static_cast<std::size_t>(mOptions.requests));
+
+        if (mOptions.connections <= 0) {
+            co_return std::move(mReport);
+        }
+
+        const auto started = Clock::now();
+        std::vector<QCoro::Task<>> connections;
+        connections.reserve(static_cast<std::size_t>(mOptions.connections));
+        for (int i = 0; i < mOptions.connections; ++i) {
+            if (mOptions.transport == Transport::Local) {
+                connections.push_back(runConnection(std::make_unique<QLocalSocket>(), i));
+            } else {
+                connections.push_back(runConnection(std::make_unique<QTcpSocket>(), i));
+            }
+        }
+
+        co_await mAllConnected.wait();
+        const auto connected = Clock::now();
+        mReport.connectTime = connected - started;
+
+        mStart.set();
+        for (auto &connection : connections) {
+            co_await connection;
+        }
+        mReport.requestTime = Clock::now() - connected;
+
+        co_return std::move(mReport);
+    }
+
+private:
+    template<typename Socket>
+    QCoro::Task<> runConnection(std::unique_ptr<Socket> socket, int index) {
+        co_await mConnectSlots.acquire();
+        if constexpr (std::is_same_v<Socket, QLocalSocket>) {
+            Q_UNUSED(index);
+            socket->connectToServer(mOptions.name);
+        } else {
+            const auto &ports = mOptions.ports;
+            socket->connectToHost(mOptions.address,
+                                  ports[static_cast<std::size_t>(index) % ports.size()]);
+        }
+        const bool connected = co_await qCoro(socket.get()).waitForConnected(mOptions.timeout);
+        mConnectSlots.release();
+
+        connectionEstablished(connected);
+        if (!connected) {
+            co_return;
+        }
+
+        co_await mStart.wait();
+        for (int i = 0; i < mOptions.requests; ++i) {
+            const auto sent = Clock::now();
+            socket->write(mRequest);
+            const auto received = co_await receiveResponse(socket.get());
+            if (received <= 0) {
+                // The connection is in an unknown state, don't send more requests over it
+                mReport.failedRequests += mOptions.requests - i;
+                break;
+            }
+            mReport.latencies.push_back(Clock::now() - sent);
+            mReport.bytesSent += mRequest.size();
+            mReport.bytesReceived += received;
+        }
+        socket->close();
+    }
+
+    //! Waits for the response to a request, returns its size or -1 if it failed.
+    template<typename Socket>
+    QCoro::Task<std::int64_t> receiveResponse(Socket *socket) {
+        if (mOptions.protocol == Protocol::Echo) {
+            const auto response =
+                co_await QCoro::withTimeout(qCoro(socket).readUntil("\n", maxRequestSize),
+                                            mOptions.timeout);
+            if (!response || response->size() != mRequest.size()) {
+                co_return -1;
+            }
+            co_return response->size();
+        }
+
+        const auto headers =
+            co_await QCoro::withTimeout(qCoro(socket).readUntil("\r\n\r\n", 64 * 1024),
+                                        mOptions.timeout);
+        if (!headers || !headers->startsWith("HTTP/1.1 200")) {
+            co_return -1;
+        }
+        const auto length = contentLength(*headers);
+        if (length < 0) {
+            co_return -1;
+        }
+        const auto available =
+            co_await QCoro::withTimeout(qCoro(socket).bytesAvailable(length), mOptions.timeout);
+        if (!available || *available < length || socket->read(length).size() != length) {
+            co_return -1;
+        }
+        co_return headers->size() + length;
+    }
+
+    static qint64 contentLength(const QByteArray &headers) {
+        for (const auto &line : headers.split('\n')) {
+            if (line.toLower().startsWith("content-length:")) {
+                bool ok = false;
+                const auto length = line.mid(line.indexOf(':') + 1).trimmed().toLongLong(&ok);
+                return ok ? length : -1;
+            }
+        }
+        return -1;
+    }
+
+    void connectionEstablished(bool connected) {
+        if (connected) {
+            ++mReport.connected;
+        } else {
+            ++mReport.failedConnections;
+            mReport.failedRequests += mOptions.requests;
+        }
+        if (mReport.connected + mReport.failedConnections == mOptions.connections) {
+            mAllConnected.set();
+        }
+    }
+
+    ClientOptions mOptions;
+    QByteArray mRequest;
+    ClientReport mReport;
+    QCoro::Semaphore mConnectSlots;
+    QCoro::Event mAllConnected;
+    QCoro::Event mStart;
+};
+
+} // namespace LoadTest
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "qcoro/coro.h"
+#include "qcoro/task.h"
+
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace LoadTest {
+
+enum class Transport {
+    Tcp,
+    Local,
+};
+
+enum class Protocol {
+    //! Every request is a line, the server sends it back.
+    Echo,
+    //! HTTP/1.1 requests on keep-alive connections, the server replies with a fixed body.
+    Http,
+};
+
+//! Requests larger than this are rejected by the server.
+inline constexpr qint64 maxRequestSize = 16 * 1024 * 1024;
+
+//! Returns the sequence of bytes that ends a request of the \c protocol.
+inline QByteArray requestDelimiter(Protocol protocol) {
+    return protocol == Protocol::Echo ? QByteArray{"\n"} : QByteArray{"\r\n\r\n"};
+}
+
+//! Returns the response that the server sends to each HTTP request.
+inline QByteArray httpResponse(qint64 payloadSize) {
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " +
+           QByteArray::number(payloadSize) + "\r\n\r\n" +
+           QByteArray(static_cast<int>(payloadSize), 'x');
+}
+
+struct ServerOptions {
+    Transport transport = Transport::Tcp;
+    Protocol protocol = Protocol::Echo;
+    //! Size of the body of HTTP responses.
+    qint64 payloadSize = 64;
+    //! Number of TCP ports to listen on, starting at \c port.
+    int listeners = 1;
+    QHostAddress address{QHostAddress::LocalHost};
+    //! First TCP port, 0 to listen on any free ports.
+    quint16 port = 0;
+    //! Name of the local server.
+    QString name;
+};
+
+//! Serves a single connection until the client disconnects, then destroys the socket.
+template<typename Socket>
+QCoro::Task<> serveConnection(Socket *socket, Protocol protocol, QByteArray response) {
+    const auto delimiter = requestDelimiter(protocol);
+    while (true) {
+        const auto request = co_await qCoro(socket).readUntil(delimiter, maxRequestSize);
+        if (!request.endsWith(delimiter)) {
+            // Disconnected, or the request is too large
+            break;
+        }
+        socket->write(protocol == Protocol::Echo ? request : response);
+    }
+    socket->deleteLater();
+}
+
+//! Accepts connections of the \c server and serves each of them in its own coroutine.
+template<typename Server>
+QCoro::Task<> acceptConnections(Server *server, Protocol protocol, QByteArray response) {
+    auto connections = qCoro(server).connections();
+    for (auto it = co_await connections.begin(); it != connections.end();) {
+        serveConnection(*it, protocol, response);
+        co_await ++it;
+    }
+}
+
+//! A coroutine-based echo or HTTP server that serves any number of concurrent connections.
+/*!
+ * All the connections are served from the event loop of the thread that has called listen().
+ */
+class LoadServer {
+public:
+    explicit LoadServer(ServerOptions options) : mOptions(std::move(options)) {}
+
+    bool listen() {
+        const auto response = httpResponse(mOptions.payloadSize);
+        if (mOptions.transport == Transport::Local) {
+            QLocalServer::removeServer(mOptions.name);
+            auto server = std::make_unique<QLocalServer>();
+            server->setMaxPendingConnections(std::numeric_limits<int>::max());
+            if (!server->listen(mOptions.name)) {
+                return false;
+            }
+            acceptConnections(server.get(), mOptions.protocol, response);
+            mLocalServer = std::move(server);
+            return true;
+        }
+
+        for (int i = 0; i < mOptions.listeners; ++i) {
+            auto server = std::make_unique<QTcpServer>();
+            server->setMaxPendingConnections(std::numeric_limits<int>::max());
+            const quint16 port = mOptions.port == 0 ? 0 : static_cast<quint16>(mOptions.port + i);
+            if (!server->listen(mOptions.address, port)) {
+                return false;
+            }
+            acceptConnections(server.get(), mOptions.protocol, response);
+            mTcpServers.push_back(std::move(server));
+        }
+        return true;
+    }
+
+    //! Returns the TCP ports the server listens on.
+    std::vector<quint16> ports() const {
+        std::vector<quint16> ports;
+        for (const auto &server : mTcpServers) {
+            ports.push_back(server->serverPort());
+        }
+        return ports;
+    }
+
+    QString errorString() const {
+        if (mLocalServer) {
+            return mLocalServer->errorString();
+        }
+        return mTcpServers.empty() ? QString{} : mTcpServers.back()->errorString();
+    }
+
+private:
+    ServerOptions mOptions;
+    std::vector<std::unique_ptr<QTcpServer>> mTcpServers;
+    std::unique_ptr<QLocalServer> mLocalServer;
+};
+
+//! Runs a LoadServer in its own thread, so that it doesn't compete with the clients.
+class ServerThread : public QThread {
+public:
+    explicit ServerThread(ServerOptions options) : mOptions(std::move(options)) {}
+
+    ~ServerThread() override {
+        stop();
+    }
+
+    //! Starts the server, returns once it's listening or has failed to listen.
+    bool startServer() {
+        start();
+        std::unique_lock lock{mMutex};
+        mStateChanged.wait(lock, [this]() { return mState != State::Starting; });
+        return mState == State::Listening;
+    }
+
+    void stop() {
+        quit();
+        wait();
+    }
+
+    std::vector<quint16> ports() const {
+        std::scoped_lock lock{mMutex};
+        return mPorts;
+    }
+
+protected:
+    void run() override {
+        LoadServer server{mOptions};
+        const bool listening = server.listen();
+        {
+            std::scoped_lock lock{mMutex};
+            mPorts = server.ports();
+            mState = listening ? State::Listening : State::Failed;
+        }
+        mStateChanged.notify_all();
+
+        if (listening) {
+            exec();
+        }
+    }
+
+private:
+    enum class State {
+        Starting,
+        Listening,
+        Failed,
+    };
+
+    ServerOptions mOptions;
+    mutable std::mutex mMutex;
+    std::condition_variable mStateChanged;
+    State mState = State::Starting;
+    std::vector<quint16> mPorts;
+};
+
+} // namespace LoadTest
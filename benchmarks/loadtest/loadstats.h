@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QFile>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace LoadTest {
+
+//! Percentiles of request latencies.
+struct LatencySummary {
+    std::chrono::nanoseconds p50{};
+    std::chrono::nanoseconds p90{};
+    std::chrono::nanoseconds p99{};
+    std::chrono::nanoseconds max{};
+    std::chrono::nanoseconds mean{};
+};
+
+//! Computes the latency percentiles, reorders the \c samples.
+inline LatencySummary summarize(std::vector<std::chrono::nanoseconds> &samples) {
+    if (samples.empty()) {
+        return {};
+    }
+
+    const auto percentile = [&samples](double p) {
+        const auto index = static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    };
+
+    LatencySummary summary;
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p99 = percentile(0.99);
+    summary.max = *std::max_element(samples.begin(), samples.end());
+    summary.mean = std::accumulate(samples.begin(), samples.end(), std::chrono::nanoseconds{}) /
+                   static_cast<std::int64_t>(samples.size());
+    return summary;
+}
+
+//! Memory used by the process, in kilobytes
+struct MemoryUsage {
+    std::int64_t rss = 0;
+    std::int64_t peakRss = 0;
+};
+
+//! Returns the current and the peak resident set size of the process, if known.
+inline MemoryUsage memoryUsage() {
+    MemoryUsage usage;
+    QFile status{QStringLiteral("/proc/self/status")};
+    if (status.open(QIODevice::ReadOnly)) {
+        const auto parseKb = [](const QByteArray &line) {
+            return line.mid(line.indexOf(':') + 1).trimmed().split(' ').front().toLongLong();
+        };
+        for (const auto &line : status.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:")) {
+                usage.rss = parseKb(line);
+            } else if (line.startsWith("VmHWM:")) {
+                usage.peakRss = parseKb(line);
+            }
+        }
+    }
+#ifdef Q_OS_UNIX
+    if (usage.peakRss == 0) {
+        rusage ru{};
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef Q_OS_MACOS
+            usage.peakRss = ru.ru_maxrss / 1024;
+#else
+            usage.peakRss = ru.ru_maxrss;
+#endif
+        }
+    }
+#endif
+    return usage;
+}
+
+//! Raises the limit of open file descriptors as high as allowed, each connection needs one.
+/*!
+ * \return The new limit, or -1 if it's unknown.
+ */
+inline std::int64_t raiseFileLimit() {
+#ifdef Q_OS_UNIX
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return -1;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return static_cast<std::int64_t>(limit.rlim_cur);
+#else
+    return -1;
+#endif
+}
+
+} // namespace LoadTest
@@ -0,0 +1,208 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "loadclient.h"
+#include "loadserver.h"
+#include "loadstats.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+using namespace LoadTest;
+
+namespace {
+
+double toMsecs(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double toSecs(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+void printReport(const ClientOptions &options, ClientReport &report, const MemoryUsage &baseline) {
+    const auto succeeded = static_cast<std::int64_t>(report.latencies.size());
+    const double seconds = toSecs(report.requestTime);
+    const auto latency = summarize(report.latencies);
+    const auto memory = memoryUsage();
+
+    std::printf("transport: %s, protocol: %s, payload: %lld bytes\n",
+                options.transport == Transport::Tcp ? "tcp" : "local",
+                options.protocol == Protocol::Echo ? "echo" : "http",
+                static_cast<long long>(options.payloadSize));
+    std::printf("connections: %d connected, %d failed in %.1f ms\n", report.connected,
+                report.failedConnections, toMsecs(report.connectTime));
+    std::printf("requests: %lld succeeded, %d failed in %.3f s\n",
+                static_cast<long long>(succeeded), report.failedRequests, seconds);
+    if (seconds > 0) {
+        std::printf("throughput: %.0f requests/s, %.2f MiB/s sent, %.2f MiB/s received\n",
+                    static_cast<double>(succeeded) / seconds,
+                    static_cast<double>(report.bytesSent) / seconds / (1024 * 1024),
+                    static_cast<double>(report.bytesReceived) / seconds / (1024 * 1024));
+    }
+    std::printf("latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms, mean %.3f ms\n",
+                toMsecs(latency.p50), toMsecs(latency.p90), toMsecs(latency.p99),
+                toMsecs(latency.max), toMsecs(latency.mean));
+    std::printf("memory: RSS %.1f MiB, peak RSS %.1f MiB", static_cast<double>(memory.rss) / 1024,
+                static_cast<double>(memory.peakRss) / 1024);
+    if (report.connected > 0 && memory.peakRss > baseline.rss) {
+        std::printf(", %.1f KiB per connection",
+                    static_cast<double>(memory.peakRss - baseline.rss) / report.connected);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+        "Opens many concurrent connections to a coroutine-based echo or HTTP server and reports "
+        "request latencies, throughput and memory usage."));
+    parser.addHelpOption();
+
+    const QCommandLineOption transportOption{
+        QStringList{QStringLiteral("t"), QStringLiteral("transport")},
+        QStringLiteral("Transport to use, \"tcp\" or \"local\"."), QStringLiteral("transport"),
+        QStringLiteral("tcp")};
+    const QCommandLineOption protocolOption{
+        QStringList{QStringLiteral("p"), QStringLiteral("protocol")},
+        QStringLiteral("Protocol to use, \"echo\" or \"http\"."), QStringLiteral("protocol"),
+        QStringLiteral("echo")};
+    const QCommandLineOption connectionsOption{
+        QStringList{QStringLiteral("c"), QStringLiteral("connections")},
+        QStringLiteral("Number of concurrent connections."), QStringLiteral("count"),
+        QStringLiteral("1000")};
+    const QCommandLineOption requestsOption{
+        QStringList{QStringLiteral("r"), QStringLiteral("requests")},
+        QStringLiteral("Number of requests sent over each connection."), QStringLiteral("count"),
+        QStringLiteral("100")};
+    const QCommandLineOption payloadOption{
+        QStringList{QStringLiteral("s"), QStringLiteral("payload")},
+        QStringLiteral("Size of echo requests or of HTTP response bodies."),
+        QStringLiteral("bytes"), QStringLiteral("64")};
+    const QCommandLineOption connectConcurrencyOption{
+        QStringLiteral("connect-concurrency"),
+        QStringLiteral("Maximum number of connections being established at the same time."),
+        QStringLiteral("count"), QStringLiteral("128")};
+    const QCommandLineOption timeoutOption{
+        QStringLiteral("timeout"),
+        QStringLiteral("Timeout for establishing a connection and for each response."),
+        QStringLiteral("msecs"), QStringLiteral("10000")};
+    const QCommandLineOption listenersOption{
+        QStringLiteral("listeners"),
+        QStringLiteral("Number of TCP ports the server listens on. Each port allows about 28k "
+                       "connections from a single client address."),
+        QStringLiteral("count"), QStringLiteral("1")};
+    const QCommandLineOption hostOption{QStringLiteral("host"),
+                                        QStringLiteral("Address of the TCP server."),
+                                        QStringLiteral("address"), QStringLiteral("127.0.0.1")};
+    const QCommandLineOption portOption{
+        QStringLiteral("port"),
+        QStringLiteral("First TCP port of the server, required with --client."),
+        QStringLiteral("port"), QStringLiteral("0")};
+    const QCommandLineOption nameOption{QStringLiteral("name"),
+                                        QStringLiteral("Name of the local server."),
+                                        QStringLiteral("name"), QStringLiteral("qcoro-loadtest")};
+    const QCommandLineOption serverOption{
+        QStringLiteral("server"), QStringLiteral("Only run the server, until interrupted.")};
+    const QCommandLineOption clientOption{
+        QStringLiteral("client"),
+        QStringLiteral("Only run the clients, against a server started with --server.")};
+    for (const auto &option : {transportOption, protocolOption, connectionsOption, requestsOption,
+                               payloadOption, connectConcurrencyOption, timeoutOption,
+                               listenersOption, hostOption, portOption, nameOption, serverOption,
+                               clientOption}) {
+        parser.addOption(option);
+    }
+    parser.process(app);
+
+    ServerOptions serverOptions;
+    serverOptions.transport = parser.value(transportOption) == QStringLiteral("local")
+                                  ? Transport::Local
+                                  : Transport::Tcp;
+    serverOptions.protocol = parser.value(protocolOption) == QStringLiteral("http")
+                                 ? Protocol::Http
+                                 : Protocol::Echo;
+    serverOptions.payloadSize = std::clamp<qint64>(parser.value(payloadOption).toLongLong(), 0,
+                                                   maxRequestSize - 1);
+    serverOptions.listeners = std::max(parser.value(listenersOption).toInt(), 1);
+    serverOptions.address = QHostAddress{parser.value(hostOption)};
+    serverOptions.port = static_cast<quint16>(parser.value(portOption).toUInt());
+    serverOptions.name = parser.value(nameOption);
+
+    const auto fileLimit = raiseFileLimit();
+
+    if (parser.isSet(serverOption)) {
+        LoadServer server{serverOptions};
+        if (!server.listen()) {
+            std::fprintf(stderr, "Failed to listen: %s\n", qPrintable(server.errorString()));
+            return 1;
+        }
+        for (const auto port : server.ports()) {
+            std::printf("listening on port %u\n", static_cast<unsigned>(port));
+        }
+        if (serverOptions.transport == Transport::Local) {
+            std::printf("listening on %s\n", qPrintable(serverOptions.name));
+        }
+        std::printf("open files limit: %lld\n", static_cast<long long>(fileLimit));
+        std::fflush(stdout);
+        return app.exec();
+    }
+
+    ClientOptions clientOptions;
+    clientOptions.transport = serverOptions.transport;
+    clientOptions.protocol = serverOptions.protocol;
+    clientOptions.connections = parser.value(connectionsOption).toInt();
+    clientOptions.requests = parser.value(requestsOption).toInt();
+    clientOptions.payloadSize = serverOptions.payloadSize;
+    clientOptions.connectConcurrency = parser.value(connectConcurrencyOption).toInt();
+    clientOptions.timeout = std::chrono::milliseconds{parser.value(timeoutOption).toInt()};
+    clientOptions.address = serverOptions.address;
+    clientOptions.name = serverOptions.name;
+
+    if (fileLimit >= 0 && fileLimit < 2 * clientOptions.connections + 64) {
+        std::fprintf(stderr, "Warning: limit of open files (%lld) is too low for %d connections\n",
+                     static_cast<long long>(fileLimit), clientOptions.connections);
+    }
+
+    std::unique_ptr<ServerThread> serverThread;
+    if (parser.isSet(clientOption)) {
+        if (serverOptions.transport == Transport::Tcp && serverOptions.port == 0) {
+            std::fprintf(stderr, "--client requires --port\n");
+            return 1;
+        }
+        for (int i = 0; i < serverOptions.listeners; ++i) {
+            clientOptions.ports.push_back(static_cast<quint16>(serverOptions.port + i));
+        }
+    } else {
+        serverThread = std::make_unique<ServerThread>(serverOptions);
+        if (!serverThread->startServer()) {
+            std::fprintf(stderr, "Failed to start the server\n");
+            return 1;
+        }
+        clientOptions.ports = serverThread->ports();
+    }
+
+    const auto baseline = memoryUsage();
+    LoadClient client{clientOptions};
+    ClientReport report;
+    auto run = [](LoadClient &client, ClientReport &report) -> QCoro::Task<> {
+        report = co_await client.run();
+        QCoreApplication::quit();
+    }(client, report);
+    if (!run.isReady()) {
+        app.exec();
+    }
+
+    printReport(clientOptions, report, baseline);
+    return report.failedConnections == 0 && report.failedRequests == 0 ? 0 : 2;
+}
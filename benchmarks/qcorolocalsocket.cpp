@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "benchmark.h"
+#include "qcoro/coro.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTest>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr qint64 bytesPerRun = 16 * 1024 * 1024;
+
+} // namespace
+
+class QCoroLocalSocketBenchmark : public QObject {
+    Q_OBJECT
+
+private:
+    static QCoro::Task<> writer(QLocalSocket &socket, qint64 chunkSize) {
+        const QByteArray chunk(static_cast<int>(chunkSize), 'x');
+        for (qint64 written = 0; written < bytesPerRun; written += chunkSize) {
+            co_await qCoro(socket).write(chunk);
+        }
+    }
+
+    static QCoro::Task<> reader(QLocalSocket &socket, qint64 chunkSize) {
+        std::vector<char> buffer(static_cast<std::size_t>(chunkSize));
+        qint64 received = 0;
+        while (received < bytesPerRun) {
+            const auto read = co_await qCoro(socket).readInto(buffer.data(), chunkSize);
+            if (read <= 0 && socket.state() != QLocalSocket::ConnectedState) {
+                break;
+            }
+            received += std::max<qint64>(read, 0);
+        }
+    }
+
+private Q_SLOTS:
+    void initTestCase() {
+        const auto name = QStringLiteral("qcoro-bench-%1").arg(QCoreApplication::applicationPid());
+        QLocalServer::removeServer(name);
+        QVERIFY(mServer.listen(name));
+
+        mClient.connectToServer(name);
+        QVERIFY(mClient.waitForConnected());
+        QVERIFY(mServer.waitForNewConnection(1000));
+        mPeer.reset(mServer.nextPendingConnection());
+        QVERIFY(mPeer);
+    }
+
+    void cleanupTestCase() {
+        mClient.disconnectFromServer();
+        mPeer.reset();
+        mServer.close();
+    }
+
+    void benchmarkThroughput_data() {
+        QTest::addColumn<qint64>("chunkSize");
+
+        QTest::newRow("1 KiB") << qint64{1024};
+        QTest::newRow("16 KiB") << qint64{16 * 1024};
+        QTest::newRow("256 KiB") << qint64{256 * 1024};
+    }
+
+    //! Moves bytesPerRun bytes from one end of a local socket to the other one.
+    void benchmarkThroughput() {
+        QFETCH(qint64, chunkSize);
+
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                [this, chunkSize]() {
+                    auto read = reader(*mPeer, chunkSize);
+                    QCoro::Bench::waitFor(writer(mClient, chunkSize));
+                    QCoro::Bench::waitFor(std::move(read));
+                },
+                bytesPerRun / chunkSize);
+        }
+        allocations.report();
+    }
+
+private:
+    QLocalServer mServer;
+    QLocalSocket mClient;
+    std::unique_ptr<QLocalSocket> mPeer;
+};
+
+QTEST_GUILESS_MAIN(QCoroLocalSocketBenchmark)
+
+#include "qcorolocalsocket.moc"
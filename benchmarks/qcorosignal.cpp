@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "benchmark.h"
+#include "qcoro/coro.h"
+
+#include <QTest>
+
+#include <memory>
+
+namespace {
+
+constexpr int roundTripsPerRun = 1000;
+
+} // namespace
+
+class PingPong : public QObject {
+    Q_OBJECT
+Q_SIGNALS:
+    void ping(int value);
+    void pong(int value);
+};
+
+class QCoroSignalBenchmark : public QObject {
+    Q_OBJECT
+
+private:
+    static QCoro::Task<> ponger(PingPong &obj) {
+        for (int i = 0; i < roundTripsPerRun; ++i) {
+            const int value = co_await qCoro(&obj, &PingPong::ping);
+            Q_EMIT obj.pong(value);
+        }
+    }
+
+    static QCoro::Task<> pinger(PingPong &obj) {
+        for (int i = 0; i < roundTripsPerRun; ++i) {
+            Q_EMIT obj.ping(i);
+            co_await qCoro(&obj, &PingPong::pong);
+        }
+    }
+
+    static QCoro::Task<> consume(QCoro::AsyncGenerator<int> emissions) {
+        QCORO_FOREACH(int value, emissions) {
+            Q_UNUSED(value);
+        }
+    }
+
+private Q_SLOTS:
+    //! Two coroutines passing a value back and forth using co_await qCoro(obj, signal).
+    void benchmarkRoundTrip() {
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                []() {
+                    PingPong obj;
+                    auto pong = ponger(obj);
+                    QCoro::Bench::waitFor(pinger(obj));
+                    QCoro::Bench::waitFor(std::move(pong));
+                },
+                roundTripsPerRun);
+        }
+        allocations.report();
+    }
+
+    //! A coroutine consuming a stream of emissions using qCoroSignalListener().
+    void benchmarkListener() {
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                []() {
+                    auto obj = std::make_unique<PingPong>();
+                    auto consumed = consume(qCoroSignalListener(obj.get(), &PingPong::ping));
+                    for (int i = 0; i < roundTripsPerRun; ++i) {
+                        Q_EMIT obj->ping(i);
+                    }
+                    obj.reset();
+                    QCoro::Bench::waitFor(std::move(consumed));
+                },
+                roundTripsPerRun);
+        }
+        allocations.report();
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroSignalBenchmark)
+
+#include "qcorosignal.moc"
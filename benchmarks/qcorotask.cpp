@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "benchmark.h"
+#include "qcoro/impl/resume.h"
+#include "qcoro/task.h"
+
+#include <QTest>
+
+namespace {
+
+constexpr int awaitsPerRun = 1000;
+
+QCoro::Task<> readyTask() {
+    co_return;
+}
+
+QCoro::Task<int> chain(int depth) {
+    if (depth == 0) {
+        co_return 0;
+    }
+    co_return co_await chain(depth - 1) + 1;
+}
+
+//! Suspends the coroutine and resumes it from the ready queue of the event loop.
+class QueuedResume {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        QCoro::detail::resumeQueued(mReadyNode, awaitingCoroutine);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    QCoro::detail::ReadyNode mReadyNode;
+};
+
+QCoro::Task<> suspendingTask() {
+    co_await QueuedResume{};
+}
+
+} // namespace
+
+class QCoroTaskBenchmark : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkCreateAndDestroy() {
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure([]() { [[maybe_unused]] auto task = readyTask(); });
+        }
+        allocations.report();
+    }
+
+    void benchmarkAwaitChain_data() {
+        QTest::addColumn<int>("depth");
+
+        QTest::newRow("1") << 1;
+        QTest::newRow("8") << 8;
+        QTest::newRow("64") << 64;
+    }
+
+    void benchmarkAwaitChain() {
+        QFETCH(int, depth);
+
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure([depth]() {
+                auto task = chain(depth);
+                Q_ASSERT(task.isReady());
+            });
+        }
+        allocations.report();
+    }
+
+    //! co_await of a Task that has already finished, the awaiter doesn't suspend.
+    void benchmarkReadyAwait() {
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                []() {
+                    [[maybe_unused]] auto task = []() -> QCoro::Task<> {
+                        auto finished = readyTask();
+                        for (int i = 0; i < awaitsPerRun; ++i) {
+                            co_await finished;
+                        }
+                    }();
+                },
+                awaitsPerRun);
+        }
+        allocations.report();
+    }
+
+    //! co_await of a Task that suspends and is resumed from the event loop.
+    void benchmarkSuspendedAwait() {
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                []() {
+                    QCoro::Bench::waitFor([]() -> QCoro::Task<> {
+                        for (int i = 0; i < awaitsPerRun; ++i) {
+                            co_await suspendingTask();
+                        }
+                    }());
+                },
+                awaitsPerRun);
+        }
+        allocations.report();
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroTaskBenchmark)
+
+#include "qcorotask.moc"
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "benchmark.h"
+#include "qcoro/timer.h"
+
+#include <QTest>
+#include <QTimer>
+
+namespace {
+
+constexpr int timeoutsPerRun = 100;
+
+} // namespace
+
+class QCoroTimerBenchmark : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    //! co_await of a zero-interval QTimer, measures the TimerAwaiter and event loop overhead.
+    void benchmarkTimerAwaiter() {
+        QTimer timer;
+        timer.setSingleShot(true);
+        timer.setInterval(0);
+
+        QCoro::Bench::AllocationCounter allocations;
+        QBENCHMARK {
+            allocations.measure(
+                [&timer]() {
+                    QCoro::Bench::waitFor([](QTimer &timer) -> QCoro::Task<> {
+                        for (int i = 0; i < timeoutsPerRun; ++i) {
+                            timer.start();
+                            co_await timer;
+                        }
+                    }(timer));
+                },
+                timeoutsPerRun);
+        }
+        allocations.report();
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroTimerBenchmark)
+
+#include "qtimer.moc"
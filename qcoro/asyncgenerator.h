@@ -0,0 +1,385 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "task.h"
+
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace QCoro {
+
+template<typename T>
+class AsyncGenerator;
+
+template<typename T>
+class AsyncGeneratorIterator;
+
+/*! \cond internal */
+
+namespace detail {
+
+template<typename T>
+class AsyncGeneratorPromise;
+
+//! Awaitable that transfers execution from the generator coroutine back to its consumer.
+/*!
+ * Used both when the generator yields a value and when it finishes.
+ */
+template<typename T>
+class AsyncGeneratorYieldAwaiter {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<AsyncGeneratorPromise<T>> generator) noexcept {
+        return generator.promise().mConsumer;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+//! Yield awaiter that holds a copy of a value that can't be yielded by reference.
+template<typename T>
+class AsyncGeneratorYieldCopyAwaiter : public AsyncGeneratorYieldAwaiter<T> {
+public:
+    template<typename U>
+    explicit AsyncGeneratorYieldCopyAwaiter(U &&value) : mValue(std::forward<U>(value)) {}
+
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<AsyncGeneratorPromise<T>> generator) noexcept {
+        // The awaiter lives in the generator's coroutine frame until it's resumed again
+        generator.promise().mValue = std::addressof(mValue);
+        return AsyncGeneratorYieldAwaiter<T>::await_suspend(generator);
+    }
+
+private:
+    std::remove_cvref_t<T> mValue;
+};
+
+//! The promise_type for AsyncGenerator<T>.
+/*!
+ * The generator coroutine is suspended immediately after it's created. It's resumed by
+ * its consumer whenever the consumer co_awaits the next value, and it transfers execution
+ * back to the consumer directly (symmetric transfer) whenever it yields a value or finishes.
+ * While the generator is suspended on some other operation (e.g. waiting for data from a
+ * socket), the consumer remains suspended as well.
+ */
+template<typename T>
+class AsyncGeneratorPromise final : public PromiseBase {
+public:
+    using value_type = std::remove_reference_t<T>;
+
+    AsyncGenerator<T> get_return_object() noexcept;
+
+    //! The generator is only started when the first value is co_awaited.
+    QCORO_STD::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    //! Transfers execution to the consumer.
+    AsyncGeneratorYieldAwaiter<T> final_suspend() const noexcept {
+        return {};
+    }
+
+    //! Stores a pointer to the yielded \c value and transfers execution to the consumer.
+    /*!
+     * The value lives in the generator's coroutine frame until the generator is resumed,
+     * so it doesn't have to be copied.
+     */
+    AsyncGeneratorYieldAwaiter<T> yield_value(value_type &value) noexcept {
+        mValue = std::addressof(value);
+        return {};
+    }
+
+    //! \copydoc AsyncGeneratorPromise::yield_value(value_type &)
+    AsyncGeneratorYieldAwaiter<T> yield_value(value_type &&value) noexcept {
+        mValue = std::addressof(value);
+        return {};
+    }
+
+    //! Yields a value that can't be yielded by reference by storing a copy of it.
+    /*!
+     * Used for other types convertible to \c T, or for const values when \c T is not const.
+     */
+    template<typename U>
+        requires std::is_constructible_v<std::remove_cvref_t<T>, U &&>
+    AsyncGeneratorYieldCopyAwaiter<T> yield_value(U &&value) {
+        return AsyncGeneratorYieldCopyAwaiter<T>{std::forward<U>(value)};
+    }
+
+    void return_void() noexcept {}
+
+    //! Stores the exception, which is rethrown to the consumer.
+    void unhandled_exception() noexcept {
+        mException = std::current_exception();
+    }
+
+    //! Rethrows exception thrown by the generator, if any.
+    void rethrowIfException() {
+        if (mException) {
+            std::rethrow_exception(std::exchange(mException, nullptr));
+        }
+    }
+
+    value_type &value() const noexcept {
+        return *mValue;
+    }
+
+private:
+    friend class AsyncGeneratorYieldAwaiter<T>;
+    friend class AsyncGeneratorYieldCopyAwaiter<T>;
+    friend class AsyncGeneratorIterator<T>;
+    friend class AsyncGenerator<T>;
+
+    //! The coroutine that's waiting for the next value.
+    QCORO_STD::coroutine_handle<> mConsumer = {};
+    //! The most recently yielded value.
+    value_type *mValue = nullptr;
+    std::exception_ptr mException;
+};
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Iterator over values produced by an AsyncGenerator<T>.
+/*!
+ * The iterator is obtained by co_awaiting \ref AsyncGenerator::begin(). Advancing the
+ * iterator resumes the generator, so the increment operator returns an Awaitable, which
+ * must be co_awaited before the iterator is dereferenced again:
+ *
+ * ```
+ * for (auto it = co_await generator.begin(); it != generator.end(); co_await ++it) {
+ *     ...
+ * }
+ * ```
+ */
+template<typename T>
+class AsyncGeneratorIterator {
+    using promise_type = detail::AsyncGeneratorPromise<T>;
+
+public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::remove_cvref_t<T>;
+    using reference = std::remove_reference_t<T> &;
+    using pointer = std::remove_reference_t<T> *;
+
+    //! Constructs an end iterator.
+    AsyncGeneratorIterator() noexcept = default;
+
+    //! Returns the current value.
+    reference operator*() const noexcept {
+        return mCoroutine.promise().value();
+    }
+
+    pointer operator->() const noexcept {
+        return std::addressof(operator*());
+    }
+
+    //! Resumes the generator to produce the next value.
+    /*!
+     * Returns an Awaitable, which suspends the co_awaiting coroutine until the generator
+     * yields the next value or finishes. The Awaitable returns reference to this iterator,
+     * which becomes the end iterator if the generator has finished. If the generator has
+     * thrown an exception, the exception is rethrown from the co_await.
+     */
+    auto operator++() noexcept {
+        class AdvanceAwaiter {
+        public:
+            explicit AdvanceAwaiter(AsyncGeneratorIterator &iterator) noexcept
+                : mIterator(iterator) {}
+
+            bool await_ready() const noexcept {
+                return !mIterator.mCoroutine;
+            }
+
+            QCORO_STD::coroutine_handle<>
+            await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mIterator.mCoroutine.promise().mConsumer = awaitingCoroutine;
+                return mIterator.mCoroutine;
+            }
+
+            AsyncGeneratorIterator &await_resume() {
+                mIterator.advanced();
+                return mIterator;
+            }
+
+        private:
+            AsyncGeneratorIterator &mIterator;
+        };
+        return AdvanceAwaiter{*this};
+    }
+
+    bool operator==(const AsyncGeneratorIterator &other) const noexcept {
+        return mCoroutine == other.mCoroutine;
+    }
+
+private:
+    friend class AsyncGenerator<T>;
+
+    explicit AsyncGeneratorIterator(QCORO_STD::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {}
+
+    //! Called when the generator returns control to the consumer.
+    void advanced() {
+        if (mCoroutine.done()) {
+            auto coroutine = std::exchange(mCoroutine, nullptr);
+            coroutine.promise().rethrowIfException();
+        }
+    }
+
+    QCORO_STD::coroutine_handle<promise_type> mCoroutine = {};
+};
+
+//! A coroutine that asynchronously produces a sequence of values.
+/*!
+ * A coroutine returning AsyncGenerator<T> can co_await the same types as a coroutine
+ * returning \ref Task<T>, and it uses \c co_yield to produce values of type \c T for its
+ * consumer. The generator only runs while its consumer is waiting for the next value:
+ * it's started when the consumer co_awaits \ref begin() and it's suspended again at each
+ * \c co_yield, until the consumer co_awaits the next value.
+ *
+ * ```
+ * QCoro::AsyncGenerator<QByteArray> records(QTcpSocket *socket) {
+ *     while (socket->state() == QAbstractSocket::ConnectedState) {
+ *         if (co_await qCoro(socket).bytesAvailable(RecordSize) < RecordSize) {
+ *             break;
+ *         }
+ *         co_yield socket->read(RecordSize);
+ *     }
+ * }
+ *
+ * QCoro::Task<> process(QTcpSocket *socket) {
+ *     QCORO_FOREACH(const QByteArray &record, records(socket)) {
+ *         processRecord(record);
+ *     }
+ * }
+ * ```
+ *
+ * Destroying the AsyncGenerator destroys the generator coroutine, even if it hasn't finished
+ * yet. The generator must not be destroyed while its consumer is waiting for the next value.
+ */
+template<typename T>
+class AsyncGenerator {
+public:
+    //! Promise type of the coroutine. This is required by the C++ standard.
+    using promise_type = detail::AsyncGeneratorPromise<T>;
+    using iterator = AsyncGeneratorIterator<T>;
+
+    //! Constructs an empty generator, which doesn't produce any values.
+    explicit AsyncGenerator() noexcept = default;
+
+    //! Constructs a generator bound to a coroutine.
+    explicit AsyncGenerator(QCORO_STD::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {}
+
+    AsyncGenerator(const AsyncGenerator &) = delete;
+    AsyncGenerator &operator=(const AsyncGenerator &) = delete;
+
+    AsyncGenerator(AsyncGenerator &&other) noexcept
+        : mCoroutine(std::exchange(other.mCoroutine, nullptr)) {}
+
+    AsyncGenerator &operator=(AsyncGenerator &&other) noexcept {
+        if (this != &other) {
+            if (mCoroutine) {
+                mCoroutine.destroy();
+            }
+            mCoroutine = std::exchange(other.mCoroutine, nullptr);
+        }
+        return *this;
+    }
+
+    //! Destroys the generator coroutine.
+    ~AsyncGenerator() {
+        if (mCoroutine) {
+            mCoroutine.destroy();
+        }
+    }
+
+    //! Starts the generator.
+    /*!
+     * Returns an Awaitable, which suspends the co_awaiting coroutine until the generator
+     * yields its first value or finishes, and returns an iterator to the first value
+     * (or the end iterator if the generator has finished without producing any value).
+     *
+     * Must only be co_awaited once.
+     */
+    auto begin() noexcept {
+        class BeginAwaiter {
+        public:
+            explicit BeginAwaiter(QCORO_STD::coroutine_handle<promise_type> coroutine) noexcept
+                : mIterator(coroutine) {}
+
+            bool await_ready() const noexcept {
+                return !mIterator.mCoroutine;
+            }
+
+            QCORO_STD::coroutine_handle<>
+            await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mIterator.mCoroutine.promise().mConsumer = awaitingCoroutine;
+                return mIterator.mCoroutine;
+            }
+
+            iterator await_resume() {
+                mIterator.advanced();
+                return mIterator;
+            }
+
+        private:
+            iterator mIterator;
+        };
+        return BeginAwaiter{mCoroutine};
+    }
+
+    //! Returns the end iterator.
+    iterator end() const noexcept {
+        return {};
+    }
+
+private:
+    QCORO_STD::coroutine_handle<promise_type> mCoroutine = {};
+};
+
+namespace detail {
+
+template<typename T>
+inline AsyncGenerator<T> AsyncGeneratorPromise<T>::get_return_object() noexcept {
+    return AsyncGenerator<T>{
+        QCORO_STD::coroutine_handle<AsyncGeneratorPromise>::from_promise(*this)};
+}
+
+} // namespace detail
+
+} // namespace QCoro
+
+//! Iterates over all values produced by an AsyncGenerator.
+/*!
+ * Since C++20 doesn't have an asynchronous range-based for loop, this macro expands to
+ * the equivalent loop that co_awaits the generator's iterators:
+ *
+ * ```
+ * QCORO_FOREACH(const QByteArray &chunk, qCoro(socket).readChunks()) {
+ *     ...
+ * }
+ * ```
+ *
+ * The \c generator expression is evaluated only once and the generator is kept alive
+ * until the loop finishes. Can only be used inside a coroutine.
+ */
+#define QCORO_FOREACH(var, generator)                                                              \
+    if (auto &&_qcoro_generator = (generator); false) {                                            \
+    } else                                                                                         \
+        for (auto _qcoro_it = co_await _qcoro_generator.begin(),                                   \
+                  _qcoro_end = _qcoro_generator.end();                                             \
+             _qcoro_it != _qcoro_end; co_await ++_qcoro_it)                                        \
+            if (var = *_qcoro_it; false) {                                                         \
+            } else
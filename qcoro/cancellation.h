@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/cancellable.h"
+#include "impl/resume.h"
+#include "impl/when.h"
+#include "macros.h"
+#include "task.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! Wraps a cancellable awaiter and cancels it when a stop is requested on the token.
+template<CancellableAwaiter Awaiter>
+class CancellationAwaiter final {
+    using Result = when_result_t<Awaiter>;
+
+    struct OnStopRequested {
+        CancellationAwaiter *awaiter;
+        void operator()() noexcept {
+            awaiter->stopRequested();
+        }
+    };
+
+public:
+    CancellationAwaiter(Awaiter &&awaiter, std::stop_token token)
+        : mAwaiter(std::move(awaiter)), mToken(std::move(token)) {}
+    Q_DISABLE_COPY(CancellationAwaiter)
+
+    //! The stop callback is only registered while suspended, so moving doesn't move it.
+    CancellationAwaiter(CancellationAwaiter &&other) noexcept
+        : mAwaiter(std::move(other.mAwaiter)), mToken(std::move(other.mToken)) {}
+    CancellationAwaiter &operator=(CancellationAwaiter &&) = delete;
+
+    ~CancellationAwaiter() = default;
+
+    bool await_ready() {
+        mCancelled = mToken.stop_requested();
+        return mCancelled || mAwaiter.await_ready();
+    }
+
+    template<typename Promise>
+    auto await_suspend(QCORO_STD::coroutine_handle<Promise> awaitingCoroutine) {
+        mAwaitingCoroutine = awaitingCoroutine;
+
+        using SuspendResult = decltype(mAwaiter.await_suspend(awaitingCoroutine));
+        if constexpr (std::is_void_v<SuspendResult>) {
+            mAwaiter.await_suspend(awaitingCoroutine);
+            mStopCallback.emplace(mToken, OnStopRequested{this});
+        } else if constexpr (std::is_same_v<SuspendResult, bool>) {
+            const bool suspended = mAwaiter.await_suspend(awaitingCoroutine);
+            if (suspended) {
+                mStopCallback.emplace(mToken, OnStopRequested{this});
+            }
+            return suspended;
+        } else {
+            QCORO_STD::coroutine_handle<> next = mAwaiter.await_suspend(awaitingCoroutine);
+            if (next != awaitingCoroutine) {
+                mStopCallback.emplace(mToken, OnStopRequested{this});
+            }
+            return next;
+        }
+    }
+
+    std::optional<Result> await_resume() {
+        mStopCallback.reset();
+        if (mCancelled) {
+            return std::nullopt;
+        }
+        if constexpr (std::is_void_v<awaitable_result_t<Awaiter>>) {
+            mAwaiter.await_resume();
+            return Result{};
+        } else {
+            return mAwaiter.await_resume();
+        }
+    }
+
+private:
+    void stopRequested() {
+        // If cancelling fails, the operation has just finished and resumes the coroutine itself.
+        if (mAwaiter.cancel()) {
+            mCancelled = true;
+            resumeQueued(mReadyNode, mAwaitingCoroutine);
+        }
+    }
+
+    Awaiter mAwaiter;
+    std::stop_token mToken;
+    std::optional<std::stop_callback<OnStopRequested>> mStopCallback;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
+    bool mCancelled = false;
+};
+
+//! State shared between withCancellationImpl() and the coroutine awaiting the awaitable.
+template<typename Result>
+struct CancellationState {
+    std::atomic<bool> finished{false};
+    std::optional<Result> result;
+    std::exception_ptr exception;
+    WhenLatch latch{1};
+};
+
+template<typename T, typename Result>
+Task<> withCancellationHelper(T awaitable, std::shared_ptr<CancellationState<Result>> state) {
+    std::optional<Result> value;
+    std::exception_ptr exception;
+    try {
+        co_await awaitInto<T>(std::forward<T>(awaitable), value);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    if (state->finished.exchange(true, std::memory_order_acq_rel)) {
+        co_return;
+    }
+    state->result = std::move(value);
+    state->exception = exception;
+    state->latch.countDown();
+}
+
+//! Stops waiting for the \c awaitable when a stop is requested, for awaitables that cannot be
+//! cancelled.
+template<typename T>
+Task<std::optional<when_result_t<T>>> withCancellationImpl(T awaitable, std::stop_token token) {
+    using Result = when_result_t<T>;
+    auto state = std::make_shared<CancellationState<Result>>();
+    if (token.stop_requested()) {
+        co_return std::nullopt;
+    }
+
+    withCancellationHelper<T>(std::forward<T>(awaitable), state);
+    {
+        std::stop_callback onStopRequested{token, [state]() {
+            if (!state->finished.exchange(true, std::memory_order_acq_rel)) {
+                state->latch.countDown();
+            }
+        }};
+        co_await state->latch.wait();
+    }
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+    co_return std::move(state->result);
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Waits for the \c awaitable to finish, unless a stop is requested on the \c token first.
+/*!
+ * ```cpp
+ * QCoro::Task<> Handler::handle(QLocalSocket *client, std::stop_token token) {
+ *     const auto request = co_await QCoro::withCancellation(qCoro(client).readAll(), token);
+ *     if (!request) {
+ *         co_return; // cancelled
+ *     }
+ *     ...
+ * }
+ * ```
+ *
+ * The \c awaitable can be anything that can be co_awaited from a QCoro coroutine.
+ *
+ * Operations of the QCoro wrappers for Qt types (IO operations, waitFor* operations, awaiting
+ * a signal, a QTimer, a pending DBus call or QCoro::sleepFor()) are cancelled as soon as the
+ * stop is requested: they disconnect from all signals and the awaiting coroutine is resumed
+ * from the event loop. Other awaitables (e.g. a Task<T>) cannot be cancelled, so the awaiting
+ * coroutine is resumed right away while they keep running and their result is discarded. In
+ * that case l-value arguments must stay alive until they finish.
+ *
+ * The stop must be requested from the thread in which the awaiting coroutine runs.
+ *
+ * \return The result of the \c awaitable, or an empty optional if the operation has been
+ * cancelled. Awaitables with \c void result are represented by \c std::monostate. Exceptions
+ * thrown by the \c awaitable are rethrown.
+ */
+template<detail::TaskAwaitable T>
+auto withCancellation(T &&awaitable, std::stop_token token) {
+    if constexpr (!std::is_lvalue_reference_v<T> &&
+                  detail::CancellableAwaiter<std::remove_cvref_t<T>>) {
+        return detail::CancellationAwaiter<std::remove_cvref_t<T>>{std::move(awaitable),
+                                                                   std::move(token)};
+    } else if constexpr (detail::HasCancellableAwaiter<T>) {
+        using Awaiter = detail::awaiter_type_t<std::remove_cvref_t<T>>;
+        return detail::CancellationAwaiter<Awaiter>{Awaiter{awaitable}, std::move(token)};
+    } else {
+        return detail::withCancellationImpl<detail::when_argument_t<T>>(
+            std::forward<T>(awaitable), std::move(token));
+    }
+}
+
+} // namespace QCoro
@@ -0,0 +1,359 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/waitqueue.h"
+#include "macros.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace QCoro {
+
+template<typename T>
+class Channel;
+
+/*! \cond internal */
+
+namespace detail {
+
+//! A coroutine waiting to send a value into or to receive a value from a Channel.
+template<typename T>
+struct ChannelWaiter : SyncWaiter {
+    //! The value to send, or the received value.
+    std::optional<T> value;
+    //! Whether the value has been sent.
+    bool sent = false;
+};
+
+//! Base class for the awaiters of Channel operations.
+/*!
+ * The operation is attempted in await_suspend(), so it's done with a single lock of the
+ * channel, and the coroutine only suspends if the operation can't be completed right away.
+ */
+template<typename T>
+class ChannelAwaiterBase {
+public:
+    Q_DISABLE_COPY(ChannelAwaiterBase)
+
+    //! The waiter is only linked while suspended, so moving the awaiter doesn't move it.
+    ChannelAwaiterBase(ChannelAwaiterBase &&other) noexcept : mChannel(other.mChannel) {
+        mWaiter.value = std::move(other.mWaiter.value);
+    }
+    ChannelAwaiterBase &operator=(ChannelAwaiterBase &&) = delete;
+
+    ~ChannelAwaiterBase() {
+        cancel();
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    //! Stops waiting for the channel.
+    /*!
+     * \return Whether the awaiter has been removed from the channel's queue before the
+     * operation has completed. If so, the coroutine will not be resumed by the channel and a
+     * value that was being sent is not sent.
+     */
+    bool cancel() noexcept {
+        return mQueued && mChannel->dequeue(&mWaiter);
+    }
+
+protected:
+    explicit ChannelAwaiterBase(Channel<T> *channel) : mChannel(channel) {}
+
+    template<typename Operation>
+    bool suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine, Operation operation) {
+        mWaiter.coroutine = awaitingCoroutine;
+        mWaiter.thread = QThread::currentThread();
+        // The coroutine may be resumed from another thread before the operation returns,
+        // so `this` must not be touched anymore once the waiter is queued.
+        mQueued = true;
+        if (!(mChannel->*operation)(&mWaiter)) {
+            mQueued = false;
+            return false;
+        }
+        return true;
+    }
+
+    Channel<T> *mChannel;
+    ChannelWaiter<T> mWaiter;
+    bool mQueued = false;
+};
+
+} // namespace detail
+
+/*! \endcond */
+
+//! A bounded queue for passing values between coroutines, possibly running in different threads.
+/*!
+ * The channel holds at most \c capacity values in a ring buffer that is allocated once when
+ * the channel is created, so sending values through the channel doesn't allocate. Coroutines
+ * co_awaiting send() are suspended while the channel is full, coroutines co_awaiting receive()
+ * are suspended while the channel is empty. This provides back-pressure: a fast producer is
+ * slowed down to the pace of the consumers.
+ *
+ * ```cpp
+ * QCoro::Channel<QByteArray> messages{16};
+ *
+ * QCoro::Task<> reader(QTcpSocket *socket) {
+ *     while (socket->isOpen()) {
+ *         co_await messages.send(co_await qCoro(socket).readAll());
+ *     }
+ *     messages.close();
+ * }
+ *
+ * QCoro::Task<> worker() {
+ *     while (const auto message = co_await messages.receive()) {
+ *         process(*message);
+ *     }
+ * }
+ * ```
+ *
+ * Any number of coroutines can send and receive values, each of them is resumed in the
+ * thread in which it has co_awaited the operation. Waiting coroutines are served in the
+ * order in which they started waiting.
+ */
+template<typename T>
+class Channel {
+public:
+    //! Constructs a channel that can hold up to \c capacity values (at least one).
+    explicit Channel(std::size_t capacity) : mBuffer(std::max<std::size_t>(capacity, 1)) {}
+    Q_DISABLE_COPY(Channel)
+
+    ~Channel() {
+        Q_ASSERT(mSenders.isEmpty() && mReceivers.isEmpty());
+    }
+
+    //! Returns an Awaitable that sends the \c value into the channel.
+    /*!
+     * The awaiting coroutine is suspended while the channel is full. The Awaitable returns
+     * \c true when the value has been sent, or \c false when the channel has been closed.
+     */
+    auto send(T value) {
+        class SendAwaiter : public detail::ChannelAwaiterBase<T> {
+        public:
+            SendAwaiter(Channel *channel, T &&value) : detail::ChannelAwaiterBase<T>(channel) {
+                this->mWaiter.value.emplace(std::move(value));
+            }
+
+            bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+                return this->suspend(awaitingCoroutine, &Channel::enqueueSender);
+            }
+
+            bool await_resume() const noexcept {
+                return this->mWaiter.sent;
+            }
+        };
+        return SendAwaiter{this, std::move(value)};
+    }
+
+    //! Returns an Awaitable that receives a value from the channel.
+    /*!
+     * The awaiting coroutine is suspended while the channel is empty. The Awaitable returns
+     * the oldest value in the channel, or an empty optional when the channel has been closed
+     * and all the values sent before it was closed have been received.
+     */
+    auto receive() {
+        class ReceiveAwaiter : public detail::ChannelAwaiterBase<T> {
+        public:
+            explicit ReceiveAwaiter(Channel *channel) : detail::ChannelAwaiterBase<T>(channel) {}
+
+            bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+                return this->suspend(awaitingCoroutine, &Channel::enqueueReceiver);
+            }
+
+            std::optional<T> await_resume() {
+                return std::move(this->mWaiter.value);
+            }
+        };
+        return ReceiveAwaiter{this};
+    }
+
+    //! Sends the \c value if there's space in the channel, without waiting.
+    /*!
+     * The \c value is only moved from if it has been sent.
+     *
+     * \return Whether the value has been sent.
+     */
+    bool trySend(T &&value) {
+        std::unique_lock lock{mLock};
+        if (mClosed) {
+            return false;
+        }
+        if (auto *receiver = popWaiter(mReceivers)) {
+            receiver->value.emplace(std::move(value));
+            lock.unlock();
+            detail::resumeWaiter(receiver);
+            return true;
+        }
+        if (mSize == mBuffer.size()) {
+            return false;
+        }
+        push(std::move(value));
+        return true;
+    }
+
+    //! Receives a value if the channel is not empty, without waiting.
+    std::optional<T> tryReceive() {
+        std::unique_lock lock{mLock};
+        if (mSize == 0) {
+            return std::nullopt;
+        }
+        std::optional<T> value = pop();
+        auto *sender = refill();
+        lock.unlock();
+        if (sender) {
+            detail::resumeWaiter(sender);
+        }
+        return value;
+    }
+
+    //! Closes the channel.
+    /*!
+     * Values can no longer be sent into a closed channel, pending and future sends return
+     * \c false. Values that have already been sent can still be received, once the channel
+     * is empty pending and future receives return an empty optional.
+     */
+    void close() {
+        detail::SyncWaiter *ready = nullptr;
+        detail::SyncWaiter *readyTail = nullptr;
+        {
+            std::lock_guard guard{mLock};
+            mClosed = true;
+            // Popped waiters can't be cancelled anymore, they are chained through their
+            // `next` pointer until they are resumed.
+            for (auto *queue : {&mSenders, &mReceivers}) {
+                while (auto *waiter = queue->pop()) {
+                    if (readyTail) {
+                        readyTail->next = waiter;
+                    } else {
+                        ready = waiter;
+                    }
+                    readyTail = waiter;
+                }
+            }
+        }
+        detail::resumeWaiters(ready);
+    }
+
+    //! Returns whether the channel has been closed.
+    bool isClosed() const noexcept {
+        std::lock_guard guard{mLock};
+        return mClosed;
+    }
+
+    //! Returns the number of values in the channel.
+    std::size_t size() const noexcept {
+        std::lock_guard guard{mLock};
+        return mSize;
+    }
+
+    //! Returns the maximum number of values the channel can hold.
+    std::size_t capacity() const noexcept {
+        return mBuffer.size();
+    }
+
+private:
+    friend class detail::ChannelAwaiterBase<T>;
+    using Waiter = detail::ChannelWaiter<T>;
+
+    //! Sends the value of the \c sender, or queues the sender if the channel is full.
+    bool enqueueSender(Waiter *sender) {
+        std::unique_lock lock{mLock};
+        if (mClosed) {
+            return false;
+        }
+        if (auto *receiver = popWaiter(mReceivers)) {
+            receiver->value = std::move(sender->value);
+            sender->sent = true;
+            lock.unlock();
+            detail::resumeWaiter(receiver);
+            return false;
+        }
+        if (mSize < mBuffer.size()) {
+            push(std::move(*sender->value));
+            sender->sent = true;
+            return false;
+        }
+        mSenders.push(sender);
+        return true;
+    }
+
+    //! Receives a value for the \c receiver, or queues the receiver if the channel is empty.
+    bool enqueueReceiver(Waiter *receiver) {
+        std::unique_lock lock{mLock};
+        if (mSize > 0) {
+            receiver->value = pop();
+            auto *sender = refill();
+            lock.unlock();
+            if (sender) {
+                detail::resumeWaiter(sender);
+            }
+            return false;
+        }
+        if (mClosed) {
+            return false;
+        }
+        mReceivers.push(receiver);
+        return true;
+    }
+
+    bool dequeue(Waiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (!waiter->linked) {
+            return false;
+        }
+        (waiter->value.has_value() ? mSenders : mReceivers).remove(waiter);
+        return true;
+    }
+
+    static Waiter *popWaiter(detail::WaitQueue &queue) noexcept {
+        return static_cast<Waiter *>(queue.pop());
+    }
+
+    //! Moves the value of the longest waiting sender into the buffer.
+    /*!
+     * \return The sender to resume once the lock is released, if any.
+     */
+    Waiter *refill() {
+        auto *sender = popWaiter(mSenders);
+        if (sender) {
+            push(std::move(*sender->value));
+            sender->sent = true;
+        }
+        return sender;
+    }
+
+    void push(T &&value) {
+        mBuffer[(mHead + mSize) % mBuffer.size()].emplace(std::move(value));
+        ++mSize;
+    }
+
+    std::optional<T> pop() {
+        auto &slot = mBuffer[mHead];
+        std::optional<T> value = std::move(slot);
+        slot.reset();
+        mHead = (mHead + 1) % mBuffer.size();
+        --mSize;
+        return value;
+    }
+
+    mutable std::mutex mLock;
+    std::vector<std::optional<T>> mBuffer;
+    std::size_t mHead = 0;
+    std::size_t mSize = 0;
+    detail::WaitQueue mSenders;
+    detail::WaitQueue mReceivers;
+    bool mClosed = false;
+};
+
+} // namespace QCoro
@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/when.h"
+#include "task.h"
+#include "whenall.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! State shared by the workers of forEachConcurrent() and mapConcurrent().
+template<typename Iterator, typename Sentinel>
+struct ConcurrentState {
+    ConcurrentState(Iterator first, Sentinel last) : next(std::move(first)), end(std::move(last)) {}
+
+    Iterator next;
+    Sentinel end;
+    std::size_t index = 0;
+    std::exception_ptr exception;
+};
+
+//! Used by forEachConcurrent() in place of the result vector.
+struct DiscardResults {};
+
+//! Type of the awaitable returned by \c Fn for elements of the \c Range.
+template<typename Range, typename Fn>
+using concurrent_awaitable_t = std::invoke_result_t<Fn &, std::ranges::range_reference_t<Range>>;
+
+//! Stores the \c value as the result of an operation.
+template<typename Result, typename Value>
+void storeResult(Result &result, Value &&value) {
+    result = std::forward<Value>(value);
+}
+
+template<typename Result, typename Value>
+void storeResult(std::optional<Result> &result, Value &&value) {
+    result.emplace(std::forward<Value>(value));
+}
+
+//! A worker that keeps taking the next element of the range until there are none left.
+/*!
+ * Each worker has at most one operation in flight, so running \c limit workers keeps
+ * exactly \c limit operations running, until the range is exhausted. Once any operation
+ * throws, no new operations are started.
+ */
+template<typename State, typename Fn, typename Results>
+Task<> concurrentWorker(State &state, Fn &fn, Results &results) {
+    while (!state.exception && state.next != state.end) {
+        const std::size_t index = state.index++;
+        auto &&element = *state.next;
+        ++state.next;
+
+        try {
+            using Awaitable = std::invoke_result_t<Fn &, decltype(element)>;
+            if constexpr (std::is_same_v<Results, DiscardResults> ||
+                          std::is_void_v<awaitable_result_t<Awaitable>>) {
+                // Results of void operations are the default-constructed std::monostate
+                co_await std::invoke(fn, std::forward<decltype(element)>(element));
+            } else {
+                storeResult(results[index],
+                            co_await std::invoke(fn, std::forward<decltype(element)>(element)));
+            }
+        } catch (...) {
+            if (!state.exception) {
+                state.exception = std::current_exception();
+            }
+        }
+    }
+}
+
+template<typename Range, typename Fn, typename Results>
+Task<> runConcurrently(Range &range, std::size_t limit, Fn &fn, Results &results) {
+    ConcurrentState<std::ranges::iterator_t<Range>, std::ranges::sentinel_t<Range>> state{
+        std::ranges::begin(range), std::ranges::end(range)};
+
+    std::vector<Task<>> workers;
+    workers.reserve(std::max<std::size_t>(limit, 1));
+    for (std::size_t i = 0; i < std::max<std::size_t>(limit, 1); ++i) {
+        if (state.next == state.end || state.exception) {
+            break;
+        }
+        workers.push_back(concurrentWorker(state, fn, results));
+    }
+    co_await whenAll(std::move(workers));
+
+    if (state.exception) {
+        std::rethrow_exception(state.exception);
+    }
+}
+
+//! Implementation of forEachConcurrent().
+/*!
+ * \c Range is an lvalue reference for lvalue ranges, rvalue ranges are moved into the
+ * coroutine frame, so they stay alive for as long as the operations are running.
+ */
+template<typename Range, typename Fn>
+Task<> forEachConcurrentImpl(Range range, std::size_t limit, Fn fn) {
+    DiscardResults results;
+    co_await runConcurrently(range, limit, fn, results);
+}
+
+//! Implementation of mapConcurrent(), \c Range is the same as for forEachConcurrentImpl().
+template<typename Range, typename Fn>
+Task<std::vector<when_result_t<concurrent_awaitable_t<Range, Fn>>>>
+mapConcurrentImpl(Range range, std::size_t limit, Fn fn) {
+    using Result = when_result_t<concurrent_awaitable_t<Range, Fn>>;
+    const auto size = static_cast<std::size_t>(std::ranges::distance(range));
+
+    if constexpr (std::is_default_constructible_v<Result>) {
+        std::vector<Result> results(size);
+        co_await runConcurrently(range, limit, fn, results);
+        co_return results;
+    } else {
+        // There's no placeholder for the results that haven't been produced yet
+        std::vector<std::optional<Result>> results(size);
+        co_await runConcurrently(range, limit, fn, results);
+
+        std::vector<Result> values;
+        values.reserve(results.size());
+        for (auto &result : results) {
+            values.push_back(std::move(*result));
+        }
+        co_return values;
+    }
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Runs \c fn for each element of the \c range, with at most \c limit operations at a time.
+/*!
+ * The \c fn is called with each element of the \c range and must return something that can
+ * be co_awaited, typically a Task. At most \c limit of the returned awaitables run at the
+ * same time: the elements are processed in order and as soon as one of the operations
+ * finishes, the next one is started.
+ *
+ * ```cpp
+ * QCoro::Task<> downloadAll(QNetworkAccessManager &nam, const QList<QUrl> &urls) {
+ *     co_await QCoro::forEachConcurrent(urls, 64, [&nam](const QUrl &url) -> QCoro::Task<> {
+ *         auto *reply = co_await nam.get(QNetworkRequest{url});
+ *         store(url, reply->readAll());
+ *         reply->deleteLater();
+ *     });
+ * }
+ * ```
+ *
+ * A \c range passed as an lvalue must stay alive until the returned Task finishes, a temporary
+ * range is moved into the Task. The operations must resume in the thread in which
+ * forEachConcurrent() is co_awaited.
+ *
+ * If any of the operations throws an exception, no new operations are started and the first
+ * exception thrown is rethrown once all the running operations have finished.
+ */
+template<std::ranges::forward_range Range, typename Fn>
+    requires detail::TaskAwaitable<detail::concurrent_awaitable_t<Range, Fn>>
+Task<> forEachConcurrent(Range &&range, std::size_t limit, Fn fn) {
+    return detail::forEachConcurrentImpl<Range>(std::forward<Range>(range), limit, std::move(fn));
+}
+
+//! Maps each element of the \c range with \c fn, with at most \c limit operations at a time.
+/*!
+ * Same as forEachConcurrent(), but the results of the operations are collected into a vector,
+ * in the order of the elements of the \c range (rather than in the order in which the
+ * operations have finished). The vector is allocated upfront and, unless the result type is not
+ * default-constructible, the results are stored directly into it.
+ *
+ * ```cpp
+ * const std::vector<QByteArray> pages = co_await QCoro::mapConcurrent(
+ *     urls, 64, [&nam](const QUrl &url) { return download(nam, url); });
+ * ```
+ *
+ * Operations with \c void result are represented by \c std::monostate.
+ */
+template<std::ranges::forward_range Range, typename Fn>
+    requires detail::TaskAwaitable<detail::concurrent_awaitable_t<Range, Fn>>
+Task<std::vector<detail::when_result_t<detail::concurrent_awaitable_t<Range, Fn>>>>
+mapConcurrent(Range &&range, std::size_t limit, Fn fn) {
+    return detail::mapConcurrentImpl<Range>(std::forward<Range>(range), limit, std::move(fn));
+}
+
+} // namespace QCoro
@@ -0,0 +1,272 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coro.h"
+#include "impl/resourcepool.h"
+#include "task.h"
+
+#include <QAbstractSocket>
+#include <QLocalSocket>
+#include <QString>
+#include <QTcpSocket>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace QCoro {
+
+class ConnectionPool;
+
+//! A connection acquired from a ConnectionPool.
+/*!
+ * The connection is returned to the pool when the handle is destroyed or when release() is
+ * called, unless it has been discarded or the socket is no longer connected. A
+ * default-constructed handle, or one returned by ConnectionPool::acquire() or
+ * ConnectionPool::acquireLocal() when the connection couldn't be established, holds no socket.
+ *
+ * Use discard() when the connection is left in an unknown state, e.g. after a request has been
+ * interrupted in the middle, so that it's closed instead of being returned to the pool.
+ */
+template<typename Socket>
+class BasicPooledConnection : public detail::PooledResource<Socket> {
+public:
+    //! Constructs an invalid connection.
+    BasicPooledConnection() noexcept = default;
+
+    //! Returns the connected socket, or \c nullptr if the connection is not valid.
+    Socket *socket() const noexcept {
+        return this->get();
+    }
+
+    Socket *operator->() const noexcept {
+        return this->get();
+    }
+
+private:
+    friend class ConnectionPool;
+
+    explicit BasicPooledConnection(detail::PooledResource<Socket> &&connection) noexcept
+        : detail::PooledResource<Socket>(std::move(connection)) {}
+};
+
+//! A network connection acquired with ConnectionPool::acquire().
+using PooledConnection = BasicPooledConnection<QAbstractSocket>;
+//! A local connection acquired with ConnectionPool::acquireLocal().
+using PooledLocalConnection = BasicPooledConnection<QLocalSocket>;
+
+//! A pool of connected sockets, keyed by host, port and network protocol or by local server name.
+/*!
+ * Establishing a connection costs at least one round trip to the server (more with TLS).
+ * The pool keeps the connections that are no longer used open for a while and hands them
+ * out again to the next caller that wants to talk to the same host:
+ *
+ * ```cpp
+ * QCoro::ConnectionPool pool;
+ *
+ * QCoro::Task<QByteArray> Client::call(const QByteArray &request) {
+ *     auto connection = co_await pool.acquire(QStringLiteral("backend"), 7000);
+ *     if (!connection) {
+ *         co_return {};
+ *     }
+ *     co_await qCoro(connection.socket()).write(request);
+ *     co_return co_await qCoro(connection.socket()).readAll();
+ * } // the connection returns to the pool when it goes out of scope
+ * ```
+ *
+ * At most maxConnectionsPerHost() connections to the same host are open at the same time,
+ * acquire() waits until a connection is released when the limit has been reached. Idle
+ * connections are closed after idleTimeout(). A connection that has been closed by the server,
+ * or that has unread data when it's released, is not reused.
+ *
+ * Connections to local servers (QLocalServer) are acquired with acquireLocal() and are pooled
+ * in the same way, keyed by the server name. Each server name counts as a separate host.
+ *
+ * The pool and its connections must only be used from the thread in which the pool has been
+ * created, and the pool must outlive all the connections acquired from it.
+ */
+class ConnectionPool {
+public:
+    //! Creates a socket for a new connection.
+    using SocketFactory = std::function<std::unique_ptr<QAbstractSocket>()>;
+    //! Creates a socket for a new local connection.
+    using LocalSocketFactory = std::function<std::unique_ptr<QLocalSocket>()>;
+
+    //! Constructs a pool that creates QTcpSocket connections.
+    ConnectionPool() = default;
+    Q_DISABLE_COPY(ConnectionPool)
+
+    //! Returns the maximum number of connections to a single host, 8 by default.
+    std::size_t maxConnectionsPerHost() const noexcept {
+        return mMaxConnectionsPerHost;
+    }
+
+    //! Sets the maximum number of connections to a single host.
+    /*!
+     * Only applies to hosts to which the pool hasn't connected yet.
+     */
+    void setMaxConnectionsPerHost(std::size_t maxConnections) noexcept {
+        mMaxConnectionsPerHost = std::max<std::size_t>(maxConnections, 1);
+    }
+
+    //! Returns how long an idle connection is kept open, 60 seconds by default.
+    std::chrono::milliseconds idleTimeout() const noexcept {
+        return mIdleTimeout;
+    }
+
+    //! Sets how long an idle connection is kept open. A negative timeout keeps it forever.
+    void setIdleTimeout(std::chrono::milliseconds timeout) noexcept {
+        mIdleTimeout = timeout;
+    }
+
+    //! Returns how long acquire() waits for a new connection to be established.
+    std::chrono::milliseconds connectTimeout() const noexcept {
+        return mConnectTimeout;
+    }
+
+    //! Sets how long acquire() waits for a new connection to be established, 30 seconds by default.
+    void setConnectTimeout(std::chrono::milliseconds timeout) noexcept {
+        mConnectTimeout = timeout;
+    }
+
+    //! Sets the function that creates sockets for new connections.
+    /*!
+     * Can be used to configure the sockets, e.g. to set socket options or a proxy.
+     */
+    void setSocketFactory(SocketFactory factory) {
+        mSocketFactory = std::move(factory);
+    }
+
+    //! Sets the function that creates sockets for new local connections.
+    void setLocalSocketFactory(LocalSocketFactory factory) {
+        mLocalSocketFactory = std::move(factory);
+    }
+
+    //! Acquires a connection to the \c host and \c port.
+    /*!
+     * Returns an idle connection to the host, if there's one, or establishes a new connection.
+     * If maxConnectionsPerHost() connections to the host are already in use, waits until one
+     * of them is released. The returned connection is invalid if a new connection couldn't be
+     * established within connectTimeout().
+     */
+    Task<PooledConnection>
+    acquire(QString host, quint16 port,
+            QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::AnyIPProtocol) {
+        auto *endpoint = this->endpoint(host, port, protocol);
+        co_await endpoint->acquirePermit();
+
+        if (auto socket = endpoint->takeIdle()) {
+            co_return PooledConnection{endpoint->hand(std::move(socket))};
+        }
+
+        auto socket = mSocketFactory ? mSocketFactory() : std::make_unique<QTcpSocket>();
+        socket->connectToHost(host, port, QIODevice::ReadWrite, protocol);
+        if (!co_await qCoro(socket.get()).waitForConnected(mConnectTimeout) ||
+            socket->state() != QAbstractSocket::ConnectedState) {
+            detail::discardLater(std::move(socket));
+            endpoint->releasePermit();
+            co_return PooledConnection{};
+        }
+
+        co_return PooledConnection{endpoint->hand(std::move(socket))};
+    }
+
+    //! Acquires a connection to the local server called \c serverName.
+    /*!
+     * Like acquire(), but connects a QLocalSocket to the QLocalServer listening on
+     * \c serverName. At most maxConnectionsPerHost() connections to the same server are in use
+     * at the same time.
+     */
+    Task<PooledLocalConnection> acquireLocal(QString serverName) {
+        auto *endpoint = this->endpoint(mLocalEndpoints, serverName);
+        co_await endpoint->acquirePermit();
+
+        if (auto socket = endpoint->takeIdle()) {
+            co_return PooledLocalConnection{endpoint->hand(std::move(socket))};
+        }
+
+        auto socket =
+            mLocalSocketFactory ? mLocalSocketFactory() : std::make_unique<QLocalSocket>();
+        socket->connectToServer(serverName);
+        if (!co_await qCoro(socket.get()).waitForConnected(mConnectTimeout) ||
+            socket->state() != QLocalSocket::ConnectedState) {
+            detail::discardLater(std::move(socket));
+            endpoint->releasePermit();
+            co_return PooledLocalConnection{};
+        }
+
+        co_return PooledLocalConnection{endpoint->hand(std::move(socket))};
+    }
+
+    //! Returns the number of idle connections in the pool.
+    std::size_t idleCount() const noexcept {
+        return count(mEndpoints, &Endpoint::idleCount) +
+               count(mLocalEndpoints, &LocalEndpoint::idleCount);
+    }
+
+    //! Returns the number of acquired connections that haven't been released yet.
+    std::size_t activeCount() const noexcept {
+        return count(mEndpoints, &Endpoint::activeCount) +
+               count(mLocalEndpoints, &LocalEndpoint::activeCount);
+    }
+
+private:
+    using Endpoint = detail::ResourcePool<QAbstractSocket>;
+    using LocalEndpoint = detail::ResourcePool<QLocalSocket>;
+    using Key = std::tuple<QString, quint16, QAbstractSocket::NetworkLayerProtocol>;
+
+    Endpoint *endpoint(const QString &host, quint16 port,
+                       QAbstractSocket::NetworkLayerProtocol protocol) {
+        return endpoint(mEndpoints, Key{host, port, protocol});
+    }
+
+    template<typename EndpointKey, typename Socket>
+    detail::ResourcePool<Socket> *
+    endpoint(std::map<EndpointKey, std::unique_ptr<detail::ResourcePool<Socket>>> &endpoints,
+             const EndpointKey &key) {
+        auto &endpoint = endpoints[key];
+        if (!endpoint) {
+            using ReusableFn = typename detail::ResourcePool<Socket>::ReusableFn;
+            endpoint = std::make_unique<detail::ResourcePool<Socket>>(
+                mMaxConnectionsPerHost, mIdleTimeout, ReusableFn{&ConnectionPool::isReusable});
+        }
+        return endpoint.get();
+    }
+
+    template<typename Endpoints, typename Count>
+    static std::size_t count(const Endpoints &endpoints, Count count) {
+        std::size_t total = 0;
+        for (const auto &[key, endpoint] : endpoints) {
+            total += ((*endpoint).*count)();
+        }
+        return total;
+    }
+
+    //! A connection can only be reused when it's connected and no data is expected from it.
+    static bool isReusable(const QAbstractSocket &socket) {
+        return socket.state() == QAbstractSocket::ConnectedState && socket.bytesAvailable() == 0;
+    }
+
+    static bool isReusable(const QLocalSocket &socket) {
+        return socket.state() == QLocalSocket::ConnectedState && socket.bytesAvailable() == 0;
+    }
+
+    // Declared before the endpoints, which reference it
+    std::chrono::milliseconds mIdleTimeout = std::chrono::seconds{60};
+    std::map<Key, std::unique_ptr<Endpoint>> mEndpoints;
+    std::map<QString, std::unique_ptr<LocalEndpoint>> mLocalEndpoints;
+    SocketFactory mSocketFactory;
+    LocalSocketFactory mLocalSocketFactory;
+    std::size_t mMaxConnectionsPerHost = 8;
+    std::chrono::milliseconds mConnectTimeout = std::chrono::seconds{30};
+};
+
+} // namespace QCoro
@@ -6,24 +6,63 @@
 
 #include "qcoroabstractsocket.h"
 #include "qcoroiodevice.h"
+#include "qcorolocalserver.h"
 #include "qcorolocalsocket.h"
 #include "qcoronetworkreply.h"
 #include "qcoroprocess.h"
 #include "qcorosignal.h"
 #include "qcorotcpserver.h"
+#include "qcoroudpsocket.h"
 #include "task.h"
 
+#if QT_CONFIG(ssl)
+#include "qcorosslsocket.h"
+#endif
+
+#ifndef QCORO_SINGLE_THREADED
+#include "qcorofile.h"
+#endif
+
 //! Allows co_awaiting on signal emission.
 /*!
  * Returns an Awaitable object that allows co_awaiting for a signal to
  * be emitted. The result of the co_awaiting is a tuple with the signal
  * arguments.
  *
+ * By default the awaiting coroutine is resumed from the event loop after
+ * the signal emission. Passing \c Qt::AutoConnection as \c connectionType
+ * resumes the coroutine directly from the emission when the signal is emitted
+ * in the thread of \c obj, which avoids the event loop round-trip.
+ *
+ * @see docs/reference/coro.md
+ */
+template<QCoro::detail::concepts::QObject T, typename FuncPtr>
+inline auto qCoro(T *obj, FuncPtr &&ptr, Qt::ConnectionType connectionType = Qt::QueuedConnection) {
+    return QCoro::detail::QCoroSignal(obj, std::forward<FuncPtr>(ptr), connectionType);
+}
+
+//! Returns a generator that yields every emission of a signal.
+/*!
+ * Unlike \c qCoro(obj, signal), which connects to the signal for a single emission, the
+ * listener connects to the signal immediately and stays connected until the returned
+ * generator is destroyed. Emissions that occur while the consumer is not waiting for the
+ * next one are queued, so no emission is lost. At most \c queueSize emissions are queued,
+ * if the queue is full the oldest emission is dropped. The generator finishes when the
+ * \c obj is destroyed.
+ *
+ * The generator must be consumed in the thread in which qCoroSignalListener() is called.
+ * Emissions in that thread are queued right away, emissions from other threads are delivered
+ * through the event loop of the consumer's thread. Emissions that haven't been delivered yet
+ * when the generator is destroyed are dropped.
+ *
  * @see docs/reference/coro.md
  */
 template<QCoro::detail::concepts::QObject T, typename FuncPtr>
-inline auto qCoro(T *obj, FuncPtr &&ptr) {
-    return QCoro::detail::QCoroSignal(obj, std::forward<FuncPtr>(ptr));
+inline auto qCoroSignalListener(T *obj, FuncPtr &&ptr,
+                                std::size_t queueSize = std::numeric_limits<std::size_t>::max()) {
+    using Listener = QCoro::detail::QCoroSignalListener<T, std::remove_cvref_t<FuncPtr>>;
+    return QCoro::detail::signalListenerGenerator(
+        std::make_unique<Listener>(obj, std::forward<FuncPtr>(ptr), queueSize));
 }
 
 //! Returns a coroutine-friendly wrapper for QProcess object.
@@ -71,6 +110,38 @@ inline auto qCoro(QAbstractSocket *s) noexcept {
     return QCoro::detail::QCoroAbstractSocket{s};
 }
 
+//! Returns a coroutine-friendly wrapper for QUdpSocket object.
+/*!
+ * Returns a wrapper for the QUdpSocket \c s that provides coroutine-friendly
+ * way to co_await incoming datagrams.
+ *
+ * @see docs/reference/qudpsocket.md
+ */
+inline auto qCoro(QUdpSocket &s) noexcept {
+    return QCoro::detail::QCoroUdpSocket{&s};
+}
+//! \copydoc qCoro(QUdpSocket &s) noexcept
+inline auto qCoro(QUdpSocket *s) noexcept {
+    return QCoro::detail::QCoroUdpSocket{s};
+}
+
+#if QT_CONFIG(ssl)
+//! Returns a coroutine-friendly wrapper for QSslSocket object.
+/*!
+ * Returns a wrapper for the QSslSocket \c s that provides coroutine-friendly
+ * way to co_await the socket to connect, finish the TLS handshake and disconnect.
+ *
+ * @see docs/reference/qsslsocket.md
+ */
+inline auto qCoro(QSslSocket &s) noexcept {
+    return QCoro::detail::QCoroSslSocket{&s};
+}
+//! \copydoc qCoro(QSslSocket &s) noexcept
+inline auto qCoro(QSslSocket *s) noexcept {
+    return QCoro::detail::QCoroSslSocket{s};
+}
+#endif
+
 //! Returns a coroutine-friendly wrapper for QNetworkReply object.
 /*!
  * Returns a wrapper for the QNetworkReply \c s that provides coroutine-friendly
@@ -101,6 +172,23 @@ inline auto qCoro(QIODevice *d) noexcept {
     return QCoro::detail::QCoroIODevice{d};
 }
 
+#ifndef QCORO_SINGLE_THREADED
+//! Returns a coroutine-friendly wrapper for QFile object.
+/*!
+ * Returns a wrapper for QFile \c f that provides coroutine-friendly way of reading
+ * and writing the file without blocking the event loop.
+ *
+ * @see docs/reference/qfile.md
+ */
+inline auto qCoro(QFile &f) noexcept {
+    return QCoro::detail::QCoroFile{&f};
+}
+//! \copydoc qCoro(QFile &f) noexcept
+inline auto qCoro(QFile *f) noexcept {
+    return QCoro::detail::QCoroFile{f};
+}
+#endif
+
 //! Returns a coroutine-friendly wrapper for QTcpServer object.
 /*!
  * Returns a wrapper for QTcpServer \c s that provides coroutine-friendly way
@@ -116,3 +204,17 @@ inline auto qCoro(QTcpServer *s) noexcept {
     return QCoro::detail::QCoroTcpServer{s};
 }
 
+//! Returns a coroutine-friendly wrapper for QLocalServer object.
+/*!
+ * Returns a wrapper for QLocalServer \c s that provides coroutine-friendly way
+ * of co_awaiting new connections.
+ *
+ * @see docs/reference/qlocalserver.md
+ */
+inline auto qCoro(QLocalServer &s) noexcept {
+    return QCoro::detail::QCoroLocalServer{&s};
+}
+//! \copydoc qCoro(QLocalServer &s) noexcept
+inline auto qCoro(QLocalServer *s) noexcept {
+    return QCoro::detail::QCoroLocalServer{s};
+}
@@ -4,18 +4,87 @@
 
 #pragma once
 
+#include "impl/resume.h"
 #include "task.h"
 
+#include <QDBusConnection>
+#include <QDBusContext>
+#include <QDBusError>
 #include <QDBusMessage>
 #include <QDBusPendingCall>
 #include <QDBusPendingCallWatcher>
 #include <QDBusPendingReply>
 
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 /*! \cond internal */
 
 namespace QCoro::detail {
 
-class DBusPendingCallAwaiter {
+//! Base class for awaiters of pending DBus calls.
+/*!
+ * The QDBusPendingCallWatcher lives in the awaiter, which lives in the coroutine frame, and
+ * exists only while the coroutine is suspended, so awaiting a call doesn't allocate the
+ * watcher and doesn't need to deleteLater() it. The coroutine is always resumed from the
+ * ready queue, after the watcher has finished emitting its signal, because resuming the
+ * coroutine destroys the awaiter along with the watcher.
+ */
+class DBusPendingCallAwaiterBase {
+public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::DBus;
+    }
+
+    Q_DISABLE_COPY(DBusPendingCallAwaiterBase)
+
+    //! The watcher only exists while suspended, so moving an awaiter doesn't move the watcher.
+    DBusPendingCallAwaiterBase(DBusPendingCallAwaiterBase &&) noexcept {}
+    DBusPendingCallAwaiterBase &operator=(DBusPendingCallAwaiterBase &&) noexcept {
+        return *this;
+    }
+
+    ~DBusPendingCallAwaiterBase() {
+        cancel();
+    }
+
+    //! Stops waiting for the call to finish.
+    /*!
+     * \return Whether the awaiter has been cancelled before the call has finished. If so,
+     * the coroutine will not be resumed by the awaiter.
+     */
+    bool cancel() noexcept {
+        if (!mWatcher.has_value() || mFinished) {
+            return false;
+        }
+        mWatcher.reset();
+        return true;
+    }
+
+protected:
+    DBusPendingCallAwaiterBase() = default;
+
+    void watch(const QDBusPendingCall &call, QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mWatcher.emplace(call);
+        QObject::connect(&*mWatcher, &QDBusPendingCallWatcher::finished,
+                         [this, awaitingCoroutine]() {
+                             mFinished = true;
+                             resumeQueued(mReadyNode, awaitingCoroutine);
+                         });
+    }
+
+private:
+    std::optional<QDBusPendingCallWatcher> mWatcher;
+    ReadyNode mReadyNode;
+    bool mFinished = false;
+};
+
+class DBusPendingCallAwaiter final : public DBusPendingCallAwaiterBase {
 public:
     explicit DBusPendingCallAwaiter(const QDBusPendingCall &call) : mCall(call) {}
 
@@ -24,12 +93,7 @@ public:
     }
 
     void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-        auto *watcher = new QDBusPendingCallWatcher{mCall};
-        QObject::connect(watcher, &QDBusPendingCallWatcher::finished,
-                         [awaitingCoroutine](auto *watcher) mutable {
-                             awaitingCoroutine.resume();
-                             watcher->deleteLater();
-                         });
+        watch(mCall, awaitingCoroutine);
     }
 
     QDBusMessage await_resume() const {
@@ -42,7 +106,7 @@ private:
 };
 
 template<typename T = void>
-class DBusPendingReplyAwaiter {
+class DBusPendingReplyAwaiter final : public DBusPendingCallAwaiterBase {
 public:
     explicit DBusPendingReplyAwaiter(const QDBusPendingReply<T> &reply) : mReply(reply) {}
 
@@ -51,12 +115,7 @@ public:
     }
 
     void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-        auto *watcher = new QDBusPendingCallWatcher{mReply};
-        QObject::connect(watcher, &QDBusPendingCallWatcher::finished,
-                         [awaitingCoroutine](auto *watcher) mutable {
-                             awaitingCoroutine.resume();
-                             watcher->deleteLater();
-                         });
+        watch(mReply, awaitingCoroutine);
     }
 
     QDBusPendingReply<T> await_resume() const {
@@ -83,6 +142,178 @@ struct awaiter_type<QDBusPendingReply<>> {
     using type = DBusPendingReplyAwaiter<>;
 };
 
+//! Awaiter that waits for a group of pending DBus calls to finish.
+/*!
+ * QtDBus only reports a finished call through a QDBusPendingCallWatcher, so each pending call
+ * still needs its own watcher, but the watchers for all the calls are stored in a single vector
+ * that only exists while the coroutine is suspended, and the coroutine is resumed only once,
+ * after the last call has finished.
+ */
+template<typename Call>
+class DBusPendingCallsAwaiter {
+public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::DBus;
+    }
+
+    explicit DBusPendingCallsAwaiter(QList<Call> calls) : mCalls(std::move(calls)) {}
+    Q_DISABLE_COPY(DBusPendingCallsAwaiter)
+
+    //! The watchers only exist while suspended, so moving an awaiter doesn't move them.
+    DBusPendingCallsAwaiter(DBusPendingCallsAwaiter &&other) noexcept
+        : mCalls(std::move(other.mCalls)) {}
+    DBusPendingCallsAwaiter &operator=(DBusPendingCallsAwaiter &&) = delete;
+
+    ~DBusPendingCallsAwaiter() {
+        cancel();
+    }
+
+    bool await_ready() const noexcept {
+        return std::all_of(mCalls.cbegin(), mCalls.cend(),
+                           [](const auto &call) { return call.isFinished(); });
+    }
+
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mWatchers = std::vector<std::optional<QDBusPendingCallWatcher>>(
+            static_cast<std::size_t>(mCalls.size()));
+        auto watcher = mWatchers.begin();
+        for (const auto &call : std::as_const(mCalls)) {
+            if (!call.isFinished()) {
+                watcher->emplace(call);
+                QObject::connect(&**watcher, &QDBusPendingCallWatcher::finished,
+                                 [this, awaitingCoroutine]() {
+                                     if (--mPending == 0) {
+                                         resumeQueued(mReadyNode, awaitingCoroutine);
+                                     }
+                                 });
+                ++mPending;
+            }
+            ++watcher;
+        }
+        // All the calls may have finished since await_ready()
+        if (mPending == 0) {
+            mWatchers.clear();
+            return false;
+        }
+        return true;
+    }
+
+    QList<Call> await_resume() {
+        return std::move(mCalls);
+    }
+
+    //! Stops waiting for the calls to finish.
+    /*!
+     * \return Whether the awaiter has been cancelled before all the calls have finished.
+     * If so, the coroutine will not be resumed by the awaiter.
+     */
+    bool cancel() noexcept {
+        if (mWatchers.empty() || mPending == 0) {
+            return false;
+        }
+        mWatchers.clear();
+        return true;
+    }
+
+private:
+    QList<Call> mCalls;
+    std::vector<std::optional<QDBusPendingCallWatcher>> mWatchers;
+    std::size_t mPending = 0;
+    ReadyNode mReadyNode;
+};
+
 } // namespace QCoro::detail
 
 /*! \endcond */
+
+namespace QCoro {
+
+//! Returns an Awaitable that waits until all the pending DBus \c calls have finished.
+/*!
+ * Co_awaiting each of many small calls resumes the coroutine once per reply. This Awaitable
+ * resumes the awaiting coroutine only once, after all the \c calls have finished, and returns
+ * the finished calls, in the same order:
+ *
+ * ```cpp
+ * QList<QDBusPendingReply<QString>> calls;
+ * for (const auto &id : ids) {
+ *     calls.push_back(iface.asyncCall(QStringLiteral("name"), id));
+ * }
+ * const auto replies = co_await QCoro::waitForReplies(std::move(calls));
+ * ```
+ *
+ * The coroutine is not suspended at all if all the calls have already finished. The wait
+ * can be cancelled, e.g. by QCoro::withTimeout().
+ */
+template<typename Call>
+    requires std::is_base_of_v<QDBusPendingCall, Call>
+auto waitForReplies(QList<Call> calls) {
+    return detail::DBusPendingCallsAwaiter<Call>{std::move(calls)};
+}
+
+/*! \cond internal */
+
+namespace detail {
+
+//! Sends the result of the \c task, or the exception it has thrown, as the reply to \c message.
+template<typename T>
+Task<> sendDBusReply(QDBusConnection connection, QDBusMessage message, Task<T> task) {
+    QDBusMessage reply;
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+            reply = message.createReply();
+        } else {
+            reply = message.createReply(QVariant::fromValue(co_await std::move(task)));
+        }
+    } catch (const std::exception &e) {
+        reply = message.createErrorReply(QDBusError::Failed, QString::fromUtf8(e.what()));
+    } catch (...) {
+        reply = message.createErrorReply(QDBusError::Failed, QStringLiteral("Unknown error"));
+    }
+    connection.send(reply);
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Replies to the DBus call currently handled by the \c context once the \c task finishes.
+/*!
+ * Lets a slot exported on DBus be implemented as a coroutine, so that a slow call doesn't
+ * block the other callers served by the same thread. The slot hands the Task over to this
+ * function and returns its result right away:
+ *
+ * ```cpp
+ * class Service : public QObject, protected QDBusContext {
+ *     Q_OBJECT
+ * public Q_SLOTS:
+ *     QString lookup(const QString &key) {
+ *         return QCoro::delayedDBusReply(*this, lookupImpl(key));
+ *     }
+ *
+ * private:
+ *     QCoro::Task<QString> lookupImpl(QString key);
+ * };
+ * ```
+ *
+ * The reply to the call is delayed (see QDBusContext::setDelayedReply()) and it's sent when
+ * the \c task finishes, with the value returned by the \c task. If the \c task throws an
+ * exception, an error reply of type QDBusError::Failed is sent instead, with the exception's
+ * message.
+ *
+ * The returned value is a default-constructed \c T, which is ignored by QtDBus. When the slot
+ * has not been called through DBus, the \c task keeps running but its result is discarded.
+ */
+template<typename T>
+T delayedDBusReply(const QDBusContext &context, Task<T> task) {
+    if (context.calledFromDBus()) {
+        context.setDelayedReply(true);
+        detail::sendDBusReply(context.connection(), context.message(), std::move(task));
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return T{};
+    }
+}
+
+} // namespace QCoro
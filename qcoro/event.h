@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/waitqueue.h"
+#include "macros.h"
+
+#include <mutex>
+
+namespace QCoro {
+
+//! An event that coroutines can wait for.
+/*!
+ * Coroutines co_awaiting wait() while the event is not set are suspended, instead of
+ * blocking the thread, until the event is set:
+ *
+ * ```cpp
+ * QCoro::Event ready;
+ *
+ * QCoro::Task<> Worker::run() {
+ *     co_await ready.wait(); // waits until initialize() finishes
+ *     ...
+ * }
+ *
+ * QCoro::Task<> Worker::initialize() {
+ *     co_await loadConfig();
+ *     ready.set();
+ * }
+ * ```
+ *
+ * A \c ManualReset event resumes all waiting coroutines when set and stays set until it is
+ * reset, so coroutines co_awaiting it in the meantime don't suspend. An \c AutoReset event
+ * resumes only a single coroutine, the one that has been waiting the longest, and is reset
+ * automatically once a coroutine has been let through.
+ *
+ * The event can be shared by coroutines running in different threads, each coroutine is
+ * resumed in the thread in which it has co_awaited wait().
+ */
+class Event {
+public:
+    enum class Mode {
+        //! The event stays set until reset() is called.
+        ManualReset,
+        //! The event is reset when it lets a single waiting coroutine through.
+        AutoReset,
+    };
+
+    //! Constructs an event, which is not set unless \c initiallySet is \c true.
+    explicit Event(Mode mode = Mode::ManualReset, bool initiallySet = false) noexcept
+        : mMode(mode), mSet(initiallySet) {}
+    Q_DISABLE_COPY(Event)
+
+    ~Event() {
+        Q_ASSERT(mWaiters.isEmpty());
+    }
+
+    //! Returns an Awaitable that waits until the event is set.
+    /*!
+     * The awaiter can be cancelled, so the event can be awaited with QCoro::withTimeout().
+     */
+    auto wait() noexcept {
+        return detail::SyncAwaiter<Event>{this};
+    }
+
+    //! Sets the event.
+    /*!
+     * Resumes all waiting coroutines, or only the one that has been waiting the longest
+     * for an \c AutoReset event.
+     */
+    void set() {
+        detail::SyncWaiter *ready = nullptr;
+        detail::SyncWaiter *readyTail = nullptr;
+        {
+            std::lock_guard guard{mLock};
+            if (mMode == Mode::AutoReset) {
+                ready = mWaiters.pop();
+                mSet = (ready == nullptr);
+            } else {
+                mSet = true;
+                // Popped waiters can't be cancelled anymore, they are chained through
+                // their `next` pointer until they are resumed.
+                while (auto *waiter = mWaiters.pop()) {
+                    if (readyTail) {
+                        readyTail->next = waiter;
+                    } else {
+                        ready = waiter;
+                    }
+                    readyTail = waiter;
+                }
+            }
+        }
+        detail::resumeWaiters(ready);
+    }
+
+    //! Resets the event, coroutines co_awaiting wait() will be suspended again.
+    void reset() noexcept {
+        std::lock_guard guard{mLock};
+        mSet = false;
+    }
+
+    //! Returns whether the event is set.
+    bool isSet() const noexcept {
+        std::lock_guard guard{mLock};
+        return mSet;
+    }
+
+private:
+    friend class detail::SyncAwaiter<Event>;
+
+    bool tryAcquire() noexcept {
+        std::lock_guard guard{mLock};
+        return consume();
+    }
+
+    bool enqueue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (consume()) {
+            return false;
+        }
+        mWaiters.push(waiter);
+        return true;
+    }
+
+    bool dequeue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (!waiter->linked) {
+            return false;
+        }
+        mWaiters.remove(waiter);
+        return true;
+    }
+
+    //! Lets a coroutine through if the event is set, must be called with the lock held.
+    bool consume() noexcept {
+        if (!mSet) {
+            return false;
+        }
+        if (mMode == Mode::AutoReset) {
+            mSet = false;
+        }
+        return true;
+    }
+
+    const Mode mMode;
+    mutable std::mutex mLock;
+    detail::WaitQueue mWaiters;
+    bool mSet;
+};
+
+} // namespace QCoro
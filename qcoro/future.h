@@ -4,18 +4,148 @@
 
 #pragma once
 
+#include "asyncgenerator.h"
+#include "impl/resume.h"
+#include "impl/waitqueue.h"
+#include "macros.h"
 #include "task.h"
 
+#include <QAbstractEventDispatcher>
 #include <QFuture>
 #include <QFutureWatcher>
 
+#include <atomic>
+#include <memory>
+#include <utility>
+
 /*! \cond internal */
 
 namespace QCoro::detail {
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+
+//! The waiter of a FutureAwaiter, shared with the continuation attached to the future.
+/*!
+ * The continuation may run after the awaiter has been destroyed (e.g. when the coroutine
+ * suspended on the future is destroyed), so it only reaches the waiter through this state,
+ * which the awaiter clears when it's destroyed. The thread is kept here, so the continuation
+ * can post the resumption to the waiter's thread without touching the waiter: the waiter is
+ * only taken out of the state in that thread.
+ */
+struct FutureContinuationState {
+    explicit FutureContinuationState(SyncWaiter *syncWaiter)
+        : waiter(syncWaiter), thread(syncWaiter->thread) {}
+
+    //! Resumes the waiter, unless the awaiter has been destroyed in the meantime.
+    void resume() {
+        if (auto *current = waiter.exchange(nullptr)) {
+            resumeWaiter(current);
+        }
+    }
+
+    std::atomic<SyncWaiter *> waiter;
+    QThread *const thread;
+};
+
+//! Resumes the waiter of the \c state in its thread, called by the continuation.
+inline void resumeFromContinuation(const std::shared_ptr<FutureContinuationState> &state) {
+    auto *dispatcher = state->thread == QThread::currentThread()
+                           ? nullptr
+                           : QAbstractEventDispatcher::instance(state->thread);
+    if (!dispatcher) {
+        state->resume();
+        return;
+    }
+    QMetaObject::invokeMethod(
+        dispatcher, [state]() { state->resume(); }, Qt::QueuedConnection);
+}
+
+//! Awaiter for a QFuture.
+/*!
+ * A QFuture holds only a single continuation, attaching another one overwrites it. So only
+ * a future that has been handed over to the awaiter (co_awaiting a temporary like the result
+ * of QtConcurrent::run(), or a moved-from future) gets a continuation attached directly,
+ * which resumes the coroutine through the ready queue without any QObject. Futures that may
+ * be shared (co_awaited as l-values) are watched by a QFutureWatcher, so that any number of
+ * coroutines can await them and continuations attached by the caller are preserved.
+ */
+template<typename T>
+class FutureAwaiterBase {
+public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Future;
+    }
+
+    //! Awaits a future that may be shared, through a QFutureWatcher.
+    explicit FutureAwaiterBase(const QFuture<T> &future) : mFuture(future), mShared(true) {}
+    //! Awaits a future handed over to the awaiter, through a continuation.
+    explicit FutureAwaiterBase(QFuture<T> &&future) : mFuture(std::move(future)) {}
+    Q_DISABLE_COPY(FutureAwaiterBase)
+    QCORO_DEFAULT_MOVE(FutureAwaiterBase)
+
+    ~FutureAwaiterBase() {
+        if (mState) {
+            // The continuation must not resume a destroyed coroutine
+            mState->waiter.store(nullptr);
+        }
+    }
+
+    bool await_ready() const noexcept {
+        return mFuture.isFinished() || mFuture.isCanceled();
+    }
+
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mWaiter.coroutine = awaitingCoroutine;
+        mWaiter.thread = QThread::currentThread();
+        if (mShared) {
+            mWatcher = std::make_unique<QFutureWatcher<T>>();
+            QObject::connect(mWatcher.get(), &QFutureWatcherBase::finished,
+                             [waiter = &mWaiter]() { resumeWaiter(waiter); });
+            mWatcher->setFuture(mFuture);
+            return;
+        }
+
+        // Exactly one of the handlers runs: the continuation when the future finishes, or
+        // the cancel handler when the continuation is skipped because the future was canceled.
+        // Neither of them may touch `this`, the coroutine can be resumed before then() returns.
+        mState = std::make_shared<FutureContinuationState>(&mWaiter);
+        mFuture.then(QtFuture::Launch::Sync,
+                     [state = mState](const QFuture<T> &) { resumeFromContinuation(state); })
+            .onCanceled([state = mState]() { resumeFromContinuation(state); });
+    }
+
+protected:
+    QFuture<T> mFuture;
+    SyncWaiter mWaiter;
+    std::shared_ptr<FutureContinuationState> mState;
+    std::unique_ptr<QFutureWatcher<T>> mWatcher;
+    bool mShared = false;
+};
+
+template<typename T>
+class FutureAwaiter : public FutureAwaiterBase<T> {
+public:
+    using FutureAwaiterBase<T>::FutureAwaiterBase;
+
+    T await_resume() {
+        return this->mFuture.result();
+    }
+};
+
+#else // Qt5
+
+//! Awaiter that waits for the QFuture through a QFutureWatcher.
+/*!
+ * Qt5 provides no public way to attach a continuation to a QFuture, so the watcher is the
+ * only way to get notified when the future finishes.
+ */
 template<typename T>
 class FutureAwaiterBase {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Future;
+    }
+
     explicit FutureAwaiterBase(QFuture<T> future) {
         QObject::connect(&mFutureWatcher, &QFutureWatcher<T>::finished,
                          [this]() { futureReady(); });
@@ -26,20 +156,25 @@ public:
         return mFutureWatcher.isFinished() || mFutureWatcher.isCanceled();
     }
 
-    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        // The watcher may have delivered the finished signal in the meantime
         if (mFutureWatcher.isFinished()) {
-            awaitingCoroutine.resume();
+            return false;
         }
 
         mAwaitingCoroutine = awaitingCoroutine;
+        return true;
     }
 
 protected:
     void futureReady() {
-        mAwaitingCoroutine.resume();
+        if (mAwaitingCoroutine) {
+            resumeCoroutine(mReadyNode, std::exchange(mAwaitingCoroutine, nullptr));
+        }
     }
 
     QCORO_STD::coroutine_handle<> mAwaitingCoroutine;
+    ReadyNode mReadyNode;
     QFutureWatcher<T> mFutureWatcher;
 };
 
@@ -53,6 +188,8 @@ public:
     }
 };
 
+#endif
+
 template<>
 class FutureAwaiter<void> : public FutureAwaiterBase<void> {
 public:
@@ -66,6 +203,114 @@ struct awaiter_type<QFuture<T>> {
     using type = FutureAwaiter<T>;
 };
 
+//! Watches a QFuture for results reported while the computation is still running.
+/*!
+ * A single QFutureWatcher is used for all the results of the future. The coroutine waiting
+ * for a result is woken up by any result reported by the future or when the future finishes,
+ * so the wait must be repeated until the awaited result is actually available.
+ */
+template<typename T>
+class FutureResultsWatcher {
+public:
+    FutureResultsWatcher(const QFuture<T> &future, int pendingResultsLimit) : mFuture(future) {
+        QObject::connect(&mWatcher, &QFutureWatcherBase::resultReadyAt,
+                         [this](int) { wakeUp(); });
+        QObject::connect(&mWatcher, &QFutureWatcherBase::finished, [this]() { wakeUp(); });
+        if (pendingResultsLimit > 0) {
+            mWatcher.setPendingResultsLimit(pendingResultsLimit);
+        }
+        mWatcher.setFuture(future);
+    }
+    Q_DISABLE_COPY(FutureResultsWatcher)
+
+    //! Returns whether the result at \c index is available, or whether it will never be.
+    bool isSettled(int index) const {
+        return mFuture.isResultReadyAt(index) || mFuture.isFinished();
+    }
+
+    //! Returns an Awaitable that waits until the future reports a result or finishes.
+    auto changed() noexcept {
+        class ChangedAwaiter {
+        public:
+            static constexpr AwaiterKind awaiterKind() noexcept {
+                return AwaiterKind::Future;
+            }
+
+            explicit ChangedAwaiter(FutureResultsWatcher *watcher) : mWatcher(watcher) {}
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mWatcher->mAwaitingCoroutine = awaitingCoroutine;
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            FutureResultsWatcher *mWatcher;
+        };
+        return ChangedAwaiter{this};
+    }
+
+    QFuture<T> &future() noexcept {
+        return mFuture;
+    }
+
+private:
+    void wakeUp() {
+        if (auto coroutine = std::exchange(mAwaitingCoroutine, nullptr); coroutine) {
+            resumeCoroutine(mReadyNode, coroutine);
+        }
+    }
+
+    QFuture<T> mFuture;
+    QFutureWatcher<T> mWatcher;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
+};
+
 } // namespace QCoro::detail
 
 /*! \endcond */
+
+namespace QCoro {
+
+//! Returns a generator that yields results of the \c future as soon as they are reported.
+/*!
+ * Co_awaiting a QFuture only returns its first result once the whole computation has finished.
+ * The generator instead yields each result as soon as it becomes available, in the order of
+ * their indexes, so the results of e.g. \c QtConcurrent::mapped() can be processed while the
+ * computation is still running:
+ *
+ * ```cpp
+ * const QFuture<QImage> thumbnails = QtConcurrent::mapped(files, makeThumbnail);
+ * QCORO_FOREACH(const QImage &thumbnail, QCoro::futureResults(thumbnails)) {
+ *     store(thumbnail);
+ * }
+ * ```
+ *
+ * If \c pendingResultsLimit is greater than zero, the computation is throttled when more than
+ * that many reported results are waiting to be delivered to the thread in which the generator
+ * runs (see QFutureWatcher::setPendingResultsLimit()). When the future is canceled, the generator
+ * finishes after yielding the results that have been reported until then. An exception thrown by
+ * the computation is rethrown to the consumer after all the reported results have been yielded.
+ */
+template<typename T>
+AsyncGenerator<T> futureResults(QFuture<T> future, int pendingResultsLimit = 0) {
+    detail::FutureResultsWatcher<T> watcher{future, pendingResultsLimit};
+    for (int index = 0;; ++index) {
+        while (!watcher.isSettled(index)) {
+            co_await watcher.changed();
+        }
+        if (!watcher.future().isResultReadyAt(index)) {
+            break;
+        }
+        co_yield watcher.future().resultAt(index);
+    }
+    // Rethrows the exception thrown by the computation, if any; the future has already finished
+    watcher.future().waitForFinished();
+}
+
+} // namespace QCoro
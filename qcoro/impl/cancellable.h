@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+#include "../task.h"
+
+// Moc doesn't understand the <concepts> header, see coroutine.h
+#ifndef Q_MOC_RUN
+
+#include <concepts>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Awaiters that can stop waiting before the operation finishes.
+/*!
+ * \c cancel() detaches the awaiter from the operation (e.g. disconnects its signal connections)
+ * and returns whether it has succeeded. If it returns false, the operation has already finished
+ * and the awaiting coroutine is going to be resumed.
+ *
+ * Implemented by awaiters of the QCoro wrappers for Qt types, used by withTimeout() and
+ * withCancellation().
+ */
+template<typename T>
+concept CancellableAwaiter = Awaitable<T> && requires(T t) {
+    { t.cancel() } -> std::same_as<bool>;
+};
+
+//! Types that are co_awaited through a cancellable awaiter_type, e.g. QTimer or QDBusPendingCall.
+template<typename T>
+concept HasCancellableAwaiter = requires {
+    typename awaiter_type_t<std::remove_cvref_t<T>>;
+} && CancellableAwaiter<awaiter_type_t<std::remove_cvref_t<T>>>;
+
+} // namespace QCoro::detail
+
+/*! \endcond */
+
+#endif // Q_MOC_RUN
@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "framing.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <algorithm>
+#include <utility>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! A file on which positional reads and writes are performed by a worker thread.
+/*!
+ * The QFile itself is not thread-safe, so everything the worker needs is captured in the
+ * thread that owns the QFile when the operation is started. On Unix the worker reads and writes
+ * a duplicate of the QFile's file descriptor with \c pread() and \c pwrite(), which don't touch
+ * the file offset. The duplicate is owned by the operation, so the QFile can be closed while the
+ * operation is running without the worker accessing whatever file reuses the descriptor number.
+ * Elsewhere, or when the QFile has no file descriptor (e.g. Qt resources), the worker opens the
+ * file by its name.
+ */
+class PositionalFile {
+public:
+    //! Captures the \c file, flushing any data buffered in the QFile first.
+    explicit PositionalFile(QFile *file) {
+        if (!file || !file->isOpen()) {
+            return;
+        }
+        file->flush();
+#ifdef Q_OS_UNIX
+        if (const int handle = file->handle(); handle >= 0) {
+            mHandle = ::fcntl(handle, F_DUPFD_CLOEXEC, 0);
+            if (mHandle < 0) {
+                return;
+            }
+        }
+#endif
+        mFileName = file->fileName();
+        mReadable = file->isReadable();
+        mWritable = file->isWritable();
+    }
+
+    Q_DISABLE_COPY(PositionalFile)
+    PositionalFile(PositionalFile &&other) noexcept
+        : mHandle(std::exchange(other.mHandle, -1)), mFileName(std::move(other.mFileName)),
+          mReadable(other.mReadable), mWritable(other.mWritable) {}
+    PositionalFile &operator=(PositionalFile &&) = delete;
+
+    ~PositionalFile() {
+#ifdef Q_OS_UNIX
+        if (mHandle >= 0) {
+            ::close(mHandle);
+        }
+#endif
+    }
+
+    //! Reads up to \c maxSize bytes starting at \c offset, less if the file ends sooner.
+    QByteArray readAt(qint64 offset, qint64 maxSize) const {
+        if (!mReadable || offset < 0 || maxSize <= 0) {
+            return {};
+        }
+#ifdef Q_OS_UNIX
+        if (mHandle >= 0) {
+            return preadAt(offset, maxSize);
+        }
+#endif
+        QFile file(mFileName);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+            return {};
+        }
+        return file.read(std::min({maxSize, std::max<qint64>(file.size() - offset, 0),
+                                   maxByteArraySize}));
+    }
+
+    //! Writes \c data at \c offset, returns the number of bytes written or -1 on error.
+    qint64 writeAt(qint64 offset, const QByteArray &data) const {
+        if (!mWritable || offset < 0) {
+            return -1;
+        }
+#ifdef Q_OS_UNIX
+        if (mHandle >= 0) {
+            return pwriteAt(offset, data);
+        }
+#endif
+        QFile file(mFileName);
+        // ReadWrite, unlike WriteOnly, doesn't truncate the file
+        if (!file.open(QIODevice::ReadWrite) || !file.seek(offset)) {
+            return -1;
+        }
+        const qint64 written = file.write(data);
+        return file.flush() ? written : -1;
+    }
+
+private:
+#ifdef Q_OS_UNIX
+    QByteArray preadAt(qint64 offset, qint64 maxSize) const {
+        // Don't allocate more than the file can provide, maxSize is often "the rest of the file"
+        struct stat info = {};
+        if (::fstat(mHandle, &info) == 0) {
+            maxSize = std::min<qint64>(maxSize, std::max<qint64>(info.st_size - offset, 0));
+        }
+        maxSize = std::min(maxSize, maxByteArraySize);
+
+        QByteArray data(static_cast<decltype(data.size())>(maxSize), Qt::Uninitialized);
+        qint64 total = 0;
+        while (total < maxSize) {
+            const auto result = ::pread(mHandle, data.data() + total,
+                                        static_cast<std::size_t>(maxSize - total),
+                                        static_cast<off_t>(offset + total));
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                break;
+            }
+            total += result;
+        }
+        data.resize(static_cast<decltype(data.size())>(total));
+        return data;
+    }
+
+    qint64 pwriteAt(qint64 offset, const QByteArray &data) const {
+        qint64 total = 0;
+        while (total < data.size()) {
+            const auto result = ::pwrite(mHandle, data.constData() + total,
+                                         static_cast<std::size_t>(data.size() - total),
+                                         static_cast<off_t>(offset + total));
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                return total > 0 ? total : -1;
+            }
+            total += result;
+        }
+        return total;
+    }
+#endif
+
+    int mHandle = -1;
+    QString mFileName;
+    bool mReadable = false;
+    bool mWritable = false;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -0,0 +1,223 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace QCoro {
+
+//! Custom allocation hooks for coroutine frames.
+/*!
+ * By default QCoro allocates frames of its coroutines from a small thread-local
+ * pool of recycled memory blocks, falling back to the global `operator new` for
+ * large frames or when the pool is empty. Applications that want to manage the
+ * memory themselves (e.g. using a per-request arena) can install their own
+ * allocator using \c QCoro::setFrameAllocator().
+ *
+ * The \c deallocate function is called with the same size that was passed to
+ * \c allocate for the given block.
+ */
+struct FrameAllocator {
+    //! Allocates a block of at least \c size bytes. Must not return \c nullptr.
+    void *(*allocate)(std::size_t size) = nullptr;
+    //! Frees a block previously returned from \c allocate.
+    void (*deallocate)(void *ptr, std::size_t size) = nullptr;
+};
+
+//! Statistics of the coroutine frame pool of the current thread.
+struct FrameAllocatorStats {
+    //! Number of frames allocated from the pool.
+    std::uint64_t hits = 0;
+    //! Number of frames that had to be allocated using the global `operator new`.
+    std::uint64_t misses = 0;
+    //! Number of blocks currently cached in the pool, ready for reuse.
+    std::uint64_t cached = 0;
+};
+
+/*! \cond internal */
+
+namespace detail {
+
+//! Thread-local freelist allocator for coroutine frames.
+/*!
+ * Frames are grouped into size classes of \c Granularity bytes. Each size class
+ * has its own freelist of blocks, that are reused for new frames of the same
+ * size class. The blocks are always obtained from the global `operator new`, so
+ * they can be safely released to a pool of a different thread when a coroutine
+ * finishes on another thread than the one where it was started.
+ */
+class FramePool {
+public:
+    //! Size classes are multiples of this value.
+    static constexpr std::size_t Granularity = 64;
+    //! Frames larger than this are never pooled.
+    static constexpr std::size_t MaxPooledSize = 1024;
+    //! Maximum number of blocks cached in a single size class.
+    static constexpr std::size_t MaxCachedPerClass = 64;
+
+    FramePool() = default;
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    ~FramePool() {
+        for (auto &freeList : mFreeLists) {
+            while (freeList.head) {
+                auto *block = freeList.head;
+                freeList.head = block->next;
+                ::operator delete(block);
+            }
+        }
+        sDestroyed = true;
+    }
+
+    //! Returns the frame pool for the current thread, or \c nullptr if it's already destroyed.
+    static FramePool *instance() noexcept {
+        if (sDestroyed) {
+            return nullptr;
+        }
+        thread_local FramePool pool;
+        return &pool;
+    }
+
+    void *allocate(std::size_t size) {
+        if (size > MaxPooledSize) {
+            ++mStats.misses;
+            return ::operator new(size);
+        }
+
+        const auto sizeClass = sizeClassFor(size);
+        auto &freeList = mFreeLists[sizeClass];
+        if (auto *block = freeList.head; block != nullptr) {
+            freeList.head = block->next;
+            --freeList.count;
+            --mStats.cached;
+            ++mStats.hits;
+            return block;
+        }
+
+        ++mStats.misses;
+        return ::operator new(blockSize(sizeClass));
+    }
+
+    void deallocate(void *ptr, std::size_t size) noexcept {
+        if (size > MaxPooledSize) {
+            ::operator delete(ptr);
+            return;
+        }
+
+        auto &freeList = mFreeLists[sizeClassFor(size)];
+        if (freeList.count >= MaxCachedPerClass) {
+            ::operator delete(ptr);
+            return;
+        }
+
+        freeList.head = new (ptr) Block{freeList.head};
+        ++freeList.count;
+        ++mStats.cached;
+    }
+
+    const FrameAllocatorStats &stats() const noexcept {
+        return mStats;
+    }
+
+    //! Allocates a frame of given size using the block size for its size class.
+    /*!
+     * Used when the pool for the current thread is not available anymore (the thread
+     * is shutting down), so that the block can still be recycled by a pool of another
+     * thread later.
+     */
+    static void *allocateUnpooled(std::size_t size) {
+        return ::operator new(size > MaxPooledSize ? size : blockSize(sizeClassFor(size)));
+    }
+
+private:
+    struct Block {
+        Block *next = nullptr;
+    };
+
+    struct FreeList {
+        Block *head = nullptr;
+        std::size_t count = 0;
+    };
+
+    static constexpr std::size_t sizeClassFor(std::size_t size) noexcept {
+        return (size + Granularity - 1) / Granularity - 1;
+    }
+
+    static constexpr std::size_t blockSize(std::size_t sizeClass) noexcept {
+        return (sizeClass + 1) * Granularity;
+    }
+
+    std::array<FreeList, MaxPooledSize / Granularity> mFreeLists = {};
+    FrameAllocatorStats mStats;
+
+    //! Set once the pool of the current thread is destroyed during thread exit.
+    static inline thread_local bool sDestroyed = false;
+};
+
+inline FrameAllocator &frameAllocatorHooks() noexcept {
+    static FrameAllocator hooks;
+    return hooks;
+}
+
+//! Allocates memory for a coroutine frame.
+inline void *allocateFrame(std::size_t size) {
+    if (const auto &hooks = frameAllocatorHooks(); hooks.allocate) {
+        return hooks.allocate(size);
+    }
+
+    if (auto *pool = FramePool::instance(); pool != nullptr) {
+        return pool->allocate(size);
+    }
+    return FramePool::allocateUnpooled(size);
+}
+
+//! Releases memory of a coroutine frame allocated by allocateFrame().
+inline void deallocateFrame(void *ptr, std::size_t size) noexcept {
+    if (const auto &hooks = frameAllocatorHooks(); hooks.deallocate) {
+        hooks.deallocate(ptr, size);
+        return;
+    }
+
+    if (auto *pool = FramePool::instance(); pool != nullptr) {
+        pool->deallocate(ptr, size);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Installs custom allocator for coroutine frames.
+/*!
+ * The allocator must be installed before any QCoro coroutine is started, since frames
+ * allocated by the previous allocator would otherwise be released to the new one.
+ * Passing a default-constructed \c FrameAllocator restores the default pooled allocator.
+ */
+inline void setFrameAllocator(FrameAllocator allocator) {
+    detail::frameAllocatorHooks() = allocator;
+}
+
+//! Returns statistics of the coroutine frame pool of the calling thread.
+/*!
+ * The numbers can be used to determine whether the pool is large enough
+ * for the application's workload - if the number of misses keeps growing
+ * after the application has warmed up, the frames are either too large to
+ * be pooled, or the application has more coroutines alive at the same time
+ * than the pool can hold.
+ */
+inline FrameAllocatorStats frameAllocatorStats() {
+    if (const auto *pool = detail::FramePool::instance(); pool != nullptr) {
+        return pool->stats();
+    }
+    return {};
+}
+
+} // namespace QCoro
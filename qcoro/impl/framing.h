@@ -0,0 +1,191 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QtEndian>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Largest number of bytes that can be stored in a QByteArray.
+inline constexpr qint64 maxByteArraySize =
+    std::numeric_limits<decltype(std::declval<QByteArray>().size())>::max();
+
+//! Largest frame accepted by readFrame() when no maximum size is given.
+inline constexpr qint64 defaultMaxFrameSize = 16 * 1024 * 1024;
+
+//! Collects data from a device until a delimiter is found, used by readUntil().
+/*!
+ * Every chunk of data that arrives is copied into the frame buffer once and only the new bytes
+ * (plus the tail of the previous chunk, in which the delimiter may begin) are searched for the
+ * delimiter. Data up to the end of the delimiter are consumed from the device, anything after
+ * it remains in the device for the next read operation.
+ */
+class DelimiterFramer {
+public:
+    DelimiterFramer(QByteArray delimiter, qint64 maxSize)
+        : mDelimiter(std::move(delimiter)), mMaxSize(maxSize > 0 ? maxSize : maxByteArraySize) {
+        Q_ASSERT(!mDelimiter.isEmpty());
+    }
+
+    //! Returns whether the frame has been completed by a previous consume().
+    bool isComplete() const noexcept {
+        return mComplete;
+    }
+
+    //! Moves the available data that belong to the frame from the \c device into the buffer.
+    /*!
+     * \return Whether the frame is complete.
+     */
+    bool consume(QIODevice *device) {
+        if (mComplete) {
+            return true;
+        }
+
+        const qint64 scanned = mBuffer.size();
+        const qint64 available = std::min(device->bytesAvailable(), mMaxSize - scanned);
+        if (available <= 0) {
+            return false;
+        }
+
+        mBuffer.resize(scanned + available);
+        const qint64 peeked = device->peek(mBuffer.data() + scanned, available);
+        if (peeked <= 0) {
+            mBuffer.resize(scanned);
+            return false;
+        }
+        mBuffer.resize(scanned + peeked);
+
+        // The delimiter may begin in the already scanned data
+        const qint64 delimiterSize = mDelimiter.size();
+        const auto from = std::max<qint64>(0, scanned - delimiterSize + 1);
+        const auto pos = view(mBuffer).find(view(mDelimiter), static_cast<std::size_t>(from));
+        if (pos != std::string_view::npos) {
+            const qint64 end = static_cast<qint64>(pos) + delimiterSize;
+            mBuffer.truncate(end);
+            device->skip(end - scanned);
+            mComplete = true;
+        } else {
+            device->skip(peeked);
+            mComplete = mBuffer.size() >= mMaxSize;
+        }
+        return mComplete;
+    }
+
+    //! Returns the frame, including the delimiter, or the data collected so far.
+    QByteArray operator()(QIODevice *device) {
+        if (device && device->isOpen()) {
+            consume(device);
+        }
+        return std::move(mBuffer);
+    }
+
+private:
+    static std::string_view view(const QByteArray &data) noexcept {
+        return {data.constData(), static_cast<std::size_t>(data.size())};
+    }
+
+    QByteArray mDelimiter;
+    QByteArray mBuffer;
+    qint64 mMaxSize;
+    bool mComplete = false;
+};
+
+//! Collects a frame preceded by its big-endian length from a device, used by readFrame().
+/*!
+ * Only the prefix and the payload are consumed from the device, the payload is read
+ * directly into the frame buffer. The buffer only grows by the data that have actually
+ * arrived, so a peer can't make us allocate a huge buffer just by sending a huge length.
+ */
+template<std::unsigned_integral LengthPrefix>
+class LengthPrefixFramer {
+public:
+    explicit LengthPrefixFramer(qint64 maxSize)
+        : mMaxSize(maxSize > 0 ? std::min(maxSize, maxByteArraySize) : defaultMaxFrameSize) {}
+
+    //! Returns whether the frame has been completed, or found invalid, by a previous consume().
+    bool isComplete() const noexcept {
+        return mComplete || mInvalid;
+    }
+
+    //! Moves the available data that belong to the frame from the \c device into the buffer.
+    /*!
+     * \return Whether the frame is complete or can't be read.
+     */
+    bool consume(QIODevice *device) {
+        if (mComplete || mInvalid) {
+            return true;
+        }
+
+        if (!mLength) {
+            if (device->bytesAvailable() < static_cast<qint64>(sizeof(LengthPrefix))) {
+                return false;
+            }
+            uchar prefix[sizeof(LengthPrefix)];
+            if (device->read(reinterpret_cast<char *>(prefix), sizeof(prefix)) !=
+                static_cast<qint64>(sizeof(prefix))) {
+                mInvalid = true;
+                return true;
+            }
+            const auto length = qFromBigEndian<LengthPrefix>(prefix);
+            if (length > static_cast<std::make_unsigned_t<qint64>>(mMaxSize)) {
+                mInvalid = true;
+                return true;
+            }
+            mLength = static_cast<qint64>(length);
+        }
+
+        const qint64 received = mBuffer.size();
+        const qint64 missing = *mLength - received;
+        const qint64 available = std::min(device->bytesAvailable(), missing);
+        if (available > 0) {
+            mBuffer.resize(received + available);
+            const qint64 read = device->read(mBuffer.data() + received, available);
+            mBuffer.resize(received + std::max<qint64>(read, 0));
+        }
+        mComplete = mBuffer.size() == *mLength;
+        return mComplete;
+    }
+
+    //! Returns the payload of the frame, or an empty optional if it's incomplete or invalid.
+    std::optional<QByteArray> operator()(QIODevice *device) {
+        if (device && device->isOpen()) {
+            consume(device);
+        }
+        if (!mComplete) {
+            return std::nullopt;
+        }
+        return std::move(mBuffer);
+    }
+
+private:
+    QByteArray mBuffer;
+    std::optional<qint64> mLength;
+    qint64 mMaxSize;
+    bool mComplete = false;
+    bool mInvalid = false;
+};
+
+//! Result callbacks of read operations that collect data from the device themselves.
+template<typename T>
+concept Framer = requires(T framer, const T constFramer, QIODevice *device) {
+    { framer.consume(device) } -> std::same_as<bool>;
+    { constFramer.isComplete() } -> std::same_as<bool>;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+#include "stats.h"
+#include "tracing.h"
+
+#include <QtGlobal>
+
+#include <chrono>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+template<typename T>
+concept has_member_co_await = requires(T &&t) {
+    std::forward<T>(t).operator co_await();
+};
+
+//! Awaiters, or awaitables, that declare the kind of operation they represent.
+template<typename T>
+concept has_awaiter_kind = requires {
+    { std::remove_cvref_t<T>::awaiterKind() } -> std::same_as<AwaiterKind>;
+};
+
+//! Returns the kind of operation represented by the \c Awaiter obtained from the \c Awaitable.
+template<typename Awaitable, typename Awaiter>
+constexpr AwaiterKind awaiterKind() noexcept {
+    if constexpr (has_awaiter_kind<Awaiter>) {
+        return std::remove_cvref_t<Awaiter>::awaiterKind();
+    } else if constexpr (has_awaiter_kind<Awaitable>) {
+        return std::remove_cvref_t<Awaitable>::awaiterKind();
+    } else {
+        return AwaiterKind::Other;
+    }
+}
+
+template<typename T>
+struct instrumented_awaiter {
+    using type = std::remove_reference_t<T> &;
+};
+
+template<has_member_co_await T>
+struct instrumented_awaiter<T> {
+    using type = decltype(std::declval<T &&>().operator co_await());
+};
+
+//! Wraps an awaitable co_awaited from a QCoro coroutine to collect statistics and traces.
+/*!
+ * \c T is the type in which the awaitable is stored - a value, or an l-value reference for
+ * awaitables owned by the caller. The awaiter is obtained from the awaitable the same way the
+ * compiler would do it. The object is neither copyable nor movable, since the awaiter may
+ * reference the stored awaitable, it is only ever returned from await_transform() as a prvalue.
+ *
+ * Nothing is recorded for awaitables that are ready right away, only when the coroutine
+ * is suspended.
+ */
+template<typename T>
+class InstrumentedAwaitable {
+    using Awaiter = typename instrumented_awaiter<T>::type;
+    static constexpr AwaiterKind Kind = awaiterKind<T, Awaiter>();
+
+public:
+    template<typename U>
+    explicit InstrumentedAwaitable(U &&awaitable)
+        : mAwaitable(std::forward<U>(awaitable)), mAwaiter(awaiter()) {}
+    Q_DISABLE_COPY(InstrumentedAwaitable)
+
+    ~InstrumentedAwaitable() {
+#ifndef QCORO_DISABLE_STATS
+        if (mSuspended) {
+            // The coroutine has been destroyed while suspended
+            statsAwaitAbandoned(Kind);
+        }
+#endif
+    }
+
+    bool await_ready() {
+        return mAwaiter.await_ready();
+    }
+
+    template<typename Promise>
+    decltype(auto) await_suspend(QCORO_STD::coroutine_handle<Promise> awaitingCoroutine) {
+        // The coroutine may be resumed (and even destroyed) in another thread before
+        // the awaiter's await_suspend() returns, so no member can be touched afterwards.
+#ifndef QCORO_DISABLE_STATS
+        mSuspended = true;
+        mSuspendedAt = statsAwaitSuspended(Kind);
+#endif
+#ifdef QCORO_ENABLE_TRACING
+        mCoroutine = awaitingCoroutine.address();
+        traceEvent(TraceEventType::Suspended, mCoroutine, name());
+#endif
+        return mAwaiter.await_suspend(awaitingCoroutine);
+    }
+
+    decltype(auto) await_resume() {
+#ifndef QCORO_DISABLE_STATS
+        if (mSuspended) {
+            mSuspended = false;
+            statsAwaitResumed(Kind, mSuspendedAt);
+        }
+#endif
+#ifdef QCORO_ENABLE_TRACING
+        if (mCoroutine) {
+            traceEvent(TraceEventType::Resumed, mCoroutine, name());
+        }
+#endif
+        return mAwaiter.await_resume();
+    }
+
+private:
+    static constexpr std::string_view name() noexcept {
+        return typeName<std::remove_cvref_t<T>>();
+    }
+
+    Awaiter awaiter() {
+        if constexpr (has_member_co_await<T>) {
+            return std::forward<T>(mAwaitable).operator co_await();
+        } else {
+            return mAwaitable;
+        }
+    }
+
+    T mAwaitable;
+    Awaiter mAwaiter;
+#ifndef QCORO_DISABLE_STATS
+    std::chrono::steady_clock::time_point mSuspendedAt;
+    bool mSuspended = false;
+#endif
+#ifdef QCORO_ENABLE_TRACING
+    const void *mCoroutine = nullptr;
+#endif
+};
+
+#if !defined(QCORO_DISABLE_STATS) || defined(QCORO_ENABLE_TRACING)
+//! Wraps the \c awaitable, stored as \c Type, so that awaiting it is instrumented.
+#define QCORO_INSTRUMENT_AWAIT(Type, awaitable)                                                    \
+    ::QCoro::detail::InstrumentedAwaitable<Type>(awaitable)
+#else
+#define QCORO_INSTRUMENT_AWAIT(Type, awaitable) awaitable
+#endif
+
+} // namespace QCoro::detail
+
+/*! \endcond */
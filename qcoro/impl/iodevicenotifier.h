@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+#include "resume.h"
+
+#include <QIODevice>
+#include <QObject>
+#include <QVariant>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+class IODeviceNotifier;
+
+//! Events of a QIODevice (or its subclass) that coroutines can wait for.
+enum class IODeviceEvent : unsigned {
+    ReadyRead = 0x01,
+    BytesWritten = 0x02,
+    AboutToClose = 0x04,
+    //! State of a socket has changed.
+    StateChanged = 0x08,
+    //! A network reply has finished.
+    Finished = 0x10,
+    //! A process has new data in its standard output channel.
+    ReadyReadStandardOutput = 0x20,
+    //! A process has new data in its standard error channel.
+    ReadyReadStandardError = 0x40,
+};
+
+//! A coroutine suspended until some event occurs on an IO device.
+/*!
+ * The waiter is embedded in the awaiter object and is linked into the list of waiters
+ * of the device's IODeviceNotifier while the coroutine is suspended, so suspending
+ * doesn't need to allocate or to create any signal connections.
+ */
+class IODeviceWaiter {
+public:
+    IODeviceWaiter() = default;
+    Q_DISABLE_COPY(IODeviceWaiter)
+
+    //! Waiters are only linked while suspended, so moving an awaiter doesn't move the links.
+    IODeviceWaiter(IODeviceWaiter &&) noexcept {}
+    IODeviceWaiter &operator=(IODeviceWaiter &&) noexcept {
+        return *this;
+    }
+
+    virtual ~IODeviceWaiter();
+
+    //! Stops waiting for the device.
+    /*!
+     * \return Whether the waiter has been cancelled before the coroutine was scheduled
+     * to be resumed. If so, the coroutine will not be resumed by the waiter.
+     */
+    bool cancel() noexcept;
+
+protected:
+    //! Called by the notifier for every event on the device while the waiter is suspended.
+    /*!
+     * \return Whether the waiting coroutine should be resumed.
+     */
+    virtual bool notify(IODeviceEvent event, qint64 bytesWritten) = 0;
+
+    //! Registers the waiter with the \c notifier.
+    /*!
+     * The coroutine is resumed once notify() returns true.
+     */
+    void wait(IODeviceNotifier *notifier, QCORO_STD::coroutine_handle<> awaitingCoroutine);
+
+private:
+    friend class IODeviceNotifier;
+
+    IODeviceNotifier *mNotifier = nullptr;
+    IODeviceWaiter *mPrev = nullptr;
+    IODeviceWaiter *mNext = nullptr;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
+    //! Set once the notifier has scheduled the coroutine for resumption.
+    bool mResuming = false;
+};
+
+//! Dispatches events of a single QIODevice to the coroutines waiting for them.
+/*!
+ * The notifier is created the first time a coroutine awaits an operation on the device
+ * and is destroyed together with the device. It connects to the device's signals only once,
+ * all operations afterwards just link their waiter into the notifier's list of waiters.
+ *
+ * The notifier is not a child of the device, so it doesn't show up in the device's children()
+ * and it can be created even when the device lives in another thread than the awaiting
+ * coroutine; it's moved to the device's thread, so that the signals are delivered directly.
+ */
+class IODeviceNotifier final : public QObject {
+public:
+    //! Returns the notifier for the \c device, creating it if it doesn't exist yet.
+    static IODeviceNotifier *instance(QIODevice *device) {
+        auto *notifier = static_cast<IODeviceNotifier *>(
+            device->property(propertyName).value<QObject *>());
+        if (!notifier) {
+            notifier = new IODeviceNotifier(device);
+            notifier->moveToThread(device->thread());
+            // A connection without context object is always direct, the notifier is
+            // destroyed in whichever thread the device is destroyed.
+            connect(device, &QObject::destroyed, [notifier]() { delete notifier; });
+            device->setProperty(propertyName, QVariant::fromValue<QObject *>(notifier));
+        }
+        return notifier;
+    }
+
+    ~IODeviceNotifier() override {
+        // The device is being destroyed: its signals won't be emitted anymore, so just
+        // detach the remaining waiters so that they don't reference us when destroyed.
+        for (auto *waiter = mHead; waiter != nullptr;) {
+            auto *next = waiter->mNext;
+            waiter->mNotifier = nullptr;
+            waiter->mPrev = waiter->mNext = nullptr;
+            waiter = next;
+        }
+    }
+
+    //! Makes sure that \c event is dispatched to waiters whenever the \c sender emits \c signal.
+    /*!
+     * Used for signals of QIODevice subclasses. The connection is only created the first
+     * time the event is watched.
+     */
+    template<typename Sender, typename Signal>
+    void watch(IODeviceEvent event, const Sender *sender, Signal signal) {
+        const auto flag = static_cast<unsigned>(event);
+        if (mWatched & flag) {
+            return;
+        }
+        mWatched |= flag;
+        connect(sender, signal, this, [this, event]() { dispatch(event, 0); });
+    }
+
+private:
+    friend class IODeviceWaiter;
+
+    static constexpr const char *propertyName = "_qcoro_iodevicenotifier";
+
+    explicit IODeviceNotifier(QIODevice *device) {
+        connect(device, &QIODevice::readyRead, this,
+                [this]() { dispatch(IODeviceEvent::ReadyRead, 0); });
+        connect(device, &QIODevice::bytesWritten, this,
+                [this](qint64 written) { dispatch(IODeviceEvent::BytesWritten, written); });
+        connect(device, &QIODevice::aboutToClose, this,
+                [this]() { dispatch(IODeviceEvent::AboutToClose, 0); });
+    }
+
+    void append(IODeviceWaiter *waiter) {
+        Q_ASSERT(waiter->mNotifier == nullptr);
+        waiter->mNotifier = this;
+        waiter->mPrev = mTail;
+        waiter->mNext = nullptr;
+        if (mTail) {
+            mTail->mNext = waiter;
+        } else {
+            mHead = waiter;
+        }
+        mTail = waiter;
+    }
+
+    void remove(IODeviceWaiter *waiter) {
+        Q_ASSERT(waiter->mNotifier == this);
+        if (waiter->mPrev) {
+            waiter->mPrev->mNext = waiter->mNext;
+        } else {
+            mHead = waiter->mNext;
+        }
+        if (waiter->mNext) {
+            waiter->mNext->mPrev = waiter->mPrev;
+        } else {
+            mTail = waiter->mPrev;
+        }
+        waiter->mNotifier = nullptr;
+        waiter->mPrev = waiter->mNext = nullptr;
+    }
+
+    void dispatch(IODeviceEvent event, qint64 bytesWritten) {
+        // Unlink all waiters that are done first and only then resume them, in the order
+        // in which they started waiting, so that coroutines resumed directly can start
+        // waiting again without being notified about the same event twice.
+        IODeviceWaiter *readyHead = nullptr;
+        IODeviceWaiter *readyTail = nullptr;
+        for (auto *waiter = mHead; waiter != nullptr;) {
+            auto *next = waiter->mNext;
+            if (waiter->notify(event, bytesWritten)) {
+                remove(waiter);
+                // Unlinked waiters can't be cancelled anymore
+                waiter->mResuming = true;
+                if (readyTail) {
+                    readyTail->mNext = waiter;
+                } else {
+                    readyHead = waiter;
+                }
+                readyTail = waiter;
+            }
+            waiter = next;
+        }
+
+        if (readyHead && !readyHead->mNext) {
+            resumeCoroutine(readyHead->mReadyNode, readyHead->mAwaitingCoroutine);
+            return;
+        }
+        // A coroutine resumed directly could destroy a later waiter of the batch (or the
+        // device), so the batch is always resumed from the event loop: the ReadyNode of a
+        // destroyed waiter removes itself from the ReadyQueue.
+        while (readyHead) {
+            auto *waiter = readyHead;
+            readyHead = waiter->mNext;
+            waiter->mNext = nullptr;
+            resumeQueued(waiter->mReadyNode, waiter->mAwaitingCoroutine);
+        }
+    }
+
+    IODeviceWaiter *mHead = nullptr;
+    IODeviceWaiter *mTail = nullptr;
+    //! Bitmask of IODeviceEvents connected through watch().
+    unsigned mWatched = 0;
+};
+
+inline IODeviceWaiter::~IODeviceWaiter() {
+    // The coroutine has been destroyed while suspended
+    if (mNotifier) {
+        mNotifier->remove(this);
+    }
+}
+
+inline void IODeviceWaiter::wait(IODeviceNotifier *notifier,
+                                 QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+    mAwaitingCoroutine = awaitingCoroutine;
+    mResuming = false;
+    notifier->append(this);
+}
+
+inline bool IODeviceWaiter::cancel() noexcept {
+    if (mResuming) {
+        return false;
+    }
+    if (mNotifier) {
+        mNotifier->remove(this);
+    }
+    return true;
+}
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -0,0 +1,221 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../macros.h"
+#include "../semaphore.h"
+#include "timerwheel.h"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <utility>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Destroys the \c object from the event loop, it may still be emitting a signal.
+template<typename T>
+void discardLater(std::unique_ptr<T> object) {
+    if (object) {
+        object.release()->deleteLater();
+    }
+}
+
+template<typename T>
+class ResourcePool;
+
+//! A resource acquired from a ResourcePool, returned to the pool when destroyed.
+/*!
+ * Base of the public handles of the pools, like QCoro::PooledConnection.
+ */
+template<typename T>
+class PooledResource {
+public:
+    //! Constructs a handle that holds no resource.
+    PooledResource() noexcept = default;
+    Q_DISABLE_COPY(PooledResource)
+
+    PooledResource(PooledResource &&other) noexcept
+        : mPool(std::exchange(other.mPool, nullptr)), mResource(std::move(other.mResource)),
+          mDiscard(other.mDiscard) {}
+
+    PooledResource &operator=(PooledResource &&other) noexcept {
+        if (this != &other) {
+            release();
+            mPool = std::exchange(other.mPool, nullptr);
+            mResource = std::move(other.mResource);
+            mDiscard = other.mDiscard;
+        }
+        return *this;
+    }
+
+    //! Returns the resource to the pool.
+    ~PooledResource() {
+        release();
+    }
+
+    //! Returns whether the handle holds a resource.
+    explicit operator bool() const noexcept {
+        return mResource != nullptr;
+    }
+
+    //! Marks the resource to be destroyed instead of being returned to the pool.
+    void discard() noexcept {
+        mDiscard = true;
+    }
+
+    //! Returns the resource to the pool (or destroys it, if discarded) right away.
+    void release() {
+        if (auto *pool = std::exchange(mPool, nullptr); pool && mResource) {
+            pool->release(std::move(mResource), mDiscard);
+        }
+        discardLater(std::move(mResource));
+    }
+
+protected:
+    T *get() const noexcept {
+        return mResource.get();
+    }
+
+private:
+    friend class ResourcePool<T>;
+
+    PooledResource(ResourcePool<T> *pool, std::unique_ptr<T> resource) noexcept
+        : mPool(pool), mResource(std::move(resource)) {}
+
+    ResourcePool<T> *mPool = nullptr;
+    std::unique_ptr<T> mResource;
+    bool mDiscard = false;
+};
+
+//! A limited number of reusable resources (e.g. connected sockets or running processes).
+/*!
+ * Permits limit how many resources are in use at the same time. Released resources are
+ * kept idle for the idle timeout, which is scheduled in the TimerWheel so the idle resources
+ * don't need a QTimer each, and they are handed out again (most recently used first) as long
+ * as they are still reusable. Creating new resources is up to the owner of the pool.
+ */
+template<typename T>
+class ResourcePool {
+public:
+    //! Returns whether an idle \c resource can be handed out again.
+    using ReusableFn = bool (*)(const T &resource);
+
+    //! Constructs a pool of at most \c maxResources resources.
+    /*!
+     * The \c idleTimeout is referenced, so that changes of the owner's setting apply to
+     * resources released afterwards.
+     */
+    ResourcePool(std::size_t maxResources, const std::chrono::milliseconds &idleTimeout,
+                 ReusableFn isReusable)
+        : mPermits(maxResources), mIdleTimeout(idleTimeout), mIsReusable(isReusable) {}
+    Q_DISABLE_COPY(ResourcePool)
+
+    ~ResourcePool() {
+        Q_ASSERT(mActive == 0);
+    }
+
+    //! Returns an Awaitable that acquires a permit to use a resource.
+    auto acquirePermit() noexcept {
+        return mPermits.acquire();
+    }
+
+    //! Returns a permit that wasn't used because no resource could be created.
+    void releasePermit() {
+        mPermits.release();
+    }
+
+    //! Returns the most recently used idle resource that is still reusable, if any.
+    std::unique_ptr<T> takeIdle() {
+        while (!mIdle.empty()) {
+            auto resource = mIdle.front().take();
+            mIdle.pop_front();
+            if (mIsReusable(*resource)) {
+                return resource;
+            }
+            discardLater(std::move(resource));
+        }
+        return {};
+    }
+
+    //! Hands out the \c resource, for which a permit has been acquired.
+    PooledResource<T> hand(std::unique_ptr<T> resource) {
+        ++mActive;
+        return PooledResource<T>{this, std::move(resource)};
+    }
+
+    //! Returns the number of idle resources.
+    std::size_t idleCount() const noexcept {
+        return mIdle.size();
+    }
+
+    //! Returns the number of resources that have been handed out and haven't been released yet.
+    std::size_t activeCount() const noexcept {
+        return mActive;
+    }
+
+private:
+    friend class PooledResource<T>;
+
+    //! An idle resource, it removes itself from the pool when its idle timeout expires.
+    class IdleResource final : private TimeoutEntry {
+    public:
+        IdleResource(ResourcePool *pool, std::unique_ptr<T> resource)
+            : mPool(pool), mResource(std::move(resource)) {}
+
+        ~IdleResource() override {
+            discardLater(std::move(mResource));
+        }
+
+        void startIdleTimeout(std::chrono::milliseconds timeout,
+                              typename std::list<IdleResource>::iterator self) {
+            mSelf = self;
+            if (timeout.count() >= 0) {
+                scheduleTimeout(timeout);
+            }
+        }
+
+        //! Takes the resource out, the IdleResource can be destroyed afterwards.
+        std::unique_ptr<T> take() noexcept {
+            cancelTimeout();
+            return std::move(mResource);
+        }
+
+    private:
+        void timedOut() override {
+            // Destroys this
+            mPool->mIdle.erase(mSelf);
+        }
+
+        ResourcePool *mPool;
+        std::unique_ptr<T> mResource;
+        typename std::list<IdleResource>::iterator mSelf;
+    };
+
+    void release(std::unique_ptr<T> resource, bool discard) {
+        --mActive;
+        if (!discard && mIsReusable(*resource)) {
+            auto &idle = mIdle.emplace_front(this, std::move(resource));
+            idle.startIdleTimeout(mIdleTimeout, mIdle.begin());
+        } else {
+            discardLater(std::move(resource));
+        }
+        mPermits.release();
+    }
+
+    Semaphore mPermits;
+    //! Idle resources, the most recently released one first.
+    std::list<IdleResource> mIdle;
+    const std::chrono::milliseconds &mIdleTimeout;
+    ReusableFn mIsReusable;
+    std::size_t mActive = 0;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
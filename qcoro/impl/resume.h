@@ -0,0 +1,211 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QObject>
+
+#include <cstdint>
+
+namespace QCoro {
+
+//! Describes how coroutines suspended on IO and wait operations are resumed.
+enum class ResumePolicy {
+    //! The coroutine is resumed from the event loop after the signal emission has finished.
+    /*!
+     * This is the default and it is always safe, even if the resumed coroutine destroys
+     * the object that has emitted the signal.
+     */
+    Queued,
+    //! The coroutine is resumed directly from the signal handler.
+    /*!
+     * This avoids the latency of an event loop round-trip, but the resumed coroutine must
+     * not destroy the object that has emitted the signal (use `deleteLater()` instead).
+     */
+    Direct,
+};
+
+/*! \cond internal */
+
+namespace detail {
+
+inline ResumePolicy &currentResumePolicy() noexcept {
+    thread_local ResumePolicy policy = ResumePolicy::Queued;
+    return policy;
+}
+
+class ReadyQueue;
+
+//! Node of the per-thread ready queue.
+/*!
+ * The node is embedded in the awaiter object of the suspended coroutine,
+ * so enqueueing a coroutine for resumption doesn't need to allocate.
+ */
+struct ReadyNode {
+    ReadyNode() noexcept = default;
+    //! Only suspended awaiters are queued, so copies of the node are never queued.
+    ReadyNode(const ReadyNode &) noexcept {}
+    ReadyNode &operator=(const ReadyNode &) noexcept {
+        return *this;
+    }
+
+    //! Removes the node from the ready queue if the coroutine is destroyed before it's resumed.
+    ~ReadyNode();
+
+    ReadyNode *prev = nullptr;
+    ReadyNode *next = nullptr;
+    QCORO_STD::coroutine_handle<> coroutine = {};
+    //! The queue in which the node is queued, if any.
+    ReadyQueue *queue = nullptr;
+    //! The drain() that resumes the coroutine.
+    std::uint64_t batch = 0;
+};
+
+//! Per-thread queue of coroutines ready to be resumed.
+/*!
+ * Operations that complete while some signal is being emitted enqueue their
+ * coroutine into the ready queue of the current thread. The first enqueued
+ * coroutine posts a single event to the event loop, and when the event is
+ * delivered all coroutines currently in the queue are resumed in the order
+ * in which they were enqueued. Coroutines enqueued while the queue is being
+ * drained will be resumed in the next batch.
+ *
+ * A resumed coroutine may destroy another coroutine that is still in the queue
+ * (e.g. by destroying an AsyncGenerator), so the queue is doubly-linked and the
+ * node of a destroyed coroutine removes itself from it.
+ */
+class ReadyQueue final : public QObject {
+public:
+    //! Returns the ReadyQueue for the current thread.
+    static ReadyQueue *instance() {
+        thread_local ReadyQueue queue;
+        return &queue;
+    }
+
+    //! Enqueues the coroutine to be resumed from the event loop.
+    void schedule(ReadyNode &node, QCORO_STD::coroutine_handle<> coroutine) {
+        Q_ASSERT(node.queue == nullptr);
+        node.prev = mTail;
+        node.next = nullptr;
+        node.coroutine = coroutine;
+        node.queue = this;
+        node.batch = mNextBatch;
+        if (mTail) {
+            mTail->next = &node;
+        } else {
+            mHead = &node;
+        }
+        mTail = &node;
+
+        if (!mEventPosted) {
+            mEventPosted = true;
+            QCoreApplication::postEvent(this, new QEvent(eventType()));
+        }
+    }
+
+    bool event(QEvent *event) override {
+        if (event->type() == eventType()) {
+            drain();
+            return true;
+        }
+        return QObject::event(event);
+    }
+
+    //! Removes the \c node from the queue, its coroutine won't be resumed.
+    void remove(ReadyNode &node) noexcept {
+        Q_ASSERT(node.queue == this);
+        if (node.prev) {
+            node.prev->next = node.next;
+        } else {
+            mHead = node.next;
+        }
+        if (node.next) {
+            node.next->prev = node.prev;
+        } else {
+            mTail = node.prev;
+        }
+        node.prev = node.next = nullptr;
+        node.queue = nullptr;
+    }
+
+private:
+    ReadyQueue() = default;
+
+    ~ReadyQueue() override {
+        while (mHead) {
+            remove(*mHead);
+        }
+    }
+
+    static QEvent::Type eventType() {
+        static const auto type = static_cast<QEvent::Type>(QEvent::registerEventType());
+        return type;
+    }
+
+    void drain() {
+        // Coroutines resumed by a nested event loop of a resumed coroutine resume the
+        // rest of the outer batch as well, so the batch number only ever grows.
+        const auto batch = mNextBatch++;
+        mEventPosted = false;
+
+        while (mHead && mHead->batch <= batch) {
+            // The node lives in the awaiter, which is gone once the coroutine is resumed.
+            auto *node = mHead;
+            const auto coroutine = node->coroutine;
+            remove(*node);
+            coroutine.resume();
+        }
+    }
+
+    ReadyNode *mHead = nullptr;
+    ReadyNode *mTail = nullptr;
+    std::uint64_t mNextBatch = 0;
+    bool mEventPosted = false;
+};
+
+inline ReadyNode::~ReadyNode() {
+    if (queue) {
+        queue->remove(*this);
+    }
+}
+
+//! Resumes the coroutine from the event loop of the current thread.
+inline void resumeQueued(ReadyNode &node, QCORO_STD::coroutine_handle<> coroutine) {
+    ReadyQueue::instance()->schedule(node, coroutine);
+}
+
+//! Resumes the coroutine according to the current thread's ResumePolicy.
+inline void resumeCoroutine(ReadyNode &node, QCORO_STD::coroutine_handle<> coroutine) {
+    if (currentResumePolicy() == ResumePolicy::Direct) {
+        coroutine.resume();
+    } else {
+        resumeQueued(node, coroutine);
+    }
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Sets how coroutines suspended on IO and wait operations in the current thread are resumed.
+/*!
+ * The policy applies to operations that complete in the current thread, e.g. to all
+ * `co_await qCoro(socket).readAll()` calls on sockets living in the current thread.
+ *
+ * \sa ResumePolicy
+ */
+inline void setResumePolicy(ResumePolicy policy) noexcept {
+    detail::currentResumePolicy() = policy;
+}
+
+//! Returns the resume policy of the current thread.
+inline ResumePolicy resumePolicy() noexcept {
+    return detail::currentResumePolicy();
+}
+
+} // namespace QCoro
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../asyncgenerator.h"
+#include "../qcorosignal.h"
+
+#include <QPointer>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Implementation of connections() of the server wrappers (QTcpServer, QLocalServer).
+/*!
+ * References the \c server rather than the wrapper, which doesn't have to outlive the stream.
+ */
+template<typename Server, typename Socket>
+AsyncGenerator<Socket *> serverConnections(QPointer<Server> server) {
+    if (!server) {
+        co_return;
+    }
+
+    // Stays connected for the whole lifetime of the stream. Emissions are only used to
+    // wake up the generator, which then takes all the pending connections, so there's
+    // no point in queueing more than one.
+    QCoroSignalListener<Server, decltype(&Server::newConnection)> listener{
+        server.data(), &Server::newConnection, 1};
+    while (server) {
+        while (server && server->hasPendingConnections()) {
+            co_yield server->nextPendingConnection();
+        }
+        if (!server || !co_await listener.next()) {
+            break;
+        }
+    }
+}
+
+} // namespace QCoro::detail
+
+/*! \endcond */
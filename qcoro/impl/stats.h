@@ -0,0 +1,278 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace QCoro {
+
+//! Kinds of operations a coroutine can be suspended on, reported by QCoro::stats().
+enum class AwaiterKind : std::uint8_t {
+    //! Reading from a QIODevice, or waiting for a QNetworkReply to finish.
+    IORead,
+    //! Writing into a QIODevice.
+    IOWrite,
+    //! The waitFor* operations, e.g. waiting for a socket to connect.
+    WaitFor,
+    //! Pending DBus calls.
+    DBus,
+    //! QFuture.
+    Future,
+    //! Qt signals.
+    Signal,
+    //! QTimer and QCoro::sleepFor().
+    Timer,
+    //! Other coroutines - QCoro::Task, QCoro::LazyTask and QCoro::SharedTask.
+    Task,
+    //! Anything else, e.g. QCoro::Mutex or QCoro::Channel.
+    Other,
+};
+
+//! Number of values of the AwaiterKind enum.
+inline constexpr std::size_t AwaiterKindCount = static_cast<std::size_t>(AwaiterKind::Other) + 1;
+
+//! Histogram of durations for which coroutines have been suspended.
+struct SuspendDurationHistogram {
+    //! Upper bounds of the buckets, the last bucket counts all longer suspensions.
+    static constexpr std::array<std::chrono::nanoseconds, 7> BucketBounds = {
+        std::chrono::microseconds{10}, std::chrono::microseconds{100},
+        std::chrono::milliseconds{1},  std::chrono::milliseconds{10},
+        std::chrono::milliseconds{100}, std::chrono::seconds{1},
+        std::chrono::seconds{10}};
+
+    //! Number of suspensions in each bucket (not cumulative).
+    std::array<std::uint64_t, BucketBounds.size() + 1> buckets = {};
+    //! Total number of suspensions.
+    std::uint64_t count = 0;
+    //! Sum of all the suspension durations.
+    std::chrono::nanoseconds sum{0};
+};
+
+/*! \cond internal */
+
+namespace detail {
+
+#ifndef QCORO_DISABLE_STATS
+
+//! Statistics counters updated by a single thread.
+/*!
+ * Only the owning thread writes into the counters, so updating them requires no atomic
+ * read-modify-write operations, the atomics only make it safe to read them from another
+ * thread. Counters can be negative, e.g. when a frame allocated in one thread is released
+ * in another one, only the sum over all threads is meaningful.
+ */
+class StatsCounters {
+public:
+    StatsCounters() = default;
+    Q_DISABLE_COPY(StatsCounters)
+
+    struct Histogram {
+        std::array<std::atomic<std::uint64_t>, SuspendDurationHistogram::BucketBounds.size() + 1>
+            buckets = {};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::int64_t> sum{0};
+    };
+
+    template<typename T, typename U>
+    static void add(std::atomic<T> &counter, U value) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + static_cast<T>(value),
+                      std::memory_order_relaxed);
+    }
+
+    void recordSuspension(AwaiterKind kind, std::chrono::nanoseconds duration) noexcept {
+        auto &histogram = durations[static_cast<std::size_t>(kind)];
+        const auto &bounds = SuspendDurationHistogram::BucketBounds;
+        std::size_t bucket = 0;
+        while (bucket < bounds.size() && duration > bounds[bucket]) {
+            ++bucket;
+        }
+        add(histogram.buckets[bucket], 1);
+        add(histogram.count, 1);
+        add(histogram.sum, duration.count());
+    }
+
+    //! Adds values of all counters into the \c other counters.
+    void addTo(StatsCounters &other) const noexcept {
+        const auto addCounter = [](auto &to, const auto &from) {
+            add(to, from.load(std::memory_order_relaxed));
+        };
+        addCounter(other.liveFrames, liveFrames);
+        addCounter(other.frameBytes, frameBytes);
+        addCounter(other.activeTimeouts, activeTimeouts);
+        for (std::size_t kind = 0; kind < AwaiterKindCount; ++kind) {
+            addCounter(other.suspended[kind], suspended[kind]);
+            auto &to = other.durations[kind];
+            const auto &from = durations[kind];
+            for (std::size_t bucket = 0; bucket < from.buckets.size(); ++bucket) {
+                addCounter(to.buckets[bucket], from.buckets[bucket]);
+            }
+            addCounter(to.count, from.count);
+            addCounter(to.sum, from.sum);
+        }
+    }
+
+    std::atomic<std::int64_t> liveFrames{0};
+    std::atomic<std::int64_t> frameBytes{0};
+    std::atomic<std::int64_t> activeTimeouts{0};
+    std::array<std::atomic<std::int64_t>, AwaiterKindCount> suspended = {};
+    std::array<Histogram, AwaiterKindCount> durations = {};
+};
+
+//! Keeps track of the counters of all threads.
+/*!
+ * When a thread finishes, its counters are folded into the retired counters, which are
+ * also used by threads whose counters have already been destroyed during thread exit.
+ */
+class StatsRegistry {
+public:
+    static StatsRegistry &instance() {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    void registerThread(StatsCounters *counters) {
+        std::scoped_lock lock{mMutex};
+        mThreads.push_back(counters);
+    }
+
+    void unregisterThread(StatsCounters *counters) {
+        std::scoped_lock lock{mMutex};
+        counters->addTo(mRetired);
+        std::erase(mThreads, counters);
+    }
+
+    //! Updates the retired counters, writes to them are serialized by the mutex.
+    template<typename Update>
+    void updateRetired(Update &&update) {
+        std::scoped_lock lock{mMutex};
+        update(mRetired);
+    }
+
+    //! Returns the sum of the counters of all threads.
+    template<typename Visitor>
+    void visit(Visitor &&visitor) const {
+        std::scoped_lock lock{mMutex};
+        visitor(mRetired);
+        for (const auto *counters : mThreads) {
+            visitor(*counters);
+        }
+    }
+
+private:
+    StatsRegistry() = default;
+
+    mutable std::mutex mMutex;
+    std::vector<StatsCounters *> mThreads;
+    StatsCounters mRetired;
+};
+
+//! Statistics counters of the current thread.
+class ThreadStats {
+public:
+    //! Returns the counters of the current thread, or \c nullptr if they're already destroyed.
+    static StatsCounters *instance() noexcept {
+        if (sDestroyed) {
+            return nullptr;
+        }
+        thread_local ThreadStats stats;
+        return &stats.mCounters;
+    }
+
+private:
+    ThreadStats() {
+        StatsRegistry::instance().registerThread(&mCounters);
+    }
+
+    ~ThreadStats() {
+        StatsRegistry::instance().unregisterThread(&mCounters);
+        sDestroyed = true;
+    }
+
+    StatsCounters mCounters;
+
+    //! Set once the counters of the current thread are destroyed during thread exit.
+    static inline thread_local bool sDestroyed = false;
+};
+
+template<typename Update>
+inline void updateStats(Update &&update) noexcept {
+    if (auto *counters = ThreadStats::instance(); counters != nullptr) {
+        update(*counters);
+    } else {
+        StatsRegistry::instance().updateRetired(update);
+    }
+}
+
+inline void statsFrameAllocated(std::size_t size) noexcept {
+    updateStats([size](StatsCounters &counters) {
+        StatsCounters::add(counters.liveFrames, 1);
+        StatsCounters::add(counters.frameBytes, size);
+    });
+}
+
+inline void statsFrameReleased(std::size_t size) noexcept {
+    updateStats([size](StatsCounters &counters) {
+        StatsCounters::add(counters.liveFrames, -1);
+        StatsCounters::add(counters.frameBytes, -static_cast<std::int64_t>(size));
+    });
+}
+
+//! Records that a coroutine has been suspended on an operation of given \c kind.
+/*!
+ * \return The time of the suspension, to be passed to statsAwaitResumed().
+ */
+inline std::chrono::steady_clock::time_point statsAwaitSuspended(AwaiterKind kind) noexcept {
+    updateStats([kind](StatsCounters &counters) {
+        StatsCounters::add(counters.suspended[static_cast<std::size_t>(kind)], 1);
+    });
+    return std::chrono::steady_clock::now();
+}
+
+inline void statsAwaitResumed(AwaiterKind kind,
+                              std::chrono::steady_clock::time_point suspended) noexcept {
+    const auto duration = std::chrono::steady_clock::now() - suspended;
+    updateStats([kind, duration](StatsCounters &counters) {
+        StatsCounters::add(counters.suspended[static_cast<std::size_t>(kind)], -1);
+        counters.recordSuspension(kind, duration);
+    });
+}
+
+//! Records that a suspended coroutine has been destroyed without being resumed.
+inline void statsAwaitAbandoned(AwaiterKind kind) noexcept {
+    updateStats([kind](StatsCounters &counters) {
+        StatsCounters::add(counters.suspended[static_cast<std::size_t>(kind)], -1);
+    });
+}
+
+inline void statsTimeoutStarted() noexcept {
+    updateStats([](StatsCounters &counters) { StatsCounters::add(counters.activeTimeouts, 1); });
+}
+
+inline void statsTimeoutFinished() noexcept {
+    updateStats([](StatsCounters &counters) { StatsCounters::add(counters.activeTimeouts, -1); });
+}
+
+#else // QCORO_DISABLE_STATS
+
+inline void statsFrameAllocated(std::size_t) noexcept {}
+inline void statsFrameReleased(std::size_t) noexcept {}
+inline void statsTimeoutStarted() noexcept {}
+inline void statsTimeoutFinished() noexcept {}
+
+#endif // QCORO_DISABLE_STATS
+
+} // namespace detail
+
+/*! \endcond */
+
+} // namespace QCoro
@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimerEvent>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+class TimerWheel;
+
+//! A timeout registered with the TimerWheel.
+/*!
+ * The entry is embedded in the awaiter object, so scheduling a timeout doesn't need to
+ * allocate, nor to create a QTimer. It is only linked into the wheel while it's scheduled.
+ */
+class TimeoutEntry {
+public:
+    TimeoutEntry() = default;
+    Q_DISABLE_COPY(TimeoutEntry)
+
+    //! Entries are only linked while scheduled, so moving an entry doesn't move the links.
+    TimeoutEntry(TimeoutEntry &&) noexcept {}
+    TimeoutEntry &operator=(TimeoutEntry &&) noexcept {
+        return *this;
+    }
+
+    virtual ~TimeoutEntry();
+
+protected:
+    //! Schedules the timeout to expire after \c timeout in the current thread's TimerWheel.
+    void scheduleTimeout(std::chrono::milliseconds timeout);
+
+    //! Cancels the timeout, if scheduled. Does nothing otherwise.
+    void cancelTimeout() noexcept;
+
+    //! Returns whether the timeout is scheduled and hasn't expired yet.
+    bool isTimeoutScheduled() const noexcept {
+        return mWheel != nullptr;
+    }
+
+    //! Called from the event loop once the timeout expires.
+    virtual void timedOut() = 0;
+
+private:
+    friend class TimerWheel;
+
+    TimerWheel *mWheel = nullptr;
+    TimeoutEntry *mPrev = nullptr;
+    TimeoutEntry *mNext = nullptr;
+    qint64 mDeadline = 0;
+    std::size_t mSlot = 0;
+};
+
+//! Per-thread hashed timer wheel for timeouts of coroutine operations.
+/*!
+ * Timeouts of waitFor* operations rarely expire, the operation usually finishes first and
+ * cancels its timeout. Instead of a QTimer per operation, all timeouts in a thread are
+ * stored in a single wheel of slots, driven by a single timer that only runs while there
+ * are any timeouts scheduled. Scheduling and cancelling a timeout are O(1).
+ *
+ * Each slot covers \c TickMsecs milliseconds, a timeout expires at most one tick after its
+ * deadline. Timeouts longer than one revolution of the wheel stay in their slot and are
+ * skipped until their deadline is reached.
+ */
+class TimerWheel final : public QObject {
+public:
+    //! Returns the TimerWheel for the current thread.
+    static TimerWheel *instance() {
+        thread_local TimerWheel wheel;
+        return &wheel;
+    }
+
+    void schedule(TimeoutEntry *entry, std::chrono::milliseconds timeout) {
+        Q_ASSERT(entry->mWheel == nullptr);
+        if (mCount++ == 0) {
+            mTimer.start(TickMsecs, this);
+            mCurrentTick = currentTick();
+        }
+
+        entry->mWheel = this;
+        entry->mDeadline = mClock.elapsed() + std::max<qint64>(timeout.count(), 0);
+        // Round up, the entry must not be visited before its deadline. Entries that would
+        // land in an already processed tick go to the next one.
+        const qint64 tick =
+            std::max((entry->mDeadline + TickMsecs - 1) / TickMsecs, mCurrentTick + 1);
+        entry->mSlot = static_cast<std::size_t>(tick % SlotCount);
+
+        auto &head = mSlots[entry->mSlot];
+        entry->mPrev = nullptr;
+        entry->mNext = head;
+        if (head) {
+            head->mPrev = entry;
+        }
+        head = entry;
+    }
+
+    void cancel(TimeoutEntry *entry) noexcept {
+        Q_ASSERT(entry->mWheel == this);
+        unlink(entry);
+        if (--mCount == 0) {
+            mTimer.stop();
+        }
+    }
+
+protected:
+    void timerEvent(QTimerEvent *event) override {
+        if (event->timerId() != mTimer.timerId()) {
+            QObject::timerEvent(event);
+            return;
+        }
+
+        const qint64 now = mClock.elapsed();
+        const qint64 tick = currentTick();
+        // If the event loop was blocked for longer than a full revolution, each slot
+        // needs to be visited only once.
+        const qint64 firstTick = std::max(mCurrentTick + 1, tick - SlotCount + 1);
+        mCurrentTick = tick;
+
+        // Unlink all expired entries first and only then notify them, just like
+        // IODeviceNotifier does, since notifying an entry may cancel other entries.
+        // Entries are notified tick by tick, in the order in which they were scheduled.
+        TimeoutEntry *expired = nullptr;
+        TimeoutEntry *expiredTail = nullptr;
+        for (qint64 t = firstTick; t <= tick; ++t) {
+            // Slots are ordered from the most recently scheduled entry, reverse them.
+            TimeoutEntry *slotExpired = nullptr;
+            TimeoutEntry *slotExpiredTail = nullptr;
+            for (auto *entry = mSlots[static_cast<std::size_t>(t % SlotCount)]; entry;) {
+                auto *next = entry->mNext;
+                if (entry->mDeadline <= now) {
+                    unlink(entry);
+                    --mCount;
+                    entry->mNext = slotExpired;
+                    slotExpired = entry;
+                    if (!slotExpiredTail) {
+                        slotExpiredTail = entry;
+                    }
+                }
+                entry = next;
+            }
+            if (slotExpired) {
+                if (expiredTail) {
+                    expiredTail->mNext = slotExpired;
+                } else {
+                    expired = slotExpired;
+                }
+                expiredTail = slotExpiredTail;
+            }
+        }
+
+        if (mCount == 0) {
+            mTimer.stop();
+        }
+
+        while (expired) {
+            auto *entry = expired;
+            expired = entry->mNext;
+            entry->mNext = nullptr;
+            entry->timedOut();
+        }
+    }
+
+private:
+    static constexpr int TickMsecs = 10;
+    static constexpr qint64 SlotCount = 512;
+
+    TimerWheel() {
+        mClock.start();
+    }
+
+    ~TimerWheel() override {
+        // The thread is finishing, detach the remaining entries so that they don't
+        // reference us when destroyed.
+        for (auto *head : mSlots) {
+            for (auto *entry = head; entry;) {
+                auto *next = entry->mNext;
+                entry->mWheel = nullptr;
+                entry->mPrev = entry->mNext = nullptr;
+                entry = next;
+            }
+        }
+    }
+
+    qint64 currentTick() const {
+        return mClock.elapsed() / TickMsecs;
+    }
+
+    void unlink(TimeoutEntry *entry) noexcept {
+        if (entry->mPrev) {
+            entry->mPrev->mNext = entry->mNext;
+        } else {
+            mSlots[entry->mSlot] = entry->mNext;
+        }
+        if (entry->mNext) {
+            entry->mNext->mPrev = entry->mPrev;
+        }
+        entry->mWheel = nullptr;
+        entry->mPrev = entry->mNext = nullptr;
+    }
+
+    std::array<TimeoutEntry *, static_cast<std::size_t>(SlotCount)> mSlots = {};
+    std::size_t mCount = 0;
+    //! Last tick processed by timerEvent().
+    qint64 mCurrentTick = 0;
+    QElapsedTimer mClock;
+    QBasicTimer mTimer;
+};
+
+inline TimeoutEntry::~TimeoutEntry() {
+    cancelTimeout();
+}
+
+inline void TimeoutEntry::scheduleTimeout(std::chrono::milliseconds timeout) {
+    TimerWheel::instance()->schedule(this, timeout);
+}
+
+inline void TimeoutEntry::cancelTimeout() noexcept {
+    if (mWheel) {
+        mWheel->cancel(this);
+    }
+}
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -0,0 +1,264 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+
+#include <QtGlobal>
+
+#include <cstdint>
+#include <string_view>
+
+#ifdef QCORO_ENABLE_TRACING
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Returns the name of the type \c T.
+/*!
+ * The view points to a string with static storage duration, but it is not null-terminated.
+ */
+template<typename T>
+constexpr std::string_view typeName() noexcept {
+#if defined(__clang__) || defined(__GNUC__)
+    // "... typeName() [with T = Foo; std::string_view = ...]" (GCC), "... [T = Foo]" (Clang)
+    constexpr std::string_view function = __PRETTY_FUNCTION__;
+    constexpr auto start = function.find("T = ") + 4;
+    constexpr auto semicolon = function.find(';', start);
+    constexpr auto end = semicolon != std::string_view::npos ? semicolon : function.rfind(']');
+    return function.substr(start, end - start);
+#else
+    return "unknown";
+#endif
+}
+
+//! Events recorded by the tracing hooks.
+enum class TraceEventType : std::uint8_t {
+    //! The coroutine has been created, the name is the type of the coroutine.
+    Created,
+    //! The coroutine has given itself a name.
+    Named,
+    //! The coroutine has been suspended, the name is the type of the awaitable.
+    Suspended,
+    //! The coroutine has been resumed, the name is the type of the awaitable.
+    Resumed,
+    //! The coroutine has reached its final suspend point.
+    Finished,
+    //! The coroutine frame has been destroyed.
+    Destroyed,
+};
+
+#ifdef QCORO_ENABLE_TRACING
+
+//! An event recorded by the tracing hooks.
+struct TraceEvent {
+    //! Nanoseconds since the epoch of std::chrono::steady_clock
+    std::int64_t timestamp;
+    //! Address of the coroutine frame.
+    const void *coroutine;
+    const char *name;
+    std::uint32_t nameLength;
+    TraceEventType type;
+};
+
+//! Fixed-size ring buffer of trace events recorded in a single thread.
+/*!
+ * Only the owning thread writes into the buffer, so recording an event is just a few relaxed
+ * stores and a release increment of the head. Once the buffer is full, the oldest events are
+ * overwritten. snapshot() can be called from any thread: each slot is a seqlock with atomic
+ * fields, so events that have been overwritten while they were being copied are discarded.
+ */
+class TraceBuffer {
+public:
+    TraceBuffer(std::size_t capacity, std::uint32_t threadId)
+        : mSlots(std::bit_ceil(std::max<std::size_t>(capacity, 2))),
+          mMask(mSlots.size() - 1), mThreadId(threadId) {}
+    Q_DISABLE_COPY(TraceBuffer)
+
+    void record(TraceEventType type, const void *coroutine, std::string_view name) noexcept {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        const auto head = mHead.load(std::memory_order_relaxed);
+        auto &slot = mSlots[head & mMask];
+        slot.sequence.store(Slot::Writing, std::memory_order_relaxed);
+        // Readers that see any of the stores below also see that the slot is being written
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(),
+                             std::memory_order_relaxed);
+        slot.coroutine.store(coroutine, std::memory_order_relaxed);
+        slot.name.store(name.data(), std::memory_order_relaxed);
+        slot.nameLength.store(static_cast<std::uint32_t>(name.size()), std::memory_order_relaxed);
+        slot.type.store(type, std::memory_order_relaxed);
+        slot.sequence.store(head + 1, std::memory_order_release);
+        mHead.store(head + 1, std::memory_order_release);
+    }
+
+    //! Returns the recorded events, oldest first.
+    std::vector<TraceEvent> snapshot() const {
+        const auto capacity = static_cast<std::uint64_t>(mSlots.size());
+        const auto head = mHead.load(std::memory_order_acquire);
+        const auto first = std::max(head > capacity ? head - capacity : 0,
+                                    mCleared.load(std::memory_order_acquire));
+
+        std::vector<TraceEvent> events;
+        events.reserve(static_cast<std::size_t>(head - first));
+        for (auto i = first; i < head; ++i) {
+            const auto &slot = mSlots[i & mMask];
+            if (slot.sequence.load(std::memory_order_acquire) != i + 1) {
+                // Already overwritten by the owning thread, and so are all the events before i
+                events.clear();
+                continue;
+            }
+            const TraceEvent event{slot.timestamp.load(std::memory_order_relaxed),
+                                   slot.coroutine.load(std::memory_order_relaxed),
+                                   slot.name.load(std::memory_order_relaxed),
+                                   slot.nameLength.load(std::memory_order_relaxed),
+                                   slot.type.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != i + 1) {
+                events.clear();
+                continue;
+            }
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    //! Discards all events recorded so far.
+    void clear() noexcept {
+        mCleared.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    std::uint32_t threadId() const noexcept {
+        return mThreadId;
+    }
+
+private:
+    //! Storage of one TraceEvent, which can be read while it's being overwritten.
+    struct Slot {
+        //! Marks a slot that is being written.
+        static constexpr std::uint64_t Writing = 0;
+
+        //! Index of the stored event plus one, or Writing.
+        std::atomic<std::uint64_t> sequence{Writing};
+        std::atomic<std::int64_t> timestamp{0};
+        std::atomic<const void *> coroutine{nullptr};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<std::uint32_t> nameLength{0};
+        std::atomic<TraceEventType> type{TraceEventType::Created};
+    };
+
+    std::vector<Slot> mSlots;
+    std::size_t mMask;
+    std::uint32_t mThreadId;
+    std::atomic<std::uint64_t> mHead{0};
+    std::atomic<std::uint64_t> mCleared{0};
+};
+
+//! Keeps trace buffers of all threads, including those that have already finished.
+class TraceRegistry {
+public:
+    static TraceRegistry &instance() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    std::shared_ptr<TraceBuffer> registerThread() {
+        std::scoped_lock lock{mMutex};
+        auto buffer = std::make_shared<TraceBuffer>(mCapacity, ++mLastThreadId);
+        mBuffers.push_back(buffer);
+        return buffer;
+    }
+
+    std::vector<std::shared_ptr<TraceBuffer>> buffers() const {
+        std::scoped_lock lock{mMutex};
+        return mBuffers;
+    }
+
+    //! Discards all recorded events, and the buffers of threads that have finished.
+    void clear() {
+        std::scoped_lock lock{mMutex};
+        std::erase_if(mBuffers, [](const auto &buffer) { return buffer.use_count() == 1; });
+        for (const auto &buffer : mBuffers) {
+            buffer->clear();
+        }
+    }
+
+    void setCapacity(std::size_t capacity) {
+        std::scoped_lock lock{mMutex};
+        mCapacity = capacity;
+    }
+
+    bool isEnabled() const noexcept {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool enabled) noexcept {
+        mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+private:
+    TraceRegistry() = default;
+
+    mutable std::mutex mMutex;
+    std::vector<std::shared_ptr<TraceBuffer>> mBuffers;
+    std::size_t mCapacity = 64 * 1024;
+    std::uint32_t mLastThreadId = 0;
+    std::atomic<bool> mEnabled{true};
+};
+
+//! Records an event into the trace buffer of the current thread.
+inline void traceEvent(TraceEventType type, const void *coroutine,
+                       std::string_view name = {}) noexcept {
+    auto &registry = TraceRegistry::instance();
+    if (!registry.isEnabled()) {
+        return;
+    }
+    thread_local const auto buffer = registry.registerThread();
+    buffer->record(type, coroutine, name);
+}
+
+#else // QCORO_ENABLE_TRACING
+
+inline void traceEvent(TraceEventType, const void *, std::string_view = {}) noexcept {}
+
+#endif // QCORO_ENABLE_TRACING
+
+//! Awaitable returned by QCoro::traceName(), names the awaiting coroutine without suspending it.
+class TraceNameAwaiter {
+public:
+    explicit constexpr TraceNameAwaiter(const char *name) noexcept : mName(name) {}
+
+    bool await_ready() const noexcept {
+#ifdef QCORO_ENABLE_TRACING
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) const noexcept {
+        traceEvent(TraceEventType::Named, awaitingCoroutine.address(), mName);
+        return false;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    const char *mName;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
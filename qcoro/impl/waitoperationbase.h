@@ -4,61 +4,110 @@
 
 #pragma once
 
+#include "../coroutine.h"
 #include "../macros.h"
+#include "resume.h"
+#include "stats.h"
+#include "timerwheel.h"
 
-#include <QTimer>
+#include <QPointer>
+
+#include <chrono>
+#include <utility>
 
 namespace QCoro::detail {
 
 //! Base class for co_awaitable waitFor* operations.
+/*!
+ * The timeout is scheduled in the per-thread TimerWheel rather than in a QTimer owned
+ * by each operation, since most of the timeouts never expire.
+ */
 template<typename T>
-class WaitOperationBase {
+class WaitOperationBase : private TimeoutEntry {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::WaitFor;
+    }
+
     Q_DISABLE_COPY(WaitOperationBase)
     QCORO_DEFAULT_MOVE(WaitOperationBase)
 
-    ~WaitOperationBase() = default;
+    ~WaitOperationBase() override {
+        timeoutFinished();
+        QObject::disconnect(mConn);
+    }
 
     bool await_resume() noexcept {
         return !mTimedOut;
     }
 
-protected:
-    WaitOperationBase(T *obj, int timeout_msecs) : mObj{obj} {
-        if (timeout_msecs > -1) {
-            mTimeoutTimer = std::make_unique<QTimer>();
-            mTimeoutTimer->setInterval(timeout_msecs);
-            mTimeoutTimer->setSingleShot(true);
+    //! Stops waiting for the operation.
+    /*!
+     * \return Whether the operation has been cancelled before the coroutine was scheduled
+     * to be resumed. If so, the coroutine will not be resumed by the operation.
+     */
+    bool cancel() noexcept {
+        if (mResumed) {
+            return false;
         }
+        mResumed = true;
+        stop();
+        return true;
     }
 
+protected:
+    WaitOperationBase(T *obj, int timeout_msecs) : mObj{obj}, mTimeout{timeout_msecs} {}
+
     void startTimeoutTimer(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-        if (!mTimeoutTimer) {
+        if (mTimeout < 0) {
             return;
         }
 
-        QObject::connect(mTimeoutTimer.get(), &QTimer::timeout,
-                         [this, awaitingCoroutine]() mutable {
-                             mTimedOut = true;
-                             resume(awaitingCoroutine);
-                         });
-        mTimeoutTimer->start();
+        mAwaitingCoroutine = awaitingCoroutine;
+        scheduleTimeout(std::chrono::milliseconds{mTimeout});
+        mTimeoutActive = true;
+        statsTimeoutStarted();
     }
 
     void resume(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-        if (mTimeoutTimer) {
-            mTimeoutTimer->stop();
-        }
+        mResumed = true;
+        stop();
+        resumeCoroutine(mReadyNode, awaitingCoroutine);
+    }
 
+    void stop() {
+        timeoutFinished();
+        cancelTimeout();
         QObject::disconnect(mConn);
-
-        QTimer::singleShot(0, [awaitingCoroutine]() mutable { awaitingCoroutine.resume(); });
     }
 
     QPointer<T> mObj;
-    std::unique_ptr<QTimer> mTimeoutTimer;
     QMetaObject::Connection mConn;
+    ReadyNode mReadyNode;
     bool mTimedOut = false;
+
+private:
+    void timedOut() override {
+        timeoutFinished();
+        mTimedOut = true;
+        mResumed = true;
+        QObject::disconnect(mConn);
+        // Always resume from the event loop, resuming directly could destroy other
+        // operations whose timeouts expired in the same tick of the wheel.
+        resumeQueued(mReadyNode, mAwaitingCoroutine);
+    }
+
+    //! Updates the statistics once the timeout has been cancelled or has expired.
+    void timeoutFinished() noexcept {
+        if (std::exchange(mTimeoutActive, false)) {
+            statsTimeoutFinished();
+        }
+    }
+
+    int mTimeout;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    bool mResumed = false;
+    bool mTimeoutActive = false;
 };
 
 } // namespace QCoro::detail
@@ -0,0 +1,202 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+#include "resume.h"
+
+#include <QAbstractEventDispatcher>
+#include <QMetaObject>
+#include <QThread>
+
+#include <utility>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! A coroutine suspended on one of the synchronization primitives.
+/*!
+ * The waiter is embedded in the awaiter object of the suspended coroutine, so suspending
+ * doesn't need to allocate.
+ */
+struct SyncWaiter {
+    SyncWaiter *prev = nullptr;
+    SyncWaiter *next = nullptr;
+    QCORO_STD::coroutine_handle<> coroutine = {};
+    //! Thread in which the coroutine has suspended and in which it will be resumed.
+    QThread *thread = nullptr;
+    ReadyNode readyNode;
+    bool linked = false;
+};
+
+//! Intrusive FIFO of coroutines waiting for a synchronization primitive.
+/*!
+ * The queue is not synchronized, it must be protected by the primitive that owns it.
+ */
+class WaitQueue {
+public:
+    bool isEmpty() const noexcept {
+        return mHead == nullptr;
+    }
+
+    void push(SyncWaiter *waiter) noexcept {
+        Q_ASSERT(!waiter->linked);
+        waiter->prev = mTail;
+        waiter->next = nullptr;
+        waiter->linked = true;
+        if (mTail) {
+            mTail->next = waiter;
+        } else {
+            mHead = waiter;
+        }
+        mTail = waiter;
+    }
+
+    //! Removes the longest waiting coroutine from the queue.
+    SyncWaiter *pop() noexcept {
+        auto *waiter = mHead;
+        if (waiter) {
+            remove(waiter);
+        }
+        return waiter;
+    }
+
+    void remove(SyncWaiter *waiter) noexcept {
+        Q_ASSERT(waiter->linked);
+        if (waiter->prev) {
+            waiter->prev->next = waiter->next;
+        } else {
+            mHead = waiter->next;
+        }
+        if (waiter->next) {
+            waiter->next->prev = waiter->prev;
+        } else {
+            mTail = waiter->prev;
+        }
+        waiter->prev = waiter->next = nullptr;
+        waiter->linked = false;
+    }
+
+private:
+    SyncWaiter *mHead = nullptr;
+    SyncWaiter *mTail = nullptr;
+};
+
+//! Resumes a coroutine popped from a WaitQueue in the thread in which it has suspended.
+/*!
+ * Waiters from the current thread are resumed according to the thread's ResumePolicy.
+ * Waiters from other threads are resumed by a queued call posted to the event dispatcher
+ * of their thread, just like resumeOn() does. Threads without an event dispatcher (e.g.
+ * QThreadPool workers) cannot be posted to, such waiters are resumed right away.
+ *
+ * Must be called after the primitive has released its internal lock, since the resumed
+ * coroutine may use the primitive again.
+ */
+inline void resumeWaiter(SyncWaiter *waiter) {
+    if (waiter->thread == QThread::currentThread()) {
+        resumeCoroutine(waiter->readyNode, waiter->coroutine);
+        return;
+    }
+
+    auto *dispatcher = QAbstractEventDispatcher::instance(waiter->thread);
+    if (!dispatcher) {
+        waiter->coroutine.resume();
+        return;
+    }
+    QMetaObject::invokeMethod(
+        dispatcher, [coroutine = waiter->coroutine]() mutable { coroutine.resume(); },
+        Qt::QueuedConnection);
+}
+
+//! Resumes a batch of coroutines popped from a WaitQueue, chained through their \c next pointer.
+/*!
+ * A resumed coroutine may destroy the coroutine of a later waiter in the batch, so unless the
+ * batch has a single waiter, waiters from the current thread are resumed from the event loop
+ * regardless of the ResumePolicy, in the order of the batch. The ReadyNode of a waiter whose
+ * coroutine is destroyed in the meantime removes itself from the ReadyQueue. Waiters from
+ * threads without an event dispatcher are resumed from the event loop of the current thread
+ * as well, or right away if the current thread doesn't have an event dispatcher either.
+ *
+ * Must be called after the primitive has released its internal lock.
+ */
+inline void resumeWaiters(SyncWaiter *batch) {
+    if (batch && !batch->next) {
+        resumeWaiter(batch);
+        return;
+    }
+    while (batch) {
+        auto *waiter = std::exchange(batch, batch->next);
+        waiter->next = nullptr;
+        if (waiter->thread == QThread::currentThread()
+            || (!QAbstractEventDispatcher::instance(waiter->thread)
+                && QAbstractEventDispatcher::instance())) {
+            resumeQueued(waiter->readyNode, waiter->coroutine);
+        } else {
+            resumeWaiter(waiter);
+        }
+    }
+}
+
+//! Awaiter that acquires a synchronization primitive.
+/*!
+ * The \c Primitive must provide \c tryAcquire(), which acquires the primitive if it's
+ * available, \c enqueue(waiter), which either acquires the primitive or queues the waiter
+ * and returns whether the waiter has been queued, and \c dequeue(waiter), which removes
+ * the waiter from the queue if it's still queued and returns whether it was removed.
+ *
+ * The awaiter can be cancelled (e.g. by QCoro::withTimeout()) while it waits in the queue.
+ */
+template<typename Primitive>
+class SyncAwaiter {
+public:
+    explicit SyncAwaiter(Primitive *primitive) : mPrimitive(primitive) {}
+    Q_DISABLE_COPY(SyncAwaiter)
+
+    //! The waiter is only linked while suspended, so moving the awaiter doesn't move it.
+    SyncAwaiter(SyncAwaiter &&other) noexcept : mPrimitive(other.mPrimitive) {}
+    SyncAwaiter &operator=(SyncAwaiter &&) = delete;
+
+    ~SyncAwaiter() {
+        cancel();
+    }
+
+    bool await_ready() {
+        return mPrimitive->tryAcquire();
+    }
+
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mWaiter.coroutine = awaitingCoroutine;
+        mWaiter.thread = QThread::currentThread();
+        // The coroutine may be resumed from another thread before enqueue() returns,
+        // so `this` must not be touched anymore once the waiter is queued.
+        mQueued = true;
+        if (!mPrimitive->enqueue(&mWaiter)) {
+            mQueued = false;
+            return false;
+        }
+        return true;
+    }
+
+    void await_resume() const noexcept {}
+
+    //! Stops waiting for the primitive.
+    /*!
+     * \return Whether the awaiter has been removed from the queue before it has acquired
+     * the primitive. If so, the coroutine will not be resumed by the primitive.
+     */
+    bool cancel() noexcept {
+        return mQueued && mPrimitive->dequeue(&mWaiter);
+    }
+
+protected:
+    Primitive *mPrimitive;
+    SyncWaiter mWaiter;
+    bool mQueued = false;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
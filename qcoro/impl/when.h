@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+#include "../task.h"
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Describes types that can be co_awaited from a coroutine returning Task<T>.
+template<typename T>
+concept TaskAwaitable = has_member_co_await<T> || Awaitable<std::remove_cvref_t<T>> || requires {
+    typename awaiter_type_t<std::remove_cvref_t<T>>;
+};
+
+template<typename T>
+auto awaitableResultType() {
+    if constexpr (has_member_co_await<T>) {
+        return std::type_identity<decltype(std::declval<T>().operator co_await().await_resume())>{};
+    } else if constexpr (Awaitable<std::remove_cvref_t<T>>) {
+        return std::type_identity<
+            decltype(std::declval<std::remove_cvref_t<T> &>().await_resume())>{};
+    } else {
+        return std::type_identity<
+            decltype(std::declval<awaiter_type_t<std::remove_cvref_t<T>> &>().await_resume())>{};
+    }
+}
+
+//! Type of the result of co_awaiting a value of type \c T in a QCoro coroutine.
+template<typename T>
+using awaitable_result_t = typename decltype(awaitableResultType<T>())::type;
+
+//! Like awaitable_result_t, but \c void results are represented by \c std::monostate.
+/*!
+ * Results returned by reference (e.g. by a SharedTask<T>) are stored as copies.
+ */
+template<typename T>
+using when_result_t = std::conditional_t<std::is_void_v<awaitable_result_t<T>>, std::monostate,
+                                         std::remove_cvref_t<awaitable_result_t<T>>>;
+
+//! Type in which the awaitable of type \c T is passed to the helper coroutines.
+/*!
+ * L-values are passed by reference, since the caller owns them, r-values are moved
+ * into the frame of the helper coroutine.
+ */
+template<typename T>
+using when_argument_t =
+    std::conditional_t<std::is_lvalue_reference_v<T>, T, std::remove_cvref_t<T>>;
+
+//! co_awaits the \c awaitable and stores its result into \c result.
+/*!
+ * \c void results are mapped to \c std::monostate.
+ */
+template<typename T>
+Task<> awaitInto(T awaitable, std::optional<when_result_t<T>> &result) {
+    if constexpr (std::is_void_v<awaitable_result_t<T>>) {
+        co_await std::forward<T>(awaitable);
+        result.emplace();
+    } else {
+        result.emplace(co_await std::forward<T>(awaitable));
+    }
+}
+
+//! A countdown latch that resumes a single awaiting coroutine.
+/*!
+ * The latch is initialized with the number of operations to wait for. Each finished
+ * operation calls countDown(). The coroutine co_awaiting the latch is resumed once all
+ * the operations have finished, or it doesn't suspend at all if they have all finished
+ * before it co_awaited the latch.
+ *
+ * The awaiter holds one extra count, so that the coroutine is resumed exactly once,
+ * regardless of whether the last operation finishes before or after the coroutine
+ * suspends.
+ */
+class WhenLatch {
+public:
+    explicit WhenLatch(std::size_t count) : mCount(count + 1) {}
+
+    //! Marks one of the operations as finished.
+    void countDown() noexcept {
+        if (mCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            mAwaitingCoroutine.resume();
+        }
+    }
+
+    //! Returns an Awaitable that suspends the awaiter until all operations have finished.
+    auto wait() noexcept {
+        class Awaiter {
+        public:
+            explicit Awaiter(WhenLatch &latch) : mLatch(latch) {}
+
+            bool await_ready() const noexcept {
+                return mLatch.mCount.load(std::memory_order_acquire) == 1;
+            }
+
+            bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mLatch.mAwaitingCoroutine = awaitingCoroutine;
+                return mLatch.mCount.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            WhenLatch &mLatch;
+        };
+        return Awaiter{*this};
+    }
+
+private:
+    std::atomic<std::size_t> mCount;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "../coroutine.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*! \cond internal */
+
+namespace QCoro::detail {
+
+//! Lock-free work-stealing deque of coroutine handles.
+/*!
+ * An implementation of the Chase-Lev deque, as described in "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" by Lê, Pop, Cohen and Zappa Nardelli.
+ *
+ * Only the thread that owns the deque may call push() and pop(), which operate on the
+ * bottom end of the deque in LIFO order. Any thread may call steal(), which takes the
+ * oldest element from the top end of the deque.
+ *
+ * The deque grows when full. Arrays that have been replaced are kept alive until the
+ * deque is destroyed, since a concurrent thief may still be reading from them.
+ */
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(std::size_t capacity = 256) {
+        auto array = std::make_unique<Array>(roundUpToPowerOfTwo(capacity));
+        mArray.store(array.get(), std::memory_order_relaxed);
+        mArrays.push_back(std::move(array));
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    //! Pushes the coroutine to the bottom of the deque. Must only be called by the owner.
+    void push(QCORO_STD::coroutine_handle<> coroutine) {
+        const auto bottom = mBottom.load(std::memory_order_relaxed);
+        const auto top = mTop.load(std::memory_order_acquire);
+        auto *array = mArray.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<std::int64_t>(array->capacity) - 1) {
+            array = grow(array, top, bottom);
+        }
+        array->put(bottom, coroutine.address());
+        mBottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    //! Pops the most recently pushed coroutine. Must only be called by the owner.
+    /*!
+     * \return Handle of the coroutine or a null handle if the deque is empty.
+     */
+    QCORO_STD::coroutine_handle<> pop() {
+        const auto bottom = mBottom.load(std::memory_order_relaxed) - 1;
+        auto *array = mArray.load(std::memory_order_relaxed);
+        mBottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = mTop.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return {};
+        }
+
+        void *address = array->get(bottom);
+        if (top == bottom) {
+            // Last element, race with thieves for it
+            if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                address = nullptr;
+            }
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return QCORO_STD::coroutine_handle<>::from_address(address);
+    }
+
+    //! Steals the oldest coroutine from the deque. Can be called from any thread.
+    /*!
+     * \return Handle of the coroutine or a null handle if the deque is empty or
+     *         another thread has won the race for the element.
+     */
+    QCORO_STD::coroutine_handle<> steal() {
+        auto top = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = mBottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return {};
+        }
+
+        auto *array = mArray.load(std::memory_order_acquire);
+        void *address = array->get(top);
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return {};
+        }
+        return QCORO_STD::coroutine_handle<>::from_address(address);
+    }
+
+    //! Returns whether the deque appears to be empty.
+    bool empty() const {
+        const auto bottom = mBottom.load(std::memory_order_relaxed);
+        const auto top = mTop.load(std::memory_order_relaxed);
+        return top >= bottom;
+    }
+
+private:
+    struct Array {
+        explicit Array(std::size_t capacity)
+            : capacity(capacity), mask(capacity - 1), buffer(new std::atomic<void *>[capacity]) {}
+
+        void put(std::int64_t index, void *address) noexcept {
+            buffer[static_cast<std::size_t>(index) & mask].store(address,
+                                                                 std::memory_order_relaxed);
+        }
+
+        void *get(std::int64_t index) const noexcept {
+            return buffer[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        const std::size_t capacity;
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<void *>[]> buffer;
+    };
+
+    Array *grow(Array *array, std::int64_t top, std::int64_t bottom) {
+        auto newArray = std::make_unique<Array>(array->capacity * 2);
+        for (auto i = top; i < bottom; ++i) {
+            newArray->put(i, array->get(i));
+        }
+        auto *result = newArray.get();
+        mArrays.push_back(std::move(newArray));
+        mArray.store(result, std::memory_order_release);
+        return result;
+    }
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+        std::size_t result = 2;
+        while (result < value) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    alignas(64) std::atomic<std::int64_t> mTop{0};
+    alignas(64) std::atomic<std::int64_t> mBottom{0};
+    std::atomic<Array *> mArray{nullptr};
+    //! All arrays ever used by the deque, only accessed by the owner.
+    std::vector<std::unique_ptr<Array>> mArrays;
+};
+
+} // namespace QCoro::detail
+
+/*! \endcond */
@@ -16,6 +16,10 @@ namespace QCoro::detail {
 
 class IODeviceAwaiter {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::IORead;
+    }
+
     explicit IODeviceAwaiter(QIODevice *device) : mDevice(device) {}
     explicit IODeviceAwaiter(QIODevice &device) : mDevice(&device){};
 
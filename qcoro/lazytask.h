@@ -0,0 +1,232 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "task.h"
+
+#include <utility>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! The promise_type for LazyTask<T>
+/*!
+ * Behaves exactly like \ref TaskPromise, except that the coroutine is suspended
+ * immediately after it's created and the user code only starts executing once
+ * the LazyTask is co_awaited or explicitly started.
+ */
+template<typename T>
+class LazyTaskPromise final : public TaskPromise<T> {
+public:
+    //! Constructs a LazyTask<T> for this promise.
+    LazyTask<T> get_return_object() noexcept;
+
+    //! Suspends the coroutine before any user code is executed.
+    QCORO_STD::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    //! Marks the coroutine as started.
+    /*!
+     * \return Returns true if the coroutine has not been started before, and thus
+     *         the caller is responsible for resuming the coroutine.
+     */
+    bool markStarted() noexcept {
+        return !std::exchange(mStarted, true);
+    }
+
+    //! Returns whether the coroutine has already been started.
+    bool isStarted() const noexcept {
+        return mStarted;
+    }
+
+private:
+    bool mStarted = false;
+};
+
+//! Base-class for Awaiter objects returned by the \c LazyTask<T> operator co_await().
+template<typename T>
+class LazyTaskAwaiterBase : public TaskAwaiterBase<LazyTaskPromise<T>> {
+public:
+    //! Called by co_await in a coroutine that co_awaits the lazy coroutine.
+    /*!
+     * Registers the awaiting coroutine with the promise of the awaited coroutine, same
+     * as \ref TaskAwaiterBase does. If the lazy coroutine hasn't been started yet, it is
+     * started by transferring execution to it directly.
+     */
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+        auto &promise = this->mAwaitedCoroutine.promise();
+        const bool start = promise.markStarted();
+        if (!promise.setAwaitingCoroutine(awaitingCoroutine)) {
+            return awaitingCoroutine;
+        }
+        if (start) {
+            return this->mAwaitedCoroutine;
+        }
+        return QCORO_STD::noop_coroutine();
+    }
+
+protected:
+    LazyTaskAwaiterBase(QCORO_STD::coroutine_handle<LazyTaskPromise<T>> awaitedCoroutine)
+        : TaskAwaiterBase<LazyTaskPromise<T>>{awaitedCoroutine} {}
+};
+
+} // namespace detail
+
+/*! \endcond */
+
+//! A lazily started asynchronous task.
+/*!
+ * Unlike \ref Task<T>, whose coroutine starts executing as soon as it's called, calling
+ * coroutine that returns LazyTask<T> only creates the coroutine, but doesn't execute any
+ * of its code. The coroutine is started once the LazyTask is co_awaited, or when it is
+ * explicitly started by calling \ref start().
+ *
+ * This allows to create a collection of pending work and let a scheduler decide when and
+ * in what order the work should be started.
+ *
+ * The lazy coroutine can co_await any types that can be co_awaited from a coroutine that
+ * returns Task<T>, and LazyTask<T> can be co_awaited from a coroutine returning Task<T>.
+ */
+template<typename T>
+class LazyTask {
+public:
+    //! Promise type of the coroutine. This is required by the C++ standard.
+    using promise_type = detail::LazyTaskPromise<T>;
+    //! The type of the coroutine return value.
+    using value_type = T;
+
+    //! Constructs a new empty task.
+    explicit LazyTask() noexcept = default;
+
+    //! Constructs a task bound to a coroutine.
+    /*!
+     * \param[in] coroutine handle of the coroutine that has constructed the task.
+     */
+    explicit LazyTask(QCORO_STD::coroutine_handle<promise_type> coroutine)
+        : mCoroutine(coroutine) {}
+
+    //! LazyTask cannot be copy-constructed.
+    LazyTask(const LazyTask &) = delete;
+    //! LazyTask cannot be copy-assigned.
+    LazyTask &operator=(const LazyTask &) = delete;
+
+    //! The task can be move-constructed.
+    LazyTask(LazyTask &&other) noexcept : mCoroutine(other.mCoroutine) {
+        other.mCoroutine = nullptr;
+    }
+
+    //! The task can be move-assigned.
+    LazyTask &operator=(LazyTask &&other) noexcept {
+        if (this != &other) {
+            releaseCoroutine();
+            mCoroutine = other.mCoroutine;
+            other.mCoroutine = nullptr;
+        }
+        return *this;
+    }
+
+    //! Destructor.
+    /*!
+     * Destroys the coroutine if it has not been started or if it has already finished.
+     * Otherwise the coroutine keeps running and destroys itself once it finishes.
+     */
+    ~LazyTask() {
+        releaseCoroutine();
+    }
+
+    //! Returns whether the coroutine has been started.
+    bool isStarted() const {
+        return mCoroutine && mCoroutine.promise().isStarted();
+    }
+
+    //! Returns whether the task has finished.
+    bool isReady() const {
+        return !mCoroutine || mCoroutine.promise().isFinished();
+    }
+
+    //! Starts executing the coroutine, unless it has been started already.
+    /*!
+     * The coroutine is executed until it reaches its first suspension point, the
+     * same way as when calling a coroutine returning \ref Task<T>. The result of
+     * the coroutine can then be obtained by co_awaiting the LazyTask.
+     */
+    void start() {
+        if (mCoroutine && mCoroutine.promise().markStarted()) {
+            mCoroutine.resume();
+        }
+    }
+
+    //! Provides an Awaiter for the coroutine machinery.
+    /*!
+     * Starts the coroutine if it has not been started yet and suspends the co_awaiting
+     * coroutine until the lazy coroutine finishes.
+     */
+    auto operator co_await() const &noexcept {
+        //! Specialization of the LazyTaskAwaiterBase that returns a reference to the promise result
+        class LazyTaskAwaiter : public detail::LazyTaskAwaiterBase<T> {
+        public:
+            LazyTaskAwaiter(QCORO_STD::coroutine_handle<promise_type> awaitedCoroutine)
+                : detail::LazyTaskAwaiterBase<T>{awaitedCoroutine} {}
+
+            //! Called when the co_awaited coroutine is resumed.
+            decltype(auto) await_resume() {
+                Q_ASSERT(this->mAwaitedCoroutine != nullptr);
+                return this->mAwaitedCoroutine.promise().result();
+            }
+        };
+        return LazyTaskAwaiter{mCoroutine};
+    }
+
+    //! \copydoc QCoro::LazyTask::operator co_await() const & noexcept
+    auto operator co_await() const &&noexcept {
+        //! Specialization of the LazyTaskAwaiterBase that returns the promise result as an r-value
+        //! reference.
+        class LazyTaskAwaiter : public detail::LazyTaskAwaiterBase<T> {
+        public:
+            LazyTaskAwaiter(QCORO_STD::coroutine_handle<promise_type> awaitedCoroutine)
+                : detail::LazyTaskAwaiterBase<T>{awaitedCoroutine} {}
+
+            //! Called when the co_awaited coroutine is resumed.
+            T await_resume() {
+                Q_ASSERT(this->mAwaitedCoroutine != nullptr);
+                return std::move(this->mAwaitedCoroutine.promise()).result();
+            }
+        };
+        return LazyTaskAwaiter{mCoroutine};
+    }
+
+private:
+    void releaseCoroutine() noexcept {
+        if (!mCoroutine) {
+            return;
+        }
+        // A coroutine that has never been started doesn't hold a reference to itself.
+        if (!mCoroutine.promise().isStarted() || mCoroutine.promise().release()) {
+            detail::traceEvent(detail::TraceEventType::Destroyed, mCoroutine.address());
+            mCoroutine.destroy();
+        }
+    }
+
+    //! The coroutine represented by this task
+    QCORO_STD::coroutine_handle<promise_type> mCoroutine = {};
+};
+
+namespace detail {
+
+template<typename T>
+inline LazyTask<T> LazyTaskPromise<T>::get_return_object() noexcept {
+    const auto coroutine = QCORO_STD::coroutine_handle<LazyTaskPromise>::from_promise(*this);
+    traceEvent(TraceEventType::Created, coroutine.address(), typeName<LazyTask<T>>());
+    return LazyTask<T>{coroutine};
+}
+
+} // namespace detail
+
+} // namespace QCoro
@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/waitqueue.h"
+#include "macros.h"
+
+#include <mutex>
+#include <utility>
+
+namespace QCoro {
+
+class Mutex;
+
+//! Unlocks the QCoro::Mutex when destroyed.
+/*!
+ * Returned by co_awaiting Mutex::scopedLock(), similarly to QMutexLocker.
+ */
+class MutexLocker {
+public:
+    explicit MutexLocker(Mutex *mutex) noexcept : mMutex(mutex) {}
+    Q_DISABLE_COPY(MutexLocker)
+
+    MutexLocker(MutexLocker &&other) noexcept : mMutex(std::exchange(other.mMutex, nullptr)) {}
+    MutexLocker &operator=(MutexLocker &&other) noexcept {
+        if (this != &other) {
+            unlock();
+            mMutex = std::exchange(other.mMutex, nullptr);
+        }
+        return *this;
+    }
+
+    ~MutexLocker() {
+        unlock();
+    }
+
+    //! Unlocks the mutex before the locker is destroyed.
+    void unlock();
+
+private:
+    Mutex *mMutex = nullptr;
+};
+
+//! A mutex for coroutines.
+/*!
+ * Coroutines co_awaiting the lock() of a locked mutex are suspended, instead of blocking
+ * the thread, and are resumed one by one, in the order in which they started waiting,
+ * as the mutex is unlocked. The mutex is handed over directly to the next waiting
+ * coroutine, so a coroutine that has just started waiting can't acquire the mutex before
+ * the coroutines that have been waiting longer.
+ *
+ * ```cpp
+ * QCoro::Task<> Database::write(Record record) {
+ *     const auto locker = co_await mMutex.scopedLock();
+ *     co_await writeRecord(record); // other coroutines calling write() wait here
+ * }
+ * ```
+ *
+ * The mutex can be shared by coroutines running in different threads, each coroutine is
+ * resumed in the thread in which it has co_awaited the lock.
+ *
+ * Unlike QMutex, the mutex is not owned by a thread or by a coroutine, so it can be unlocked
+ * by anyone. It is not recursive, a coroutine co_awaiting a mutex that it has already locked
+ * waits forever.
+ */
+class Mutex {
+public:
+    Mutex() = default;
+    Q_DISABLE_COPY(Mutex)
+
+    ~Mutex() {
+        Q_ASSERT(mWaiters.isEmpty());
+    }
+
+    //! Returns an Awaitable that locks the mutex.
+    /*!
+     * The awaiting coroutine is suspended until the mutex is locked. The awaiter can be
+     * cancelled, so the lock can be awaited with QCoro::withTimeout().
+     */
+    auto lock() noexcept {
+        return detail::SyncAwaiter<Mutex>{this};
+    }
+
+    //! Returns an Awaitable that locks the mutex and returns a MutexLocker.
+    /*!
+     * The mutex is unlocked when the returned MutexLocker is destroyed.
+     */
+    auto scopedLock() noexcept {
+        class ScopedLockAwaiter : public detail::SyncAwaiter<Mutex> {
+        public:
+            using detail::SyncAwaiter<Mutex>::SyncAwaiter;
+
+            MutexLocker await_resume() const noexcept {
+                return MutexLocker{mPrimitive};
+            }
+        };
+        return ScopedLockAwaiter{this};
+    }
+
+    //! Locks the mutex if it's not locked.
+    /*!
+     * \return Whether the mutex has been locked by this call.
+     */
+    bool tryLock() noexcept {
+        std::lock_guard guard{mLock};
+        return std::exchange(mLocked, true) == false;
+    }
+
+    //! Unlocks the mutex.
+    /*!
+     * If there are coroutines waiting for the mutex, the mutex stays locked and the
+     * coroutine that has been waiting the longest is resumed with the lock held.
+     */
+    void unlock() {
+        detail::SyncWaiter *next = nullptr;
+        {
+            std::lock_guard guard{mLock};
+            Q_ASSERT(mLocked);
+            next = mWaiters.pop();
+            if (!next) {
+                mLocked = false;
+            }
+        }
+        if (next) {
+            detail::resumeWaiter(next);
+        }
+    }
+
+    //! Returns whether the mutex is currently locked.
+    bool isLocked() const noexcept {
+        std::lock_guard guard{mLock};
+        return mLocked;
+    }
+
+private:
+    friend class detail::SyncAwaiter<Mutex>;
+
+    bool tryAcquire() noexcept {
+        return tryLock();
+    }
+
+    bool enqueue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (!std::exchange(mLocked, true)) {
+            return false;
+        }
+        mWaiters.push(waiter);
+        return true;
+    }
+
+    bool dequeue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (!waiter->linked) {
+            return false;
+        }
+        mWaiters.remove(waiter);
+        return true;
+    }
+
+    mutable std::mutex mLock;
+    detail::WaitQueue mWaiters;
+    bool mLocked = false;
+};
+
+inline void MutexLocker::unlock() {
+    if (auto *mutex = std::exchange(mMutex, nullptr); mutex) {
+        mutex->unlock();
+    }
+}
+
+} // namespace QCoro
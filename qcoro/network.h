@@ -15,6 +15,10 @@ namespace QCoro::detail {
 
 class NetworkReplyAwaiter {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::IORead;
+    }
+
     explicit NetworkReplyAwaiter(QNetworkReply *reply) : mReply(reply) {}
 
     bool await_ready() const noexcept {
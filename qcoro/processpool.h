@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coro.h"
+#include "impl/resourcepool.h"
+#include "task.h"
+
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace QCoro {
+
+class ProcessPool;
+
+//! A worker process acquired from a ProcessPool.
+/*!
+ * The process is returned to the pool when the PooledProcess is destroyed or when release()
+ * is called, unless it has been discarded or it's no longer running. A default-constructed
+ * PooledProcess, or one returned by ProcessPool::acquire() when the process couldn't be
+ * started, holds no process.
+ *
+ * Use discard() when the worker is left in an unknown state, e.g. after a job has failed or has
+ * been interrupted in the middle, so that it's killed instead of being returned to the pool.
+ */
+class PooledProcess : public detail::PooledResource<QProcess> {
+public:
+    //! Constructs an invalid process.
+    PooledProcess() noexcept = default;
+
+    //! Returns the running process, or \c nullptr if the PooledProcess is not valid.
+    QProcess *process() const noexcept {
+        return get();
+    }
+
+    QProcess *operator->() const noexcept {
+        return get();
+    }
+
+private:
+    friend class ProcessPool;
+
+    explicit PooledProcess(detail::PooledResource<QProcess> &&process) noexcept
+        : detail::PooledResource<QProcess>(std::move(process)) {}
+};
+
+//! A pool of long-lived worker processes.
+/*!
+ * Starting a process costs a fork and exec, plus whatever the program does when it starts.
+ * For workers that read jobs from their standard input and write the results to their
+ * standard output, the pool keeps the processes running and hands them out to the next
+ * job once a job is done:
+ *
+ * ```cpp
+ * QCoro::ProcessPool pool{QStringLiteral("transcoder"), {QStringLiteral("--stdin")}};
+ *
+ * QCoro::Task<QByteArray> Farm::transcode(const QByteArray &job) {
+ *     auto worker = co_await pool.acquire();
+ *     if (!worker) {
+ *         co_return {};
+ *     }
+ *     co_await qCoro(worker.process()).write(job);
+ *     co_return co_await qCoro(worker.process()).readUntil("\n");
+ * } // the worker returns to the pool when it goes out of scope
+ * ```
+ *
+ * At most maxProcesses() processes are running at the same time, acquire() waits until a
+ * process is released when the limit has been reached. A process that has exited, or that has
+ * unread data in its current read channel when it's released, is not reused. Idle processes
+ * are killed after idleTimeout(), if set, and when the pool is destroyed.
+ *
+ * The pool and its processes must only be used from the thread in which the pool has been
+ * created, and the pool must outlive all the processes acquired from it.
+ */
+class ProcessPool {
+public:
+    //! Creates a process for a new worker, which is then started by the pool.
+    using ProcessFactory = std::function<std::unique_ptr<QProcess>()>;
+
+    //! Constructs a pool of worker processes running the \c program with \c arguments.
+    explicit ProcessPool(QString program, QStringList arguments = {}, std::size_t maxProcesses = 4)
+        : mProgram(std::move(program)), mArguments(std::move(arguments)),
+          mMaxProcesses(std::max<std::size_t>(maxProcesses, 1)),
+          mProcesses(mMaxProcesses, mIdleTimeout, &ProcessPool::isReusable) {}
+    Q_DISABLE_COPY(ProcessPool)
+
+    //! Returns the maximum number of processes running at the same time.
+    std::size_t maxProcesses() const noexcept {
+        return mMaxProcesses;
+    }
+
+    //! Returns how long an idle process is kept running. Negative (the default) means forever.
+    std::chrono::milliseconds idleTimeout() const noexcept {
+        return mIdleTimeout;
+    }
+
+    //! Sets how long an idle process is kept running. A negative timeout keeps it forever.
+    void setIdleTimeout(std::chrono::milliseconds timeout) noexcept {
+        mIdleTimeout = timeout;
+    }
+
+    //! Returns how long acquire() waits for a new process to start.
+    std::chrono::milliseconds startTimeout() const noexcept {
+        return mStartTimeout;
+    }
+
+    //! Sets how long acquire() waits for a new process to start, 30 seconds by default.
+    void setStartTimeout(std::chrono::milliseconds timeout) noexcept {
+        mStartTimeout = timeout;
+    }
+
+    //! Sets the function that creates processes for new workers.
+    /*!
+     * Can be used to configure the processes, e.g. to set their environment or working
+     * directory. The pool starts the process itself.
+     */
+    void setProcessFactory(ProcessFactory factory) {
+        mProcessFactory = std::move(factory);
+    }
+
+    //! Acquires a running worker process.
+    /*!
+     * Returns an idle process, if there's one, or starts a new one. If maxProcesses() processes
+     * are already in use, waits until one of them is released. The returned PooledProcess is
+     * invalid if a new process couldn't be started within startTimeout().
+     */
+    Task<PooledProcess> acquire() {
+        co_await mProcesses.acquirePermit();
+
+        if (auto process = mProcesses.takeIdle()) {
+            co_return PooledProcess{mProcesses.hand(std::move(process))};
+        }
+
+        auto process = mProcessFactory ? mProcessFactory() : std::make_unique<QProcess>();
+        process->start(mProgram, mArguments);
+        if (!co_await qCoro(process.get()).waitForStarted(mStartTimeout) ||
+            process->state() != QProcess::Running) {
+            // QProcess kills the process when destroyed, if it's still running
+            detail::discardLater(std::move(process));
+            mProcesses.releasePermit();
+            co_return PooledProcess{};
+        }
+
+        co_return PooledProcess{mProcesses.hand(std::move(process))};
+    }
+
+    //! Returns the number of idle processes in the pool.
+    std::size_t idleCount() const noexcept {
+        return mProcesses.idleCount();
+    }
+
+    //! Returns the number of acquired processes that haven't been released yet.
+    std::size_t activeCount() const noexcept {
+        return mProcesses.activeCount();
+    }
+
+private:
+    //! A process can only be reused when it's running and has no output left from a previous job.
+    static bool isReusable(const QProcess &process) {
+        return process.state() == QProcess::Running && process.bytesAvailable() == 0;
+    }
+
+    QString mProgram;
+    QStringList mArguments;
+    ProcessFactory mProcessFactory;
+    std::size_t mMaxProcesses;
+    std::chrono::milliseconds mIdleTimeout{-1};
+    std::chrono::milliseconds mStartTimeout = std::chrono::seconds{30};
+    // Declared last, it references the idle timeout
+    detail::ResourcePool<QProcess> mProcesses;
+};
+
+} // namespace QCoro
@@ -17,7 +17,7 @@ namespace QCoro::detail {
 using namespace std::chrono_literals;
 
 //! QAbstractSocket wrapper with co_awaitable-friendly API.
-class QCoroAbstractSocket final : private QCoroIODevice {
+class QCoroAbstractSocket : private QCoroIODevice {
     //! An Awaitable that suspends the coroutine until the socket is connected
     class WaitForConnectedOperation : public WaitOperationBase<QAbstractSocket> {
     public:
@@ -71,35 +71,69 @@ class QCoroAbstractSocket final : private QCoroIODevice {
         }
     };
 
-    class ReadOperation final : public QCoroIODevice::ReadOperation {
+    template<typename ResultCb>
+    class ReadOperation final : public QCoroIODevice::ReadOperation<ResultCb> {
+        using Base = QCoroIODevice::ReadOperation<ResultCb>;
+
     public:
-        using QCoroIODevice::ReadOperation::ReadOperation;
+        ReadOperation(QIODevice *device, ResultCb resultCb, qint64 minBytes = 1)
+            : Base(device, std::move(resultCb), minBytes) {}
 
         bool await_ready() const noexcept final {
-            return QCoroIODevice::ReadOperation::await_ready() ||
-                   static_cast<const QAbstractSocket *>(mDevice.data())->state() ==
+            return Base::await_ready() ||
+                   static_cast<const QAbstractSocket *>(this->mDevice.data())->state() ==
                        QAbstractSocket::UnconnectedState;
         }
 
-        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
-            QCoroIODevice::ReadOperation::await_suspend(awaitingCoroutine);
-            mStateConn = QObject::connect(
-                static_cast<QAbstractSocket *>(mDevice.data()), &QAbstractSocket::stateChanged,
-                [this, awaitingCoroutine]() {
-                    if (static_cast<const QAbstractSocket *>(mDevice.data())->state() ==
-                        QAbstractSocket::UnconnectedState) {
-                        finish(awaitingCoroutine);
-                    }
-                });
+        bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) final {
+            auto *device = static_cast<QAbstractSocket *>(this->mDevice.data());
+            IODeviceNotifier::instance(device)->watch(IODeviceEvent::StateChanged, device,
+                                                      &QAbstractSocket::stateChanged);
+            return Base::await_suspend(awaitingCoroutine);
         }
 
-    private:
-        void finish(QCORO_STD::coroutine_handle<> awaitingCoroutine) final {
-            QObject::disconnect(mStateConn);
-            QCoroIODevice::ReadOperation::finish(awaitingCoroutine);
+    protected:
+        bool notify(IODeviceEvent event, qint64 bytesWritten) final {
+            if (event == IODeviceEvent::StateChanged) {
+                return static_cast<const QAbstractSocket *>(this->mDevice.data())->state() ==
+                       QAbstractSocket::UnconnectedState;
+            }
+            return Base::notify(event, bytesWritten);
         }
+    };
 
-        QMetaObject::Connection mStateConn;
+    class WaitForWritableOperation final : public QCoroIODevice::WaitForWritableOperation {
+    public:
+        using QCoroIODevice::WaitForWritableOperation::WaitForWritableOperation;
+
+        bool await_ready() const noexcept final {
+            return QCoroIODevice::WaitForWritableOperation::await_ready() || isDisconnected();
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept final {
+            auto *device = static_cast<QAbstractSocket *>(mDevice.data());
+            IODeviceNotifier::instance(device)->watch(IODeviceEvent::StateChanged, device,
+                                                      &QAbstractSocket::stateChanged);
+            QCoroIODevice::WaitForWritableOperation::await_suspend(awaitingCoroutine);
+        }
+
+        bool await_resume() const noexcept {
+            return QCoroIODevice::WaitForWritableOperation::await_resume() && !isDisconnected();
+        }
+
+    protected:
+        bool notify(IODeviceEvent event, qint64 bytesWritten) final {
+            if (event == IODeviceEvent::StateChanged) {
+                return isDisconnected();
+            }
+            return QCoroIODevice::WaitForWritableOperation::notify(event, bytesWritten);
+        }
+
+    private:
+        bool isDisconnected() const noexcept {
+            return mDevice && static_cast<const QAbstractSocket *>(mDevice.data())->state() ==
+                                  QAbstractSocket::UnconnectedState;
+        }
     };
 
 public:
@@ -161,19 +195,61 @@ public:
     }
 
     //! \copydoc QCoroIODevice::readAll
-    ReadOperation readAll() {
+    Awaitable auto readAll() {
         return ReadOperation(mDevice, [](QIODevice *dev) { return dev->readAll(); });
     }
 
     //! \copydoc QCoroIODevice::read
-    ReadOperation read(qint64 maxSize) {
+    Awaitable auto read(qint64 maxSize) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->read(maxSize); });
     }
 
     //! \copydoc QCoroIODevice::readLine
-    ReadOperation readLine(qint64 maxSize = 0) {
+    Awaitable auto readLine(qint64 maxSize = 0) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->readLine(maxSize); });
     }
+
+    //! \copydoc QCoroIODevice::readInto(char *, qint64)
+    Awaitable auto readInto(char *data, qint64 maxSize) {
+        return ReadOperation(mDevice,
+                             [data, maxSize](QIODevice *dev) { return dev->read(data, maxSize); });
+    }
+
+    //! \copydoc QCoroIODevice::readInto(char *, qint64)
+    Awaitable auto readInto(std::span<std::byte> buffer) {
+        return readInto(reinterpret_cast<char *>(buffer.data()),
+                        static_cast<qint64>(buffer.size()));
+    }
+
+    //! \copydoc QCoroIODevice::readUntil
+    Awaitable auto readUntil(QByteArray delimiter, qint64 maxSize = 0) {
+        return ReadOperation(mDevice, DelimiterFramer{std::move(delimiter), maxSize});
+    }
+
+    //! \copydoc QCoroIODevice::readFrame
+    template<std::unsigned_integral LengthPrefix>
+    Awaitable auto readFrame(qint64 maxSize = 0) {
+        return ReadOperation(mDevice, LengthPrefixFramer<LengthPrefix>{maxSize});
+    }
+
+    //! \copydoc QCoroIODevice::bytesAvailable
+    Awaitable auto bytesAvailable(qint64 minBytes) {
+        return ReadOperation(
+            mDevice, [](QIODevice *dev) { return dev->bytesAvailable(); }, minBytes);
+    }
+
+    //! \copydoc QCoroIODevice::readChunks
+    AsyncGenerator<QByteArray> readChunks(qint64 maxSize = 0) {
+        return readChunksImpl<QCoroAbstractSocket>(static_cast<QAbstractSocket *>(mDevice.data()),
+                                                   maxSize);
+    }
+
+    using QCoroIODevice::write;
+
+    //! \copydoc QCoroIODevice::waitForWritable
+    Awaitable auto waitForWritable(qint64 highWater, qint64 lowWater) {
+        return WaitForWritableOperation(mDevice, highWater, lowWater);
+    }
 };
 
 } // namespace QCoro::detail
@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "asyncgenerator.h"
+#include "impl/fileio.h"
+#include "qcoroiodevice.h"
+#include "task.h"
+#include "thread.h"
+
+#include <QFile>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace QCoro::detail {
+
+//! QFile wrapper with co_awaitable-friendly API.
+/*!
+ * Reading a QFile never blocks on the event loop, so the operations inherited from
+ * QCoroIODevice complete synchronously. The operations declared here perform the file IO
+ * in the global QThreadPool instead and only resume the awaiting coroutine once the data
+ * have been read or written.
+ */
+class QCoroFile : public QCoroIODevice {
+    //! Runs a positional read or write in the thread pool.
+    template<AwaiterKind Kind, typename Fn>
+    class FileOperation final : public ThreadPoolCallAwaiter<Fn> {
+    public:
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return Kind;
+        }
+
+        explicit FileOperation(Fn &&fn)
+            : ThreadPoolCallAwaiter<Fn>(std::move(fn), QThreadPool::globalInstance()) {}
+    };
+
+    template<AwaiterKind Kind, typename Fn>
+    static auto fileOperation(Fn &&fn) {
+        return FileOperation<Kind, std::decay_t<Fn>>{std::decay_t<Fn>(std::forward<Fn>(fn))};
+    }
+
+    static auto readAtImpl(QFile *file, qint64 offset, qint64 maxSize) {
+        return fileOperation<AwaiterKind::IORead>(
+            [target = PositionalFile{file}, offset, maxSize]() {
+                return target.readAt(offset, maxSize);
+            });
+    }
+
+    //! Reads from the current position of the \c file and moves the position past the data.
+    static Task<QByteArray> readFromPosition(QPointer<QFile> file, qint64 maxSize) {
+        if (!file) {
+            co_return QByteArray{};
+        }
+        const qint64 pos = file->pos();
+        auto data = co_await readAtImpl(file.data(), pos, maxSize);
+        if (file && !data.isEmpty()) {
+            file->seek(pos + data.size());
+        }
+        co_return data;
+    }
+
+    static AsyncGenerator<QByteArray> readChunksImpl(QPointer<QFile> file, qint64 chunkSize) {
+        while (file) {
+            auto chunk = co_await readFromPosition(file, chunkSize);
+            if (chunk.isEmpty()) {
+                break;
+            }
+            co_yield chunk;
+        }
+    }
+
+public:
+    //! Size of the chunks yielded by readChunks() when no size is given.
+    static constexpr qint64 DefaultChunkSize = 1024 * 1024;
+
+    //! Constructor.
+    explicit QCoroFile(QFile *file) : QCoroIODevice(file) {}
+
+    /*!
+     * \brief Reads up to \c maxSize bytes starting at \c offset without blocking the event loop.
+     *
+     * The data are read by a worker thread of the global QThreadPool and the awaiting coroutine
+     * is resumed in its own thread once they have been read. The current position of the file
+     * is not changed. Returns less than \c maxSize bytes if the file ends sooner, and an empty
+     * QByteArray if there's nothing to read at \c offset or on error.
+     */
+    Awaitable auto readAt(qint64 offset, qint64 maxSize) {
+        return readAtImpl(file(), offset, maxSize);
+    }
+
+    /*!
+     * \brief Writes \c data at \c offset without blocking the event loop.
+     *
+     * The data are written by a worker thread of the global QThreadPool, the current position
+     * of the file is not changed. Returns the number of bytes written, or -1 on error.
+     *
+     * On Linux, data are always appended to files opened with \c QIODevice::Append,
+     * regardless of the \c offset.
+     */
+    Awaitable auto writeAt(qint64 offset, QByteArray data) {
+        return fileOperation<AwaiterKind::IOWrite>(
+            [target = PositionalFile{file()}, offset, data = std::move(data)]() {
+                return target.writeAt(offset, data);
+            });
+    }
+
+    /*!
+     * \brief Reads all remaining data from the file without blocking the event loop.
+     *
+     * Like `QIODevice::readAll()`, reads everything from the current position to the end of
+     * the file and moves the position to the end, but the data are read by a worker thread
+     * of the global QThreadPool.
+     */
+    Task<QByteArray> readAll() {
+        return readFromPosition(file(), std::numeric_limits<qint64>::max());
+    }
+
+    /*!
+     * \brief Returns a generator that reads the file in chunks without blocking the event loop.
+     *
+     * Each chunk of at most \c maxSize bytes (or \c DefaultChunkSize if \c maxSize is not
+     * greater than 0) is read from the current position of the file by a worker thread of the
+     * global QThreadPool. The generator finishes once the end of the file is reached.
+     *
+     * ```cpp
+     * QCORO_FOREACH(const QByteArray &chunk, qCoro(file).readChunks()) {
+     *     co_await qCoro(socket).write(chunk);
+     * }
+     * ```
+     */
+    AsyncGenerator<QByteArray> readChunks(qint64 maxSize = 0) {
+        return readChunksImpl(file(), maxSize > 0 ? maxSize : DefaultChunkSize);
+    }
+
+private:
+    QFile *file() const {
+        return static_cast<QFile *>(mDevice.data());
+    }
+};
+
+} // namespace QCoro::detail
@@ -4,18 +4,26 @@
 
 #pragma once
 
+#include "asyncgenerator.h"
 #include "coroutine.h"
+#include "impl/framing.h"
+#include "impl/iodevicenotifier.h"
 #include "macros.h"
 
 #include <QByteArray>
 #include <QIODevice>
+#include <QList>
 #include <QPointer>
 
+#include <concepts>
+#include <cstddef>
+#include <span>
+
 namespace QCoro::detail {
 
 class QCoroIODevice {
 private:
-    class OperationBase {
+    class OperationBase : public IODeviceWaiter {
     public:
         Q_DISABLE_COPY(OperationBase)
         QCORO_DEFAULT_MOVE(OperationBase)
@@ -25,54 +33,130 @@ private:
     protected:
         explicit OperationBase(QIODevice *device) : mDevice(device) {}
 
-        virtual void finish(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-            QObject::disconnect(mConn);
-            QObject::disconnect(mCloseConn);
-            // Delayed trigger
-            QTimer::singleShot(0, [awaitingCoroutine]() mutable { awaitingCoroutine.resume(); });
+        //! Suspends the coroutine until notify() reports that the operation has finished.
+        void wait(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            IODeviceWaiter::wait(IODeviceNotifier::instance(mDevice), awaitingCoroutine);
         }
 
         QPointer<QIODevice> mDevice;
-        QMetaObject::Connection mConn;
-        QMetaObject::Connection mCloseConn;
-        QMetaObject::Connection mFinishedConn;
     };
 
 protected:
+    //! Operation that waits for data to become available and then reads them using \c ResultCb.
+    /*!
+     * The operation is a template over the callable that performs the actual read, so that the
+     * awaiter doesn't need to heap-allocate a type-erased function object.
+     */
+    template<typename ResultCb>
     class ReadOperation : public OperationBase {
     public:
-        ReadOperation(QIODevice *device, std::function<QByteArray(QIODevice *)> &&resultCb)
-            : OperationBase(device), mResultCb(std::move(resultCb)) {}
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return AwaiterKind::IORead;
+        }
+
+        //! Constructor.
+        /*!
+         * The operation is ready once the device has at least \c minBytes bytes available
+         * for reading, or when it can't provide any more data.
+         */
+        ReadOperation(QIODevice *device, ResultCb resultCb, qint64 minBytes = 1)
+            : OperationBase(device), mResultCb(std::move(resultCb)), mMinBytes(minBytes) {}
 
         Q_DISABLE_COPY(ReadOperation)
         QCORO_DEFAULT_MOVE(ReadOperation)
 
         virtual bool await_ready() const noexcept {
-            return !mDevice || !mDevice->isOpen() || !mDevice->isReadable() ||
-                   mDevice->bytesAvailable() > 0;
+            return !mDevice || !mDevice->isOpen() || !mDevice->isReadable() || hasEnoughData();
         }
 
-        virtual void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+        //! Suspends the coroutine until enough data are available.
+        /*!
+         * A Framer first collects the data that are already buffered in the device, if that
+         * completes the frame the coroutine is not suspended at all.
+         */
+        virtual bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
             Q_ASSERT(mDevice);
-            mConn = QObject::connect(mDevice, &QIODevice::readyRead,
-                                     std::bind(&ReadOperation::finish, this, awaitingCoroutine));
-            mCloseConn =
-                QObject::connect(mDevice, &QIODevice::aboutToClose,
-                                 std::bind(&ReadOperation::finish, this, awaitingCoroutine));
+            if constexpr (Framer<ResultCb>) {
+                if (mResultCb.consume(mDevice.data())) {
+                    return false;
+                }
+            }
+            wait(awaitingCoroutine);
+            return true;
         }
 
         auto await_resume() {
-            return mResultCb(mDevice);
+            return mResultCb(mDevice.data());
+        }
+
+    protected:
+        bool notify(IODeviceEvent event, qint64) override {
+            switch (event) {
+            case IODeviceEvent::ReadyRead:
+                // Don't wake up the coroutine until enough data have been buffered.
+                if constexpr (Framer<ResultCb>) {
+                    return mResultCb.consume(mDevice.data());
+                } else {
+                    return hasEnoughData();
+                }
+            case IODeviceEvent::AboutToClose:
+                return true;
+            default:
+                return false;
+            }
         }
 
     private:
-        std::function<QByteArray(QIODevice *)> mResultCb;
+        //! Returns whether the operation can finish.
+        /*!
+         * A Framer collects the data from the device itself, in await_suspend() and notify(),
+         * only once it has the whole frame the operation is finished.
+         */
+        bool hasEnoughData() const noexcept {
+            if constexpr (Framer<ResultCb>) {
+                return mResultCb.isComplete();
+            } else {
+                return mDevice->bytesAvailable() >= mMinBytes;
+            }
+        }
+
+        ResultCb mResultCb;
+        qint64 mMinBytes = 1;
     };
 
     class WriteOperation : public OperationBase {
     public:
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return AwaiterKind::IOWrite;
+        }
+
         WriteOperation(QIODevice *device, const QByteArray &data)
-            : OperationBase(device), mBytesToBeWritten(device->write(data)) {}
+            : WriteOperation(device, std::span<const QByteArray>(&data, 1)) {}
+
+        //! Writes all \c buffers into the device and waits until all of them have been written.
+        /*!
+         * The buffers are passed to the device one by one, so they are not concatenated
+         * into a temporary buffer. When a device is buffered, all of them are appended to
+         * the device's write buffer and are flushed together from the event loop.
+         */
+        template<typename Buffers>
+        WriteOperation(QIODevice *device, const Buffers &buffers) : OperationBase(device) {
+            for (const QByteArray &buffer : buffers) {
+                const auto written = device->write(buffer);
+                if (written < 0) {
+                    mBytesToBeWritten = -1;
+                    return;
+                }
+                mBytesToBeWritten += written;
+            }
+
+            // Unbuffered devices, or devices that could write all the data right away. Random
+            // access devices (e.g. QFile) never emit bytesWritten() for their buffered data, so
+            // waiting for them would only finish once the device is closed.
+            if (device->bytesToWrite() == 0 || !device->isSequential()) {
+                mBytesWritten = mBytesToBeWritten;
+            }
+        }
 
         Q_DISABLE_COPY(WriteOperation)
         QCORO_DEFAULT_MOVE(WriteOperation)
@@ -82,40 +166,144 @@ protected:
                 return true;
             }
 
-            if (mBytesWritten == 0) {
+            // Also true when writing has failed
+            return mBytesWritten >= mBytesToBeWritten;
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+            Q_ASSERT(mDevice);
+            wait(awaitingCoroutine);
+        }
+
+        qint64 await_resume() noexcept {
+            return mBytesToBeWritten < 0 ? -1 : mBytesWritten;
+        }
+
+    protected:
+        bool notify(IODeviceEvent event, qint64 written) override {
+            switch (event) {
+            case IODeviceEvent::BytesWritten:
+                mBytesWritten += written;
+                return mBytesWritten >= mBytesToBeWritten;
+            case IODeviceEvent::AboutToClose:
                 return true;
+            default:
+                return false;
             }
+        }
+
+    private:
+        qint64 mBytesToBeWritten = 0;
+        qint64 mBytesWritten = 0;
+    };
+
+    //! Operation that suspends the coroutine while the device has too much data to write.
+    class WaitForWritableOperation : public OperationBase {
+    public:
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return AwaiterKind::IOWrite;
+        }
+
+        WaitForWritableOperation(QIODevice *device, qint64 highWater, qint64 lowWater)
+            : OperationBase(device), mHighWater(highWater), mLowWater(lowWater) {
+            Q_ASSERT(lowWater <= highWater);
+        }
+
+        Q_DISABLE_COPY(WaitForWritableOperation)
+        QCORO_DEFAULT_MOVE(WaitForWritableOperation)
+
+        virtual bool await_ready() const noexcept {
+            return !isWritable() || mDevice->bytesToWrite() <= mHighWater;
+        }
+
+        virtual void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+            Q_ASSERT(mDevice);
+            wait(awaitingCoroutine);
+        }
+
+        bool await_resume() const noexcept {
+            return isWritable();
+        }
+
+    protected:
+        bool isWritable() const noexcept {
+            return mDevice && mDevice->isOpen() && mDevice->isWritable();
+        }
 
-            if (mDevice->bytesToWrite() == 0) {
+        bool notify(IODeviceEvent event, qint64) override {
+            switch (event) {
+            case IODeviceEvent::BytesWritten:
+                return mDevice->bytesToWrite() <= mLowWater;
+            case IODeviceEvent::AboutToClose:
                 return true;
+            default:
+                return false;
             }
+        }
+
+    private:
+        qint64 mHighWater = 0;
+        qint64 mLowWater = 0;
+    };
 
-            return false;
+    //! Implementation of readChunks() that uses the \c Wrapper to read from the \c device.
+    /*!
+     * The generator references the device, rather than the (usually temporary) wrapper.
+     */
+    template<typename Wrapper, typename Device>
+    static AsyncGenerator<QByteArray> readChunksImpl(Device *device, qint64 maxSize) {
+        Wrapper wrapper(device);
+        if (maxSize > 0) {
+            return readChunksWith(QPointer<Device>{device}, wrapper.read(maxSize));
         }
+        return readChunksWith(QPointer<Device>{device}, wrapper.readAll());
+    }
 
-        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
-            Q_ASSERT(mDevice);
-            mConn = QObject::connect(mDevice, &QIODevice::bytesWritten,
-                                     [this, awaitingCoroutine](qint64 written) {
-                                         mBytesWritten += written;
-                                         if (mBytesWritten >= mBytesToBeWritten) {
-                                             finish(awaitingCoroutine);
-                                         }
-                                     });
-            mCloseConn =
-                QObject::connect(mDevice, &QIODevice::aboutToClose,
-                                 std::bind(&WriteOperation::finish, this, awaitingCoroutine));
+    //! A copyable awaiter that co_awaits the referenced \c Operation.
+    /*!
+     * Operations are not copyable, but await_transform() copies l-value awaitables.
+     */
+    template<typename Operation>
+    class OperationRef {
+    public:
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return Operation::awaiterKind();
         }
 
-        qint64 await_resume() noexcept {
-            return mBytesWritten;
+        explicit OperationRef(Operation &operation) noexcept : mOperation(&operation) {}
+
+        bool await_ready() const noexcept {
+            return mOperation->await_ready();
+        }
+
+        bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            return mOperation->await_suspend(awaitingCoroutine);
+        }
+
+        auto await_resume() {
+            return mOperation->await_resume();
         }
 
     private:
-        qint64 mBytesToBeWritten = 0;
-        qint64 mBytesWritten = 0;
+        Operation *mOperation;
     };
 
+    //! Yields the chunks read by the \c operation.
+    /*!
+     * The operation lives in the generator frame and is co_awaited again for each chunk.
+     */
+    template<typename Device, typename Operation>
+    static AsyncGenerator<QByteArray> readChunksWith(QPointer<Device> device, Operation operation) {
+        while (device) {
+            QByteArray chunk = co_await OperationRef<Operation>{operation};
+            // Read operations only return no data once the device can't provide any more
+            if (chunk.isEmpty()) {
+                break;
+            }
+            co_yield chunk;
+        }
+    }
+
 public:
     //! Constructor.
     explicit QCoroIODevice(QIODevice *device) : mDevice{device} {}
@@ -135,7 +323,7 @@ public:
      * [qdoc-qiodevice-readall]: https://doc.qt.io/qt-5/qiodevice.html#readAll
      * [qdoc-qiodevice-readyRead]: https://doc.qt.io/qt-5/qiodevice.html#readyRead
      */
-    ReadOperation readAll() {
+    Awaitable auto readAll() {
         return ReadOperation(mDevice, [](QIODevice *dev) { return dev->readAll(); });
     }
 
@@ -154,7 +342,7 @@ public:
      * [qdoc-qiodevice-read]: https://doc.qt.io/qt-5/qiodevice.html#read-1
      * [qdoc-qiodevice-readyRead]: https://doc.qt.io/qt-5/qiodevice.html#readyRead
      */
-    ReadOperation read(qint64 maxSize) {
+    Awaitable auto read(qint64 maxSize) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->read(maxSize); });
     }
 
@@ -174,12 +362,114 @@ public:
      * [qdoc-qiodevice-readLine]: https://doc.qt.io/qt-5/qiodevice.html#readLine
      * [qdoc-qiodevice-readyRead]: https://doc.qt.io/qt-5/qiodevice.html#readyRead
      */
-    ReadOperation readLine(qint64 maxSize = 0) {
+    Awaitable auto readLine(qint64 maxSize = 0) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->readLine(maxSize); });
     }
 
-    // TODO
-    //auto bytesAvailable(qint64 minBytes) {
+    /*!
+     * \brief Co_awaitable equivalent to [`QIODevice::read(char *, qint64)`][qdoc-qiodevice-read].
+     *
+     * Waits until the `QIODevice` emits [`readyRead()`][qdoc-qiodevice-readyRead] and
+     * then reads up to \c maxSize bytes into the caller-owned \c data buffer, avoiding
+     * the allocation of a new `QByteArray` for every read. The buffer must stay valid until
+     * the operation finishes. Has the same readiness semantics as \c read().
+     *
+     * Returns the number of bytes read, or -1 on error.
+     *
+     * [qdoc-qiodevice-read]: https://doc.qt.io/qt-5/qiodevice.html#read
+     * [qdoc-qiodevice-readyRead]: https://doc.qt.io/qt-5/qiodevice.html#readyRead
+     */
+    Awaitable auto readInto(char *data, qint64 maxSize) {
+        return ReadOperation(mDevice,
+                             [data, maxSize](QIODevice *dev) { return dev->read(data, maxSize); });
+    }
+
+    //! \copydoc QCoroIODevice::readInto(char *, qint64)
+    Awaitable auto readInto(std::span<std::byte> buffer) {
+        return readInto(reinterpret_cast<char *>(buffer.data()),
+                        static_cast<qint64>(buffer.size()));
+    }
+
+    /*!
+     * \brief Reads data from the device until the \c delimiter, or \c maxSize bytes, are read.
+     *
+     * Unlike \c readLine(), which only returns what's already buffered in the device, this
+     * operation collects the data as they arrive and resumes the awaiting coroutine only once,
+     * when the whole frame has been received. Each chunk of incoming data is searched for the
+     * delimiter only once. Data following the delimiter remain in the device.
+     *
+     * Returns the frame including the delimiter. If the device is closed, or \c maxSize bytes
+     * (if greater than 0) have been read before the delimiter is found, returns the data that
+     * have been read.
+     */
+    Awaitable auto readUntil(QByteArray delimiter, qint64 maxSize = 0) {
+        return ReadOperation(mDevice, DelimiterFramer{std::move(delimiter), maxSize});
+    }
+
+    /*!
+     * \brief Reads a frame preceded by its length, encoded as a big-endian \c LengthPrefix.
+     *
+     * Resumes the awaiting coroutine only once, when the whole frame has been received, so
+     * the frame can be larger than the device's read buffer. Data following the frame remain
+     * in the device.
+     *
+     * Returns the payload of the frame, without the length. Returns an empty optional if the
+     * device is closed before the whole frame is received, or if the length exceeds \c maxSize
+     * (16 MiB if \c maxSize is not greater than 0), in which case the rest of the frame is left
+     * in the device.
+     *
+     * ```cpp
+     * while (const auto frame = co_await qCoro(socket).readFrame<quint32>(1024 * 1024)) {
+     *     handleMessage(*frame);
+     * }
+     * ```
+     */
+    template<std::unsigned_integral LengthPrefix>
+    Awaitable auto readFrame(qint64 maxSize = 0) {
+        return ReadOperation(mDevice, LengthPrefixFramer<LengthPrefix>{maxSize});
+    }
+
+    /*!
+     * \brief Waits until at least \c minBytes bytes are available for reading.
+     *
+     * Unlike \c read(), which resumes the awaiting coroutine as soon as any data arrive,
+     * this operation keeps the coroutine suspended until the device has buffered at least
+     * \c minBytes bytes, so a fixed-size record can be collected with a single wakeup.
+     * The coroutine is also resumed when the device is closed or can't provide any
+     * more data, so the caller must check the result.
+     *
+     * Returns the number of bytes available for reading, as returned by
+     * [`QIODevice::bytesAvailable()`][qdoc-qiodevice-bytesAvailable].
+     *
+     * Note that for devices with a limited read buffer size (e.g.
+     * [`QAbstractSocket`][qdoc-qabstractsocket]) \c minBytes must not exceed the buffer size,
+     * otherwise the operation can only finish when the device is closed.
+     *
+     * [qdoc-qiodevice-bytesAvailable]: https://doc.qt.io/qt-5/qiodevice.html#bytesAvailable
+     * [qdoc-qabstractsocket]: https://doc.qt.io/qt-5/qabstractsocket.html#setReadBufferSize
+     */
+    Awaitable auto bytesAvailable(qint64 minBytes) {
+        return ReadOperation(
+            mDevice, [](QIODevice *dev) { return dev->bytesAvailable(); }, minBytes);
+    }
+
+    /*!
+     * \brief Returns a generator that yields chunks of data as they arrive.
+     *
+     * Each time the consumer co_awaits the next chunk, the generator waits until there are
+     * any data available (just like \c readAll()) and yields all the available data, or at
+     * most \c maxSize bytes if \c maxSize is greater than 0. The generator finishes once the
+     * device is closed, or can't provide any more data.
+     *
+     * ```cpp
+     * QCORO_FOREACH(const QByteArray &chunk, qCoro(device).readChunks()) {
+     *     file.write(chunk);
+     * }
+     * ```
+     */
+    AsyncGenerator<QByteArray> readChunks(qint64 maxSize = 0) {
+        return readChunksImpl<QCoroIODevice>(mDevice.data(), maxSize);
+    }
 
     /*!
      * \brief Co_awaitable equivalent to [`QIODevice::write`][qdoc-qiodevice-write].
@@ -201,6 +491,54 @@ public:
         return WriteOperation(mDevice, buffer);
     }
 
+    /*!
+     * \brief Writes all \c buffers into the device and waits until all of them have been written.
+     *
+     * This is a vectored equivalent to \c write(const QByteArray &): the buffers are written
+     * in order without being concatenated, and the coroutine is suspended only once, until
+     * the device emits [`bytesWritten()`][qdoc-qiodevice-bytesWritten] with total bytes equal
+     * to the total size of all the \c buffers.
+     *
+     * Returns the total number of bytes written, or -1 if writing any of the buffers has failed.
+     *
+     * [qdoc-qiodevice-bytesWritten]: https://doc.qt.io/qt-5/qiodevice.html#bytesWritten
+     */
+    auto write(std::span<const QByteArray> buffers) {
+        return WriteOperation(mDevice, buffers);
+    }
+
+    //! \copydoc QCoroIODevice::write(std::span<const QByteArray>)
+    auto write(const QList<QByteArray> &buffers) {
+        return WriteOperation(mDevice, buffers);
+    }
+
+    /*!
+     * \brief Suspends the coroutine while the device has too much data waiting to be written.
+     *
+     * If the device has more than \c highWater bytes waiting to be written (as reported by
+     * [`QIODevice::bytesToWrite()`][qdoc-qiodevice-bytesToWrite]), the coroutine is suspended
+     * until the device has written enough data for `bytesToWrite()` to drop to \c lowWater
+     * bytes or less. Otherwise the coroutine isn't suspended at all.
+     *
+     * This allows a producer to write data as fast as the device can send them, without
+     * making the device buffer an unbounded amount of data:
+     * ```cpp
+     * while (!source.atEnd()) {
+     *     if (!co_await qCoro(socket).waitForWritable(256 * 1024, 64 * 1024)) {
+     *         break; // socket has been closed
+     *     }
+     *     socket.write(source.read(16 * 1024));
+     * }
+     * ```
+     *
+     * Returns `true` if the device can still be written into, `false` if it has been closed.
+     *
+     * [qdoc-qiodevice-bytesToWrite]: https://doc.qt.io/qt-5/qiodevice.html#bytesToWrite
+     */
+    Awaitable auto waitForWritable(qint64 highWater, qint64 lowWater) {
+        return WaitForWritableOperation(mDevice, highWater, lowWater);
+    }
+
 protected:
     QPointer<QIODevice> mDevice = {};
 };
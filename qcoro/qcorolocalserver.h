@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "asyncgenerator.h"
+#include "impl/serverconnections.h"
+#include "impl/waitoperationbase.h"
+#include "qcorosignal.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+
+#include <chrono>
+
+namespace QCoro::detail {
+
+using namespace std::chrono_literals;
+
+//! QLocalServer wrapper with co_awaitable-friendly API.
+class QCoroLocalServer {
+    //! An Awaitable that suspends the coroutine until new connection is available
+    class WaitForNewConnectionOperation final : public WaitOperationBase<QLocalServer> {
+    public:
+        WaitForNewConnectionOperation(QLocalServer *server, int timeout_msecs = 30'000)
+            : WaitOperationBase(server, timeout_msecs) {}
+
+        bool await_ready() const noexcept {
+            return !mObj || mObj->hasPendingConnections();
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+            mConn = QObject::connect(mObj, &QLocalServer::newConnection,
+                                     [this, awaitingCoroutine]() mutable {
+                                         resume(awaitingCoroutine);
+                                     });
+            startTimeoutTimer(awaitingCoroutine);
+        }
+
+        QLocalSocket *await_resume() {
+            return (mTimedOut || !mObj) ? nullptr : mObj->nextPendingConnection();
+        }
+    };
+
+public:
+    explicit QCoroLocalServer(QLocalServer *server) : mServer(server) {}
+
+    //! Co_awaitable equivalent to [`QLocalServer::waitForNewConnection()`][qtdoc-qlocalserver-waitForNewConnection].
+    /*!
+     * Returns the new connection, or \c nullptr if the operation timed out.
+     */
+    Awaitable auto waitForNewConnection(int timeout_msecs = 30'000) {
+        return WaitForNewConnectionOperation{mServer.data(), timeout_msecs};
+    }
+
+    //! Co_awaitable equivalent to [`QLocalServer::waitForNewConnection()`][qtdoc-qlocalserver-waitForNewConnection].
+    /*!
+     * Unlike the Qt version, this overload uses `std::chrono::milliseconds` to express the
+     * timeout rather than plain `int`.
+     */
+    Awaitable auto waitForNewConnection(std::chrono::milliseconds timeout) {
+        return WaitForNewConnectionOperation{mServer.data(), static_cast<int>(timeout.count())};
+    }
+
+    //! Returns an asynchronous stream of incoming connections.
+    /*!
+     * The generator yields all the connections that are pending in the server at once,
+     * without returning to the event loop in between, and then waits for the server to
+     * emit \c newConnection(). The generator finishes when the server is destroyed.
+     *
+     * ```cpp
+     * QCORO_FOREACH(QLocalSocket *socket, qCoro(server).connections()) {
+     *     handleClient(socket);
+     * }
+     * ```
+     */
+    AsyncGenerator<QLocalSocket *> connections() {
+        return serverConnections<QLocalServer, QLocalSocket>(mServer);
+    }
+
+private:
+    QPointer<QLocalServer> mServer;
+};
+
+} // namespace QCoro::detail
+
+/*!
+ * [qtdoc-qlocalserver-waitForNewConnection]: https://doc.qt.io/qt-5/qlocalserver.html#waitForNewConnection
+ */
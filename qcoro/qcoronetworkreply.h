@@ -12,46 +12,104 @@ namespace QCoro::detail {
 
 class QCoroNetworkReply final : private QCoroIODevice {
 private:
-    class ReadOperation final : public QCoroIODevice::ReadOperation {
+    template<typename ResultCb>
+    class ReadOperation final : public QCoroIODevice::ReadOperation<ResultCb> {
+        using Base = QCoroIODevice::ReadOperation<ResultCb>;
+
     public:
-        using QCoroIODevice::ReadOperation::ReadOperation;
+        ReadOperation(QIODevice *device, ResultCb resultCb, qint64 minBytes = 1)
+            : Base(device, std::move(resultCb), minBytes) {}
 
         bool await_ready() const noexcept final {
-            return QCoroIODevice::ReadOperation::await_ready() ||
-                   static_cast<const QNetworkReply *>(mDevice.data())->isFinished();
+            return Base::await_ready() ||
+                   static_cast<const QNetworkReply *>(this->mDevice.data())->isFinished();
         }
 
-        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept final {
-            QCoroIODevice::ReadOperation::await_suspend(awaitingCoroutine);
-
-            mFinishedConn = QObject::connect(
-                static_cast<QNetworkReply *>(mDevice.data()), &QNetworkReply::finished,
-                std::bind(&ReadOperation::finish, this, awaitingCoroutine));
+        bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) final {
+            auto *device = static_cast<QNetworkReply *>(this->mDevice.data());
+            IODeviceNotifier::instance(device)->watch(IODeviceEvent::Finished, device,
+                                                      &QNetworkReply::finished);
+            return Base::await_suspend(awaitingCoroutine);
         }
 
-    private:
-        void finish(QCORO_STD::coroutine_handle<> awaitingCoroutine) final {
-            QObject::disconnect(mFinishedConn);
-            QCoroIODevice::ReadOperation::finish(awaitingCoroutine);
+    protected:
+        bool notify(IODeviceEvent event, qint64 bytesWritten) final {
+            return event == IODeviceEvent::Finished || Base::notify(event, bytesWritten);
         }
-
-        QMetaObject::Connection mFinishedConn;
     };
 
 public:
     using QCoroIODevice::QCoroIODevice;
 
-    ReadOperation readAll() {
+    Awaitable auto readAll() {
         return ReadOperation(mDevice, [](QIODevice *dev) { return dev->readAll(); });
     }
 
-    ReadOperation read(qint64 maxSize) {
+    Awaitable auto read(qint64 maxSize) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->read(maxSize); });
     }
 
-    ReadOperation readLine(qint64 maxSize = 0) {
+    Awaitable auto readLine(qint64 maxSize = 0) {
         return ReadOperation(mDevice, [maxSize](QIODevice *dev) { return dev->readLine(maxSize); });
     }
+
+    //! \copydoc QCoroIODevice::readInto(char *, qint64)
+    Awaitable auto readInto(char *data, qint64 maxSize) {
+        return ReadOperation(mDevice,
+                             [data, maxSize](QIODevice *dev) { return dev->read(data, maxSize); });
+    }
+
+    //! \copydoc QCoroIODevice::readInto(char *, qint64)
+    Awaitable auto readInto(std::span<std::byte> buffer) {
+        return readInto(reinterpret_cast<char *>(buffer.data()),
+                        static_cast<qint64>(buffer.size()));
+    }
+
+    //! \copydoc QCoroIODevice::readUntil
+    Awaitable auto readUntil(QByteArray delimiter, qint64 maxSize = 0) {
+        return ReadOperation(mDevice, DelimiterFramer{std::move(delimiter), maxSize});
+    }
+
+    //! \copydoc QCoroIODevice::readFrame
+    template<std::unsigned_integral LengthPrefix>
+    Awaitable auto readFrame(qint64 maxSize = 0) {
+        return ReadOperation(mDevice, LengthPrefixFramer<LengthPrefix>{maxSize});
+    }
+
+    //! \copydoc QCoroIODevice::bytesAvailable
+    Awaitable auto bytesAvailable(qint64 minBytes) {
+        return ReadOperation(
+            mDevice, [](QIODevice *dev) { return dev->bytesAvailable(); }, minBytes);
+    }
+
+    //! \copydoc QCoroIODevice::readChunks
+    AsyncGenerator<QByteArray> readChunks(qint64 maxSize = 0) {
+        return readChunksImpl<QCoroNetworkReply>(static_cast<QNetworkReply *>(mDevice.data()),
+                                                 maxSize);
+    }
+
+    //! Returns a generator that streams the body of the reply with bounded buffering.
+    /*!
+     * Limits the reply's read buffer to \c bufferSize bytes (see
+     * [`QNetworkReply::setReadBufferSize()`][qtdoc-qnetworkreply-setReadBufferSize]) and yields
+     * chunks of at most \c bufferSize bytes as they arrive. Once the buffer is full, the reply
+     * stops reading from the network until the consumer asks for the next chunk, so the server
+     * is slowed down by TCP flow control rather than the whole response being buffered in memory.
+     *
+     * Should be called right after the request has been sent, before the reply starts buffering
+     * data. The generator finishes when the reply has finished and all the data have been read.
+     * Check the reply's `error()` to find out whether the whole body has been received.
+     *
+     * [qtdoc-qnetworkreply-setReadBufferSize]: https://doc.qt.io/qt-5/qnetworkreply.html#setReadBufferSize
+     */
+    AsyncGenerator<QByteArray> readBody(qint64 bufferSize = 64 * 1024) {
+        Q_ASSERT(bufferSize > 0);
+        auto *reply = static_cast<QNetworkReply *>(mDevice.data());
+        if (reply) {
+            reply->setReadBufferSize(bufferSize);
+        }
+        return readChunksImpl<QCoroNetworkReply>(reply, bufferSize);
+    }
 };
 
 } // namespace QCoro::detail
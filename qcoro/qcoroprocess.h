@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "asyncgenerator.h"
 #include "impl/waitoperationbase.h"
 #include "qcoroiodevice.h"
 
@@ -68,9 +69,104 @@ class QCoroProcess : public QCoroIODevice {
         }
     };
 
+    //! An Awaitable that suspends the coroutine until a read channel has new data.
+    /*!
+     * The coroutine is also resumed when the process stops running. The signals of the channel
+     * are dispatched by the process' IODeviceNotifier, so awaiting the operation repeatedly
+     * (e.g. for every chunk of a readStandardOutputChunks() stream) doesn't connect to them again.
+     */
+    class WaitForChannelReadyReadOperation final : public IODeviceWaiter {
+    public:
+        static constexpr AwaiterKind awaiterKind() noexcept {
+            return AwaiterKind::WaitFor;
+        }
+
+        WaitForChannelReadyReadOperation(QProcess *process, QProcess::ProcessChannel channel)
+            : mProcess(process),
+              mEvent(channel == QProcess::StandardOutput ? IODeviceEvent::ReadyReadStandardOutput
+                                                         : IODeviceEvent::ReadyReadStandardError) {}
+        Q_DISABLE_COPY(WaitForChannelReadyReadOperation)
+        QCORO_DEFAULT_MOVE(WaitForChannelReadyReadOperation)
+
+        bool await_ready() const noexcept {
+            return !mProcess || mProcess->state() == QProcess::NotRunning;
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            auto *process = mProcess.data();
+            auto *notifier = IODeviceNotifier::instance(process);
+            notifier->watch(mEvent, process,
+                            mEvent == IODeviceEvent::ReadyReadStandardOutput
+                                ? &QProcess::readyReadStandardOutput
+                                : &QProcess::readyReadStandardError);
+            // Also emitted when the process fails to start, unlike finished()
+            notifier->watch(IODeviceEvent::StateChanged, process, &QProcess::stateChanged);
+            wait(notifier, awaitingCoroutine);
+        }
+
+        void await_resume() const noexcept {}
+
+    protected:
+        bool notify(IODeviceEvent event, qint64) override {
+            if (event == IODeviceEvent::StateChanged) {
+                return !mProcess || mProcess->state() == QProcess::NotRunning;
+            }
+            return event == mEvent;
+        }
+
+    private:
+        QPointer<QProcess> mProcess;
+        IODeviceEvent mEvent;
+    };
+
+    //! Implementation of readStandardOutputChunks() and readStandardErrorChunks().
+    static AsyncGenerator<QByteArray> readChannelChunksImpl(QPointer<QProcess> process,
+                                                            QProcess::ProcessChannel channel) {
+        while (process) {
+            QByteArray chunk = channel == QProcess::StandardOutput
+                                   ? process->readAllStandardOutput()
+                                   : process->readAllStandardError();
+            if (!chunk.isEmpty()) {
+                co_yield chunk;
+                continue;
+            }
+            // All the output has been read once the process is not running anymore
+            if (process->state() == QProcess::NotRunning) {
+                break;
+            }
+            co_await WaitForChannelReadyReadOperation{process.data(), channel};
+        }
+    }
+
 public:
     explicit QCoroProcess(QProcess *process) : QCoroIODevice(process) {}
 
+    /*!
+     * \brief Returns a generator that yields the standard output of the process as it arrives.
+     *
+     * Unlike readChunks(), which reads from the current read channel, the generator always
+     * reads from the standard output and doesn't change the current read channel, so the
+     * standard output and the standard error can be consumed at the same time by two
+     * coroutines without one blocking the other. The generator finishes once the process
+     * is not running anymore and all its output has been read.
+     *
+     * The process must use the QProcess::SeparateChannels channel mode (the default).
+     */
+    AsyncGenerator<QByteArray> readStandardOutputChunks() {
+        return readChannelChunksImpl(QPointer{static_cast<QProcess *>(mDevice.data())},
+                                     QProcess::StandardOutput);
+    }
+
+    /*!
+     * \brief Returns a generator that yields the standard error of the process as it arrives.
+     *
+     * See readStandardOutputChunks() for details.
+     */
+    AsyncGenerator<QByteArray> readStandardErrorChunks() {
+        return readChannelChunksImpl(QPointer{static_cast<QProcess *>(mDevice.data())},
+                                     QProcess::StandardError);
+    }
+
     /*!
      * \brief Co_awaitable equivalent to [`QProcess::waitForStarted()`][qtdoc-qprocess-waitForStarted].
      *
@@ -4,14 +4,24 @@
 
 #pragma once
 
+#include "asyncgenerator.h"
 #include "coroutine.h"
+#include "impl/resume.h"
 #include "macros.h"
 
 #include <QObject>
 #include <QPointer>
 
+#include <algorithm>
 #include <cassert>
+#include <deque>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 #ifndef Q_MOC_RUN // Moc cannot parse the libc++ concepts header
 #include <concepts>
@@ -48,22 +58,53 @@ class QCoroSignal {
     using ArgsTuple = typename args_tuple<FuncPtr>::types;
 
 public:
-    QCoroSignal(T *obj, FuncPtr &&funcPtr) : mObj(obj), mFuncPtr(std::forward<FuncPtr>(funcPtr)) {}
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Signal;
+    }
+
+    QCoroSignal(T *obj, FuncPtr &&funcPtr,
+                Qt::ConnectionType connectionType = Qt::QueuedConnection)
+        : mObj(obj), mFuncPtr(std::forward<FuncPtr>(funcPtr)), mConnectionType(connectionType) {}
+    Q_DISABLE_COPY(QCoroSignal)
+    QCORO_DEFAULT_MOVE(QCoroSignal)
+
+    ~QCoroSignal() {
+        cancel();
+    }
 
     bool await_ready() const noexcept {
         return mObj.isNull();
     }
 
-    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mSuspended = true;
+        if (mConnectionType == Qt::DirectConnection) {
+            // The slot is never invoked once disconnected, so it can reference the awaiter
+            mConn = QObject::connect(
+                mObj, mFuncPtr, mObj,
+                [this, awaitingCoroutine](auto &&...args) {
+                    resumeWith(awaitingCoroutine, std::forward<decltype(args)>(args)...);
+                },
+                Qt::DirectConnection);
+            return;
+        }
+
+        // A queued invocation of the slot may still be delivered after the connection is
+        // disconnected, so the slot only reaches the awaiter through the guard. The guard
+        // is reused unless it's still referenced by the slot of a previous await.
+        if (!mGuard || mGuard.use_count() > 1) {
+            mGuard = std::make_shared<QCoroSignal *>(this);
+        } else {
+            *mGuard = this;
+        }
         mConn = QObject::connect(
             mObj, mFuncPtr, mObj,
-            [this, awaitingCoroutine](auto &&...args) mutable {
-                QObject::disconnect(mConn);
-
-                mResult.emplace(std::forward<decltype(args)>(args)...);
-                awaitingCoroutine.resume();
+            [guard = mGuard, awaitingCoroutine](auto &&...args) {
+                if (auto *self = std::exchange(*guard, nullptr)) {
+                    self->resumeWith(awaitingCoroutine, std::forward<decltype(args)>(args)...);
+                }
             },
-            Qt::QueuedConnection);
+            mConnectionType);
     }
 
     auto await_resume() {
@@ -77,14 +118,190 @@ public:
         }
     }
 
+    //! Stops waiting for the signal.
+    /*!
+     * \return Whether the awaiter has been cancelled before the signal was emitted. If so,
+     * the coroutine will not be resumed by the awaiter.
+     */
+    bool cancel() noexcept {
+        if (!std::exchange(mSuspended, false)) {
+            return false;
+        }
+        if (mGuard) {
+            *mGuard = nullptr;
+        }
+        QObject::disconnect(mConn);
+        return true;
+    }
+
 private:
+    template<typename... Args>
+    void resumeWith(QCORO_STD::coroutine_handle<> awaitingCoroutine, Args &&...args) {
+        if (!std::exchange(mSuspended, false)) {
+            return;
+        }
+        QObject::disconnect(mConn);
+
+        mResult.emplace(std::forward<Args>(args)...);
+        awaitingCoroutine.resume();
+    }
+
     QPointer<T> mObj;
     FuncPtr mFuncPtr;
+    Qt::ConnectionType mConnectionType;
     QMetaObject::Connection mConn;
+    //! Only allocated for connections that may be queued.
+    std::shared_ptr<QCoroSignal *> mGuard;
     std::optional<ArgsTuple> mResult;
+    bool mSuspended = false;
 };
 
 template<concepts::QObject T, typename FuncPtr>
 QCoroSignal(T *, FuncPtr &&) -> QCoroSignal<T, FuncPtr>;
 
+template<concepts::QObject T, typename FuncPtr>
+QCoroSignal(T *, FuncPtr &&, Qt::ConnectionType) -> QCoroSignal<T, FuncPtr>;
+
+//! Type of values yielded by a signal listener for a signal with arguments \c ArgsTuple.
+/*!
+ * The arguments are copied, since the listener may have to keep them around for some
+ * time. Signals without arguments yield \c std::monostate, signals with a single argument
+ * yield a copy of the argument, otherwise the arguments are yielded as a tuple.
+ */
+template<typename ArgsTuple>
+struct signal_listener_result;
+
+template<>
+struct signal_listener_result<std::tuple<>> {
+    using type = std::monostate;
+};
+
+template<typename Arg>
+struct signal_listener_result<std::tuple<Arg>> {
+    using type = std::decay_t<Arg>;
+};
+
+template<typename... Args>
+struct signal_listener_result<std::tuple<Args...>> {
+    using type = std::tuple<std::decay_t<Args>...>;
+};
+
+//! Keeps a single connection to a signal and queues its emissions for a coroutine.
+/*!
+ * Used by \c qCoroSignalListener() to implement the stream of signal emissions. The listener
+ * connects to the signal when it's constructed and stays connected until it's destroyed, so
+ * no emission is missed while the consuming coroutine is busy processing the previous one.
+ *
+ * The slots are invoked in the context of an object owned by the listener, which lives in the
+ * thread that creates the listener (and consumes the emissions). So emissions from other
+ * threads are queued to that thread and don't race with the consumer, and emissions that are
+ * still queued when the listener is destroyed are dropped together with the context object.
+ */
+template<concepts::QObject T, typename FuncPtr>
+class QCoroSignalListener {
+    using ArgsTuple = typename args_tuple<std::remove_cvref_t<FuncPtr>>::types;
+
+public:
+    using result_type = typename signal_listener_result<ArgsTuple>::type;
+
+    //! Connects to the signal.
+    /*!
+     * At most \c queueSize emissions are kept in the queue. When the queue is full, the oldest
+     * emission is dropped to make space for the new one.
+     */
+    QCoroSignalListener(T *obj, FuncPtr funcPtr, std::size_t queueSize)
+        : mQueueSize(std::max<std::size_t>(queueSize, 1)) {
+        mConn = QObject::connect(obj, funcPtr, &mContext, [this](auto &&...args) {
+            enqueue(std::forward<decltype(args)>(args)...);
+        });
+        mDestroyedConn = QObject::connect(obj, &QObject::destroyed, &mContext, [this]() {
+            mFinished = true;
+            wakeUp();
+        });
+    }
+
+    Q_DISABLE_COPY(QCoroSignalListener)
+
+    ~QCoroSignalListener() {
+        QObject::disconnect(mConn);
+        QObject::disconnect(mDestroyedConn);
+    }
+
+    //! Returns an Awaitable that waits for the next emission.
+    /*!
+     * The Awaitable returns arguments of the next queued emission, or an empty optional if
+     * the sender has been destroyed and there are no queued emissions left.
+     */
+    auto next() noexcept {
+        class NextAwaiter {
+        public:
+            static constexpr AwaiterKind awaiterKind() noexcept {
+                return AwaiterKind::Signal;
+            }
+
+            explicit NextAwaiter(QCoroSignalListener *listener) : mListener(listener) {}
+
+            bool await_ready() const noexcept {
+                return !mListener->mQueue.empty() || mListener->mFinished;
+            }
+
+            void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mListener->mAwaitingCoroutine = awaitingCoroutine;
+            }
+
+            std::optional<result_type> await_resume() {
+                if (mListener->mQueue.empty()) {
+                    return std::nullopt;
+                }
+                std::optional<result_type> result{std::move(mListener->mQueue.front())};
+                mListener->mQueue.pop_front();
+                return result;
+            }
+
+        private:
+            QCoroSignalListener *mListener;
+        };
+        return NextAwaiter{this};
+    }
+
+private:
+    template<typename... Args>
+    void enqueue(Args &&...args) {
+        if (mQueue.size() >= mQueueSize) {
+            mQueue.pop_front();
+        }
+        mQueue.emplace_back(std::forward<Args>(args)...);
+        wakeUp();
+    }
+
+    void wakeUp() {
+        if (auto coroutine = std::exchange(mAwaitingCoroutine, nullptr); coroutine) {
+            resumeCoroutine(mReadyNode, coroutine);
+        }
+    }
+
+    //! Receiver of the connections, in the thread of the consumer.
+    QObject mContext;
+    std::size_t mQueueSize;
+    std::deque<result_type> mQueue;
+    bool mFinished = false;
+    QMetaObject::Connection mConn;
+    QMetaObject::Connection mDestroyedConn;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
+};
+
+//! Generator that yields emissions queued by the \c listener, until the sender is destroyed.
+template<typename Listener>
+AsyncGenerator<typename Listener::result_type>
+signalListenerGenerator(std::unique_ptr<Listener> listener) {
+    while (true) {
+        auto value = co_await listener->next();
+        if (!value.has_value()) {
+            co_return;
+        }
+        co_yield std::move(*value);
+    }
+}
+
 } // namespace QCoro::detail
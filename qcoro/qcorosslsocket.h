@@ -0,0 +1,353 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/waitoperationbase.h"
+#include "qcoroabstractsocket.h"
+
+#include <QByteArray>
+#include <QPointer>
+#include <QSslConfiguration>
+#include <QSslSocket>
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace QCoro {
+
+//! A process-wide cache of TLS session tickets.
+/*!
+ * A client that presents a session ticket it has received from the server in a previous
+ * connection can resume the TLS session with an abbreviated handshake, which skips the
+ * certificate exchange and verification and saves a round trip with TLS 1.2.
+ *
+ * The cache is disabled by default. Once enabled, `qCoro(socket).connectToHostEncrypted()`
+ * applies the ticket cached for the peer to the socket before connecting and stores the
+ * tickets received from the server in the cache, so all the connections to the same peer
+ * reuse the session automatically:
+ *
+ * ```cpp
+ * QCoro::SslSessionCache::global().setEnabled(true);
+ * ...
+ * QSslSocket socket;
+ * if (co_await qCoro(socket).connectToHostEncrypted(QStringLiteral("example.com"), 443)) {
+ *     ...
+ * }
+ * ```
+ *
+ * The peers are identified by the host name (or the SSL peer name, if given) and the port.
+ * Resuming a session skips the verification of the server's certificate, so prepareSocket()
+ * only stores tickets of sessions in which the certificate has been verified without any errors
+ * (not even ignored ones) and without a client certificate, see isReusable().
+ *
+ * The cache holds at most capacity() tickets, the least recently used tickets are evicted
+ * first. Expired tickets are never handed out. The cache can be used from multiple threads.
+ */
+class SslSessionCache {
+public:
+    //! Constructs an empty cache.
+    SslSessionCache() = default;
+    Q_DISABLE_COPY(SslSessionCache)
+
+    //! Returns the cache used by QCoroSslSocket::connectToHostEncrypted().
+    static SslSessionCache &global() {
+        static SslSessionCache cache{false};
+        return cache;
+    }
+
+    //! Returns whether the cache is used by QCoroSslSocket::connectToHostEncrypted().
+    bool isEnabled() const noexcept {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    //! Enables or disables the use of the cache.
+    void setEnabled(bool enabled) noexcept {
+        mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    //! Returns the maximum number of cached tickets, 256 by default.
+    std::size_t capacity() const {
+        std::scoped_lock lock(mLock);
+        return mCapacity;
+    }
+
+    //! Sets the maximum number of cached tickets, evicting the least recently used ones.
+    void setCapacity(std::size_t capacity) {
+        std::scoped_lock lock(mLock);
+        mCapacity = capacity;
+        evict();
+    }
+
+    //! Returns the number of cached tickets.
+    std::size_t size() const {
+        std::scoped_lock lock(mLock);
+        return mEntries.size();
+    }
+
+    //! Returns the session ticket cached for the peer, or an empty array if there's none.
+    QByteArray sessionTicket(const QString &peerName, quint16 port) {
+        std::scoped_lock lock(mLock);
+        const auto it = mIndex.find(Key{peerName, port});
+        if (it == mIndex.end()) {
+            return {};
+        }
+        if (it->second->expires < Clock::now()) {
+            mEntries.erase(it->second);
+            mIndex.erase(it);
+            return {};
+        }
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return it->second->ticket;
+    }
+
+    //! Stores the session ticket for the peer.
+    /*!
+     * The ticket expires after \c lifetime, a ticket without a lifetime is kept until it's
+     * evicted. An empty ticket removes the cached one.
+     */
+    void insert(const QString &peerName, quint16 port, const QByteArray &ticket,
+                std::chrono::seconds lifetime = std::chrono::seconds::zero()) {
+        if (ticket.isEmpty()) {
+            remove(peerName, port);
+            return;
+        }
+
+        const auto expires =
+            lifetime.count() > 0 ? Clock::now() + lifetime : Clock::time_point::max();
+        std::scoped_lock lock(mLock);
+        Key key{peerName, port};
+        if (const auto it = mIndex.find(key); it != mIndex.end()) {
+            it->second->ticket = ticket;
+            it->second->expires = expires;
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            return;
+        }
+        mEntries.push_front(Entry{key, ticket, expires});
+        mIndex.emplace(std::move(key), mEntries.begin());
+        evict();
+    }
+
+    //! Removes the session ticket cached for the peer.
+    void remove(const QString &peerName, quint16 port) {
+        std::scoped_lock lock(mLock);
+        if (const auto it = mIndex.find(Key{peerName, port}); it != mIndex.end()) {
+            mEntries.erase(it->second);
+            mIndex.erase(it);
+        }
+    }
+
+    //! Removes all the cached tickets.
+    void clear() {
+        std::scoped_lock lock(mLock);
+        mIndex.clear();
+        mEntries.clear();
+    }
+
+    //! Prepares the \c socket to resume a session cached for the peer.
+    /*!
+     * Enables session persistence in the socket's SSL configuration, applies the ticket cached
+     * for the peer and makes the socket store the tickets it receives in the cache. Call before
+     * connecting the socket. The cache must outlive the socket.
+     */
+    void prepareSocket(QSslSocket *socket, const QString &peerName, quint16 port) {
+        auto config = socket->sslConfiguration();
+        config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+        if (const auto ticket = sessionTicket(peerName, port); !ticket.isEmpty()) {
+            config.setSessionTicket(ticket);
+        }
+        socket->setSslConfiguration(config);
+
+        // The same socket may be reconnected, possibly to a different peer, so the peer
+        // is only looked up when a ticket arrives.
+        if (socket->property(sConnectedProperty).toBool()) {
+            return;
+        }
+        socket->setProperty(sConnectedProperty, true);
+        const auto store = [this, socket]() {
+            if (!isReusable(socket)) {
+                return;
+            }
+            const auto config = socket->sslConfiguration();
+            insert(socket->peerVerifyName().isEmpty() ? socket->peerName()
+                                                      : socket->peerVerifyName(),
+                   socket->peerPort(), config.sessionTicket(),
+                   std::chrono::seconds{config.sessionTicketLifeTimeHint()});
+        };
+        // TLS 1.2 tickets are known once the handshake is done, TLS 1.3 tickets arrive later.
+        QObject::connect(socket, &QSslSocket::encrypted, socket, store);
+        QObject::connect(socket, &QSslSocket::newSessionTicketReceived, socket, store);
+    }
+
+    //! Returns whether the session of the \c socket can be resumed by other sockets.
+    /*!
+     * A resumed session is trusted without verifying the server's certificate again, so the
+     * session is only reusable if the \c socket has verified the certificate and the handshake
+     * has encountered no errors, including errors ignored by \c QSslSocket::ignoreSslErrors().
+     * Sessions authenticated with a client certificate are not reusable either, since another
+     * socket would resume them without presenting the certificate.
+     */
+    static bool isReusable(const QSslSocket *socket) {
+        const auto verifyMode = socket->peerVerifyMode();
+        return (verifyMode == QSslSocket::VerifyPeer || verifyMode == QSslSocket::AutoVerifyPeer) &&
+               socket->sslHandshakeErrors().isEmpty() &&
+               socket->sslConfiguration().localCertificate().isNull();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Key = std::pair<QString, quint16>;
+
+    struct Entry {
+        Key key;
+        QByteArray ticket;
+        Clock::time_point expires;
+    };
+
+    static constexpr const char *sConnectedProperty = "_qcoro_sslSessionCache";
+
+    explicit SslSessionCache(bool enabled) : mEnabled(enabled) {}
+
+    void evict() {
+        while (mEntries.size() > mCapacity) {
+            mIndex.erase(mEntries.back().key);
+            mEntries.pop_back();
+        }
+    }
+
+    mutable std::mutex mLock;
+    //! Most recently used first.
+    std::list<Entry> mEntries;
+    std::map<Key, std::list<Entry>::iterator> mIndex;
+    std::size_t mCapacity = 256;
+    std::atomic<bool> mEnabled{true};
+};
+
+} // namespace QCoro
+
+namespace QCoro::detail {
+
+//! QSslSocket wrapper with co_awaitable-friendly API.
+class QCoroSslSocket final : public QCoroAbstractSocket {
+    //! An Awaitable that suspends the coroutine until the TLS handshake is finished
+    class WaitForEncryptedOperation final : public WaitOperationBase<QSslSocket> {
+    public:
+        WaitForEncryptedOperation(QSslSocket *socket, int timeout_msecs = 30'000)
+            : WaitOperationBase(socket, timeout_msecs) {}
+        Q_DISABLE_COPY(WaitForEncryptedOperation)
+        QCORO_DEFAULT_MOVE(WaitForEncryptedOperation)
+
+        ~WaitForEncryptedOperation() override {
+            QObject::disconnect(mStateConn);
+        }
+
+        bool await_ready() const noexcept {
+            return !mObj || mObj->isEncrypted() ||
+                   mObj->state() == QAbstractSocket::UnconnectedState;
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            mConn = QObject::connect(mObj, &QSslSocket::encrypted,
+                                     [this, awaitingCoroutine]() { finish(awaitingCoroutine); });
+            // The socket is disconnected when the handshake fails
+            mStateConn = QObject::connect(
+                mObj, &QAbstractSocket::stateChanged,
+                [this, awaitingCoroutine](QAbstractSocket::SocketState state) {
+                    if (state == QAbstractSocket::UnconnectedState && !mTimedOut) {
+                        finish(awaitingCoroutine);
+                    }
+                });
+            startTimeoutTimer(awaitingCoroutine);
+        }
+
+        //! Returns whether the connection is encrypted.
+        bool await_resume() const noexcept {
+            return !mTimedOut && mObj && mObj->isEncrypted();
+        }
+
+        //! Stops waiting for the handshake, including the socket's state changes.
+        bool cancel() noexcept {
+            QObject::disconnect(mStateConn);
+            return WaitOperationBase::cancel();
+        }
+
+    private:
+        void finish(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            QObject::disconnect(mStateConn);
+            resume(awaitingCoroutine);
+        }
+
+        QMetaObject::Connection mStateConn;
+    };
+
+public:
+    explicit QCoroSslSocket(QSslSocket *socket) : QCoroAbstractSocket(socket), mSocket(socket) {}
+
+    //! Co_awaitable equivalent to [`QSslSocket::waitForEncrypted()`][qtdoc-qsslsocket-waitForEncrypted].
+    /*!
+     * Returns \c true when the connection is encrypted, \c false if the handshake has failed
+     * or the operation timed out.
+     */
+    Awaitable auto waitForEncrypted(int timeout_msecs = 30'000) {
+        return WaitForEncryptedOperation{mSocket.data(), timeout_msecs};
+    }
+
+    //! Co_awaitable equivalent to [`QSslSocket::waitForEncrypted()`][qtdoc-qsslsocket-waitForEncrypted].
+    /*!
+     * Unlike the Qt version, this overload uses `std::chrono::milliseconds` to express the
+     * timeout rather than plain `int`.
+     */
+    Awaitable auto waitForEncrypted(std::chrono::milliseconds timeout) {
+        return waitForEncrypted(static_cast<int>(timeout.count()));
+    }
+
+    //! Connects to the server and waits until the connection is encrypted.
+    /*!
+     * Equivalent to calling [`QSslSocket::connectToHostEncrypted()`][qtdoc-qsslsocket-connectToHostEncrypted]
+     * followed by [`QSslSocket::waitForEncrypted()`][qtdoc-qsslsocket-waitForEncrypted]. When
+     * the global SslSessionCache is enabled, resumes the TLS session cached for the peer.
+     */
+    Awaitable auto connectToHostEncrypted(
+        const QString &hostName, quint16 port, QIODevice::OpenMode openMode = QIODevice::ReadWrite,
+        QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::AnyIPProtocol) {
+        if (auto &cache = SslSessionCache::global(); cache.isEnabled()) {
+            cache.prepareSocket(mSocket, hostName, port);
+        }
+        mSocket->connectToHostEncrypted(hostName, port, openMode, protocol);
+        return waitForEncrypted();
+    }
+
+    //! Connects to the server and waits until the connection is encrypted.
+    /*!
+     * Uses \c sslPeerName instead of \c hostName to verify the server's certificate, see
+     * [`QSslSocket::connectToHostEncrypted()`][qtdoc-qsslsocket-connectToHostEncrypted-1].
+     */
+    Awaitable auto connectToHostEncrypted(
+        const QString &hostName, quint16 port, const QString &sslPeerName,
+        QIODevice::OpenMode openMode = QIODevice::ReadWrite,
+        QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::AnyIPProtocol) {
+        if (auto &cache = SslSessionCache::global(); cache.isEnabled()) {
+            cache.prepareSocket(mSocket, sslPeerName, port);
+        }
+        mSocket->connectToHostEncrypted(hostName, port, sslPeerName, openMode, protocol);
+        return waitForEncrypted();
+    }
+
+private:
+    QPointer<QSslSocket> mSocket;
+};
+
+} // namespace QCoro::detail
+
+/*!
+ * [qtdoc-qsslsocket-waitForEncrypted]: https://doc.qt.io/qt-5/qsslsocket.html#waitForEncrypted
+ * [qtdoc-qsslsocket-connectToHostEncrypted]: https://doc.qt.io/qt-5/qsslsocket.html#connectToHostEncrypted
+ * [qtdoc-qsslsocket-connectToHostEncrypted-1]: https://doc.qt.io/qt-5/qsslsocket.html#connectToHostEncrypted-1
+ */
@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include "asyncgenerator.h"
+#include "impl/serverconnections.h"
 #include "impl/waitoperationbase.h"
+#include "qcorosignal.h"
 
 #include <QTcpServer>
 #include <QPointer>
@@ -58,6 +61,22 @@ public:
         return WaitForNewConnectionOperation{mServer.data(), static_cast<int>(timeout.count())};
     }
 
+    //! Returns an asynchronous stream of incoming connections.
+    /*!
+     * The generator yields all the connections that are pending in the server at once,
+     * without returning to the event loop in between, and then waits for the server to
+     * emit \c newConnection(). The generator finishes when the server is destroyed.
+     *
+     * ```cpp
+     * QCORO_FOREACH(QTcpSocket *socket, qCoro(server).connections()) {
+     *     handleClient(socket);
+     * }
+     * ```
+     */
+    AsyncGenerator<QTcpSocket *> connections() {
+        return serverConnections<QTcpServer, QTcpSocket>(mServer);
+    }
+
 private:
     QPointer<QTcpServer> mServer;
 };
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/waitoperationbase.h"
+#include "qcoroabstractsocket.h"
+
+#include <QNetworkDatagram>
+#include <QPointer>
+#include <QUdpSocket>
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace QCoro::detail {
+
+//! QUdpSocket wrapper with co_awaitable-friendly API.
+class QCoroUdpSocket final : public QCoroAbstractSocket {
+    //! An Awaitable that suspends the coroutine until datagrams are available and takes them.
+    class ReceiveDatagramsOperation final : public WaitOperationBase<QUdpSocket> {
+    public:
+        ReceiveDatagramsOperation(QUdpSocket *socket, std::vector<QNetworkDatagram> &datagrams,
+                                  std::size_t maxBatch, int timeout_msecs)
+            : WaitOperationBase(socket, timeout_msecs), mDatagrams(&datagrams),
+              mMaxBatch(maxBatch) {}
+
+        bool await_ready() const noexcept {
+            return !mObj || mObj->hasPendingDatagrams() ||
+                   mObj->state() == QAbstractSocket::UnconnectedState;
+        }
+
+        void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+            mConn = QObject::connect(mObj, &QIODevice::readyRead,
+                                     [this, awaitingCoroutine]() { resume(awaitingCoroutine); });
+            startTimeoutTimer(awaitingCoroutine);
+        }
+
+        //! Returns the number of received datagrams.
+        std::size_t await_resume() {
+            mDatagrams->clear();
+            while (mObj && mDatagrams->size() < mMaxBatch && mObj->hasPendingDatagrams()) {
+                mDatagrams->push_back(mObj->receiveDatagram());
+            }
+            return mDatagrams->size();
+        }
+
+    private:
+        std::vector<QNetworkDatagram> *mDatagrams;
+        std::size_t mMaxBatch;
+    };
+
+public:
+    explicit QCoroUdpSocket(QUdpSocket *socket) : QCoroAbstractSocket(socket), mSocket(socket) {}
+
+    //! Waits until datagrams are available and receives all of them in one go.
+    /*!
+     * Replaces the content of \c datagrams with up to \c maxBatch pending datagrams and returns
+     * their number, which is 0 if the socket is not bound or the operation timed out. The
+     * vector is cleared but keeps its capacity, so it can be reused by the next call without
+     * reallocating. The coroutine is not suspended if datagrams are already pending.
+     */
+    Awaitable auto receiveDatagrams(std::vector<QNetworkDatagram> &datagrams,
+                                    std::size_t maxBatch = 64, int timeout_msecs = -1) {
+        return ReceiveDatagramsOperation{mSocket.data(), datagrams, maxBatch, timeout_msecs};
+    }
+
+    //! Waits until datagrams are available and receives all of them in one go.
+    /*!
+     * Unlike the overload above, this overload uses `std::chrono::milliseconds` to express the
+     * timeout rather than plain `int`.
+     */
+    Awaitable auto receiveDatagrams(std::vector<QNetworkDatagram> &datagrams, std::size_t maxBatch,
+                                    std::chrono::milliseconds timeout) {
+        return receiveDatagrams(datagrams, maxBatch, static_cast<int>(timeout.count()));
+    }
+
+    //! Sends all the \c datagrams.
+    /*!
+     * Sending a datagram never waits, so this is not an Awaitable. Returns the number of
+     * datagrams that have been sent, stops at the first datagram that couldn't be sent,
+     * for example because the socket's send buffer is full. The error is reported by
+     * the socket.
+     */
+    std::size_t sendDatagrams(std::span<const QNetworkDatagram> datagrams) {
+        std::size_t sent = 0;
+        for (const auto &datagram : datagrams) {
+            if (!mSocket || mSocket->writeDatagram(datagram) < 0) {
+                break;
+            }
+            ++sent;
+        }
+        return sent;
+    }
+
+private:
+    QPointer<QUdpSocket> mSocket;
+};
+
+} // namespace QCoro::detail
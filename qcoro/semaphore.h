@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/waitqueue.h"
+#include "macros.h"
+
+#include <cstddef>
+#include <mutex>
+
+namespace QCoro {
+
+//! A counting semaphore for coroutines.
+/*!
+ * The semaphore holds a number of permits. Coroutines co_awaiting acquire() when there are
+ * no permits available are suspended, instead of blocking the thread, and are resumed in
+ * the order in which they started waiting as the permits are released. This makes it easy
+ * to limit the number of concurrently running operations:
+ *
+ * ```cpp
+ * QCoro::Semaphore requests{4};
+ *
+ * QCoro::Task<QByteArray> Client::fetch(const QUrl &url) {
+ *     co_await requests.acquire(); // at most 4 requests are running at the same time
+ *     auto *reply = co_await mNam.get(QNetworkRequest{url});
+ *     requests.release();
+ *     ...
+ * }
+ * ```
+ *
+ * The semaphore can be shared by coroutines running in different threads, each coroutine is
+ * resumed in the thread in which it has co_awaited acquire().
+ */
+class Semaphore {
+public:
+    //! Constructs a semaphore with \c permits available permits.
+    explicit Semaphore(std::size_t permits = 0) noexcept : mAvailable(permits) {}
+    Q_DISABLE_COPY(Semaphore)
+
+    ~Semaphore() {
+        Q_ASSERT(mWaiters.isEmpty());
+    }
+
+    //! Returns an Awaitable that acquires a single permit.
+    /*!
+     * The awaiting coroutine is suspended until a permit is available. The awaiter can be
+     * cancelled, so the permit can be awaited with QCoro::withTimeout().
+     */
+    auto acquire() noexcept {
+        return detail::SyncAwaiter<Semaphore>{this};
+    }
+
+    //! Acquires a single permit if one is available.
+    /*!
+     * \return Whether a permit has been acquired by this call.
+     */
+    bool tryAcquire() noexcept {
+        std::lock_guard guard{mLock};
+        if (mAvailable == 0) {
+            return false;
+        }
+        --mAvailable;
+        return true;
+    }
+
+    //! Releases \c permits permits.
+    /*!
+     * The permits are handed over to the coroutines that have been waiting the longest,
+     * the remaining permits become available.
+     */
+    void release(std::size_t permits = 1) {
+        // Popped waiters are not linked anymore, so they can't be cancelled; they are
+        // chained through their `next` pointer until they are resumed.
+        detail::SyncWaiter *ready = nullptr;
+        detail::SyncWaiter *readyTail = nullptr;
+        {
+            std::lock_guard guard{mLock};
+            for (; permits > 0; --permits) {
+                auto *waiter = mWaiters.pop();
+                if (!waiter) {
+                    break;
+                }
+                if (readyTail) {
+                    readyTail->next = waiter;
+                } else {
+                    ready = waiter;
+                }
+                readyTail = waiter;
+            }
+            mAvailable += permits;
+        }
+        detail::resumeWaiters(ready);
+    }
+
+    //! Returns the number of currently available permits.
+    std::size_t available() const noexcept {
+        std::lock_guard guard{mLock};
+        return mAvailable;
+    }
+
+private:
+    friend class detail::SyncAwaiter<Semaphore>;
+
+    bool enqueue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (mAvailable > 0) {
+            --mAvailable;
+            return false;
+        }
+        mWaiters.push(waiter);
+        return true;
+    }
+
+    bool dequeue(detail::SyncWaiter *waiter) noexcept {
+        std::lock_guard guard{mLock};
+        if (!waiter->linked) {
+            return false;
+        }
+        mWaiters.remove(waiter);
+        return true;
+    }
+
+    mutable std::mutex mLock;
+    detail::WaitQueue mWaiters;
+    std::size_t mAvailable;
+};
+
+} // namespace QCoro
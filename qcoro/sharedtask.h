@@ -0,0 +1,390 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/resume.h"
+#include "task.h"
+
+#include <QAbstractEventDispatcher>
+
+#include <cstddef>
+#include <exception>
+#include <utility>
+#include <variant>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! A coroutine co_awaiting an unfinished SharedTask.
+/*!
+ * The waiter is embedded in the awaiter object of the suspended coroutine, so registering
+ * another awaiting coroutine doesn't need to allocate.
+ */
+struct SharedTaskWaiter {
+    SharedTaskWaiter *next = nullptr;
+    QCORO_STD::coroutine_handle<> coroutine = {};
+    ReadyNode readyNode;
+    bool linked = false;
+};
+
+//! Resumes all coroutines co_awaiting the just finished SharedTask coroutine.
+class SharedTaskFinalSuspend {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    //! Called by the compiler when the just finished coroutine is suspended for the last time.
+    /*!
+     * The coroutine drops its own reference to the frame first: each awaiter holds a reference
+     * too, so the frame is only destroyed here if there's nobody to resume. A single waiter is
+     * resumed by symmetric transfer. A resumed coroutine may destroy the coroutine of another
+     * waiter, so multiple waiters are resumed from the event loop, in the order in which they
+     * started waiting, and the ReadyNode of a destroyed waiter removes itself from the
+     * ReadyQueue. Without an event loop in the current thread they are resumed right away.
+     */
+    template<typename _Promise>
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<_Promise> finishedCoroutine) noexcept {
+        auto &promise = finishedCoroutine.promise();
+        auto *waiter = promise.finish();
+        if (promise.deref()) {
+            finishedCoroutine.destroy();
+        }
+
+        if (!waiter) {
+            return QCORO_STD::noop_coroutine();
+        }
+        if (!waiter->next) {
+            return waiter->coroutine;
+        }
+        const bool queued = QAbstractEventDispatcher::instance() != nullptr;
+        while (waiter) {
+            // The waiter lives in the awaiter, which is gone once its coroutine is resumed.
+            auto *next = std::exchange(waiter->next, nullptr);
+            if (queued) {
+                resumeQueued(waiter->readyNode, waiter->coroutine);
+            } else {
+                waiter->coroutine.resume();
+            }
+            waiter = next;
+        }
+        return QCORO_STD::noop_coroutine();
+    }
+
+    constexpr void await_resume() const noexcept {}
+};
+
+//! Base class for the \c SharedTask<T> promise_type.
+/*!
+ * The coroutine frame is reference counted: it is referenced by each copy of the SharedTask
+ * and by the coroutine itself until it finishes. The coroutine starts executing immediately,
+ * like a Task<T> coroutine, and its result is kept in the frame until the last reference
+ * is released.
+ */
+class SharedTaskPromiseBase : public PromiseBase {
+public:
+    QCORO_STD::suspend_never initial_suspend() const noexcept {
+        return {};
+    }
+
+    SharedTaskFinalSuspend final_suspend() const noexcept {
+        return {};
+    }
+
+    bool isFinished() const noexcept {
+        return mFinished;
+    }
+
+    //! Registers a coroutine to resume when the coroutine finishes.
+    /*!
+     * Waiters are resumed in the order in which they were added.
+     */
+    void addWaiter(SharedTaskWaiter *waiter) noexcept {
+        Q_ASSERT(!mFinished);
+        waiter->next = nullptr;
+        waiter->linked = true;
+        if (mTail) {
+            mTail->next = waiter;
+        } else {
+            mHead = waiter;
+        }
+        mTail = waiter;
+    }
+
+    //! Unregisters a waiter that is destroyed before the coroutine finishes.
+    void removeWaiter(SharedTaskWaiter *waiter) noexcept {
+        SharedTaskWaiter *prev = nullptr;
+        for (auto *current = mHead; current; prev = current, current = current->next) {
+            if (current != waiter) {
+                continue;
+            }
+            if (prev) {
+                prev->next = current->next;
+            } else {
+                mHead = current->next;
+            }
+            if (mTail == current) {
+                mTail = prev;
+            }
+            break;
+        }
+        waiter->next = nullptr;
+        waiter->linked = false;
+    }
+
+    //! Marks the coroutine as finished and returns the list of waiters to resume.
+    SharedTaskWaiter *finish() noexcept {
+        mFinished = true;
+        auto *head = std::exchange(mHead, nullptr);
+        mTail = nullptr;
+        for (auto *waiter = head; waiter; waiter = waiter->next) {
+            waiter->linked = false;
+        }
+        return head;
+    }
+
+    void ref() noexcept {
+        ++mRefCount;
+    }
+
+    //! Releases one reference to the coroutine frame.
+    /*!
+     * \return Returns true if this was the last reference and the caller must destroy
+     *         the coroutine.
+     */
+    bool deref() noexcept {
+        return --mRefCount == 0;
+    }
+
+private:
+    SharedTaskWaiter *mHead = nullptr;
+    SharedTaskWaiter *mTail = nullptr;
+    //! The coroutine itself holds one reference until it finishes.
+    std::size_t mRefCount = 1;
+    bool mFinished = false;
+};
+
+//! The promise_type for SharedTask<T>
+template<typename T>
+class SharedTaskPromise final : public SharedTaskPromiseBase {
+public:
+    SharedTask<T> get_return_object() noexcept;
+
+    void unhandled_exception() {
+        mValue = std::current_exception();
+    }
+
+    void return_value(T &&value) noexcept {
+        mValue = std::forward<T>(value);
+    }
+
+    void return_value(const T &value) noexcept {
+        mValue = value;
+    }
+
+    //! Returns the result of the coroutine, or rethrows the exception thrown by the coroutine.
+    const T &result() const {
+        if (std::holds_alternative<std::exception_ptr>(mValue)) {
+            std::rethrow_exception(std::get<std::exception_ptr>(mValue));
+        }
+
+        return std::get<T>(mValue);
+    }
+
+private:
+    std::variant<std::monostate, T, std::exception_ptr> mValue;
+};
+
+//! Specialization of SharedTaskPromise for coroutines returning \c void.
+template<>
+class SharedTaskPromise<void> final : public SharedTaskPromiseBase {
+public:
+    SharedTask<void> get_return_object() noexcept;
+
+    void unhandled_exception() {
+        mException = std::current_exception();
+    }
+
+    void return_void() noexcept {}
+
+    void result() const {
+        if (mException) {
+            std::rethrow_exception(mException);
+        }
+    }
+
+private:
+    std::exception_ptr mException;
+};
+
+} // namespace detail
+
+/*! \endcond */
+
+//! An asynchronously executed task that can be co_awaited by multiple coroutines.
+/*!
+ * Unlike Task<T>, the SharedTask<T> can be copied. All copies refer to the same coroutine
+ * and any number of coroutines can co_await them, even at the same time. Once the coroutine
+ * finishes, all the awaiting coroutines are resumed and each of them obtains a const reference
+ * to the same result. The result is kept until the last copy of the SharedTask is destroyed,
+ * so co_awaiting a finished SharedTask returns the result without suspending.
+ *
+ * ```cpp
+ * QCoro::SharedTask<Config> ConfigCache::config() {
+ *     if (!mConfig) {
+ *         mConfig = fetchConfig(); // all callers share a single fetch
+ *     }
+ *     return *mConfig;
+ * }
+ * ```
+ *
+ * The coroutine must be co_awaited from the thread in which it runs, and the copies of the
+ * SharedTask must not be shared between threads.
+ */
+template<typename T>
+class SharedTask {
+public:
+    //! Promise type of the coroutine. This is required by the C++ standard.
+    using promise_type = detail::SharedTaskPromise<T>;
+    //! The type of the coroutine return value.
+    using value_type = T;
+
+    //! Constructs a new empty task.
+    explicit SharedTask() noexcept = default;
+
+    //! Constructs a task bound to a coroutine.
+    explicit SharedTask(QCORO_STD::coroutine_handle<promise_type> coroutine) noexcept
+        : mCoroutine(coroutine) {
+        ref();
+    }
+
+    //! Copies refer to the same coroutine.
+    SharedTask(const SharedTask &other) noexcept : mCoroutine(other.mCoroutine) {
+        ref();
+    }
+
+    SharedTask &operator=(const SharedTask &other) noexcept {
+        if (this != &other) {
+            deref();
+            mCoroutine = other.mCoroutine;
+            ref();
+        }
+        return *this;
+    }
+
+    SharedTask(SharedTask &&other) noexcept : mCoroutine(std::exchange(other.mCoroutine, {})) {}
+
+    SharedTask &operator=(SharedTask &&other) noexcept {
+        if (this != &other) {
+            deref();
+            mCoroutine = std::exchange(other.mCoroutine, {});
+        }
+        return *this;
+    }
+
+    //! Destructor.
+    /*!
+     * Destroys the coroutine if it has already finished and this is the last copy of the
+     * task. Otherwise the coroutine keeps running and destroys itself once it finishes.
+     */
+    ~SharedTask() {
+        deref();
+    }
+
+    //! Returns whether the task has finished.
+    bool isReady() const noexcept {
+        return !mCoroutine || mCoroutine.promise().isFinished();
+    }
+
+    //! Returns the result of the finished coroutine.
+    /*!
+     * Allows to access the memoized result without co_awaiting the task. Must only be called
+     * when \c isReady() returns true. Rethrows the exception thrown by the coroutine.
+     */
+    decltype(auto) result() const {
+        Q_ASSERT(mCoroutine && mCoroutine.promise().isFinished());
+        return mCoroutine.promise().result();
+    }
+
+    //! Provides an Awaiter for the coroutine machinery.
+    /*!
+     * The Awaiter holds a reference to the coroutine, so the coroutine frame and the result it
+     * holds are guaranteed to be alive when the coroutine co_awaiting the task is resumed.
+     */
+    auto operator co_await() const noexcept {
+        class SharedTaskAwaiter {
+        public:
+            static constexpr AwaiterKind awaiterKind() noexcept {
+                return AwaiterKind::Task;
+            }
+
+            explicit SharedTaskAwaiter(const SharedTask &task) : mTask(task) {}
+            Q_DISABLE_COPY(SharedTaskAwaiter)
+            SharedTaskAwaiter(SharedTaskAwaiter &&) noexcept = default;
+            SharedTaskAwaiter &operator=(SharedTaskAwaiter &&) noexcept = default;
+
+            ~SharedTaskAwaiter() {
+                if (mWaiter.linked) {
+                    mTask.mCoroutine.promise().removeWaiter(&mWaiter);
+                }
+            }
+
+            bool await_ready() const noexcept {
+                return mTask.isReady();
+            }
+
+            void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+                mWaiter.coroutine = awaitingCoroutine;
+                mTask.mCoroutine.promise().addWaiter(&mWaiter);
+            }
+
+            //! \return a const reference to the result, owned by the shared coroutine.
+            decltype(auto) await_resume() const {
+                Q_ASSERT(mTask.mCoroutine != nullptr);
+                return mTask.mCoroutine.promise().result();
+            }
+
+        private:
+            SharedTask mTask;
+            detail::SharedTaskWaiter mWaiter;
+        };
+        return SharedTaskAwaiter{*this};
+    }
+
+private:
+    void ref() noexcept {
+        if (mCoroutine) {
+            mCoroutine.promise().ref();
+        }
+    }
+
+    void deref() noexcept {
+        if (mCoroutine && mCoroutine.promise().deref()) {
+            mCoroutine.destroy();
+        }
+    }
+
+    QCORO_STD::coroutine_handle<promise_type> mCoroutine = {};
+};
+
+namespace detail {
+
+template<typename T>
+inline SharedTask<T> SharedTaskPromise<T>::get_return_object() noexcept {
+    return SharedTask<T>{QCORO_STD::coroutine_handle<SharedTaskPromise>::from_promise(*this)};
+}
+
+inline SharedTask<void> SharedTaskPromise<void>::get_return_object() noexcept {
+    return SharedTask<void>{QCORO_STD::coroutine_handle<SharedTaskPromise>::from_promise(*this)};
+}
+
+} // namespace detail
+
+} // namespace QCoro
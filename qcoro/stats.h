@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/stats.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace QCoro {
+
+//! Snapshot of QCoro runtime statistics, summed over all threads.
+struct Stats {
+    //! Number of coroutine frames that are currently alive.
+    std::int64_t liveFrames = 0;
+    //! Total size of the coroutine frames that are currently alive, in bytes.
+    std::int64_t frameBytes = 0;
+    //! Number of waitFor* operations with a timeout that is currently running.
+    std::int64_t activeTimeouts = 0;
+    //! Number of coroutines currently suspended on each kind of operation.
+    std::array<std::int64_t, AwaiterKindCount> suspendedAwaits = {};
+    //! Durations of finished suspensions for each kind of operation.
+    std::array<SuspendDurationHistogram, AwaiterKindCount> suspendDurations = {};
+
+    //! Returns the number of coroutines currently suspended on operations of the given \c kind.
+    std::int64_t suspended(AwaiterKind kind) const noexcept {
+        return suspendedAwaits[static_cast<std::size_t>(kind)];
+    }
+
+    //! Returns the histogram of suspension durations for operations of the given \c kind.
+    const SuspendDurationHistogram &suspendDuration(AwaiterKind kind) const noexcept {
+        return suspendDurations[static_cast<std::size_t>(kind)];
+    }
+};
+
+//! Returns a snapshot of the runtime statistics.
+/*!
+ * The counters are maintained by each thread separately using relaxed atomic operations, so they
+ * are cheap enough to be always enabled. The snapshot sums the counters of all threads, since
+ * the threads keep running while it's taken, the individual numbers may be slightly out of sync.
+ *
+ * Returns an empty snapshot when QCoro is built with \c QCORO_DISABLE_STATS.
+ */
+inline Stats stats() {
+    Stats stats;
+#ifndef QCORO_DISABLE_STATS
+    detail::StatsRegistry::instance().visit([&stats](const detail::StatsCounters &counters) {
+        const auto load = [](const auto &counter) {
+            return counter.load(std::memory_order_relaxed);
+        };
+        stats.liveFrames += load(counters.liveFrames);
+        stats.frameBytes += load(counters.frameBytes);
+        stats.activeTimeouts += load(counters.activeTimeouts);
+        for (std::size_t kind = 0; kind < AwaiterKindCount; ++kind) {
+            stats.suspendedAwaits[kind] += load(counters.suspended[kind]);
+            auto &histogram = stats.suspendDurations[kind];
+            const auto &from = counters.durations[kind];
+            for (std::size_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+                histogram.buckets[bucket] += load(from.buckets[bucket]);
+            }
+            histogram.count += load(from.count);
+            histogram.sum += std::chrono::nanoseconds{load(from.sum)};
+        }
+    });
+#endif
+    return stats;
+}
+
+} // namespace QCoro
@@ -5,8 +5,14 @@
 #pragma once
 
 #include "coroutine.h"
+#include "impl/frameallocator.h"
+#include "impl/instrumentedawaitable.h"
 
 #include <atomic>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 #include <QDebug>
@@ -17,6 +23,12 @@ namespace QCoro {
 template<typename T = void>
 class Task;
 
+template<typename T = void>
+class LazyTask;
+
+template<typename T = void>
+class SharedTask;
+
 /*! \cond internal */
 
 namespace detail {
@@ -27,17 +39,40 @@ struct awaiter_type;
 template<typename T>
 using awaiter_type_t = typename awaiter_type<T>::type;
 
+#ifdef QCORO_SINGLE_THREADED
+//! Non-atomic replacement of \c std::atomic<bool> for the Task handshake.
+/*!
+ * With \c QCORO_SINGLE_THREADED all Tasks are created, awaited and finished in the same
+ * thread, so the handshake between a finishing coroutine and its awaiter doesn't need any
+ * memory fences. The memory orders are accepted only to keep the API of \c std::atomic.
+ */
+class TaskFlag {
+public:
+    TaskFlag(bool value) noexcept : mValue(value) {}
+    Q_DISABLE_COPY(TaskFlag)
+
+    bool load(std::memory_order) const noexcept {
+        return mValue;
+    }
+
+    void store(bool value, std::memory_order) noexcept {
+        mValue = value;
+    }
+
+    bool exchange(bool value, std::memory_order) noexcept {
+        return std::exchange(mValue, value);
+    }
+
+private:
+    bool mValue;
+};
+#else
+using TaskFlag = std::atomic<bool>;
+#endif
+
 //! Continuation that resumes a coroutine co_awaiting on currently finished coroutine.
 class TaskFinalSuspend {
 public:
-    //! Constructs the awaitable, passing it a handle to the co_awaiting coroutine
-    /*!
-     * \param[in] awaitingCoroutine handle of the coroutine that is co_awaiting the current
-     * coroutine (continuation).
-     */
-    explicit TaskFinalSuspend(QCORO_STD::coroutine_handle<> awaitingCoroutine)
-        : mAwaitingCoroutine(awaitingCoroutine) {}
-
     //! Returns whether the just finishing coroutine should do final suspend or not
     /*!
      * If the coroutine is not being co_awaited by another coroutine, then don't
@@ -53,20 +88,33 @@ public:
     /*!
      * It is given handle of the coroutine that is being co_awaited (that is the current
      * coroutine). If there is a co_awaiting coroutine and it has not been resumed yet,
-     * it resumes it.
+     * its handle is returned, so that the compiler transfers the execution to it directly
+     * (symmetric transfer) instead of resuming it recursively from within the current
+     * coroutine. This keeps the stack from growing with every level of nested co_awaits.
      *
-     * Finally, it destroys the just finished coroutine and frees all allocated resources.
+     * If the Task<T> owning the just finished coroutine has already been destroyed, nobody
+     * is interested in the result anymore and the coroutine frame is destroyed. Otherwise the
+     * frame is kept alive for the awaiter to retrieve the result and is destroyed by the Task.
      *
      * \param[in] finishedCoroutine handle of the just finished coroutine
+     * \return handle of the coroutine to resume next.
      */
     template<typename _Promise>
-    void await_suspend(QCORO_STD::coroutine_handle<_Promise> finishedCoroutine) noexcept {
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<_Promise> finishedCoroutine) noexcept {
         auto &promise = finishedCoroutine.promise();
+        traceEvent(TraceEventType::Finished, finishedCoroutine.address());
+        promise.mFinished.store(true, std::memory_order_release);
 
+        QCORO_STD::coroutine_handle<> next = QCORO_STD::noop_coroutine();
         if (promise.mResumeAwaiter.exchange(true, std::memory_order_acq_rel)) {
-            promise.mAwaitingCoroutine.resume();
+            next = promise.mAwaitingCoroutine;
+        }
+        if (promise.release()) {
+            traceEvent(TraceEventType::Destroyed, finishedCoroutine.address());
+            finishedCoroutine.destroy();
         }
-        finishedCoroutine.destroy();
+        return next;
     }
 
     //! Called by the compiler when the just-finished coroutine should be resumed.
@@ -75,10 +123,135 @@ public:
      * In any case, this method does nothing.
      * */
     constexpr void await_resume() const noexcept {}
+};
 
-private:
-    //! Handle of the coroutine co_awaiting the current coroutine.
-    QCORO_STD::coroutine_handle<> mAwaitingCoroutine;
+//! Base class for promise types of all QCoro coroutines.
+/*!
+ * Provides allocation of the coroutine frames from the frame pool and the \c await_transform()
+ * overloads, which make all types supported by QCoro co_awaitable from the coroutine.
+ */
+class PromiseBase {
+public:
+    //! Allocates memory for the coroutine frame.
+    /*!
+     * The compiler uses promise_type's operator new, if present, to allocate the
+     * coroutine frame (which contains the promise, the coroutine arguments and all
+     * local variables that live across suspension points). We allocate the frames
+     * from a thread-local pool of recycled blocks, which avoids going through the
+     * global allocator for most short-lived coroutines.
+     *
+     * \sa QCoro::setFrameAllocator(), QCoro::frameAllocatorStats()
+     */
+    static void *operator new(std::size_t size) {
+        auto *frame = allocateFrame(size);
+        statsFrameAllocated(size);
+        return frame;
+    }
+
+    //! Releases memory allocated for the coroutine frame.
+    static void operator delete(void *ptr, std::size_t size) noexcept {
+        statsFrameReleased(size);
+        deallocateFrame(ptr, size);
+    }
+
+    //! Called by co_await to obtain an Awaitable for type \c T.
+    /*!
+     * When co_awaiting on a value of type \c T, the type \c T must an Awaitable. To allow
+     * to co_await even on types that are not Awaitable (e.g. 3rd party types like QNetworkReply),
+     * C++ allows promise_type to provide \c await_transform() function that can transform
+     * the type \c T into an Awaitable. This is a very powerful mechanism in C++ coroutines.
+     *
+     * For types \c T for which there is no valid await_transform() overload, the C++ attempts
+     * to use those types directly as Awaitables. This is a perfectly valid scenario in cases
+     * when co_awaiting a type that implements the neccessary Awaitable interface.
+     *
+     * In our implementation, the await_transform() is overloaded only for Qt types for which
+     * a specialiation of the \c QCoro::detail::awaiter_type template class exists. The
+     * specialization returns type of the Awaiter for the given type \c T.
+     *
+     * Temporaries are moved into Awaiters that can take them, so that the Awaiter knows that
+     * nobody else holds the value (e.g. a QFuture returned by QtConcurrent::run()).
+     */
+    template<typename T, typename Awaiter = QCoro::detail::awaiter_type_t<std::remove_cvref_t<T>>>
+    auto await_transform(T &&value) {
+        if constexpr (std::is_constructible_v<Awaiter, T &&>) {
+            return QCORO_INSTRUMENT_AWAIT(Awaiter, Awaiter{std::forward<T>(value)});
+        } else {
+            return QCORO_INSTRUMENT_AWAIT(Awaiter, Awaiter{value});
+        }
+    }
+
+    //! Specialized overload of await_transform() for Task<T>.
+    /*!
+     *
+     * When co_awaiting on a value of type \c Task<T>, the co_await will try to obtain
+     * an Awaitable object for the \c Task<T>. Since \c Task<T> already implements the
+     * Awaitable interface it can be directly used as an Awaitable, thus this specialization
+     * only acts as an identity operation.
+     *
+     * The reason we need to specialize it is that co_await will always call promise's await_transform()
+     * overload if it exists. Since our generic await_transform() overload exists only for Qt types
+     * that specialize the \c QCoro::detail::awaiter_type template, the compilation would fail
+     * due to no suitable overload for \c QCoro::Task<T> being found.
+     *
+     * The reason the compiler doesn't check for an existence of await_transform() overload for type T
+     * and falling back to using the T as an Awaitable, but instead only checks for existence of
+     * any overload of await_transform() and failing compilation if non of the overloads is suitable
+     * for type T is, that it allows us to delete await_transform() overload for a particular type,
+     * and thus disallow that type to be co_awaited, even if the type itself provides the Awaitable
+     * interface. This would not be possible if the compiler would always fall back to using the T
+     * as an Awaitable type.
+     */
+    template<typename T>
+    auto await_transform(Task<T> &&task) {
+        return QCORO_INSTRUMENT_AWAIT(Task<T>, std::move(task));
+    }
+
+    //! Specialized overload of await_transform() for an l-value reference to Task<T>.
+    /*!
+     * Allows to co_await a Task<T> stored in a variable. The task is not moved from, so
+     * it still owns the finished coroutine after the co_await.
+     */
+    template<typename T>
+    decltype(auto) await_transform(Task<T> &task) {
+        return QCORO_INSTRUMENT_AWAIT(Task<T> &, task);
+    }
+
+    //! Specialized overload of await_transform() for LazyTask<T>.
+    /*!
+     * Co_awaiting a LazyTask<T> starts the lazy coroutine, unless it has already been started.
+     */
+    template<typename T>
+    auto await_transform(LazyTask<T> &&task) {
+        return QCORO_INSTRUMENT_AWAIT(LazyTask<T>, std::move(task));
+    }
+
+    //! Specialized overload of await_transform() for an l-value reference to LazyTask<T>.
+    template<typename T>
+    decltype(auto) await_transform(LazyTask<T> &task) {
+        return QCORO_INSTRUMENT_AWAIT(LazyTask<T> &, task);
+    }
+
+    //! Specialized overload of await_transform() for SharedTask<T>.
+    /*!
+     * The SharedTask is copied, so that the coroutine frame stays alive while it's co_awaited,
+     * even when co_awaiting a temporary.
+     */
+    template<typename T>
+    auto await_transform(const SharedTask<T> &task) {
+        return QCORO_INSTRUMENT_AWAIT(SharedTask<T>, SharedTask<T>{task});
+    }
+
+    //! If the type T is already an awaitable, then just forward it as it is.
+    template<Awaitable T>
+    auto await_transform(T &&awaitable) {
+        return QCORO_INSTRUMENT_AWAIT(std::remove_cvref_t<T>, std::forward<T>(awaitable));
+    }
+
+    //! Overload of await_transform() for QCoro::traceName(), which must never be traced itself.
+    detail::TraceNameAwaiter await_transform(detail::TraceNameAwaiter awaiter) const noexcept {
+        return awaiter;
+    }
 };
 
 //! Base class for the \c Task<T> promise_type.
@@ -120,7 +293,7 @@ private:
  *  * await_transform() - this one is optional and is used by co_awaits inside the coroutine.
  *    It allows the promise to transform the co_awaited type to an Awaitable.
  */
-class TaskPromiseBase {
+class TaskPromiseBase : public PromiseBase {
 public:
     //! Called when the coroutine is started to decide whether it should be suspended or not.
     /*!
@@ -138,59 +311,9 @@ public:
      * This decides what should happen when the coroutine is finished.
      */
     auto final_suspend() const noexcept {
-        return TaskFinalSuspend{mAwaitingCoroutine};
-    }
-
-    //! Called by co_await to obtain an Awaitable for type \c T.
-    /*!
-     * When co_awaiting on a value of type \c T, the type \c T must an Awaitable. To allow
-     * to co_await even on types that are not Awaitable (e.g. 3rd party types like QNetworkReply),
-     * C++ allows promise_type to provide \c await_transform() function that can transform
-     * the type \c T into an Awaitable. This is a very powerful mechanism in C++ coroutines.
-     *
-     * For types \c T for which there is no valid await_transform() overload, the C++ attempts
-     * to use those types directly as Awaitables. This is a perfectly valid scenario in cases
-     * when co_awaiting a type that implements the neccessary Awaitable interface.
-     *
-     * In our implementation, the await_transform() is overloaded only for Qt types for which
-     * a specialiation of the \c QCoro::detail::awaiter_type template class exists. The
-     * specialization returns type of the Awaiter for the given type \c T.
-     */
-    template<typename T, typename Awaiter = QCoro::detail::awaiter_type_t<std::remove_cvref_t<T>>>
-    auto await_transform(T &&value) {
-        return Awaiter{value};
-    }
-
-    //! Specialized overload of await_transform() for Task<T>.
-    /*!
-     *
-     * When co_awaiting on a value of type \c Task<T>, the co_await will try to obtain
-     * an Awaitable object for the \c Task<T>. Since \c Task<T> already implements the
-     * Awaitable interface it can be directly used as an Awaitable, thus this specialization
-     * only acts as an identity operation.
-     *
-     * The reason we need to specialize it is that co_await will always call promise's await_transform()
-     * overload if it exists. Since our generic await_transform() overload exists only for Qt types
-     * that specialize the \c QCoro::detail::awaiter_type template, the compilation would fail
-     * due to no suitable overload for \c QCoro::Task<T> being found.
-     *
-     * The reason the compiler doesn't check for an existence of await_transform() overload for type T
-     * and falling back to using the T as an Awaitable, but instead only checks for existence of
-     * any overload of await_transform() and failing compilation if non of the overloads is suitable
-     * for type T is, that it allows us to delete await_transform() overload for a particular type,
-     * and thus disallow that type to be co_awaited, even if the type itself provides the Awaitable
-     * interface. This would not be possible if the compiler would always fall back to using the T
-     * as an Awaitable type.
-     */
-    template<typename T>
-    auto await_transform(Task<T> &&task) {
-        return std::forward<Task<T>>(task);
-    }
-
-    //! If the type T is already an awaitable, then just forward it as it is.
-    template<Awaitable T>
-    auto await_transform(T &&awaitable) {
-        return std::forward<T>(awaitable);
+        // The awaiting coroutine is only read by TaskFinalSuspend after it synchronizes
+        // with the awaiter, which may be registering itself from another thread.
+        return TaskFinalSuspend{};
     }
 
     //! Called by \c TaskAwaiter when co_awaited.
@@ -212,28 +335,52 @@ public:
         return mAwaitingCoroutine != nullptr;
     }
 
+    //! Returns whether the coroutine has finished.
+    /*!
+     * Unlike \c coroutine_handle::done(), this is safe to call while the coroutine is
+     * finishing in another thread. When it returns true, the result of the coroutine
+     * is visible to the calling thread.
+     */
+    bool isFinished() const noexcept {
+        return mFinished.load(std::memory_order_acquire);
+    }
+
+    //! Releases one of the two references to the coroutine frame.
+    /*!
+     * The coroutine frame is referenced by the Task<T> returned to the caller and by the
+     * coroutine itself until it finishes. Whoever releases their reference last is responsible
+     * for destroying the coroutine frame.
+     *
+     * \return Returns true if the other reference has already been released and the caller
+     *         must destroy the coroutine.
+     */
+    bool release() noexcept {
+        return mReleased.exchange(true, std::memory_order_acq_rel);
+    }
+
 private:
     friend class TaskFinalSuspend;
 
     //! Handle of the coroutine that is currently co_awaiting this Awaitable
     QCORO_STD::coroutine_handle<> mAwaitingCoroutine;
     //! Indicates whether the awaiter should be resumed when it tries to co_await on us.
-    std::atomic<bool> mResumeAwaiter{false};
+    TaskFlag mResumeAwaiter{false};
+    //! Indicates that either the coroutine has finished or its Task has been destroyed.
+    TaskFlag mReleased{false};
+    //! Set when the coroutine reaches its final suspend point.
+    TaskFlag mFinished{false};
 };
 
-//! The promise_type for Task<T>
+//! Storage for the result of a coroutine returning \c T.
 /*!
- * See \ref TaskPromiseBase documentation for explanation about promise_type.
+ * Holds either the value co_returned by the coroutine or the exception thrown by the
+ * coroutine. The value is constructed in place from the co_returned value, so a value
+ * co_returned as an r-value is moved all the way to the co_awaiting coroutine and is
+ * never copied. This makes it possible to return move-only types from coroutines.
  */
 template<typename T>
-class TaskPromise final : public TaskPromiseBase {
+class TaskResult {
 public:
-    explicit TaskPromise() = default;
-    ~TaskPromise() = default;
-
-    //! Constructs a Task<T> for this promise.
-    Task<T> get_return_object() noexcept;
-
     //! Called by the compiler when user code throws an unhandled exception.
     /*!
      * When user code throws but doesn't catch, it is ultimately caught by the code generated by
@@ -251,12 +398,12 @@ public:
      *            promise, later can be retrieved by the calling coroutine.
      */
     void return_value(T &&value) noexcept {
-        mValue = std::forward<T>(value);
+        mValue.template emplace<T>(std::move(value));
     }
 
-    //! \copydoc template<typename T> TaskPromise::return_value(T &&value) noexcept
+    //! \copydoc template<typename T> TaskResult::return_value(T &&value) noexcept
     void return_value(const T &value) noexcept {
-        mValue = value;
+        mValue.template emplace<T>(value);
     }
 
     //! Retrieves the result of the coroutine.
@@ -272,13 +419,9 @@ public:
         return std::get<T>(mValue);
     }
 
-    //! \copydoc T &QCoro::TaskPromise<T>::result() &
+    //! \copydoc T &QCoro::TaskResult<T>::result() &
     T &&result() && {
-        if (std::holds_alternative<std::exception_ptr>(mValue)) {
-            std::rethrow_exception(std::get<std::exception_ptr>(mValue));
-        }
-
-        return std::move(std::get<T>(mValue));
+        return std::move(result());
     }
 
 private:
@@ -286,9 +429,94 @@ private:
     std::variant<std::monostate, T, std::exception_ptr> mValue;
 };
 
+//! Storage for results of small trivial types, like integers or enums.
+/*!
+ * The value is stored directly next to the exception, which is null unless the coroutine
+ * has thrown, so retrieving the result doesn't have to go through the variant.
+ */
+template<typename T>
+    requires(std::is_trivial_v<T> && sizeof(T) <= 2 * sizeof(void *))
+class TaskResult<T> {
+public:
+    //! \copydoc QCoro::TaskResult<T>::unhandled_exception()
+    void unhandled_exception() {
+        mException = std::current_exception();
+    }
+
+    //! \copydoc QCoro::TaskResult<T>::return_value(T &&value)
+    void return_value(T value) noexcept {
+        mValue = value;
+    }
+
+    //! \copydoc QCoro::TaskResult<T>::result() &
+    T &result() & {
+        if (mException) {
+            std::rethrow_exception(mException);
+        }
+        return mValue;
+    }
+
+    //! \copydoc QCoro::TaskResult<T>::result() &
+    T &&result() && {
+        return std::move(result());
+    }
+
+private:
+    T mValue{};
+    std::exception_ptr mException;
+};
+
+//! Storage for the result of a coroutine returning a reference.
+/*!
+ * Only the address of the referenced object is stored, the coroutine must make sure
+ * that the object outlives the Task.
+ */
+template<typename T>
+class TaskResult<T &> {
+public:
+    //! \copydoc QCoro::TaskResult<T>::unhandled_exception()
+    void unhandled_exception() {
+        mException = std::current_exception();
+    }
+
+    //! Called form co_return statement to store the reference returned by the coroutine.
+    void return_value(T &value) noexcept {
+        mValue = std::addressof(value);
+    }
+
+    //! Retrieves the reference returned by the coroutine, or rethrows the exception.
+    T &result() {
+        if (mException) {
+            std::rethrow_exception(mException);
+        }
+        return *mValue;
+    }
+
+private:
+    T *mValue = nullptr;
+    std::exception_ptr mException;
+};
+
+//! The promise_type for Task<T>
+/*!
+ * See \ref TaskPromiseBase documentation for explanation about promise_type. The result
+ * of the coroutine is stored by the TaskResult<T> base class.
+ *
+ * The class is not final, as it is the base class for the LazyTask<T> promise_type.
+ */
+template<typename T>
+class TaskPromise : public TaskPromiseBase, public TaskResult<T> {
+public:
+    explicit TaskPromise() = default;
+    ~TaskPromise() = default;
+
+    //! Constructs a Task<T> for this promise.
+    Task<T> get_return_object() noexcept;
+};
+
 //! Specialization of TaskPromise for coroutines returning \c void.
 template<>
-class TaskPromise<void> final : public TaskPromiseBase {
+class TaskPromise<void> : public TaskPromiseBase {
 public:
     // Constructor.
     explicit TaskPromise() = default;
@@ -328,9 +556,13 @@ private:
 template<typename _Promise>
 class TaskAwaiterBase {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Task;
+    }
+
     //! Returns whether to co_await
     bool await_ready() const noexcept {
-        return !mAwaitedCoroutine || mAwaitedCoroutine.done();
+        return !mAwaitedCoroutine || mAwaitedCoroutine.promise().isFinished();
     }
 
     //! Called by co_await in a coroutine that co_awaits our awaited coroutine managed by the current task.
@@ -361,12 +593,16 @@ public:
      *
      * \param[in] awaitingCoroutine handle of the coroutine that is currently co_awaiting the
      * coroutine represented by this Tak.
-     * \return returns whether the awaiting coroutine should be suspended, or whether the
-     * co_awaited coroutine has finished synchronously and the co_awaiting coroutine doesn't
-     * have to suspend.
+     * \return returns handle of the coroutine to resume next: a no-op coroutine if the awaiting
+     * coroutine should remain suspended, or the awaiting coroutine itself if the co_awaited
+     * coroutine has finished in the meantime and the co_awaiting coroutine doesn't have to suspend.
      */
-    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
-        return mAwaitedCoroutine.promise().setAwaitingCoroutine(awaitingCoroutine);
+    QCORO_STD::coroutine_handle<>
+    await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) noexcept {
+        if (mAwaitedCoroutine.promise().setAwaitingCoroutine(awaitingCoroutine)) {
+            return QCORO_STD::noop_coroutine();
+        }
+        return awaitingCoroutine;
     }
 
 protected:
@@ -431,17 +667,22 @@ public:
 
     //! The task can be move-assigned.
     Task &operator=(Task &&other) noexcept {
-        if (mCoroutine) {
-            mCoroutine.destroy();
+        if (this != &other) {
+            releaseCoroutine();
+            mCoroutine = other.mCoroutine;
+            other.mCoroutine = nullptr;
         }
-
-        mCoroutine = other.mCoroutine;
-        other.mCoroutine = nullptr;
         return *this;
     }
 
     //! Destructor.
-    ~Task() = default;
+    /*!
+     * Destroys the coroutine if it has already finished. Otherwise the coroutine keeps
+     * running and destroys itself once it finishes.
+     */
+    ~Task() {
+        releaseCoroutine();
+    }
 
     //! Returns whether the task has finished.
     /*!
@@ -449,7 +690,7 @@ public:
      * to suspend the coroutine again.
      */
     bool isReady() const {
-        return !mCoroutine || mCoroutine.done();
+        return !mCoroutine || mCoroutine.promise().isFinished();
     }
 
     //! Provides an Awaiter for the coroutine machinery.
@@ -460,7 +701,7 @@ public:
      * resume the coroutine.
      */
     auto operator co_await() const &noexcept {
-        //! Specialization of the TaskAwaiterBase that returns the promise result by value
+        //! Specialization of the TaskAwaiterBase that returns a reference to the promise result
         class TaskAwaiter : public detail::TaskAwaiterBase<promise_type> {
         public:
             TaskAwaiter(QCORO_STD::coroutine_handle<promise_type> awaitedCoroutine)
@@ -468,9 +709,10 @@ public:
 
             //! Called when the co_awaited coroutine is resumed.
             /*
-             * \return the result from the coroutine's promise, factically the
-             * value co_returned by the coroutine. */
-            auto await_resume() {
+             * \return a reference to the result stored in the coroutine's promise, factically
+             * the value co_returned by the coroutine. The result is owned by the co_awaited
+             * Task, so it's not copied unless the caller copies it. */
+            decltype(auto) await_resume() {
                 Q_ASSERT(this->mAwaitedCoroutine != nullptr);
                 return this->mAwaitedCoroutine.promise().result();
             }
@@ -488,17 +730,24 @@ public:
 
             //! Called when the co_awaited coroutine is resumed.
             /*
-             * \return an r-value reference to the coroutine's promise result, factically
-             *  a value co_returned by the coroutine. */
-            auto await_resume() {
+             * \return the coroutine's promise result moved out of the promise, factically
+             *  a value co_returned by the coroutine. References are returned as they are. */
+            T await_resume() {
                 Q_ASSERT(this->mAwaitedCoroutine != nullptr);
-                return std::move(this->mAwaitedCoroutine.promise().result());
+                return std::move(this->mAwaitedCoroutine.promise()).result();
             }
         };
         return TaskAwaiter{mCoroutine};
     }
 
 private:
+    void releaseCoroutine() noexcept {
+        if (mCoroutine && mCoroutine.promise().release()) {
+            detail::traceEvent(detail::TraceEventType::Destroyed, mCoroutine.address());
+            mCoroutine.destroy();
+        }
+    }
+
     //! The coroutine represented by this task
     /*!
      * In other words, this is a handle to the coroutine that has constructed and
@@ -511,11 +760,15 @@ namespace detail {
 
 template<typename T>
 inline Task<T> TaskPromise<T>::get_return_object() noexcept {
-    return Task<T>{QCORO_STD::coroutine_handle<TaskPromise>::from_promise(*this)};
+    const auto coroutine = QCORO_STD::coroutine_handle<TaskPromise>::from_promise(*this);
+    traceEvent(TraceEventType::Created, coroutine.address(), typeName<Task<T>>());
+    return Task<T>{coroutine};
 }
 
 Task<void> inline TaskPromise<void>::get_return_object() noexcept {
-    return Task<void>{QCORO_STD::coroutine_handle<TaskPromise>::from_promise(*this)};
+    const auto coroutine = QCORO_STD::coroutine_handle<TaskPromise>::from_promise(*this);
+    traceEvent(TraceEventType::Created, coroutine.address(), typeName<Task<void>>());
+    return Task<void>{coroutine};
 }
 
 } // namespace detail
@@ -0,0 +1,262 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#ifdef QCORO_SINGLE_THREADED
+#error "Tasks cannot be resumed in other threads with QCORO_SINGLE_THREADED"
+#endif
+
+#include "coroutine.h"
+#include "macros.h"
+
+#include <QAbstractEventDispatcher>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! Awaiter that resumes the awaiting coroutine in the event loop of another thread.
+/*!
+ * The coroutine is resumed by a single queued call posted to the event dispatcher of the
+ * target thread, so no QObject has to be created in the target thread.
+ */
+class ThreadAwaiter {
+public:
+    explicit ThreadAwaiter(QThread *thread) : mThread(thread) {}
+    Q_DISABLE_COPY(ThreadAwaiter)
+    QCORO_DEFAULT_MOVE(ThreadAwaiter)
+
+    //! Doesn't suspend the coroutine if it's already executing in the target thread.
+    bool await_ready() const noexcept {
+        return mThread == nullptr || mThread == QThread::currentThread();
+    }
+
+    //! Posts resumption of the awaiting coroutine into the target thread's event loop.
+    /*!
+     * The target thread must be running, otherwise it has no event dispatcher and the
+     * coroutine is not suspended.
+     */
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        auto *dispatcher = QAbstractEventDispatcher::instance(mThread);
+        Q_ASSERT(dispatcher != nullptr);
+        if (!dispatcher) {
+            return false;
+        }
+
+        // The coroutine may be resumed in the target thread before this function returns,
+        // so `this` must not be touched anymore after the call has been posted.
+        QMetaObject::invokeMethod(
+            dispatcher, [awaitingCoroutine]() mutable { awaitingCoroutine.resume(); },
+            Qt::QueuedConnection);
+        return true;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    QThread *mThread = nullptr;
+};
+
+//! Awaiter that resumes the awaiting coroutine in a worker thread of a QThreadPool.
+/*!
+ * The awaiter itself is the QRunnable scheduled in the pool, so suspending doesn't
+ * allocate anything.
+ */
+class ThreadPoolAwaiter {
+public:
+    explicit ThreadPoolAwaiter(QThreadPool *pool) : mPool(pool) {}
+    Q_DISABLE_COPY(ThreadPoolAwaiter)
+
+    //! The awaiter can be moved before it's co_awaited, the runnable is only used once suspended.
+    ThreadPoolAwaiter(ThreadPoolAwaiter &&other) noexcept : mPool(other.mPool) {}
+    ThreadPoolAwaiter &operator=(ThreadPoolAwaiter &&) = delete;
+
+    bool await_ready() const noexcept {
+        return mPool == nullptr;
+    }
+
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mRunnable.mCoroutine = awaitingCoroutine;
+        mPool->start(&mRunnable);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    class Runnable final : public QRunnable {
+    public:
+        Runnable() {
+            // Owned by the awaiter, which lives in the coroutine frame.
+            setAutoDelete(false);
+        }
+
+        void run() override {
+            mCoroutine.resume();
+        }
+
+        QCORO_STD::coroutine_handle<> mCoroutine = {};
+    };
+
+    QThreadPool *mPool = nullptr;
+    Runnable mRunnable;
+};
+
+//! Awaiter that calls a function in a worker thread of a QThreadPool.
+/*!
+ * The awaiter is the QRunnable scheduled in the pool and it stores the function's result,
+ * so neither a QFuture nor a QObject is needed. Once the function returns, the awaiting
+ * coroutine is resumed by a single queued call in the thread in which it has co_awaited
+ * the awaiter.
+ */
+template<typename Fn>
+class ThreadPoolCallAwaiter {
+    using Result = std::decay_t<std::invoke_result_t<Fn &>>;
+
+public:
+    ThreadPoolCallAwaiter(Fn &&fn, QThreadPool *pool) : mPool(pool), mRunnable(std::move(fn)) {}
+    Q_DISABLE_COPY(ThreadPoolCallAwaiter)
+
+    //! The awaiter can be moved before it's co_awaited, the runnable is only used once suspended.
+    ThreadPoolCallAwaiter(ThreadPoolCallAwaiter &&other) noexcept(
+        std::is_nothrow_move_constructible_v<Fn>)
+        : mPool(other.mPool), mRunnable(std::move(other.mRunnable.mFn)) {}
+    ThreadPoolCallAwaiter &operator=(ThreadPoolCallAwaiter &&) = delete;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mRunnable.mCoroutine = awaitingCoroutine;
+        mRunnable.mThread = QThread::currentThread();
+        mPool->start(&mRunnable);
+    }
+
+    Result await_resume() {
+        if (mRunnable.mException) {
+            std::rethrow_exception(mRunnable.mException);
+        }
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*mRunnable.mResult);
+        }
+    }
+
+private:
+    struct Empty {};
+
+    class Runnable final : public QRunnable {
+    public:
+        explicit Runnable(Fn &&fn) : mFn(std::move(fn)) {
+            // Owned by the awaiter, which lives in the coroutine frame.
+            setAutoDelete(false);
+        }
+
+        void run() override {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    std::invoke(mFn);
+                } else {
+                    mResult.emplace(std::invoke(mFn));
+                }
+            } catch (...) {
+                mException = std::current_exception();
+            }
+
+            // The coroutine may destroy the awaiter as soon as it's resumed, so `this` must
+            // not be touched anymore once the resumption has been posted.
+            auto *dispatcher = QAbstractEventDispatcher::instance(mThread);
+            if (!dispatcher || mThread == QThread::currentThread()) {
+                mCoroutine.resume();
+                return;
+            }
+            QMetaObject::invokeMethod(
+                dispatcher, [coroutine = mCoroutine]() mutable { coroutine.resume(); },
+                Qt::QueuedConnection);
+        }
+
+        Fn mFn;
+        std::conditional_t<std::is_void_v<Result>, Empty, std::optional<Result>> mResult;
+        std::exception_ptr mException;
+        QCORO_STD::coroutine_handle<> mCoroutine = {};
+        QThread *mThread = nullptr;
+    };
+
+    QThreadPool *mPool = nullptr;
+    Runnable mRunnable;
+};
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Resumes the awaiting coroutine in the given thread.
+/*!
+ * The rest of the coroutine (until it hops to another thread again) is executed from the
+ * event loop of the \c thread, which must be running. To get back, co_await \c resumeOn()
+ * with the original thread, e.g. \c qApp->thread() for the main thread.
+ *
+ * ```
+ * QCoro::Task<Document> loadDocument(QNetworkReply *reply) {
+ *     co_await reply;
+ *     co_await QCoro::resumeOn(workerThread);
+ *     auto document = parseDocument(reply->readAll()); // parsing runs in the worker thread
+ *     co_await QCoro::resumeOn(qApp->thread());
+ *     co_return document;
+ * }
+ * ```
+ *
+ * If the coroutine is already running in the \c thread, it's not suspended at all.
+ */
+inline auto resumeOn(QThread *thread) {
+    return detail::ThreadAwaiter{thread};
+}
+
+//! Resumes the awaiting coroutine in a worker thread of the given thread pool.
+/*!
+ * Note that the pool's worker threads don't run an event loop, so the coroutine should
+ * hop back to a thread with an event loop using \c resumeOn(QThread*) before it co_awaits
+ * any Qt signal-based operation.
+ */
+inline auto resumeOn(QThreadPool *pool) {
+    return detail::ThreadPoolAwaiter{pool};
+}
+
+//! Calls \c fn in a worker thread of the \c pool and returns its result.
+/*!
+ * The awaiting coroutine is suspended while \c fn runs in the \c pool and it's resumed in
+ * the thread in which it has co_awaited the call, with the value returned by \c fn. If \c fn
+ * throws an exception, the exception is rethrown from the co_await.
+ *
+ * ```
+ * QCoro::Task<> Uploader::upload(const QString &path) {
+ *     const QByteArray hash = co_await QCoro::runInThreadPool([path]() { return hashFile(path); });
+ *     ... // back in the Uploader's thread
+ * }
+ * ```
+ *
+ * Unlike QtConcurrent::run(), no QFuture is created: the result is stored directly in the
+ * awaiter. If the awaiting thread doesn't run an event loop (e.g. it's a worker of a thread
+ * pool itself), the coroutine is resumed directly in the worker thread that has called \c fn.
+ */
+template<typename Fn>
+    requires std::is_invocable_v<std::decay_t<Fn> &>
+auto runInThreadPool(Fn &&fn, QThreadPool *pool = QThreadPool::globalInstance()) {
+    return detail::ThreadPoolCallAwaiter<std::decay_t<Fn>>{std::decay_t<Fn>(std::forward<Fn>(fn)),
+                                                           pool};
+}
+
+} // namespace QCoro
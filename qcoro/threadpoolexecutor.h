@@ -0,0 +1,271 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#ifdef QCORO_SINGLE_THREADED
+#error "Tasks cannot be run in a thread pool with QCORO_SINGLE_THREADED"
+#endif
+
+#include "impl/workstealingdeque.h"
+#include "lazytask.h"
+#include "macros.h"
+#include "task.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QCoro {
+
+//! A thread pool with work stealing for executing CPU-bound coroutines.
+/*!
+ * Each worker thread of the executor has its own lock-free deque of coroutines that are
+ * ready to run. Coroutines scheduled from a worker thread are pushed to the worker's own
+ * deque and are likely to be resumed on the same worker, which keeps their data warm in
+ * the CPU cache. Idle workers steal coroutines from the other workers' deques. Coroutines
+ * scheduled from threads outside of the executor are put into a shared queue, from which
+ * they are picked up by the first idle worker.
+ *
+ * The worker threads don't run a Qt event loop, so coroutines running in the executor
+ * should only co_await other coroutines or hop to a thread with an event loop (using
+ * \c QCoro::resumeOn()) before co_awaiting any Qt signal-based operation.
+ *
+ * ```
+ * QCoro::ThreadPoolExecutor executor;
+ *
+ * QCoro::Task<> importAll(const QList<QString> &files) {
+ *     std::vector<QCoro::Task<Record>> imports;
+ *     for (const auto &file : files) {
+ *         // importFile() returns LazyTask<Record>
+ *         imports.push_back(executor.run(importFile(file)));
+ *     }
+ *     const auto records = co_await QCoro::whenAll(std::move(imports));
+ *     co_await QCoro::resumeOn(qApp->thread());
+ *     ...
+ * }
+ * ```
+ */
+class ThreadPoolExecutor {
+public:
+    //! Creates the executor and starts \c threadCount worker threads.
+    /*!
+     * If \c threadCount is 0, \c QThread::idealThreadCount() threads are started.
+     */
+    explicit ThreadPoolExecutor(std::size_t threadCount = 0) {
+        if (threadCount == 0) {
+            threadCount = static_cast<std::size_t>(std::max(QThread::idealThreadCount(), 1));
+        }
+
+        mWorkers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            mWorkers.push_back(std::make_unique<Worker>(this));
+        }
+        for (auto &worker : mWorkers) {
+            worker->thread = std::thread([this, worker = worker.get()]() { workerLoop(*worker); });
+        }
+    }
+
+    Q_DISABLE_COPY(ThreadPoolExecutor)
+
+    //! Waits for all scheduled coroutines to finish and stops the worker threads.
+    /*!
+     * Coroutines that are scheduled to the executor while it's being destroyed are
+     * still executed, so the destructor only returns once no coroutine schedules
+     * itself into the executor anymore.
+     */
+    ~ThreadPoolExecutor() {
+        {
+            std::lock_guard lock(mMutex);
+            mStopping = true;
+        }
+        mWakeup.notify_all();
+        for (auto &worker : mWorkers) {
+            worker->thread.join();
+        }
+    }
+
+    //! Returns the number of worker threads.
+    std::size_t threadCount() const {
+        return mWorkers.size();
+    }
+
+    //! Returns an Awaitable that resumes the awaiting coroutine in one of the worker threads.
+    /*!
+     * When co_awaited from a worker thread of this executor, the coroutine is pushed to
+     * the worker's own queue, allowing other coroutines to run before it is resumed.
+     */
+    auto schedule() noexcept {
+        class ScheduleAwaiter {
+        public:
+            explicit ScheduleAwaiter(ThreadPoolExecutor *executor) : mExecutor(executor) {}
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+                // The coroutine may be resumed by a worker before this function returns.
+                mExecutor->post(awaitingCoroutine);
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            ThreadPoolExecutor *mExecutor;
+        };
+        return ScheduleAwaiter{this};
+    }
+
+    //! Runs the lazy \c task in the executor.
+    /*!
+     * The \c task is started in one of the worker threads. The returned Task finishes,
+     * and resumes its awaiter, in the worker thread in which the \c task has finished.
+     */
+    template<typename T>
+    Task<T> run(LazyTask<T> task) {
+        co_await schedule();
+        co_return co_await std::move(task);
+    }
+
+    //! Schedules the coroutine to be resumed by one of the worker threads.
+    void post(QCORO_STD::coroutine_handle<> coroutine) {
+        if (auto *worker = sCurrentWorker; worker != nullptr && worker->executor == this) {
+            worker->deque.push(coroutine);
+            // Pairs with the increment of mSleeping by a worker going to sleep.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (mSleeping.load(std::memory_order_relaxed) > 0) {
+                wakeOne();
+            }
+            return;
+        }
+
+        {
+            std::lock_guard lock(mMutex);
+            mInjected.push_back(coroutine);
+        }
+        mWakeup.notify_one();
+    }
+
+private:
+    struct Worker {
+        explicit Worker(ThreadPoolExecutor *executor) : executor(executor) {}
+
+        ThreadPoolExecutor *executor;
+        detail::WorkStealingDeque deque;
+        std::thread thread;
+    };
+
+    void wakeOne() {
+        // Taking the lock guarantees that the sleeping worker is either still going to
+        // look for work, or is already waiting and will receive the notification.
+        { std::lock_guard lock(mMutex); }
+        mWakeup.notify_one();
+    }
+
+    //! Tries to steal work from any of the other workers.
+    QCORO_STD::coroutine_handle<> steal(const Worker &thief) {
+        const auto count = mWorkers.size();
+        const auto start = static_cast<std::size_t>(&thief - mWorkers.front().get());
+        for (std::size_t i = 1; i <= count; ++i) {
+            auto &victim = *mWorkers[(start + i) % count];
+            if (&victim == &thief) {
+                continue;
+            }
+            if (auto coroutine = victim.deque.steal(); coroutine) {
+                return coroutine;
+            }
+        }
+        return {};
+    }
+
+    //! Takes a coroutine from the shared queue, mMutex must be locked.
+    QCORO_STD::coroutine_handle<> takeInjectedLocked() {
+        if (mInjected.empty()) {
+            return {};
+        }
+        auto coroutine = mInjected.front();
+        mInjected.pop_front();
+        return coroutine;
+    }
+
+    QCORO_STD::coroutine_handle<> findWork(Worker &worker) {
+        if (auto coroutine = worker.deque.pop(); coroutine) {
+            return coroutine;
+        }
+        if (auto coroutine = steal(worker); coroutine) {
+            return coroutine;
+        }
+        std::lock_guard lock(mMutex);
+        return takeInjectedLocked();
+    }
+
+    void workerLoop(Worker &worker) {
+        sCurrentWorker = &worker;
+
+        while (true) {
+            if (auto coroutine = findWork(worker); coroutine) {
+                coroutine.resume();
+                continue;
+            }
+
+            QCORO_STD::coroutine_handle<> coroutine;
+            {
+                std::unique_lock lock(mMutex);
+                mSleeping.fetch_add(1, std::memory_order_seq_cst);
+                while (true) {
+                    if ((coroutine = takeInjectedLocked())) {
+                        break;
+                    }
+                    if ((coroutine = steal(worker))) {
+                        break;
+                    }
+                    if (mStopping) {
+                        break;
+                    }
+                    mWakeup.wait(lock);
+                }
+                mSleeping.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            if (!coroutine) {
+                break;
+            }
+            coroutine.resume();
+        }
+
+        sCurrentWorker = nullptr;
+    }
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mWakeup;
+    //! Coroutines scheduled from outside of the executor, protected by mMutex.
+    std::deque<QCORO_STD::coroutine_handle<>> mInjected;
+    //! Set when the executor is being destroyed, protected by mMutex.
+    bool mStopping = false;
+    //! Number of workers that are looking for work before going to sleep or are sleeping.
+    std::atomic<std::size_t> mSleeping{0};
+
+    //! The worker running in the current thread, if any.
+    static inline thread_local Worker *sCurrentWorker = nullptr;
+};
+
+//! Resumes the awaiting coroutine in one of the worker threads of the \c executor.
+/*!
+ * Equivalent to \c co_await executor->schedule().
+ */
+inline auto resumeOn(ThreadPoolExecutor *executor) {
+    return executor->schedule();
+}
+
+} // namespace QCoro
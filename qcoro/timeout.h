@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "coroutine.h"
+#include "impl/cancellable.h"
+#include "impl/resume.h"
+#include "impl/timerwheel.h"
+#include "impl/when.h"
+#include "macros.h"
+#include "task.h"
+#include "timer.h"
+#include "whenany.h"
+
+#include <chrono>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! Wraps a cancellable awaiter and cancels it when the timeout expires.
+/*!
+ * The timeout is scheduled in the per-thread TimerWheel. If it expires before the operation
+ * finishes, the operation is cancelled right away, so it doesn't keep any resources alive,
+ * and the awaiting coroutine is resumed with an empty result.
+ */
+template<CancellableAwaiter Awaiter>
+class TimeoutAwaiter final : private TimeoutEntry {
+    using Result = when_result_t<Awaiter>;
+
+public:
+    TimeoutAwaiter(Awaiter &&awaiter, std::chrono::milliseconds timeout)
+        : mAwaiter(std::move(awaiter)), mTimeout(timeout) {}
+    Q_DISABLE_COPY(TimeoutAwaiter)
+    QCORO_DEFAULT_MOVE(TimeoutAwaiter)
+
+    ~TimeoutAwaiter() override = default;
+
+    bool await_ready() {
+        return mAwaiter.await_ready();
+    }
+
+    template<typename Promise>
+    auto await_suspend(QCORO_STD::coroutine_handle<Promise> awaitingCoroutine) {
+        mAwaitingCoroutine = awaitingCoroutine;
+        // Scheduled first, the operation may resume the coroutine before await_suspend() returns
+        scheduleTimeout(mTimeout);
+
+        using SuspendResult = decltype(mAwaiter.await_suspend(awaitingCoroutine));
+        if constexpr (std::is_void_v<SuspendResult>) {
+            mAwaiter.await_suspend(awaitingCoroutine);
+        } else if constexpr (std::is_same_v<SuspendResult, bool>) {
+            const bool suspended = mAwaiter.await_suspend(awaitingCoroutine);
+            if (!suspended) {
+                cancelTimeout();
+            }
+            return suspended;
+        } else {
+            QCORO_STD::coroutine_handle<> next = mAwaiter.await_suspend(awaitingCoroutine);
+            if (next == awaitingCoroutine) {
+                cancelTimeout();
+            }
+            return next;
+        }
+    }
+
+    std::optional<Result> await_resume() {
+        if (mTimedOut) {
+            return std::nullopt;
+        }
+        cancelTimeout();
+        if constexpr (std::is_void_v<awaitable_result_t<Awaiter>>) {
+            mAwaiter.await_resume();
+            return Result{};
+        } else {
+            return mAwaiter.await_resume();
+        }
+    }
+
+private:
+    void timedOut() override {
+        // If cancelling fails, the operation has just finished and resumes the coroutine itself.
+        if (mAwaiter.cancel()) {
+            mTimedOut = true;
+            resumeQueued(mReadyNode, mAwaitingCoroutine);
+        }
+    }
+
+    Awaiter mAwaiter;
+    std::chrono::milliseconds mTimeout;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
+    bool mTimedOut = false;
+};
+
+//! Races the \c awaitable against a sleep, for awaitables that cannot be cancelled.
+template<typename T>
+Task<std::optional<when_result_t<T>>> withTimeoutImpl(T awaitable,
+                                                      std::chrono::milliseconds timeout) {
+    auto result = co_await whenAny(std::forward<T>(awaitable), sleepFor(timeout));
+    if (result.index() == 1) {
+        co_return std::nullopt;
+    }
+    co_return std::move(std::get<0>(result));
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Waits for the \c awaitable to finish, but at most for the given \c timeout.
+/*!
+ * ```cpp
+ * const std::optional<QByteArray> data = co_await QCoro::withTimeout(qCoro(socket).readAll(), 5s);
+ * if (!data) {
+ *     // timed out
+ * }
+ * ```
+ *
+ * The \c awaitable can be anything that can be co_awaited from a QCoro coroutine.
+ *
+ * Operations of the QCoro wrappers for Qt types (IO operations, waitFor* operations, awaiting
+ * a signal, a QTimer, a pending DBus call or QCoro::sleepFor()) are cancelled as soon as the
+ * timeout expires: they disconnect from all signals and don't resume the coroutine anymore.
+ * Other awaitables (e.g. a Task<T>) cannot be cancelled, so they keep running after the timeout
+ * and their result is discarded. In that case l-value arguments must stay alive until they
+ * finish.
+ *
+ * The timeout is resolved with the 10 milliseconds granularity of QCoro::sleepFor().
+ *
+ * \return The result of the \c awaitable, or an empty optional if the timeout has expired first.
+ * Awaitables with \c void result are represented by \c std::monostate. Exceptions thrown by the
+ * \c awaitable are rethrown.
+ */
+template<detail::TaskAwaitable T, typename Rep, typename Period>
+auto withTimeout(T &&awaitable, std::chrono::duration<Rep, Period> timeout) {
+    const auto timeoutMsecs = std::chrono::ceil<std::chrono::milliseconds>(timeout);
+    if constexpr (!std::is_lvalue_reference_v<T> &&
+                  detail::CancellableAwaiter<std::remove_cvref_t<T>>) {
+        return detail::TimeoutAwaiter<std::remove_cvref_t<T>>{std::move(awaitable),
+                                                              timeoutMsecs};
+    } else if constexpr (detail::HasCancellableAwaiter<T>) {
+        using Awaiter = detail::awaiter_type_t<std::remove_cvref_t<T>>;
+        return detail::TimeoutAwaiter<Awaiter>{Awaiter{awaitable}, timeoutMsecs};
+    } else {
+        return detail::withTimeoutImpl<detail::when_argument_t<T>>(std::forward<T>(awaitable),
+                                                                  timeoutMsecs);
+    }
+}
+
+//! Waits for the \c awaitable to finish, but at most until the \c deadline is reached.
+/*!
+ * Behaves like withTimeout() with the time remaining until the \c deadline. Passing the
+ * same deadline to the operations inside of child coroutines bounds the whole chain of
+ * operations by a single deadline:
+ *
+ * ```cpp
+ * QCoro::Task<Reply> request(QTcpSocket &socket, std::chrono::steady_clock::time_point deadline) {
+ *     co_await QCoro::withDeadline(qCoro(socket).write(query), deadline);
+ *     const auto data = co_await QCoro::withDeadline(qCoro(socket).readAll(), deadline);
+ *     ...
+ * }
+ *
+ * const auto deadline = std::chrono::steady_clock::now() + 10s;
+ * const auto reply = co_await QCoro::withDeadline(request(socket, deadline), deadline);
+ * ```
+ */
+template<detail::TaskAwaitable T, typename Clock, typename Duration>
+auto withDeadline(T &&awaitable, std::chrono::time_point<Clock, Duration> deadline) {
+    return withTimeout(std::forward<T>(awaitable), deadline - Clock::now());
+}
+
+} // namespace QCoro
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include "impl/resume.h"
+#include "impl/timerwheel.h"
+#include "macros.h"
 #include "task.h"
 
 #include <QMetaObject>
@@ -12,35 +15,116 @@
 
 #include <QDebug>
 
+#include <chrono>
+
 /*! \cond internal */
 
 namespace QCoro::detail {
 
 class TimerAwaiter {
 public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Timer;
+    }
+
     explicit TimerAwaiter(QTimer &timer) : mTimer(&timer) {}
     explicit TimerAwaiter(QTimer *timer) : mTimer(timer) {}
+    Q_DISABLE_COPY(TimerAwaiter)
+    QCORO_DEFAULT_MOVE(TimerAwaiter)
+
+    ~TimerAwaiter() {
+        QObject::disconnect(mConn);
+    }
 
     bool await_ready() const noexcept {
         return !mTimer || !mTimer->isActive();
     }
 
-    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
-        if (mTimer && mTimer->isActive()) {
-            mConn = QObject::connect(mTimer, &QTimer::timeout, [this, awaitingCoroutine]() mutable {
-                QObject::disconnect(mConn);
-                awaitingCoroutine.resume();
-            });
-        } else {
-            awaitingCoroutine.resume();
+    bool await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        if (!mTimer || !mTimer->isActive()) {
+            return false;
         }
+
+        mConn = QObject::connect(mTimer, &QTimer::timeout, [this, awaitingCoroutine]() mutable {
+            QObject::disconnect(mConn);
+            mResumed = true;
+            resumeCoroutine(mReadyNode, awaitingCoroutine);
+        });
+        return true;
     }
 
     void await_resume() const {}
 
+    //! Stops waiting for the timer.
+    /*!
+     * \return Whether the awaiter has been cancelled before the coroutine was scheduled
+     * to be resumed. If so, the coroutine will not be resumed by the awaiter.
+     */
+    bool cancel() noexcept {
+        if (mResumed) {
+            return false;
+        }
+        QObject::disconnect(mConn);
+        return true;
+    }
+
 private:
     QMetaObject::Connection mConn;
     QPointer<QTimer> mTimer;
+    ReadyNode mReadyNode;
+    bool mResumed = false;
+};
+
+//! Awaitable that suspends the coroutine for the given time.
+/*!
+ * The sleep is scheduled in the per-thread TimerWheel, so it doesn't need a QTimer
+ * nor any signal connections.
+ */
+class SleepAwaiter final : private TimeoutEntry {
+public:
+    static constexpr AwaiterKind awaiterKind() noexcept {
+        return AwaiterKind::Timer;
+    }
+
+    explicit SleepAwaiter(std::chrono::milliseconds timeout) : mTimeout(timeout) {}
+    Q_DISABLE_COPY(SleepAwaiter)
+    QCORO_DEFAULT_MOVE(SleepAwaiter)
+
+    ~SleepAwaiter() override = default;
+
+    bool await_ready() const noexcept {
+        return mTimeout <= std::chrono::milliseconds::zero();
+    }
+
+    void await_suspend(QCORO_STD::coroutine_handle<> awaitingCoroutine) {
+        mAwaitingCoroutine = awaitingCoroutine;
+        scheduleTimeout(mTimeout);
+    }
+
+    void await_resume() const noexcept {}
+
+    //! Stops the sleep.
+    /*!
+     * \return Whether the sleep has been cancelled before the coroutine was scheduled
+     * to be resumed. If so, the coroutine will not be resumed by the awaiter.
+     */
+    bool cancel() noexcept {
+        if (!isTimeoutScheduled()) {
+            return false;
+        }
+        cancelTimeout();
+        return true;
+    }
+
+private:
+    void timedOut() override {
+        // Resuming directly could destroy other sleeps that expired in the same tick
+        resumeQueued(mReadyNode, mAwaitingCoroutine);
+    }
+
+    std::chrono::milliseconds mTimeout;
+    QCORO_STD::coroutine_handle<> mAwaitingCoroutine = {};
+    ReadyNode mReadyNode;
 };
 
 template<>
@@ -55,3 +139,39 @@ struct awaiter_type<QTimer> {
 } // namespace QCoro::detail
 
 /*! \endcond */
+
+namespace QCoro {
+
+//! Suspends the coroutine for the given \c duration.
+/*!
+ * ```cpp
+ * co_await QCoro::sleepFor(100ms);
+ * ```
+ *
+ * Unlike `co_await`ing a QTimer, no QTimer needs to be created. The sleep is resolved with
+ * a granularity of 10 milliseconds, so the coroutine may be resumed up to 10 milliseconds
+ * after the \c duration has elapsed. If the \c duration is not positive the coroutine is not
+ * suspended at all.
+ */
+template<typename Rep, typename Period>
+Awaitable auto sleepFor(std::chrono::duration<Rep, Period> duration) {
+    return detail::SleepAwaiter{std::chrono::ceil<std::chrono::milliseconds>(duration)};
+}
+
+//! Suspends the coroutine until the \c deadline is reached.
+/*!
+ * ```cpp
+ * const auto deadline = std::chrono::steady_clock::now() + 1s;
+ * ...
+ * co_await QCoro::sleepUntil(deadline);
+ * ```
+ *
+ * Behaves like sleepFor() with the time remaining until the \c deadline. If the \c deadline
+ * has already passed the coroutine is not suspended at all.
+ */
+template<typename Clock, typename Duration>
+Awaitable auto sleepUntil(std::chrono::time_point<Clock, Duration> deadline) {
+    return sleepFor(deadline - Clock::now());
+}
+
+} // namespace QCoro
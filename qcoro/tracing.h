@@ -0,0 +1,292 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/tracing.h"
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include <cstddef>
+
+#ifdef QCORO_ENABLE_TRACING
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace QCoro {
+
+//! Enables or disables recording of trace events at runtime.
+/*!
+ * Only has an effect when QCoro is built with \c QCORO_ENABLE_TRACING defined, otherwise the
+ * tracing hooks are not compiled in at all. Recording is enabled by default.
+ */
+inline void setTracingEnabled([[maybe_unused]] bool enabled) noexcept {
+#ifdef QCORO_ENABLE_TRACING
+    detail::TraceRegistry::instance().setEnabled(enabled);
+#endif
+}
+
+//! Returns whether trace events are being recorded.
+inline bool isTracingEnabled() noexcept {
+#ifdef QCORO_ENABLE_TRACING
+    return detail::TraceRegistry::instance().isEnabled();
+#else
+    return false;
+#endif
+}
+
+//! Sets the number of events kept for each thread, once exceeded the oldest events are dropped.
+/*!
+ * Only affects threads that haven't recorded any event yet. The default is 65536 events, the
+ * capacity is rounded up to a power of two.
+ */
+inline void setTraceBufferCapacity([[maybe_unused]] std::size_t events) {
+#ifdef QCORO_ENABLE_TRACING
+    detail::TraceRegistry::instance().setCapacity(events);
+#endif
+}
+
+//! Discards all the events recorded so far.
+inline void clearTrace() {
+#ifdef QCORO_ENABLE_TRACING
+    detail::TraceRegistry::instance().clear();
+#endif
+}
+
+//! Names the current coroutine in the trace.
+/*!
+ * \code
+ * QCoro::Task<> Client::login() {
+ *     co_await QCoro::traceName("Client::login");
+ *     ...
+ * }
+ * \endcode
+ *
+ * The \c name must have static storage duration, typically it's a string literal. co_awaiting
+ * the result never suspends the coroutine.
+ */
+constexpr detail::TraceNameAwaiter traceName(const char *name) noexcept {
+    return detail::TraceNameAwaiter{name};
+}
+
+/*! \cond internal */
+namespace detail {
+
+#ifdef QCORO_ENABLE_TRACING
+
+inline void appendJsonString(QByteArray &out, const char *str, std::size_t length) {
+    static constexpr char hex[] = "0123456789abcdef";
+    out.append('"');
+    for (std::size_t i = 0; i < length; ++i) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            out.append('\\');
+            out.append(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out.append("\\u00");
+            out.append(hex[(c >> 4) & 0xf]);
+            out.append(hex[c & 0xf]);
+        } else {
+            out.append(c);
+        }
+    }
+    out.append('"');
+}
+
+inline void appendJsonString(QByteArray &out, std::string_view str) {
+    appendJsonString(out, str.data(), str.size());
+}
+
+//! Converts the recorded events into the Chrome trace event format.
+/*!
+ * Each coroutine is represented by an async slice from its creation until it finishes, with
+ * nested slices for each co_await that has suspended it, named after the type of the awaitable.
+ * Coroutine frames are reused, so events for the same address are split into instances at
+ * creation and destruction of the frame.
+ */
+class ChromeTraceWriter {
+public:
+    QByteArray write() {
+        collectEvents();
+        resolveInstances();
+
+        mOut.append(R"({"displayTimeUnit":"ns","traceEvents":[)");
+        for (const auto &buffer : mBuffers) {
+            beginEvent("thread_name", "M", buffer->threadId());
+            mOut.append(R"(,"args":{"name":"QCoro thread )");
+            mOut.append(QByteArray::number(buffer->threadId()));
+            mOut.append(R"("}})");
+        }
+        for (std::size_t i = 0; i < mEvents.size(); ++i) {
+            writeEvent(mEvents[i], mInstances[mEventInstances[i]]);
+        }
+        mOut.append("]}\n");
+        return std::move(mOut);
+    }
+
+private:
+    struct Event {
+        TraceEvent event;
+        std::uint32_t threadId;
+    };
+
+    struct Instance {
+        QByteArray id;
+        std::string_view name;
+        bool created = false;
+    };
+
+    void collectEvents() {
+        mBuffers = TraceRegistry::instance().buffers();
+        for (const auto &buffer : mBuffers) {
+            for (const auto &event : buffer->snapshot()) {
+                mEvents.push_back({event, buffer->threadId()});
+            }
+        }
+        std::stable_sort(mEvents.begin(), mEvents.end(), [](const auto &l, const auto &r) {
+            return l.event.timestamp < r.event.timestamp;
+        });
+        if (!mEvents.empty()) {
+            mStart = mEvents.front().event.timestamp;
+        }
+    }
+
+    void resolveInstances() {
+        struct Frame {
+            std::size_t generation = 0;
+            std::size_t instance = 0;
+            bool alive = false;
+        };
+        std::unordered_map<const void *, Frame> frames;
+
+        for (const auto &[event, threadId] : mEvents) {
+            auto &frame = frames[event.coroutine];
+            if (!frame.alive || event.type == TraceEventType::Created) {
+                frame.instance = mInstances.size();
+                frame.alive = true;
+                const auto address =
+                    static_cast<quint64>(reinterpret_cast<quintptr>(event.coroutine));
+                const auto generation = static_cast<quint64>(++frame.generation);
+                mInstances.push_back({"0x" + QByteArray::number(address, 16) + ':' +
+                                          QByteArray::number(generation),
+                                      "coroutine"});
+            }
+
+            auto &instance = mInstances[frame.instance];
+            if (event.type == TraceEventType::Created) {
+                instance.created = true;
+                instance.name = eventName(event);
+            } else if (event.type == TraceEventType::Named) {
+                instance.name = eventName(event);
+            } else if (event.type == TraceEventType::Destroyed) {
+                frame.alive = false;
+            }
+            mEventInstances.push_back(frame.instance);
+        }
+    }
+
+    void writeEvent(const Event &event, const Instance &instance) {
+        switch (event.event.type) {
+        case TraceEventType::Created:
+            beginAsyncEvent(event, instance, instance.name, "b");
+            mOut.append(R"(,"args":{"type":)");
+            appendJsonString(mOut, eventName(event.event));
+            mOut.append("}}");
+            return;
+        case TraceEventType::Named:
+            return;
+        case TraceEventType::Suspended:
+            beginAsyncEvent(event, instance, eventName(event.event), "b");
+            break;
+        case TraceEventType::Resumed:
+            beginAsyncEvent(event, instance, eventName(event.event), "e");
+            break;
+        case TraceEventType::Finished:
+            if (!instance.created) {
+                return;
+            }
+            beginAsyncEvent(event, instance, instance.name, "e");
+            break;
+        case TraceEventType::Destroyed:
+            beginAsyncEvent(event, instance, "destroyed", "n");
+            break;
+        }
+        mOut.append('}');
+    }
+
+    void beginEvent(std::string_view name, const char *phase, std::uint32_t threadId) {
+        if (!mFirst) {
+            mOut.append(',');
+        }
+        mFirst = false;
+        mOut.append(R"({"name":)");
+        appendJsonString(mOut, name);
+        mOut.append(R"(,"ph":")");
+        mOut.append(phase);
+        mOut.append(R"(","pid":)");
+        mOut.append(QByteArray::number(QCoreApplication::applicationPid()));
+        mOut.append(R"(,"tid":)");
+        mOut.append(QByteArray::number(threadId));
+    }
+
+    void beginAsyncEvent(const Event &event, const Instance &instance, std::string_view name,
+                         const char *phase) {
+        beginEvent(name, phase, event.threadId);
+        mOut.append(R"(,"cat":"qcoro","id":")");
+        mOut.append(instance.id);
+        mOut.append(R"(","ts":)");
+        mOut.append(QByteArray::number(static_cast<double>(event.event.timestamp - mStart) / 1000.0,
+                                       'f', 3));
+    }
+
+    static std::string_view eventName(const TraceEvent &event) {
+        return {event.name, event.nameLength};
+    }
+
+    std::vector<std::shared_ptr<TraceBuffer>> mBuffers;
+    std::vector<Event> mEvents;
+    std::vector<std::size_t> mEventInstances;
+    std::vector<Instance> mInstances;
+    std::int64_t mStart = 0;
+    QByteArray mOut;
+    bool mFirst = true;
+};
+
+#endif // QCORO_ENABLE_TRACING
+
+} // namespace detail
+/*! \endcond */
+
+//! Returns the recorded events as JSON in the Chrome trace event format.
+/*!
+ * The trace can be opened in Perfetto (https://ui.perfetto.dev) or in chrome://tracing.
+ * Without \c QCORO_ENABLE_TRACING an empty, but valid trace is returned.
+ */
+inline QByteArray chromeTrace() {
+#ifdef QCORO_ENABLE_TRACING
+    return detail::ChromeTraceWriter{}.write();
+#else
+    return QByteArray{R"({"displayTimeUnit":"ns","traceEvents":[]})" "\n"};
+#endif
+}
+
+//! Writes the recorded events as JSON in the Chrome trace event format into the \c device.
+/*!
+ * \return Returns whether the whole trace has been written.
+ * \sa chromeTrace()
+ */
+inline bool writeChromeTrace(QIODevice *device) {
+    const auto trace = chromeTrace();
+    return device->write(trace) == trace.size();
+}
+
+} // namespace QCoro
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/when.h"
+#include "task.h"
+
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <tuple>
+#include <vector>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+template<typename T>
+Task<> whenAllHelper(T awaitable, std::optional<when_result_t<T>> &result,
+                     std::exception_ptr &exception, WhenLatch &latch) {
+    try {
+        co_await awaitInto<T>(std::forward<T>(awaitable), result);
+    } catch (...) {
+        if (!exception) {
+            exception = std::current_exception();
+        }
+    }
+    latch.countDown();
+}
+
+template<typename... Awaitables, std::size_t... Is>
+Task<std::tuple<when_result_t<Awaitables>...>> whenAllTuple(std::index_sequence<Is...>,
+                                                            Awaitables &&...awaitables) {
+    std::tuple<std::optional<when_result_t<Awaitables>>...> results;
+    std::exception_ptr exception;
+    WhenLatch latch{sizeof...(Awaitables)};
+
+    (whenAllHelper<when_argument_t<Awaitables>>(std::forward<Awaitables>(awaitables),
+                                                 std::get<Is>(results), exception, latch),
+     ...);
+
+    co_await latch.wait();
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+    co_return std::tuple<when_result_t<Awaitables>...>{std::move(*std::get<Is>(results))...};
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Waits until all the awaitables finish and returns their results.
+/*!
+ * All the awaitables are started (co_awaited) at the same time, so the total time
+ * spent waiting is that of the slowest operation, rather than the sum of all of them.
+ * The awaiting coroutine is resumed only once, after all the operations have finished.
+ *
+ * The arguments can be anything that can be co_awaited from a QCoro coroutine: a \c Task,
+ * a \c LazyTask (which is started), a supported Qt type like \c QNetworkReply* or any other
+ * Awaitable. Temporaries are moved into the combinator, l-values are co_awaited in place.
+ *
+ * \return A tuple with results of the individual awaitables, in the order in which they
+ * have been passed. Awaitables with \c void result are represented by \c std::monostate.
+ * If any of the awaitables throws an exception, the first exception thrown is rethrown
+ * once all of the awaitables have finished.
+ */
+template<detail::TaskAwaitable... Awaitables>
+    requires(sizeof...(Awaitables) > 0)
+Task<std::tuple<detail::when_result_t<Awaitables>...>> whenAll(Awaitables &&...awaitables) {
+    return detail::whenAllTuple(std::index_sequence_for<Awaitables...>{},
+                                std::forward<Awaitables>(awaitables)...);
+}
+
+//! Waits until all awaitables in the range finish and returns their results.
+/*!
+ * Same as the variadic overload, but for a range (e.g. a \c std::vector or a \c QList)
+ * of awaitables of the same type.
+ *
+ * \return A vector with results of the individual awaitables, in the order of the range.
+ */
+template<std::ranges::forward_range Range>
+Task<std::vector<detail::when_result_t<std::ranges::range_reference_t<Range>>>>
+whenAll(Range &&range) {
+    using Element = std::conditional_t<std::is_lvalue_reference_v<Range>,
+                                       std::ranges::range_reference_t<Range>,
+                                       std::ranges::range_rvalue_reference_t<Range>>;
+    using Result = detail::when_result_t<std::ranges::range_reference_t<Range>>;
+
+    std::vector<std::optional<Result>> results(std::ranges::distance(range));
+    std::exception_ptr exception;
+    detail::WhenLatch latch{results.size()};
+
+    auto result = results.begin();
+    for (auto &&awaitable : range) {
+        detail::whenAllHelper<detail::when_argument_t<Element>>(static_cast<Element>(awaitable),
+                                                                *result++, exception, latch);
+    }
+
+    co_await latch.wait();
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+
+    std::vector<Result> values;
+    values.reserve(results.size());
+    for (auto &value : results) {
+        values.push_back(std::move(*value));
+    }
+    co_return values;
+}
+
+} // namespace QCoro
@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "impl/when.h"
+#include "task.h"
+
+#include <exception>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <variant>
+
+namespace QCoro {
+
+/*! \cond internal */
+
+namespace detail {
+
+//! State shared between the whenAny() coroutine and the helper coroutines.
+/*!
+ * The helpers that finish after the first one still access the state, so
+ * it must outlive the whenAny() coroutine.
+ */
+template<typename Result>
+struct WhenAnyState {
+    std::atomic<bool> finished{false};
+    std::optional<Result> result;
+    std::exception_ptr exception;
+    WhenLatch latch{1};
+};
+
+template<std::size_t Index, typename T, typename Result>
+Task<> whenAnyHelper(T awaitable, std::shared_ptr<WhenAnyState<Result>> state) {
+    std::optional<when_result_t<T>> value;
+    std::exception_ptr exception;
+    try {
+        co_await awaitInto<T>(std::forward<T>(awaitable), value);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    if (state->finished.exchange(true, std::memory_order_acq_rel)) {
+        co_return;
+    }
+
+    if (exception) {
+        state->exception = exception;
+    } else {
+        state->result.emplace(std::in_place_index<Index>, std::move(*value));
+    }
+    state->latch.countDown();
+}
+
+template<typename T, typename Result>
+Task<> whenAnyRangeHelper(T awaitable, std::size_t index,
+                          std::shared_ptr<WhenAnyState<Result>> state) {
+    std::optional<when_result_t<T>> value;
+    std::exception_ptr exception;
+    try {
+        co_await awaitInto<T>(std::forward<T>(awaitable), value);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    if (state->finished.exchange(true, std::memory_order_acq_rel)) {
+        co_return;
+    }
+
+    if (exception) {
+        state->exception = exception;
+    } else {
+        state->result.emplace(index, std::move(*value));
+    }
+    state->latch.countDown();
+}
+
+template<typename... Awaitables, std::size_t... Is>
+Task<std::variant<when_result_t<Awaitables>...>> whenAnyVariant(std::index_sequence<Is...>,
+                                                                Awaitables &&...awaitables) {
+    using Result = std::variant<when_result_t<Awaitables>...>;
+    auto state = std::make_shared<WhenAnyState<Result>>();
+
+    (whenAnyHelper<Is, when_argument_t<Awaitables>>(std::forward<Awaitables>(awaitables), state),
+     ...);
+
+    co_await state->latch.wait();
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+    co_return std::move(*state->result);
+}
+
+} // namespace detail
+
+/*! \endcond */
+
+//! Waits until the first of the awaitables finishes and returns its result.
+/*!
+ * All the awaitables are started (co_awaited) at the same time and the awaiting coroutine
+ * is resumed, exactly once, as soon as one of them finishes. The remaining operations keep
+ * running and their results are discarded, so any l-value arguments must stay alive until
+ * they finish.
+ *
+ * The arguments can be anything that can be co_awaited from a QCoro coroutine, see
+ * \ref whenAll().
+ *
+ * \return A variant with the result of the first awaitable to finish. Its \c index() is
+ * the position of the awaitable in the argument list. Awaitables with \c void result are
+ * represented by \c std::monostate. If the first awaitable to finish has thrown an exception,
+ * the exception is rethrown.
+ */
+template<detail::TaskAwaitable... Awaitables>
+    requires(sizeof...(Awaitables) > 0)
+Task<std::variant<detail::when_result_t<Awaitables>...>> whenAny(Awaitables &&...awaitables) {
+    return detail::whenAnyVariant(std::index_sequence_for<Awaitables...>{},
+                                  std::forward<Awaitables>(awaitables)...);
+}
+
+//! Waits until the first awaitable in the range finishes and returns its result.
+/*!
+ * Same as the variadic overload, but for a non-empty range of awaitables of the same type.
+ *
+ * \return A pair with the index of the first awaitable to finish and its result.
+ */
+template<std::ranges::forward_range Range>
+Task<std::pair<std::size_t, detail::when_result_t<std::ranges::range_reference_t<Range>>>>
+whenAny(Range &&range) {
+    using Element = std::conditional_t<std::is_lvalue_reference_v<Range>,
+                                       std::ranges::range_reference_t<Range>,
+                                       std::ranges::range_rvalue_reference_t<Range>>;
+    using Result =
+        std::pair<std::size_t, detail::when_result_t<std::ranges::range_reference_t<Range>>>;
+
+    Q_ASSERT(!std::ranges::empty(range));
+    auto state = std::make_shared<detail::WhenAnyState<Result>>();
+
+    std::size_t index = 0;
+    for (auto &&awaitable : range) {
+        detail::whenAnyRangeHelper<detail::when_argument_t<Element>>(
+            static_cast<Element>(awaitable), index++, state);
+    }
+
+    co_await state->latch.wait();
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+    co_return std::move(*state->result);
+}
+
+} // namespace QCoro
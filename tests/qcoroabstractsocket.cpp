@@ -8,9 +8,13 @@
 
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QTimer>
 
+#include <memory>
 #include <thread>
 
+using namespace std::chrono_literals;
+
 class QCoroAbstractSocketTest : public QCoro::TestObject<QCoroAbstractSocketTest> {
     Q_OBJECT
 
@@ -133,6 +137,123 @@ private:
         QCORO_COMPARE(lines.size(), 14);
     }
 
+    //! Writes each of the \c chunks into the \c socket from the event loop, one after another.
+    static void writeChunks(QTcpSocket *socket, QByteArrayList chunks) {
+        auto delay = 10ms;
+        for (const auto &chunk : chunks) {
+            QTimer::singleShot(delay, socket, [socket, chunk]() {
+                socket->write(chunk);
+                socket->flush();
+            });
+            delay += 10ms;
+        }
+    }
+
+    QCoro::Task<std::unique_ptr<QTcpSocket>> accept(QTcpServer &server, QTcpSocket &client) {
+        client.connectToHost(QHostAddress::LocalHost, server.serverPort());
+        std::unique_ptr<QTcpSocket> peer{co_await qCoro(server).waitForNewConnection(10s)};
+        co_await qCoro(client).waitForConnected(10s);
+        co_return peer;
+    }
+
+    QCoro::Task<> testReadUntilCollectsFrame_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        const auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {"HEL", "LO\r", "\nWOR", "LD\r\nREST"});
+
+        QCORO_COMPARE(co_await qCoro(socket).readUntil("\r\n"), QByteArray{"HELLO\r\n"});
+        QCORO_COMPARE(co_await qCoro(socket).readUntil("\r\n"), QByteArray{"WORLD\r\n"});
+        QCORO_COMPARE(socket.peek(4), QByteArray{"REST"});
+    }
+
+    QCoro::Task<> testReadUntilMaxSize_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        const auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {"ABC", "DEFGH\n"});
+
+        QCORO_COMPARE(co_await qCoro(socket).readUntil("\n", 5), QByteArray{"ABCDE"});
+        QCORO_COMPARE(co_await qCoro(socket).readUntil("\n"), QByteArray{"FGH\n"});
+    }
+
+    QCoro::Task<> testReadUntilReturnsRestOnDisconnect_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {"incomplete"});
+        QTimer::singleShot(100ms, peer.get(), [&peer]() { peer->disconnectFromHost(); });
+
+        QCORO_COMPARE(co_await qCoro(socket).readUntil("\n"), QByteArray{"incomplete"});
+    }
+
+    QCoro::Task<> testReadFrameCollectsFrame_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        const auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {QByteArray("\x00", 1), QByteArray("\x05he", 3),
+                                 QByteArray("llo\x00\x00\x00", 6), "!"});
+
+        auto frame = co_await qCoro(socket).readFrame<quint16>();
+        QCORO_VERIFY(frame.has_value());
+        QCORO_COMPARE(*frame, QByteArray{"hello"});
+
+        frame = co_await qCoro(socket).readFrame<quint16>();
+        QCORO_VERIFY(frame.has_value());
+        QCORO_VERIFY(frame->isEmpty());
+        QCORO_COMPARE(socket.peek(3), QByteArray("\x00!", 2));
+    }
+
+    QCoro::Task<> testReadFrameRejectsLargeFrame_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        const auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {QByteArray("\x00\x00\x01\x00", 4)});
+
+        QCORO_VERIFY(!(co_await qCoro(socket).readFrame<quint32>(16)).has_value());
+    }
+
+    QCoro::Task<> testReadFrameRejectsHugeLengthByDefault_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        const auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        // 4 GiB frame
+        writeChunks(peer.get(), {QByteArray("\xff\xff\xff\xff", 4)});
+
+        QCORO_VERIFY(!(co_await qCoro(socket).readFrame<quint32>()).has_value());
+    }
+
+    QCoro::Task<> testReadFrameFailsOnDisconnect_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        QTcpSocket socket;
+        auto peer = co_await accept(server, socket);
+        QCORO_VERIFY(peer != nullptr);
+
+        writeChunks(peer.get(), {QByteArray("\x08short", 6)});
+        QTimer::singleShot(100ms, peer.get(), [&peer]() { peer->disconnectFromHost(); });
+
+        QCORO_VERIFY(!(co_await qCoro(socket).readFrame<quint8>()).has_value());
+    }
+
 private Q_SLOTS:
     void init() {
         mServer.start(QHostAddress::LocalHost);
@@ -152,6 +273,13 @@ private Q_SLOTS:
     addTest(ReadAllTriggers)
     addTest(ReadTriggers)
     addTest(ReadLineTriggers)
+    addTest(ReadUntilCollectsFrame)
+    addTest(ReadUntilMaxSize)
+    addTest(ReadUntilReturnsRestOnDisconnect)
+    addTest(ReadFrameCollectsFrame)
+    addTest(ReadFrameRejectsLargeFrame)
+    addTest(ReadFrameRejectsHugeLengthByDefault)
+    addTest(ReadFrameFailsOnDisconnect)
 
 private:
     TestHttpServer<QTcpServer> mServer;
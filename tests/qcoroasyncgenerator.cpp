@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/asyncgenerator.h"
+#include "qcoro/timer.h"
+
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+QCoro::AsyncGenerator<int> numbers(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+QCoro::AsyncGenerator<int> timerNumbers(int count) {
+    QTimer timer;
+    timer.setInterval(10ms);
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        co_await timer;
+        co_yield i;
+    }
+}
+
+QCoro::AsyncGenerator<QString> strings() {
+    const QString constString = QStringLiteral("const");
+    co_yield constString;
+    QString string = QStringLiteral("lvalue");
+    co_yield string;
+    co_yield QStringLiteral("rvalue");
+}
+
+QCoro::AsyncGenerator<int> throwing() {
+    co_yield 1;
+    throw std::runtime_error("Generator failed");
+}
+
+QCoro::AsyncGenerator<int> holder(std::shared_ptr<int> value) {
+    co_yield *value;
+    co_yield *value;
+}
+
+} // namespace
+
+class QCoroAsyncGeneratorTest : public QCoro::TestObject<QCoroAsyncGeneratorTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testYieldsValues_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QList<int> values;
+        QCORO_FOREACH(int value, numbers(5)) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values, (QList<int>{0, 1, 2, 3, 4}));
+    }
+
+    QCoro::Task<> testIteratesManually_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        auto generator = numbers(3);
+        int sum = 0;
+        for (auto it = co_await generator.begin(); it != generator.end(); co_await ++it) {
+            sum += *it;
+        }
+        QCORO_COMPARE(sum, 3);
+    }
+
+    QCoro::Task<> testAwaitsInsideGenerator_coro(QCoro::TestContext) {
+        QList<int> values;
+        QCORO_FOREACH(int value, timerNumbers(3)) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values, (QList<int>{0, 1, 2}));
+    }
+
+    QCoro::Task<> testYieldsReferencesAndCopies_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QStringList values;
+        QCORO_FOREACH(const QString &value, strings()) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values, (QStringList{QStringLiteral("const"), QStringLiteral("lvalue"),
+                                           QStringLiteral("rvalue")}));
+    }
+
+    QCoro::Task<> testEmptyGenerator_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        int count = 0;
+        QCORO_FOREACH(int value, numbers(0)) {
+            Q_UNUSED(value);
+            ++count;
+        }
+        QCORO_COMPARE(count, 0);
+
+        QCoro::AsyncGenerator<int> empty;
+        const auto it = co_await empty.begin();
+        QCORO_VERIFY(it == empty.end());
+    }
+
+    QCoro::Task<> testRethrowsException_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QList<int> values;
+        bool thrown = false;
+        try {
+            QCORO_FOREACH(int value, throwing()) {
+                values.push_back(value);
+            }
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        QCORO_VERIFY(thrown);
+        QCORO_COMPARE(values, QList<int>{1});
+    }
+
+    QCoro::Task<> testDestroysUnfinishedGenerator_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        auto value = std::make_shared<int>(42);
+        {
+            auto generator = holder(value);
+            auto it = co_await generator.begin();
+            QCORO_COMPARE(*it, 42);
+            QCORO_COMPARE(value.use_count(), 2);
+        }
+        QCORO_COMPARE(value.use_count(), 1);
+    }
+
+private Q_SLOTS:
+    addTest(YieldsValues)
+    addTest(IteratesManually)
+    addTest(AwaitsInsideGenerator)
+    addTest(YieldsReferencesAndCopies)
+    addTest(EmptyGenerator)
+    addTest(RethrowsException)
+    addTest(DestroysUnfinishedGenerator)
+};
+
+QTEST_GUILESS_MAIN(QCoroAsyncGeneratorTest)
+
+#include "qcoroasyncgenerator.moc"
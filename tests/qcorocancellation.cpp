@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/cancellation.h"
+#include "qcoro/coro.h"
+#include "qcoro/timer.h"
+
+#include <QElapsedTimer>
+
+#include <stop_token>
+
+class CancellationEmitter : public QObject {
+    Q_OBJECT
+Q_SIGNALS:
+    void valueChanged(int value);
+};
+
+class QCoroCancellationTest : public QCoro::TestObject<QCoroCancellationTest> {
+    Q_OBJECT
+
+private:
+    static QCoro::Task<int> delayedValue(std::chrono::milliseconds delay, int value) {
+        co_await QCoro::sleepFor(delay);
+        co_return value;
+    }
+
+    QCoro::Task<> testReturnsResultWhenNotCancelled_coro(QCoro::TestContext) {
+        std::stop_source source;
+
+        const auto result =
+            co_await QCoro::withCancellation(QCoro::sleepFor(10ms), source.get_token());
+        QCORO_VERIFY(result.has_value());
+    }
+
+    QCoro::Task<> testCancelsOperation_coro(QCoro::TestContext) {
+        std::stop_source source;
+        QTimer::singleShot(50ms, [&source]() { source.request_stop(); });
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        const auto result =
+            co_await QCoro::withCancellation(QCoro::sleepFor(10s), source.get_token());
+        QCORO_VERIFY(!result.has_value());
+        QCORO_VERIFY(elapsed.elapsed() < 1000);
+    }
+
+    QCoro::Task<> testDoesntSuspendWhenAlreadyCancelled_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        std::stop_source source;
+        source.request_stop();
+
+        const auto result =
+            co_await QCoro::withCancellation(QCoro::sleepFor(10s), source.get_token());
+        QCORO_VERIFY(!result.has_value());
+    }
+
+    QCoro::Task<> testCancelsSignal_coro(QCoro::TestContext) {
+        CancellationEmitter emitter;
+        std::stop_source source;
+        QTimer::singleShot(10ms, [&source]() { source.request_stop(); });
+
+        const auto result = co_await QCoro::withCancellation(
+            qCoro(&emitter, &CancellationEmitter::valueChanged), source.get_token());
+        QCORO_VERIFY(!result.has_value());
+
+        // The cancelled awaiter must not be resumed by late emissions
+        Q_EMIT emitter.valueChanged(42);
+        co_await QCoro::sleepFor(10ms);
+    }
+
+    QCoro::Task<> testCancelsTask_coro(QCoro::TestContext) {
+        std::stop_source source;
+        QTimer::singleShot(50ms, [&source]() { source.request_stop(); });
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        const auto result =
+            co_await QCoro::withCancellation(delayedValue(1s, 42), source.get_token());
+        QCORO_VERIFY(!result.has_value());
+        QCORO_VERIFY(elapsed.elapsed() < 1000);
+    }
+
+    QCoro::Task<> testReturnsTaskResult_coro(QCoro::TestContext) {
+        std::stop_source source;
+
+        const auto result =
+            co_await QCoro::withCancellation(delayedValue(10ms, 42), source.get_token());
+        QCORO_COMPARE(result.value_or(0), 42);
+    }
+
+private Q_SLOTS:
+    addTest(ReturnsResultWhenNotCancelled)
+    addTest(CancelsOperation)
+    addTest(DoesntSuspendWhenAlreadyCancelled)
+    addTest(CancelsSignal)
+    addTest(CancelsTask)
+    addTest(ReturnsTaskResult)
+};
+
+QTEST_GUILESS_MAIN(QCoroCancellationTest)
+
+#include "qcorocancellation.moc"
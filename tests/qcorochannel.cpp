@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/channel.h"
+#include "qcoro/timeout.h"
+#include "qcoro/timer.h"
+#include "qcoro/whenall.h"
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+QCoro::Task<> produce(QCoro::Channel<int> &channel, int count, std::size_t &maxSize) {
+    for (int i = 0; i < count; ++i) {
+        co_await channel.send(i);
+        maxSize = std::max(maxSize, channel.size());
+    }
+    channel.close();
+}
+
+QCoro::Task<std::vector<int>> consume(QCoro::Channel<int> &channel) {
+    std::vector<int> values;
+    while (const auto value = co_await channel.receive()) {
+        co_await QCoro::sleepFor(1ms);
+        values.push_back(*value);
+    }
+    co_return values;
+}
+
+} // namespace
+
+class QCoroChannelTest : public QCoro::TestObject<QCoroChannelTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testDoesntSuspendWhenReady_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::Channel<std::unique_ptr<int>> channel{2};
+        QCORO_VERIFY(co_await channel.send(std::make_unique<int>(1)));
+        QCORO_VERIFY(co_await channel.send(std::make_unique<int>(2)));
+        QCORO_COMPARE(channel.size(), std::size_t{2});
+
+        const auto first = co_await channel.receive();
+        const auto second = co_await channel.receive();
+        QCORO_COMPARE(**first, 1);
+        QCORO_COMPARE(**second, 2);
+    }
+
+    QCoro::Task<> testSuspendsSenderWhenFull_coro(QCoro::TestContext) {
+        QCoro::Channel<int> channel{2};
+        std::size_t maxSize = 0;
+
+        const auto values =
+            std::get<1>(co_await QCoro::whenAll(produce(channel, 10, maxSize), consume(channel)));
+
+        QCORO_VERIFY(maxSize <= 2);
+        QCORO_COMPARE(values, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    }
+
+    QCoro::Task<> testReceiverWaitsForValue_coro(QCoro::TestContext) {
+        QCoro::Channel<QString> channel{1};
+        QTimer::singleShot(10ms, [&channel]() { channel.trySend(QStringLiteral("value")); });
+
+        const auto value = co_await channel.receive();
+        QCORO_COMPARE(value, std::optional<QString>{QStringLiteral("value")});
+    }
+
+    QCoro::Task<> testCloseResumesWaiters_coro(QCoro::TestContext) {
+        QCoro::Channel<int> channel{1};
+        QTimer::singleShot(10ms, [&channel]() { channel.close(); });
+
+        const auto value = co_await channel.receive();
+        QCORO_VERIFY(!value.has_value());
+        QCORO_VERIFY(channel.isClosed());
+        QCORO_VERIFY(!co_await channel.send(1));
+        QCORO_VERIFY(!channel.trySend(1));
+    }
+
+    QCoro::Task<> testReceivesValuesSentBeforeClose_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::Channel<int> channel{2};
+        QCORO_VERIFY(channel.trySend(1));
+        channel.close();
+
+        QCORO_COMPARE(co_await channel.receive(), std::optional<int>{1});
+        QCORO_COMPARE(co_await channel.receive(), std::optional<int>{});
+    }
+
+    QCoro::Task<> testSendTimesOut_coro(QCoro::TestContext) {
+        QCoro::Channel<int> channel{1};
+        QCORO_VERIFY(channel.trySend(1));
+
+        const auto sent = co_await QCoro::withTimeout(channel.send(2), 20ms);
+        QCORO_VERIFY(!sent.has_value());
+
+        // The cancelled send must not deliver its value
+        QCORO_COMPARE(channel.tryReceive(), std::optional<int>{1});
+        QCORO_COMPARE(channel.tryReceive(), std::optional<int>{});
+    }
+
+    QCoro::Task<> testReceivesFromOtherThread_coro(QCoro::TestContext) {
+        QCoro::Channel<int> channel{4};
+        std::thread producer{[&channel]() {
+            for (int i = 0; i < 100; ++i) {
+                int value = i;
+                while (!channel.trySend(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+            channel.close();
+        }};
+
+        std::vector<int> values;
+        bool inMainThread = true;
+        while (const auto value = co_await channel.receive()) {
+            inMainThread &= QThread::currentThread() == QCoreApplication::instance()->thread();
+            values.push_back(*value);
+        }
+        producer.join();
+
+        QCORO_VERIFY(inMainThread);
+        QCORO_COMPARE(values.size(), std::size_t{100});
+        QCORO_VERIFY(std::is_sorted(values.begin(), values.end()));
+    }
+
+private Q_SLOTS:
+    addTest(DoesntSuspendWhenReady)
+    addTest(SuspendsSenderWhenFull)
+    addTest(ReceiverWaitsForValue)
+    addTest(CloseResumesWaiters)
+    addTest(ReceivesValuesSentBeforeClose)
+    addTest(SendTimesOut)
+    addTest(ReceivesFromOtherThread)
+};
+
+QTEST_GUILESS_MAIN(QCoroChannelTest)
+
+#include "qcorochannel.moc"
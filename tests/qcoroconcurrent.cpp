@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/concurrent.h"
+#include "qcoro/timer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+std::vector<int> makeItems(int count) {
+    std::vector<int> items(static_cast<std::size_t>(count));
+    std::iota(items.begin(), items.end(), 0);
+    return items;
+}
+
+} // namespace
+
+class QCoroConcurrentTest : public QCoro::TestObject<QCoroConcurrentTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testForEachLimitsConcurrency_coro(QCoro::TestContext) {
+        std::vector<int> items(20);
+        std::iota(items.begin(), items.end(), 0);
+        int running = 0;
+        int maxRunning = 0;
+        std::vector<int> processed;
+
+        co_await QCoro::forEachConcurrent(items, 4, [&](int item) -> QCoro::Task<> {
+            ++running;
+            maxRunning = std::max(maxRunning, running);
+            co_await QCoro::sleepFor(10ms);
+            --running;
+            processed.push_back(item);
+        });
+
+        QCORO_COMPARE(maxRunning, 4);
+        QCORO_COMPARE(processed.size(), items.size());
+        std::sort(processed.begin(), processed.end());
+        QCORO_COMPARE(processed, items);
+    }
+
+    QCoro::Task<> testMapPreservesOrder_coro(QCoro::TestContext) {
+        const std::vector<int> items = {5, 4, 3, 2, 1};
+
+        const auto results =
+            co_await QCoro::mapConcurrent(items, 3, [](int item) -> QCoro::Task<QString> {
+                co_await QCoro::sleepFor(std::chrono::milliseconds{item * 10});
+                co_return QString::number(item);
+            });
+
+        QCORO_COMPARE(results, (std::vector<QString>{QStringLiteral("5"), QStringLiteral("4"),
+                                                     QStringLiteral("3"), QStringLiteral("2"),
+                                                     QStringLiteral("1")}));
+    }
+
+    QCoro::Task<> testMapVoidResults_coro(QCoro::TestContext) {
+        const std::vector<int> items = {1, 2, 3};
+        const auto results = co_await QCoro::mapConcurrent(
+            items, 2, [](int) -> QCoro::Task<> { co_await QCoro::sleepFor(1ms); });
+        QCORO_COMPARE(results.size(), std::size_t{3});
+    }
+
+    QCoro::Task<> testEmptyRange_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        const std::vector<int> items;
+        const auto results = co_await QCoro::mapConcurrent(
+            items, 4, [](int item) -> QCoro::Task<int> { co_return item; });
+        QCORO_VERIFY(results.empty());
+    }
+
+    QCoro::Task<> testStopsOnException_coro(QCoro::TestContext) {
+        std::vector<int> items(10);
+        std::iota(items.begin(), items.end(), 0);
+        int started = 0;
+
+        bool caught = false;
+        try {
+            co_await QCoro::forEachConcurrent(items, 2, [&](int item) -> QCoro::Task<> {
+                ++started;
+                co_await QCoro::sleepFor(10ms);
+                if (item == 0) {
+                    throw std::runtime_error("Expected exception");
+                }
+            });
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+
+        QCORO_VERIFY(caught);
+        QCORO_COMPARE(started, 2);
+    }
+
+    QCoro::Task<> testTemporaryRange_coro(QCoro::TestContext) {
+        // The temporary vector is destroyed before the operations finish, unless it's owned
+        // by the Task
+        const auto results =
+            co_await QCoro::mapConcurrent(makeItems(3), 2, [](int item) -> QCoro::Task<int> {
+                co_await QCoro::sleepFor(5ms);
+                co_return item * 10;
+            });
+
+        QCORO_COMPARE(results, (std::vector<int>{0, 10, 20}));
+    }
+
+    QCoro::Task<> testMapNonDefaultConstructibleResults_coro(QCoro::TestContext) {
+        struct Value {
+            explicit Value(int v) : value(v) {}
+            int value;
+        };
+
+        const std::vector<int> items = {1, 2, 3};
+        const auto results =
+            co_await QCoro::mapConcurrent(items, 2, [](int item) -> QCoro::Task<Value> {
+                co_await QCoro::sleepFor(1ms);
+                co_return Value{item * 2};
+            });
+
+        QCORO_COMPARE(results.size(), std::size_t{3});
+        QCORO_COMPARE(results[2].value, 6);
+    }
+
+private Q_SLOTS:
+    addTest(ForEachLimitsConcurrency)
+    addTest(MapPreservesOrder)
+    addTest(MapVoidResults)
+    addTest(EmptyRange)
+    addTest(StopsOnException)
+    addTest(TemporaryRange)
+    addTest(MapNonDefaultConstructibleResults)
+};
+
+QTEST_GUILESS_MAIN(QCoroConcurrentTest)
+
+#include "qcoroconcurrent.moc"
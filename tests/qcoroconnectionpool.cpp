@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/connectionpool.h"
+#include "qcoro/timer.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//! Accepts all incoming connections and keeps them open.
+class Server {
+public:
+    Server() {
+        mServer.listen(QHostAddress::LocalHost);
+        QObject::connect(&mServer, &QTcpServer::newConnection, [this]() {
+            while (auto *socket = mServer.nextPendingConnection()) {
+                mConnections.emplace_back(socket);
+            }
+        });
+    }
+
+    quint16 port() const {
+        return mServer.serverPort();
+    }
+
+    std::size_t accepted() const {
+        return mConnections.size();
+    }
+
+    void closeAll() {
+        for (auto &connection : mConnections) {
+            connection->close();
+        }
+    }
+
+private:
+    QTcpServer mServer;
+    std::vector<std::unique_ptr<QTcpSocket>> mConnections;
+};
+
+} // namespace
+
+class QCoroConnectionPoolTest : public QCoro::TestObject<QCoroConnectionPoolTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testReusesConnection_coro(QCoro::TestContext) {
+        Server server;
+        QCoro::ConnectionPool pool;
+
+        QAbstractSocket *socket = nullptr;
+        {
+            auto connection = co_await pool.acquire(QStringLiteral("127.0.0.1"), server.port());
+            QCORO_VERIFY(connection);
+            QCORO_COMPARE(connection->state(), QAbstractSocket::ConnectedState);
+            socket = connection.socket();
+            QCORO_COMPARE(pool.activeCount(), std::size_t{1});
+        }
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        auto connection = co_await pool.acquire(QStringLiteral("127.0.0.1"), server.port());
+        QCORO_COMPARE(connection.socket(), socket);
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testLimitsConnectionsPerHost_coro(QCoro::TestContext) {
+        Server server;
+        QCoro::ConnectionPool pool;
+        pool.setMaxConnectionsPerHost(2);
+
+        const auto host = QStringLiteral("127.0.0.1");
+        auto first = co_await pool.acquire(host, server.port());
+        auto second = co_await pool.acquire(host, server.port());
+        QCORO_VERIFY(first && second);
+
+        auto third = pool.acquire(host, server.port());
+        co_await QCoro::sleepFor(20ms);
+        QCORO_VERIFY(!third.isReady());
+
+        auto *socket = first.socket();
+        first.release();
+        auto connection = co_await std::move(third);
+        QCORO_COMPARE(connection.socket(), socket);
+        QCORO_COMPARE(server.accepted(), std::size_t{2});
+    }
+
+    QCoro::Task<> testDoesntReuseClosedConnection_coro(QCoro::TestContext) {
+        Server server;
+        QCoro::ConnectionPool pool;
+        const auto host = QStringLiteral("127.0.0.1");
+
+        {
+            auto connection = co_await pool.acquire(host, server.port());
+            QCORO_VERIFY(connection);
+        }
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        server.closeAll();
+        co_await QCoro::sleepFor(50ms);
+
+        auto connection = co_await pool.acquire(host, server.port());
+        QCORO_VERIFY(connection);
+        QCORO_COMPARE(connection->state(), QAbstractSocket::ConnectedState);
+        QCORO_COMPARE(server.accepted(), std::size_t{2});
+    }
+
+    QCoro::Task<> testDiscardedConnectionIsClosed_coro(QCoro::TestContext) {
+        Server server;
+        QCoro::ConnectionPool pool;
+
+        auto connection = co_await pool.acquire(QStringLiteral("127.0.0.1"), server.port());
+        QCORO_VERIFY(connection);
+        connection.discard();
+        connection.release();
+
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testClosesIdleConnections_coro(QCoro::TestContext) {
+        Server server;
+        QCoro::ConnectionPool pool;
+        pool.setIdleTimeout(20ms);
+
+        {
+            auto connection = co_await pool.acquire(QStringLiteral("127.0.0.1"), server.port());
+            QCORO_VERIFY(connection);
+        }
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        co_await QCoro::sleepFor(100ms);
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testFailedConnection_coro(QCoro::TestContext) {
+        quint16 port = 0;
+        {
+            // Find a port on which nobody listens
+            Server server;
+            port = server.port();
+        }
+
+        QCoro::ConnectionPool pool;
+        pool.setConnectTimeout(1s);
+        auto connection = co_await pool.acquire(QStringLiteral("127.0.0.1"), port);
+        QCORO_VERIFY(!connection);
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testReusesLocalConnection_coro(QCoro::TestContext) {
+        const auto name = QStringLiteral("qcoro-connectionpool-test");
+        QLocalServer::removeServer(name);
+        QLocalServer server;
+        QCORO_VERIFY(server.listen(name));
+        std::vector<std::unique_ptr<QLocalSocket>> accepted;
+        QObject::connect(&server, &QLocalServer::newConnection, [&]() {
+            while (auto *socket = server.nextPendingConnection()) {
+                accepted.emplace_back(socket);
+            }
+        });
+        QCoro::ConnectionPool pool;
+
+        QLocalSocket *socket = nullptr;
+        {
+            auto connection = co_await pool.acquireLocal(name);
+            QCORO_VERIFY(connection);
+            QCORO_COMPARE(connection->state(), QLocalSocket::ConnectedState);
+            socket = connection.socket();
+            QCORO_COMPARE(pool.activeCount(), std::size_t{1});
+        }
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        auto connection = co_await pool.acquireLocal(name);
+        QCORO_COMPARE(connection.socket(), socket);
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testFailedLocalConnection_coro(QCoro::TestContext) {
+        const auto name = QStringLiteral("qcoro-connectionpool-nobody");
+        QLocalServer::removeServer(name);
+
+        QCoro::ConnectionPool pool;
+        auto connection = co_await pool.acquireLocal(name);
+        QCORO_VERIFY(!connection);
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+    }
+
+private Q_SLOTS:
+    addTest(ReusesConnection)
+    addTest(LimitsConnectionsPerHost)
+    addTest(DoesntReuseClosedConnection)
+    addTest(DiscardedConnectionIsClosed)
+    addTest(ClosesIdleConnections)
+    addTest(FailedConnection)
+    addTest(ReusesLocalConnection)
+    addTest(FailedLocalConnection)
+};
+
+QTEST_GUILESS_MAIN(QCoroConnectionPoolTest)
+
+#include "qcoroconnectionpool.moc"
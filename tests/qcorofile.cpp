@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/coro.h"
+
+#include <QCoreApplication>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <utility>
+
+namespace {
+
+const QByteArray fileContent("The quick brown fox jumps over the lazy dog");
+
+bool createFile(QTemporaryFile &file) {
+    return file.open() && file.write(fileContent) == fileContent.size() && file.seek(0);
+}
+
+} // namespace
+
+class QCoroFileTest : public QCoro::TestObject<QCoroFileTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testReadsAt_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+
+        const auto data = co_await qCoro(file).readAt(4, 5);
+
+        QCORO_COMPARE(data, QByteArray("quick"));
+        QCORO_COMPARE(file.pos(), 0);
+        QCORO_COMPARE(QThread::currentThread(), QCoreApplication::instance()->thread());
+    }
+
+    QCoro::Task<> testReadsAtEnd_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+
+        const auto tail = co_await qCoro(file).readAt(fileContent.size() - 3, 100);
+        QCORO_COMPARE(tail, QByteArray("dog"));
+
+        const auto past = co_await qCoro(file).readAt(fileContent.size() + 10, 10);
+        QCORO_VERIFY(past.isEmpty());
+    }
+
+    QCoro::Task<> testReadsAtAfterClose_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+
+        // The operation owns its own file descriptor, captured when it's created
+        auto read = qCoro(file).readAt(4, 5);
+        file.close();
+
+        QCORO_COMPARE(co_await std::move(read), QByteArray("quick"));
+    }
+
+    QCoro::Task<> testWritesAt_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+
+        const auto written = co_await qCoro(file).writeAt(4, QByteArray("QUICK"));
+        QCORO_COMPARE(written, 5);
+        QCORO_COMPARE(file.pos(), 0);
+
+        const auto data = co_await qCoro(file).readAt(0, 15);
+        QCORO_COMPARE(data, QByteArray("The QUICK brown"));
+    }
+
+    QCoro::Task<> testWritesBufferedDataFirst_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(file.open());
+        // Not flushed into the file yet
+        file.write("Hello");
+
+        co_await qCoro(file).writeAt(5, QByteArray(" World"));
+
+        const auto data = co_await qCoro(file).readAt(0, 100);
+        QCORO_COMPARE(data, QByteArray("Hello World"));
+    }
+
+    QCoro::Task<> testReadsAll_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+        QCORO_VERIFY(file.seek(20));
+
+        const auto data = co_await qCoro(file).readAll();
+
+        QCORO_COMPARE(data, fileContent.mid(20));
+        QCORO_COMPARE(file.pos(), fileContent.size());
+        QCORO_VERIFY((co_await qCoro(file).readAll()).isEmpty());
+    }
+
+    QCoro::Task<> testReadsChunks_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+
+        QByteArray data;
+        int chunks = 0;
+        QCORO_FOREACH(const QByteArray &chunk, qCoro(file).readChunks(10)) {
+            QCORO_VERIFY(chunk.size() <= 10);
+            data += chunk;
+            ++chunks;
+        }
+
+        QCORO_COMPARE(data, fileContent);
+        QCORO_COMPARE(chunks, 5);
+        QCORO_COMPARE(file.pos(), fileContent.size());
+    }
+
+    QCoro::Task<> testWritesBufferedFile_coro(QCoro::TestContext ctx) {
+        QTemporaryFile file;
+        QCORO_VERIFY(file.open());
+        ctx.setShouldNotSuspend();
+
+        const auto written = co_await qCoro(file).write(fileContent);
+
+        QCORO_COMPARE(written, fileContent.size());
+        QCORO_VERIFY(file.flush());
+        QCORO_COMPARE(file.size(), fileContent.size());
+    }
+
+    QCoro::Task<> testFailsOnClosedFile_coro(QCoro::TestContext) {
+        QTemporaryFile file;
+        QCORO_VERIFY(createFile(file));
+        file.close();
+
+        QCORO_VERIFY((co_await qCoro(file).readAt(0, 10)).isEmpty());
+        QCORO_COMPARE(co_await qCoro(file).writeAt(0, QByteArray("data")), -1);
+    }
+
+private Q_SLOTS:
+    addTest(ReadsAt)
+    addTest(ReadsAtEnd)
+    addTest(ReadsAtAfterClose)
+    addTest(WritesAt)
+    addTest(WritesBufferedDataFirst)
+    addTest(ReadsAll)
+    addTest(ReadsChunks)
+    addTest(WritesBufferedFile)
+    addTest(FailsOnClosedFile)
+};
+
+QTEST_GUILESS_MAIN(QCoroFileTest)
+
+#include "qcorofile.moc"
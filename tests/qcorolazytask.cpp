@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/lazytask.h"
+#include "qcoro/timer.h"
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+QCoro::LazyTask<int> lazyValue(bool &started, int value) {
+    started = true;
+    co_return value;
+}
+
+QCoro::LazyTask<int> lazyTimer(int value) {
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    co_return value;
+}
+
+QCoro::LazyTask<> lazyHolder(std::shared_ptr<int>) {
+    co_return;
+}
+
+} // namespace
+
+class QCoroLazyTaskTest : public QCoro::TestObject<QCoroLazyTaskTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testStartsWhenAwaited_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        bool started = false;
+        auto task = lazyValue(started, 42);
+        QCORO_VERIFY(!started);
+        QCORO_VERIFY(!task.isStarted());
+
+        const int result = co_await task;
+        QCORO_VERIFY(started);
+        QCORO_COMPARE(result, 42);
+    }
+
+    QCoro::Task<> testAwaitsTemporary_coro(QCoro::TestContext) {
+        const int result = co_await lazyTimer(42);
+        QCORO_COMPARE(result, 42);
+    }
+
+    QCoro::Task<> testStartsExplicitly_coro(QCoro::TestContext) {
+        std::vector<QCoro::LazyTask<int>> tasks;
+        for (int i = 0; i < 5; ++i) {
+            tasks.push_back(lazyTimer(i));
+        }
+
+        for (auto &task : tasks) {
+            QCORO_VERIFY(!task.isStarted());
+            task.start();
+            QCORO_VERIFY(task.isStarted());
+        }
+
+        int sum = 0;
+        for (auto &task : tasks) {
+            sum += co_await task;
+        }
+        QCORO_COMPARE(sum, 10);
+    }
+
+private Q_SLOTS:
+    addTest(StartsWhenAwaited)
+    addTest(AwaitsTemporary)
+    addTest(StartsExplicitly)
+
+    void testDestroysUnstartedCoroutine() {
+        auto value = std::make_shared<int>(42);
+        {
+            [[maybe_unused]] const auto task = lazyHolder(value);
+            QCOMPARE(value.use_count(), 2);
+        }
+        QCOMPARE(value.use_count(), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroLazyTaskTest)
+
+#include "qcorolazytask.moc"
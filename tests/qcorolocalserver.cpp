@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/coro.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class QCoroLocalServerTest : public QCoro::TestObject<QCoroLocalServerTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testWaitForNewConnectionTriggers_coro(QCoro::TestContext) {
+        QLocalServer server;
+        QCORO_VERIFY(server.listen(getSocketName()));
+
+        QLocalSocket client;
+        QTimer::singleShot(10ms, [&client]() { client.connectToServer(getSocketName()); });
+
+        auto *connection = co_await qCoro(server).waitForNewConnection(10s);
+        QCORO_VERIFY(connection != nullptr);
+
+        client.write("Hello World!");
+        client.flush();
+
+        const auto data = co_await qCoro(connection).readAll();
+        QCORO_COMPARE(data, QByteArray{"Hello World!"});
+    }
+
+    QCoro::Task<> testWaitForNewConnectionTimesOut_coro(QCoro::TestContext) {
+        QLocalServer server;
+        QCORO_VERIFY(server.listen(getSocketName()));
+
+        auto *connection = co_await qCoro(server).waitForNewConnection(10ms);
+        QCORO_VERIFY(connection == nullptr);
+    }
+
+    QCoro::Task<> testDoesntCoAwaitPendingConnection_coro(QCoro::TestContext testContext) {
+        QLocalServer server;
+        QCORO_VERIFY(server.listen(getSocketName()));
+
+        QLocalSocket client;
+        client.connectToServer(getSocketName());
+        QCORO_VERIFY(server.waitForNewConnection(10'000));
+
+        testContext.setShouldNotSuspend();
+        auto *connection = co_await qCoro(server).waitForNewConnection(10s);
+        QCORO_VERIFY(connection != nullptr);
+    }
+
+    QCoro::Task<> testConnectionsStream_coro(QCoro::TestContext) {
+        QLocalServer server;
+        QCORO_VERIFY(server.listen(getSocketName()));
+
+        constexpr int count = 10;
+        std::vector<std::unique_ptr<QLocalSocket>> clients;
+        QTimer::singleShot(10ms, [&clients]() {
+            for (int i = 0; i < count; ++i) {
+                auto &client = clients.emplace_back(std::make_unique<QLocalSocket>());
+                client->connectToServer(getSocketName());
+            }
+        });
+
+        int accepted = 0;
+        QCORO_FOREACH(QLocalSocket *socket, qCoro(server).connections()) {
+            QCORO_VERIFY(socket != nullptr);
+            if (++accepted == count) {
+                break;
+            }
+        }
+        QCORO_COMPARE(accepted, count);
+    }
+
+    QCoro::Task<> testConnectionsStreamEndsWhenServerDestroyed_coro(QCoro::TestContext) {
+        auto *server = new QLocalServer;
+        QCORO_VERIFY(server->listen(getSocketName()));
+        QTimer::singleShot(10ms, server, &QObject::deleteLater);
+
+        int accepted = 0;
+        QCORO_FOREACH(QLocalSocket *socket, qCoro(server).connections()) {
+            Q_UNUSED(socket);
+            ++accepted;
+        }
+        QCORO_COMPARE(accepted, 0);
+    }
+
+private Q_SLOTS:
+    void init() {
+        QLocalServer::removeServer(getSocketName());
+    }
+
+    addTest(WaitForNewConnectionTriggers)
+    addTest(WaitForNewConnectionTimesOut)
+    addTest(DoesntCoAwaitPendingConnection)
+    addTest(ConnectionsStream)
+    addTest(ConnectionsStreamEndsWhenServerDestroyed)
+
+private:
+    static QString getSocketName() {
+        return QStringLiteral("%1-%2")
+            .arg(QCoreApplication::applicationName())
+            .arg(QCoreApplication::applicationPid());
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroLocalServerTest)
+
+#include "qcorolocalserver.moc"
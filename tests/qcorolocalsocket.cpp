@@ -5,11 +5,25 @@
 #include "testhttpserver.h"
 #include "testobject.h"
 #include "qcoro/coro.h"
+#include "qcoro/timeout.h"
+#include "qcoro/whenall.h"
 
 #include <QLocalServer>
 
+#include <array>
 #include <thread>
 
+namespace {
+
+QCoro::DestroyableCoroutine readAndDestroy(QLocalSocket &socket,
+                                           QCoro::DestroyableCoroutine &other, int &reads) {
+    co_await qCoro(socket).readAll();
+    ++reads;
+    other.destroy();
+}
+
+} // namespace
+
 class QCoroLocalSocketTest : public QCoro::TestObject<QCoroLocalSocketTest> {
     Q_OBJECT
 
@@ -25,6 +39,19 @@ private:
         QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
     }
 
+    QCoro::Task<> testDoesntAddChildrenToSocket_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        const auto children = socket.children().size();
+        QTimer::singleShot(10ms, [&socket]() mutable {
+            socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        });
+
+        co_await qCoro(socket).waitForConnected();
+
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+        QCORO_COMPARE(socket.children().size(), children);
+    }
+
     QCoro::Task<> testWaitForDisconnectedTriggers_coro(QCoro::TestContext) {
         QLocalSocket socket;
         socket.connectToServer(QCoroLocalSocketTest::getSocketName());
@@ -112,6 +139,24 @@ private:
         QCORO_VERIFY(!data.isEmpty());
     }
 
+    QCoro::Task<> testReadAllTriggersWithDirectResume_coro(QCoro::TestContext) {
+        const QCoro::ScopedResumePolicy policy{QCoro::ResumePolicy::Direct};
+
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        QByteArray data;
+        while (socket.state() == QLocalSocket::ConnectedState) {
+            data += co_await qCoro(socket).readAll();
+        }
+        data += socket.readAll(); // read what's left in the buffer
+
+        QCORO_VERIFY(!data.isEmpty());
+    }
+
     QCoro::Task<> testReadTriggers_coro(QCoro::TestContext) {
         QLocalSocket socket;
         socket.connectToServer(QCoroLocalSocketTest::getSocketName());
@@ -129,6 +174,191 @@ private:
         QCORO_VERIFY(!data.isEmpty());
     }
 
+    QCoro::Task<> testReadIntoTriggers_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        std::array<std::byte, 16> buffer;
+        QByteArray data;
+        while (socket.state() == QLocalSocket::ConnectedState) {
+            const auto read = co_await qCoro(socket).readInto(buffer);
+            QCORO_VERIFY(read >= 0);
+            QCORO_VERIFY(read <= static_cast<qint64>(buffer.size()));
+            data.append(reinterpret_cast<const char *>(buffer.data()), read);
+        }
+        QCORO_VERIFY(!data.isEmpty());
+        data += socket.readAll(); // read what's left in the buffer
+
+        QCORO_VERIFY(!data.isEmpty());
+    }
+
+    QCoro::Task<> testReadWithTimeoutTimesOut_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /block HTTP/1.1\r\n");
+
+        const auto data = co_await QCoro::withTimeout(qCoro(socket).readAll(), 50ms);
+        QCORO_VERIFY(!data.has_value());
+
+        // The timed out read must not consume the response
+        QByteArray response;
+        while (socket.state() == QLocalSocket::ConnectedState) {
+            response += co_await qCoro(socket).readAll();
+        }
+        response += socket.readAll();
+        QCORO_VERIFY(response.endsWith("abcdef"));
+    }
+
+    QCoro::Task<> testReadWithTimeoutReturnsData_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        const auto data = co_await QCoro::withTimeout(qCoro(socket).readAll(), 5s);
+        QCORO_VERIFY(data.has_value());
+        QCORO_VERIFY(!data->isEmpty());
+    }
+
+    QCoro::Task<> testBytesAvailableTriggers_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        // The response headers alone are shorter than this, so the coroutine must stay
+        // suspended until a few lines of the streamed body have arrived as well.
+        const auto available = co_await qCoro(socket).bytesAvailable(100);
+        QCORO_VERIFY(available >= 100);
+        QCORO_COMPARE(socket.bytesAvailable(), available);
+    }
+
+    QCoro::Task<> testBytesAvailableDoesntBlockOnDisconnect_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        // More than the server will ever send
+        const auto available = co_await qCoro(socket).bytesAvailable(1'000'000);
+        QCORO_VERIFY(available < 1'000'000);
+        QCORO_COMPARE(socket.state(), QLocalSocket::UnconnectedState);
+    }
+
+    QCoro::Task<> testConcurrentReadsTrigger_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        const auto reader = [](QLocalSocket &socket) -> QCoro::Task<QByteArray> {
+            co_return co_await qCoro(socket).readAll();
+        };
+        // Both readers wait on the same socket and are woken up by the same readyRead()
+        // in the order in which they started waiting, so the first one gets all the data.
+        auto firstReader = reader(socket);
+        auto secondReader = reader(socket);
+        const auto [first, second] =
+            co_await QCoro::whenAll(std::move(firstReader), std::move(secondReader));
+        QCORO_VERIFY(!first.isEmpty());
+        QCORO_VERIFY(second.isEmpty());
+    }
+
+    QCoro::Task<> testConcurrentReaderDestroyedWithDirectResume_coro(QCoro::TestContext) {
+        const QCoro::ScopedResumePolicy policy{QCoro::ResumePolicy::Direct};
+
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        // Both readers are woken up by the same readyRead(), the one that is resumed first
+        // destroys the other one, which must not be resumed anymore.
+        int reads = 0;
+        QCoro::DestroyableCoroutine first;
+        QCoro::DestroyableCoroutine second;
+        first = readAndDestroy(socket, second, reads);
+        second = readAndDestroy(socket, first, reads);
+        while (reads == 0) {
+            co_await QCoro::sleepFor(10ms);
+        }
+        co_await QCoro::sleepFor(10ms);
+
+        QCORO_COMPARE(reads, 1);
+    }
+
+    QCoro::Task<> testVectoredWriteTriggers_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        const QList<QByteArray> request = {"GET ", "/stream ", "HTTP/1.1\r\n"};
+        const auto written = co_await qCoro(socket).write(request);
+        QCORO_COMPARE(written, qint64(22));
+        QCORO_COMPARE(socket.bytesToWrite(), qint64(0));
+
+        // The server only responds if it has received the complete request
+        QByteArray data;
+        while (socket.state() == QLocalSocket::ConnectedState) {
+            data += co_await qCoro(socket).readAll();
+        }
+        data += socket.readAll();
+        QCORO_VERIFY(data.startsWith("HTTP/1.1 200 OK"));
+    }
+
+    QCoro::Task<> testWaitForWritableDoesntSuspendBelowHighWater_coro(QCoro::TestContext ctx) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        ctx.setShouldNotSuspend();
+        socket.write("GET /stream HTTP/1.1\r\n");
+        const bool writable = co_await qCoro(socket).waitForWritable(1024, 0);
+        QCORO_VERIFY(writable);
+    }
+
+    QCoro::Task<> testWaitForWritableTriggers_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+        QCORO_VERIFY(socket.bytesToWrite() > 0);
+        const bool writable = co_await qCoro(socket).waitForWritable(0, 0);
+        QCORO_VERIFY(writable);
+        QCORO_COMPARE(socket.bytesToWrite(), qint64(0));
+    }
+
+    QCoro::Task<> testReadChunksYieldsAllData_coro(QCoro::TestContext) {
+        QLocalSocket socket;
+        socket.connectToServer(QCoroLocalSocketTest::getSocketName());
+        QCORO_COMPARE(socket.state(), QLocalSocket::ConnectedState);
+
+        socket.write("GET /stream HTTP/1.1\r\n");
+
+        QByteArray data;
+        int chunks = 0;
+        QCORO_FOREACH(const QByteArray &chunk, qCoro(socket).readChunks(16)) {
+            QCORO_VERIFY(!chunk.isEmpty());
+            QCORO_VERIFY(chunk.size() <= 16);
+            data += chunk;
+            ++chunks;
+        }
+        QCORO_VERIFY(chunks > 1);
+        QCORO_VERIFY(data.startsWith("HTTP/1.1 200 OK"));
+        QCORO_VERIFY(data.endsWith("Hola 9\n"));
+    }
+
     QCoro::Task<> testReadLineTriggers_coro(QCoro::TestContext) {
         QLocalSocket socket;
         socket.connectToServer(QCoroLocalSocketTest::getSocketName());
@@ -158,6 +388,7 @@ private Q_SLOTS:
 
     addTest(WaitForConnectedTriggers)
     addTest(WaitForConnectedTimeout)
+    addTest(DoesntAddChildrenToSocket)
     addTest(WaitForDisconnectedTriggers)
     addTest(WaitForDisconnectedTimeout)
     addTest(DoesntCoAwaitConnectedSocket)
@@ -165,7 +396,19 @@ private Q_SLOTS:
     addTest(ConnectToServerWithArgs)
     addTest(ConnectToServer)
     addTest(ReadAllTriggers)
+    addTest(ReadAllTriggersWithDirectResume)
     addTest(ReadTriggers)
+    addTest(ReadIntoTriggers)
+    addTest(ReadWithTimeoutTimesOut)
+    addTest(ReadWithTimeoutReturnsData)
+    addTest(BytesAvailableTriggers)
+    addTest(BytesAvailableDoesntBlockOnDisconnect)
+    addTest(ConcurrentReadsTrigger)
+    addTest(ConcurrentReaderDestroyedWithDirectResume)
+    addTest(VectoredWriteTriggers)
+    addTest(WaitForWritableDoesntSuspendBelowHighWater)
+    addTest(WaitForWritableTriggers)
+    addTest(ReadChunksYieldsAllData)
     addTest(ReadLineTriggers)
 
 private:
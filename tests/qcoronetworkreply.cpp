@@ -61,6 +61,25 @@ private:
         QCORO_COMPARE(lines.size(), 10);
     }
 
+    QCoro::Task<> testReadBodyStreamsBoundedChunks_coro(QCoro::TestContext) {
+        QNetworkAccessManager nam;
+
+        auto *reply = nam.get(
+            QNetworkRequest{QStringLiteral("http://127.0.0.1:%1/stream").arg(mServer.port())});
+
+        QByteArray data;
+        QCORO_FOREACH(const QByteArray &chunk, qCoro(reply).readBody(8)) {
+            QCORO_VERIFY(!chunk.isEmpty());
+            QCORO_VERIFY(chunk.size() <= 8);
+            data += chunk;
+        }
+
+        QCORO_COMPARE(reply->readBufferSize(), qint64{8});
+        QCORO_VERIFY(reply->isFinished());
+        QCORO_COMPARE(reply->error(), QNetworkReply::NoError);
+        QCORO_COMPARE(data.size(), reply->rawHeader("Content-Length").toInt());
+    }
+
 private Q_SLOTS:
     void init() {
         mServer.start(QHostAddress::LocalHost);
@@ -73,6 +92,7 @@ private Q_SLOTS:
     addTest(ReadAllTriggers)
     addTest(ReadTriggers)
     addTest(ReadLineTriggers)
+    addTest(ReadBodyStreamsBoundedChunks)
 
 private:
     TestHttpServer<QTcpServer> mServer;
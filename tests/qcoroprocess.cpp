@@ -9,6 +9,14 @@ class QCoroProcessTest : public QCoro::TestObject<QCoroProcessTest> {
     Q_OBJECT
 
 private:
+    static QCoro::Task<QByteArray> collect(QCoro::AsyncGenerator<QByteArray> chunks) {
+        QByteArray data;
+        QCORO_FOREACH(const QByteArray &chunk, chunks) {
+            data += chunk;
+        }
+        co_return data;
+    }
+
     QCoro::Task<> testStartTriggers_coro(QCoro::TestContext) {
         QProcess process;
 
@@ -102,6 +110,31 @@ private:
         process.waitForFinished();
     }
 
+    QCoro::Task<> testReadsChannelsConcurrently_coro(QCoro::TestContext) {
+        const QStringList arguments{
+            QStringLiteral("-c"),
+            QStringLiteral("echo out1; echo err1 >&2; sleep 0.1; echo out2; echo err2 >&2")};
+        QProcess process;
+        co_await qCoro(process).start(QStringLiteral("sh"), arguments);
+        QCORO_COMPARE(process.state(), QProcess::Running);
+
+        auto output = collect(qCoro(process).readStandardOutputChunks());
+        auto error = collect(qCoro(process).readStandardErrorChunks());
+
+        QCORO_COMPARE(co_await output, QByteArray{"out1\nout2\n"});
+        QCORO_COMPARE(co_await error, QByteArray{"err1\nerr2\n"});
+        QCORO_COMPARE(process.readChannel(), QProcess::StandardOutput);
+    }
+
+    QCoro::Task<> testChannelStreamEndsWhenProcessFailsToStart_coro(QCoro::TestContext) {
+        QProcess process;
+        process.start(QStringLiteral("qcoro-nonexistent-program"), {});
+
+        const auto output = co_await collect(qCoro(process).readStandardOutputChunks());
+        QCORO_VERIFY(output.isEmpty());
+        QCORO_COMPARE(process.state(), QProcess::NotRunning);
+    }
+
 private Q_SLOTS:
     addTest(StartTriggers)
     addTest(StartNoArgsTriggers)
@@ -110,6 +143,8 @@ private Q_SLOTS:
     addTest(FinishTriggers)
     addTest(FinishDoesntCoAwaitFinishedProcess)
     addTest(FinishCoAwaitTimeout)
+    addTest(ReadsChannelsConcurrently)
+    addTest(ChannelStreamEndsWhenProcessFailsToStart)
 };
 
 QTEST_GUILESS_MAIN(QCoroProcessTest)
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/processpool.h"
+#include "qcoro/timer.h"
+
+#include <QProcess>
+
+using namespace std::chrono_literals;
+
+class QCoroProcessPoolTest : public QCoro::TestObject<QCoroProcessPoolTest> {
+    Q_OBJECT
+
+private:
+    //! Sends a job to a `cat` worker and returns the echoed reply.
+    static QCoro::Task<QByteArray> echo(QProcess *worker, const QByteArray &job) {
+        co_await qCoro(worker).write(job + "\n");
+        co_return co_await qCoro(worker).readUntil("\n");
+    }
+
+    QCoro::Task<> testReusesProcess_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("cat")};
+
+        QProcess *process = nullptr;
+        {
+            auto worker = co_await pool.acquire();
+            QCORO_VERIFY(worker);
+            QCORO_COMPARE(worker->state(), QProcess::Running);
+            QCORO_COMPARE(co_await echo(worker.process(), "first"), QByteArray{"first\n"});
+            process = worker.process();
+            QCORO_COMPARE(pool.activeCount(), std::size_t{1});
+        }
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        auto worker = co_await pool.acquire();
+        QCORO_COMPARE(worker.process(), process);
+        QCORO_COMPARE(co_await echo(worker.process(), "second"), QByteArray{"second\n"});
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testLimitsProcesses_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("cat"), {}, 1};
+
+        auto first = co_await pool.acquire();
+        QCORO_VERIFY(first);
+
+        auto second = pool.acquire();
+        QCORO_VERIFY(!second.isReady());
+
+        auto *process = first.process();
+        first.release();
+
+        auto worker = co_await std::move(second);
+        QCORO_COMPARE(worker.process(), process);
+        QCORO_COMPARE(pool.activeCount(), std::size_t{1});
+    }
+
+    QCoro::Task<> testDoesntReuseExitedProcess_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("cat")};
+
+        {
+            auto worker = co_await pool.acquire();
+            QCORO_VERIFY(worker);
+            worker->closeWriteChannel();
+            QCORO_VERIFY(co_await qCoro(worker.process()).waitForFinished(10s));
+        }
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testDiscardedProcessIsNotReused_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("cat")};
+
+        {
+            auto worker = co_await pool.acquire();
+            QCORO_VERIFY(worker);
+            worker.discard();
+        }
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testFailsToStart_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("qcoro-nonexistent-program")};
+
+        auto worker = co_await pool.acquire();
+        QCORO_VERIFY(!worker);
+        QCORO_COMPARE(pool.activeCount(), std::size_t{0});
+    }
+
+    QCoro::Task<> testIdleTimeout_coro(QCoro::TestContext) {
+        QCoro::ProcessPool pool{QStringLiteral("cat")};
+        pool.setIdleTimeout(100ms);
+
+        {
+            auto worker = co_await pool.acquire();
+            QCORO_VERIFY(worker);
+        }
+        QCORO_COMPARE(pool.idleCount(), std::size_t{1});
+
+        co_await QCoro::sleepFor(500ms);
+        QCORO_COMPARE(pool.idleCount(), std::size_t{0});
+    }
+
+private Q_SLOTS:
+    addTest(ReusesProcess)
+    addTest(LimitsProcesses)
+    addTest(DoesntReuseExitedProcess)
+    addTest(DiscardedProcessIsNotReused)
+    addTest(FailsToStart)
+    addTest(IdleTimeout)
+};
+
+QTEST_GUILESS_MAIN(QCoroProcessPoolTest)
+
+#include "qcoroprocesspool.moc"
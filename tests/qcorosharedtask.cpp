@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/sharedtask.h"
+#include "qcoro/timer.h"
+#include "qcoro/whenall.h"
+
+#include <stdexcept>
+
+namespace {
+
+QCoro::SharedTask<QString> delayedValue(int &runs, std::chrono::milliseconds delay) {
+    ++runs;
+    QTimer timer;
+    timer.start(delay);
+    co_await timer;
+    co_return QStringLiteral("value");
+}
+
+QCoro::SharedTask<> delayedVoid(int &runs) {
+    ++runs;
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+}
+
+QCoro::SharedTask<int> delayedThrow() {
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    throw std::runtime_error("Expected exception");
+}
+
+QCoro::Task<QString> consume(QCoro::SharedTask<QString> task) {
+    const QString &value = co_await task;
+    co_return value;
+}
+
+QCoro::DestroyableCoroutine awaitAndDestroy(QCoro::SharedTask<QString> task,
+                                            QCoro::DestroyableCoroutine &other, int &resumed) {
+    co_await task;
+    ++resumed;
+    other.destroy();
+}
+
+} // namespace
+
+class QCoroSharedTaskTest : public QCoro::TestObject<QCoroSharedTaskTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testResumesAllAwaiters_coro(QCoro::TestContext) {
+        int runs = 0;
+        const auto task = delayedValue(runs, 50ms);
+
+        const auto [first, second, third] =
+            co_await QCoro::whenAll(consume(task), consume(task), consume(task));
+
+        QCORO_COMPARE(runs, 1);
+        QCORO_COMPARE(first, QStringLiteral("value"));
+        QCORO_COMPARE(second, QStringLiteral("value"));
+        QCORO_COMPARE(third, QStringLiteral("value"));
+    }
+
+    QCoro::Task<> testMemoizesResult_coro(QCoro::TestContext ctx) {
+        int runs = 0;
+        const auto task = delayedValue(runs, 10ms);
+        const QString &value = co_await task;
+        QCORO_VERIFY(task.isReady());
+
+        ctx.setShouldNotSuspend();
+        const QString &again = co_await task;
+        QCORO_COMPARE(runs, 1);
+        QCORO_COMPARE(&again, &value);
+        QCORO_COMPARE(&task.result(), &value);
+    }
+
+    QCoro::Task<> testVoidResult_coro(QCoro::TestContext) {
+        int runs = 0;
+        const auto task = delayedVoid(runs);
+        co_await QCoro::whenAll(task, task);
+        co_await task;
+        QCORO_COMPARE(runs, 1);
+    }
+
+    QCoro::Task<> testRethrowsToAllAwaiters_coro(QCoro::TestContext) {
+        const auto task = delayedThrow();
+        int caught = 0;
+        for (int i = 0; i < 2; ++i) {
+            try {
+                co_await task;
+            } catch (const std::runtime_error &) {
+                ++caught;
+            }
+        }
+        QCORO_COMPARE(caught, 2);
+    }
+
+    QCoro::Task<> testOutlivesReleasedTask_coro(QCoro::TestContext) {
+        int runs = 0;
+        // Nobody holds the task, the coroutine must finish on its own
+        delayedValue(runs, 10ms);
+
+        QTimer timer;
+        timer.start(50ms);
+        co_await timer;
+        QCORO_COMPARE(runs, 1);
+    }
+
+    QCoro::Task<> testDoesntResumeDestroyedAwaiters_coro(QCoro::TestContext) {
+        int runs = 0;
+        const auto task = delayedValue(runs, 10ms);
+
+        // The awaiter that is resumed first destroys the other one
+        int resumed = 0;
+        QCoro::DestroyableCoroutine first;
+        QCoro::DestroyableCoroutine second;
+        first = awaitAndDestroy(task, second, resumed);
+        second = awaitAndDestroy(task, first, resumed);
+
+        co_await task;
+        QTimer timer;
+        timer.start(10ms);
+        co_await timer;
+        QCORO_COMPARE(resumed, 1);
+    }
+
+private Q_SLOTS:
+    addTest(ResumesAllAwaiters)
+    addTest(MemoizesResult)
+    addTest(VoidResult)
+    addTest(RethrowsToAllAwaiters)
+    addTest(OutlivesReleasedTask)
+    addTest(DoesntResumeDestroyedAwaiters)
+};
+
+QTEST_GUILESS_MAIN(QCoroSharedTaskTest)
+
+#include "qcorosharedtask.moc"
@@ -4,9 +4,12 @@
 
 #include "testobject.h"
 #include "qcoro/coro.h"
+#include "qcoro/timer.h"
 
 #include <QTimer>
 
+#include <thread>
+
 class SignalTest : public QObject {
     Q_OBJECT
 public:
@@ -24,6 +27,13 @@ Q_SIGNALS:
     void multiArg(const QString &value, int number, QObject *ptr);
 };
 
+class ValueEmitter : public QObject {
+    Q_OBJECT
+Q_SIGNALS:
+    void valueChanged(int value);
+    void pairChanged(const QString &key, int value);
+};
+
 class QCoroSignalTest : public QCoro::TestObject<QCoroSignalTest> {
     Q_OBJECT
 
@@ -56,10 +66,180 @@ private:
         QCORO_COMPARE(ptr, &obj);
     }
 
+    QCoro::Task<> testResumesQueuedByDefault_coro(QCoro::TestContext) {
+        ValueEmitter obj;
+        bool resumed = false;
+        auto task = [](ValueEmitter *obj, bool *resumed) -> QCoro::Task<int> {
+            const int value = co_await qCoro(obj, &ValueEmitter::valueChanged);
+            *resumed = true;
+            co_return value;
+        }(&obj, &resumed);
+
+        Q_EMIT obj.valueChanged(42);
+        QCORO_VERIFY(!resumed);
+
+        const int value = co_await task;
+        QCORO_VERIFY(resumed);
+        QCORO_COMPARE(value, 42);
+    }
+
+    QCoro::Task<> testResumesDirectlyWithAutoConnection_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        ValueEmitter obj;
+        bool resumed = false;
+        auto task = [](ValueEmitter *obj, bool *resumed) -> QCoro::Task<int> {
+            const int value =
+                co_await qCoro(obj, &ValueEmitter::valueChanged, Qt::AutoConnection);
+            *resumed = true;
+            co_return value;
+        }(&obj, &resumed);
+
+        Q_EMIT obj.valueChanged(42);
+        QCORO_VERIFY(resumed);
+
+        const int value = co_await task;
+        QCORO_COMPARE(value, 42);
+    }
+
+    QCoro::Task<> testResumesDirectlyWithDirectConnection_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        ValueEmitter obj;
+        bool resumed = false;
+        auto task = [](ValueEmitter *obj, bool *resumed) -> QCoro::Task<int> {
+            const int value =
+                co_await qCoro(obj, &ValueEmitter::valueChanged, Qt::DirectConnection);
+            *resumed = true;
+            co_return value;
+        }(&obj, &resumed);
+
+        Q_EMIT obj.valueChanged(42);
+        QCORO_VERIFY(resumed);
+        // Disconnected after the first emission
+        Q_EMIT obj.valueChanged(43);
+
+        const int value = co_await task;
+        QCORO_COMPARE(value, 42);
+    }
+
+    QCoro::Task<> testListenerYieldsAllEmissions_coro(QCoro::TestContext) {
+        auto *obj = new ValueEmitter;
+        auto listener = qCoroSignalListener(obj, &ValueEmitter::valueChanged);
+
+        // Emitted before the loop starts waiting, must be queued.
+        Q_EMIT obj->valueChanged(1);
+        Q_EMIT obj->valueChanged(2);
+        QTimer::singleShot(10ms, obj, [obj]() {
+            Q_EMIT obj->valueChanged(3);
+            Q_EMIT obj->valueChanged(4);
+            obj->deleteLater();
+        });
+
+        QList<int> values;
+        QCORO_FOREACH(int value, listener) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values, (QList<int>{1, 2, 3, 4}));
+    }
+
+    QCoro::Task<> testListenerYieldsTuple_coro(QCoro::TestContext) {
+        auto *obj = new ValueEmitter;
+        auto listener = qCoroSignalListener(obj, &ValueEmitter::pairChanged);
+        static_assert(std::is_same_v<decltype(listener),
+                                     QCoro::AsyncGenerator<std::tuple<QString, int>>>);
+
+        QTimer::singleShot(10ms, obj, [obj]() {
+            Q_EMIT obj->pairChanged(QStringLiteral("answer"), 42);
+            obj->deleteLater();
+        });
+
+        QList<std::tuple<QString, int>> values;
+        QCORO_FOREACH(const auto &value, listener) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values.size(), 1);
+        QCORO_COMPARE(std::get<0>(values[0]), QStringLiteral("answer"));
+        QCORO_COMPARE(std::get<1>(values[0]), 42);
+    }
+
+    QCoro::Task<> testListenerDropsOldestWhenQueueFull_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        auto *obj = new ValueEmitter;
+        auto listener = qCoroSignalListener(obj, &ValueEmitter::valueChanged, 2);
+        for (int i = 0; i < 5; ++i) {
+            Q_EMIT obj->valueChanged(i);
+        }
+        delete obj;
+
+        QList<int> values;
+        QCORO_FOREACH(int value, listener) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values, (QList<int>{3, 4}));
+    }
+
+    QCoro::Task<> testListenerYieldsEmissionsFromOtherThread_coro(QCoro::TestContext) {
+        auto *obj = new ValueEmitter;
+        auto listener = qCoroSignalListener(obj, &ValueEmitter::valueChanged);
+
+        // The emissions are delivered to the consumer's thread, in the order of emission
+        std::thread thread{[obj]() {
+            for (int i = 0; i < 100; ++i) {
+                Q_EMIT obj->valueChanged(i);
+            }
+        }};
+        thread.join();
+        obj->deleteLater();
+
+        QList<int> values;
+        QCORO_FOREACH(int value, listener) {
+            values.push_back(value);
+        }
+        QCORO_COMPARE(values.size(), 100);
+        for (int i = 0; i < 100; ++i) {
+            QCORO_COMPARE(values[i], i);
+        }
+    }
+
+    QCoro::Task<> testListenerDropsPendingEmissionsWhenDestroyed_coro(QCoro::TestContext) {
+        ValueEmitter obj;
+        {
+            auto listener = qCoroSignalListener(&obj, &ValueEmitter::valueChanged);
+            std::thread thread{[&obj]() { Q_EMIT obj.valueChanged(42); }};
+            thread.join();
+        }
+
+        // Delivering the emission queued for the destroyed listener must not touch it
+        co_await QCoro::sleepFor(10ms);
+    }
+
+    QCoro::Task<> testListenerFinishesWhenSenderDestroyed_coro(QCoro::TestContext) {
+        auto *obj = new ValueEmitter;
+        QTimer::singleShot(10ms, obj, &QObject::deleteLater);
+
+        int count = 0;
+        QCORO_FOREACH(int value, qCoroSignalListener(obj, &ValueEmitter::valueChanged)) {
+            Q_UNUSED(value);
+            ++count;
+        }
+        QCORO_COMPARE(count, 0);
+    }
+
 private Q_SLOTS:
     addTest(Triggers)
     addTest(ReturnsValue)
     addTest(ReturnsTuple)
+    addTest(ResumesQueuedByDefault)
+    addTest(ResumesDirectlyWithAutoConnection)
+    addTest(ResumesDirectlyWithDirectConnection)
+    addTest(ListenerYieldsAllEmissions)
+    addTest(ListenerYieldsTuple)
+    addTest(ListenerDropsOldestWhenQueueFull)
+    addTest(ListenerYieldsEmissionsFromOtherThread)
+    addTest(ListenerDropsPendingEmissionsWhenDestroyed)
+    addTest(ListenerFinishesWhenSenderDestroyed)
 };
 
 QTEST_GUILESS_MAIN(QCoroSignalTest)
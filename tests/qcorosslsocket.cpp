@@ -0,0 +1,178 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/coro.h"
+
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//! A plain TCP server, replies to the TLS handshake with \c reply, if any.
+class Server {
+public:
+    explicit Server(QByteArray reply = {}) : mReply(std::move(reply)) {
+        mServer.listen(QHostAddress::LocalHost);
+        QObject::connect(&mServer, &QTcpServer::newConnection, [this]() {
+            while (auto *socket = mServer.nextPendingConnection()) {
+                mConnections.emplace_back(socket);
+                if (!mReply.isEmpty()) {
+                    QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                        socket->readAll();
+                        socket->write(mReply);
+                        socket->disconnectFromHost();
+                    });
+                }
+            }
+        });
+    }
+
+    quint16 port() const {
+        return mServer.serverPort();
+    }
+
+private:
+    QTcpServer mServer;
+    QByteArray mReply;
+    std::vector<std::unique_ptr<QTcpSocket>> mConnections;
+};
+
+} // namespace
+
+class QCoroSslSocketTest : public QCoro::TestObject<QCoroSslSocketTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testDoesntCoAwaitUnconnectedSocket_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QSslSocket socket;
+        QCORO_VERIFY(!co_await qCoro(socket).waitForEncrypted());
+    }
+
+    QCoro::Task<> testHandshakeFailure_coro(QCoro::TestContext) {
+        Server server{"HTTP/1.1 400 Bad Request\r\n\r\n"};
+
+        QSslSocket socket;
+        const bool encrypted = co_await qCoro(socket).connectToHostEncrypted(
+            QStringLiteral("127.0.0.1"), server.port());
+        QCORO_VERIFY(!encrypted);
+        QCORO_VERIFY(!socket.isEncrypted());
+    }
+
+    QCoro::Task<> testWaitForEncryptedTimeout_coro(QCoro::TestContext) {
+        Server server;
+
+        QSslSocket socket;
+        socket.connectToHostEncrypted(QStringLiteral("127.0.0.1"), server.port());
+        QCORO_VERIFY(!co_await qCoro(socket).waitForEncrypted(200ms));
+        QCORO_VERIFY(!socket.isEncrypted());
+        QCORO_VERIFY(socket.state() != QAbstractSocket::UnconnectedState);
+    }
+
+    QCoro::Task<> testSessionCacheLookup_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::SslSessionCache cache;
+        QCORO_VERIFY(cache.sessionTicket(QStringLiteral("example.com"), 443).isEmpty());
+
+        cache.insert(QStringLiteral("example.com"), 443, "ticket1");
+        cache.insert(QStringLiteral("example.com"), 8443, "ticket2");
+        QCORO_COMPARE(cache.size(), std::size_t{2});
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("example.com"), 443),
+                      QByteArray{"ticket1"});
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("example.com"), 8443),
+                      QByteArray{"ticket2"});
+
+        cache.insert(QStringLiteral("example.com"), 443, "ticket3");
+        QCORO_COMPARE(cache.size(), std::size_t{2});
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("example.com"), 443),
+                      QByteArray{"ticket3"});
+
+        cache.insert(QStringLiteral("example.com"), 443, {});
+        QCORO_VERIFY(cache.sessionTicket(QStringLiteral("example.com"), 443).isEmpty());
+        QCORO_COMPARE(cache.size(), std::size_t{1});
+
+        cache.clear();
+        QCORO_COMPARE(cache.size(), std::size_t{0});
+    }
+
+    QCoro::Task<> testSessionCacheEvictsLeastRecentlyUsed_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::SslSessionCache cache;
+        cache.setCapacity(2);
+        cache.insert(QStringLiteral("a.example.com"), 443, "a");
+        cache.insert(QStringLiteral("b.example.com"), 443, "b");
+        // Makes "b" the least recently used one
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("a.example.com"), 443), QByteArray{"a"});
+        cache.insert(QStringLiteral("c.example.com"), 443, "c");
+
+        QCORO_COMPARE(cache.size(), std::size_t{2});
+        QCORO_VERIFY(cache.sessionTicket(QStringLiteral("b.example.com"), 443).isEmpty());
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("a.example.com"), 443), QByteArray{"a"});
+        QCORO_COMPARE(cache.sessionTicket(QStringLiteral("c.example.com"), 443), QByteArray{"c"});
+    }
+
+    QCoro::Task<> testPrepareSocketAppliesCachedTicket_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::SslSessionCache cache;
+        cache.insert(QStringLiteral("example.com"), 443, "ticket");
+
+        QSslSocket socket;
+        auto config = socket.sslConfiguration();
+        config.setSslOption(QSsl::SslOptionDisableSessionPersistence, true);
+        socket.setSslConfiguration(config);
+
+        cache.prepareSocket(&socket, QStringLiteral("example.com"), 443);
+        config = socket.sslConfiguration();
+        QCORO_VERIFY(!config.testSslOption(QSsl::SslOptionDisableSessionPersistence));
+        QCORO_COMPARE(config.sessionTicket(), QByteArray{"ticket"});
+    }
+
+    QCoro::Task<> testUnverifiedSessionIsNotReusable_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QSslSocket socket;
+        socket.setPeerVerifyMode(QSslSocket::VerifyNone);
+        QCORO_VERIFY(!QCoro::SslSessionCache::isReusable(&socket));
+
+        socket.setPeerVerifyMode(QSslSocket::VerifyPeer);
+        QCORO_VERIFY(QCoro::SslSessionCache::isReusable(&socket));
+    }
+
+    QCoro::Task<> testGlobalSessionCacheIsOptIn_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCORO_VERIFY(!QCoro::SslSessionCache::global().isEnabled());
+    }
+
+private Q_SLOTS:
+    void initTestCase() {
+        if (!QSslSocket::supportsSsl()) {
+            QSKIP("TLS is not supported");
+        }
+    }
+
+    addTest(DoesntCoAwaitUnconnectedSocket)
+    addTest(HandshakeFailure)
+    addTest(WaitForEncryptedTimeout)
+    addTest(SessionCacheLookup)
+    addTest(SessionCacheEvictsLeastRecentlyUsed)
+    addTest(PrepareSocketAppliesCachedTicket)
+    addTest(UnverifiedSessionIsNotReusable)
+    addTest(GlobalSessionCacheIsOptIn)
+};
+
+QTEST_GUILESS_MAIN(QCoroSslSocketTest)
+
+#include "qcorosslsocket.moc"
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/coro.h"
+#include "qcoro/lazytask.h"
+#include "qcoro/stats.h"
+#include "qcoro/timer.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+QCoro::LazyTask<> lazyNoop() {
+    co_return;
+}
+
+QCoro::Task<> timerTask() {
+    QTimer timer;
+    timer.start(20ms);
+    co_await timer;
+}
+
+QCoro::Task<> awaitTask(QCoro::Task<> &task) {
+    co_await task;
+}
+
+QCoro::Task<bool> waitForConnection(QTcpServer *server) {
+    co_return co_await qCoro(server).waitForNewConnection(10s);
+}
+
+} // namespace
+
+class QCoroStatsTest : public QCoro::TestObject<QCoroStatsTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testCountsSuspendedAwaits_coro(QCoro::TestContext) {
+        const auto before = QCoro::stats();
+
+        auto timer = timerTask();
+        auto waiter = awaitTask(timer);
+        auto stats = QCoro::stats();
+        QCORO_COMPARE(stats.suspended(QCoro::AwaiterKind::Timer),
+                      before.suspended(QCoro::AwaiterKind::Timer) + 1);
+        QCORO_COMPARE(stats.suspended(QCoro::AwaiterKind::Task),
+                      before.suspended(QCoro::AwaiterKind::Task) + 1);
+
+        co_await waiter;
+
+        stats = QCoro::stats();
+        QCORO_COMPARE(stats.suspended(QCoro::AwaiterKind::Timer),
+                      before.suspended(QCoro::AwaiterKind::Timer));
+        const auto &durations = stats.suspendDuration(QCoro::AwaiterKind::Timer);
+        const auto &durationsBefore = before.suspendDuration(QCoro::AwaiterKind::Timer);
+        QCORO_COMPARE(durations.count, durationsBefore.count + 1);
+        QCORO_VERIFY(durations.sum - durationsBefore.sum >= 10ms);
+        // 20ms falls into the (10ms, 100ms] bucket
+        QCORO_COMPARE(durations.buckets[4], durationsBefore.buckets[4] + 1);
+    }
+
+    QCoro::Task<> testCountsActiveTimeouts_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost));
+        const auto before = QCoro::stats();
+
+        auto wait = waitForConnection(&server);
+        auto stats = QCoro::stats();
+        QCORO_COMPARE(stats.activeTimeouts, before.activeTimeouts + 1);
+        QCORO_COMPARE(stats.suspended(QCoro::AwaiterKind::WaitFor),
+                      before.suspended(QCoro::AwaiterKind::WaitFor) + 1);
+
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, server.serverPort());
+        QCORO_VERIFY(co_await wait);
+
+        stats = QCoro::stats();
+        QCORO_COMPARE(stats.activeTimeouts, before.activeTimeouts);
+        QCORO_COMPARE(stats.suspended(QCoro::AwaiterKind::WaitFor),
+                      before.suspended(QCoro::AwaiterKind::WaitFor));
+    }
+
+private Q_SLOTS:
+    addTest(CountsSuspendedAwaits)
+    addTest(CountsActiveTimeouts)
+
+    void testCountsLiveFrames() {
+        const auto before = QCoro::stats();
+        {
+            [[maybe_unused]] const auto task = lazyNoop();
+            const auto stats = QCoro::stats();
+            QCOMPARE(stats.liveFrames, before.liveFrames + 1);
+            QVERIFY(stats.frameBytes > before.frameBytes);
+        }
+        const auto stats = QCoro::stats();
+        QCOMPARE(stats.liveFrames, before.liveFrames);
+        QCOMPARE(stats.frameBytes, before.frameBytes);
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroStatsTest)
+
+#include "qcorostats.moc"
@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/event.h"
+#include "qcoro/mutex.h"
+#include "qcoro/semaphore.h"
+#include "qcoro/timeout.h"
+#include "qcoro/timer.h"
+#include "qcoro/whenall.h"
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+QCoro::Task<> lockAndRecord(QCoro::Mutex &mutex, std::vector<int> &log, int id) {
+    const auto locker = co_await mutex.scopedLock();
+    log.push_back(id);
+    co_await QCoro::sleepFor(10ms);
+    log.push_back(id);
+}
+
+QCoro::Task<> acquireAndCount(QCoro::Semaphore &semaphore, int &running, int &maxRunning) {
+    co_await semaphore.acquire();
+    ++running;
+    maxRunning = std::max(maxRunning, running);
+    co_await QCoro::sleepFor(10ms);
+    --running;
+    semaphore.release();
+}
+
+QCoro::Task<> waitAndCount(QCoro::Event &event, int &finished) {
+    co_await event.wait();
+    ++finished;
+}
+
+QCoro::DestroyableCoroutine waitAndDestroy(QCoro::Event &event,
+                                           QCoro::DestroyableCoroutine &other, int &resumed) {
+    co_await event.wait();
+    ++resumed;
+    other.destroy();
+}
+
+} // namespace
+
+class QCoroSynchronizationTest : public QCoro::TestObject<QCoroSynchronizationTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testMutexSerializesCoroutines_coro(QCoro::TestContext) {
+        QCoro::Mutex mutex;
+        std::vector<int> log;
+
+        co_await QCoro::whenAll(lockAndRecord(mutex, log, 1), lockAndRecord(mutex, log, 2),
+                                lockAndRecord(mutex, log, 3));
+
+        QCORO_COMPARE(log, (std::vector<int>{1, 1, 2, 2, 3, 3}));
+        QCORO_VERIFY(!mutex.isLocked());
+    }
+
+    QCoro::Task<> testMutexDoesntSuspendWhenUnlocked_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QCoro::Mutex mutex;
+        co_await mutex.lock();
+        QCORO_VERIFY(mutex.isLocked());
+        QCORO_VERIFY(!mutex.tryLock());
+        mutex.unlock();
+        QCORO_VERIFY(!mutex.isLocked());
+    }
+
+    QCoro::Task<> testMutexLockTimesOut_coro(QCoro::TestContext) {
+        QCoro::Mutex mutex;
+        QCORO_VERIFY(mutex.tryLock());
+
+        const auto locker = co_await QCoro::withTimeout(mutex.scopedLock(), 50ms);
+        QCORO_VERIFY(!locker.has_value());
+
+        // The cancelled waiter must not receive the mutex
+        mutex.unlock();
+        QCORO_VERIFY(!mutex.isLocked());
+    }
+
+    QCoro::Task<> testSemaphoreLimitsConcurrency_coro(QCoro::TestContext) {
+        QCoro::Semaphore semaphore{2};
+        int running = 0;
+        int maxRunning = 0;
+
+        std::vector<QCoro::Task<>> tasks;
+        for (int i = 0; i < 5; ++i) {
+            tasks.push_back(acquireAndCount(semaphore, running, maxRunning));
+        }
+        co_await QCoro::whenAll(std::move(tasks));
+
+        QCORO_COMPARE(maxRunning, 2);
+        QCORO_COMPARE(semaphore.available(), std::size_t{2});
+    }
+
+    QCoro::Task<> testManualResetEventResumesAll_coro(QCoro::TestContext) {
+        QCoro::Event event;
+        int finished = 0;
+        auto first = waitAndCount(event, finished);
+        auto second = waitAndCount(event, finished);
+        QCORO_COMPARE(finished, 0);
+
+        event.set();
+        co_await QCoro::whenAll(first, second);
+        QCORO_COMPARE(finished, 2);
+        QCORO_VERIFY(event.isSet());
+
+        co_await waitAndCount(event, finished);
+        QCORO_COMPARE(finished, 3);
+    }
+
+    QCoro::Task<> testAutoResetEventResumesOne_coro(QCoro::TestContext) {
+        QCoro::Event event{QCoro::Event::Mode::AutoReset};
+        int finished = 0;
+        auto first = waitAndCount(event, finished);
+        auto second = waitAndCount(event, finished);
+
+        event.set();
+        co_await first;
+        QCORO_COMPARE(finished, 1);
+        QCORO_VERIFY(!event.isSet());
+
+        event.set();
+        co_await second;
+        QCORO_COMPARE(finished, 2);
+    }
+
+    QCoro::Task<> testResumesInWaiterThread_coro(QCoro::TestContext) {
+        QCoro::Event event;
+        std::thread thread{[&event]() {
+            std::this_thread::sleep_for(50ms);
+            event.set();
+        }};
+
+        co_await event.wait();
+        thread.join();
+        QCORO_COMPARE(QThread::currentThread(), QCoreApplication::instance()->thread());
+    }
+
+    QCoro::Task<> resumesOnlyWaitersThatAreAlive(QCoro::ResumePolicy policy) {
+        const QCoro::ScopedResumePolicy scopedPolicy{policy};
+
+        QCoro::Event event;
+        int resumed = 0;
+        QCoro::DestroyableCoroutine first;
+        QCoro::DestroyableCoroutine second;
+        // The waiter that is resumed first destroys the other one
+        first = waitAndDestroy(event, second, resumed);
+        second = waitAndDestroy(event, first, resumed);
+
+        event.set();
+        co_await QCoro::sleepFor(10ms);
+
+        QCORO_COMPARE(resumed, 1);
+    }
+
+    QCoro::Task<> testEventResumesOnlyWaitersThatAreAlive_coro(QCoro::TestContext) {
+        co_await resumesOnlyWaitersThatAreAlive(QCoro::ResumePolicy::Queued);
+    }
+
+    QCoro::Task<> testEventResumesOnlyWaitersThatAreAliveWithDirectResume_coro(
+        QCoro::TestContext) {
+        co_await resumesOnlyWaitersThatAreAlive(QCoro::ResumePolicy::Direct);
+    }
+
+private Q_SLOTS:
+    addTest(MutexSerializesCoroutines)
+    addTest(MutexDoesntSuspendWhenUnlocked)
+    addTest(MutexLockTimesOut)
+    addTest(SemaphoreLimitsConcurrency)
+    addTest(ManualResetEventResumesAll)
+    addTest(AutoResetEventResumesOne)
+    addTest(ResumesInWaiterThread)
+    addTest(EventResumesOnlyWaitersThatAreAlive)
+    addTest(EventResumesOnlyWaitersThatAreAliveWithDirectResume)
+};
+
+QTEST_GUILESS_MAIN(QCoroSynchronizationTest)
+
+#include "qcorosynchronization.moc"
@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/task.h"
+#include "qcoro/timer.h"
+
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+QCoro::Task<> trivialCoroutine() {
+    co_return;
+}
+
+QCoro::Task<int> immediateValue(int value) {
+    co_return value;
+}
+
+QCoro::Task<int> nestedChain(int depth) {
+    if (depth == 0) {
+        QTimer timer;
+        timer.start(10ms);
+        co_await timer;
+        co_return 0;
+    }
+
+    co_return 1 + co_await nestedChain(depth - 1);
+}
+
+//! Counts copies and moves of the result on its way from co_return to co_await.
+struct CopyCounter {
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter &other) : copies(other.copies + 1), moves(other.moves) {}
+    CopyCounter(CopyCounter &&other) noexcept : copies(other.copies), moves(other.moves + 1) {}
+    CopyCounter &operator=(const CopyCounter &) = delete;
+    CopyCounter &operator=(CopyCounter &&) = delete;
+
+    int copies = 0;
+    int moves = 0;
+};
+
+QCoro::Task<CopyCounter> delayedCounter() {
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    co_return CopyCounter{};
+}
+
+QCoro::Task<std::unique_ptr<int>> moveOnlyValue(int value) {
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    auto result = std::make_unique<int>(value);
+    co_return result;
+}
+
+QCoro::Task<int &> referenceTo(int &value) {
+    co_return value;
+}
+
+QCoro::Task<int> delayedThrow() {
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    throw std::runtime_error("Expected exception");
+}
+
+} // namespace
+
+class QCoroTaskTest : public QCoro::TestObject<QCoroTaskTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testAwaitsFinishedTask_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        int sum = 0;
+        for (int i = 0; i < 10; ++i) {
+            sum += co_await immediateValue(i);
+        }
+        QCORO_COMPARE(sum, 45);
+    }
+
+    QCoro::Task<> testResumesNestedChain_coro(QCoro::TestContext) {
+        const int depth = co_await nestedChain(100);
+        QCORO_COMPARE(depth, 100);
+    }
+
+    QCoro::Task<> testMovesResult_coro(QCoro::TestContext) {
+        const auto counter = co_await delayedCounter();
+        QCORO_COMPARE(counter.copies, 0);
+    }
+
+    QCoro::Task<> testLValueAwaitDoesntCopyResult_coro(QCoro::TestContext) {
+        auto task = delayedCounter();
+        const CopyCounter &counter = co_await task;
+        QCORO_COMPARE(counter.copies, 0);
+        const CopyCounter &again = co_await task;
+        QCORO_COMPARE(&again, &counter);
+    }
+
+    QCoro::Task<> testMoveOnlyResult_coro(QCoro::TestContext) {
+        const auto value = co_await moveOnlyValue(42);
+        QCORO_VERIFY(value != nullptr);
+        QCORO_COMPARE(*value, 42);
+    }
+
+    QCoro::Task<> testReferenceResult_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        int value = 1;
+        int &ref = co_await referenceTo(value);
+        ref = 42;
+        QCORO_COMPARE(value, 42);
+    }
+
+    QCoro::Task<> testTrivialResultRethrows_coro(QCoro::TestContext) {
+        bool caught = false;
+        try {
+            co_await delayedThrow();
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        QCORO_VERIFY(caught);
+    }
+
+private Q_SLOTS:
+    addTest(AwaitsFinishedTask)
+    addTest(ResumesNestedChain)
+    addTest(MovesResult)
+    addTest(LValueAwaitDoesntCopyResult)
+    addTest(MoveOnlyResult)
+    addTest(ReferenceResult)
+    addTest(TrivialResultRethrows)
+
+    void testFramesAreRecycled() {
+        // Warm up the pool
+        { [[maybe_unused]] const auto task = trivialCoroutine(); }
+
+        const auto before = QCoro::frameAllocatorStats();
+        for (int i = 0; i < 10; ++i) {
+            [[maybe_unused]] const auto task = trivialCoroutine();
+        }
+        const auto after = QCoro::frameAllocatorStats();
+
+        QCOMPARE(after.hits, before.hits + 10);
+        QCOMPARE(after.misses, before.misses);
+        QVERIFY(after.cached > 0);
+    }
+
+    void testCustomFrameAllocator() {
+        static int allocations = 0;
+        static int deallocations = 0;
+        QCoro::setFrameAllocator({[](std::size_t size) {
+                                      ++allocations;
+                                      return ::operator new(size);
+                                  },
+                                  [](void *ptr, std::size_t) {
+                                      ++deallocations;
+                                      ::operator delete(ptr);
+                                  }});
+
+        { [[maybe_unused]] const auto task = trivialCoroutine(); }
+
+        QCoro::setFrameAllocator({});
+
+        QCOMPARE(allocations, 1);
+        QCOMPARE(deallocations, 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroTaskTest)
+
+#include "qcorotask.moc"
@@ -8,7 +8,9 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 
+#include <memory>
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -81,9 +83,55 @@ private:
         clientThread.join();
     }
 
+    QCoro::Task<> testConnectionsStream_coro(QCoro::TestContext) {
+        QTcpServer server;
+        QCORO_VERIFY(server.listen(QHostAddress::LocalHost, 45678));
+
+        constexpr int count = 10;
+        bool ok = true;
+        std::thread clientThread{[&ok]() mutable {
+            std::vector<std::unique_ptr<QTcpSocket>> sockets;
+            for (int i = 0; i < count; ++i) {
+                auto &socket = sockets.emplace_back(std::make_unique<QTcpSocket>());
+                socket->connectToHost(QHostAddress::LocalHost, 45678);
+            }
+            for (auto &socket : sockets) {
+                ok &= socket->waitForConnected(10'000);
+            }
+            std::this_thread::sleep_for(500ms);
+        }};
+
+        int accepted = 0;
+        QCORO_FOREACH(QTcpSocket *socket, qCoro(server).connections()) {
+            QCORO_VERIFY(socket != nullptr);
+            if (++accepted == count) {
+                break;
+            }
+        }
+
+        clientThread.join();
+        QCORO_VERIFY(ok);
+        QCORO_COMPARE(accepted, count);
+    }
+
+    QCoro::Task<> testConnectionsStreamEndsWhenServerDestroyed_coro(QCoro::TestContext) {
+        auto *server = new QTcpServer;
+        QCORO_VERIFY(server->listen(QHostAddress::LocalHost, 45678));
+        QTimer::singleShot(10ms, server, &QObject::deleteLater);
+
+        int accepted = 0;
+        QCORO_FOREACH(QTcpSocket *socket, qCoro(server).connections()) {
+            Q_UNUSED(socket);
+            ++accepted;
+        }
+        QCORO_COMPARE(accepted, 0);
+    }
+
 private Q_SLOTS:
     addTest(WaitForNewConnectionTriggers)
     addTest(DoesntCoAwaitPendingConnection)
+    addTest(ConnectionsStream)
+    addTest(ConnectionsStreamEndsWhenServerDestroyed)
 };
 
 QTEST_GUILESS_MAIN(QCoroTcpServerTest)
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/thread.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QThreadPool>
+
+#include <memory>
+#include <stdexcept>
+
+class QCoroThreadTest : public QCoro::TestObject<QCoroThreadTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testResumesOnThread_coro(QCoro::TestContext) {
+        auto *mainThread = QThread::currentThread();
+
+        QThread thread;
+        thread.start();
+        QCORO_VERIFY(QTest::qWaitFor([&thread]() { return thread.eventDispatcher() != nullptr; }));
+
+        co_await QCoro::resumeOn(&thread);
+        QCORO_COMPARE(QThread::currentThread(), &thread);
+
+        co_await QCoro::resumeOn(mainThread);
+        QCORO_COMPARE(QThread::currentThread(), mainThread);
+
+        thread.quit();
+        thread.wait();
+    }
+
+    QCoro::Task<> testResumesOnThreadPool_coro(QCoro::TestContext) {
+        auto *mainThread = QThread::currentThread();
+
+        QThreadPool pool;
+        co_await QCoro::resumeOn(&pool);
+        QCORO_VERIFY(QThread::currentThread() != mainThread);
+
+        co_await QCoro::resumeOn(mainThread);
+        QCORO_COMPARE(QThread::currentThread(), mainThread);
+    }
+
+    QCoro::Task<> testDoesntSuspendOnCurrentThread_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        co_await QCoro::resumeOn(QThread::currentThread());
+    }
+
+    QCoro::Task<> testRunsInThreadPool_coro(QCoro::TestContext) {
+        auto *mainThread = QThread::currentThread();
+
+        QThreadPool pool;
+        QThread *workerThread = nullptr;
+        const auto result = co_await QCoro::runInThreadPool(
+            [&workerThread]() {
+                workerThread = QThread::currentThread();
+                return std::make_unique<int>(42);
+            },
+            &pool);
+
+        QCORO_COMPARE(*result, 42);
+        QCORO_VERIFY(workerThread != mainThread);
+        QCORO_COMPARE(QThread::currentThread(), mainThread);
+    }
+
+    QCoro::Task<> testRunInThreadPoolRethrows_coro(QCoro::TestContext) {
+        bool thrown = false;
+        try {
+            co_await QCoro::runInThreadPool([]() { throw std::runtime_error("Expected"); });
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        QCORO_VERIFY(thrown);
+        QCORO_COMPARE(QThread::currentThread(), QCoreApplication::instance()->thread());
+    }
+
+private Q_SLOTS:
+    addTest(ResumesOnThread)
+    addTest(ResumesOnThreadPool)
+    addTest(DoesntSuspendOnCurrentThread)
+    addTest(RunsInThreadPool)
+    addTest(RunInThreadPoolRethrows)
+};
+
+QTEST_GUILESS_MAIN(QCoroThreadTest)
+
+#include "qcorothread.moc"
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/threadpoolexecutor.h"
+#include "qcoro/thread.h"
+#include "qcoro/whenall.h"
+
+#include <QThread>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+QCoro::Task<int> yieldingValue(QCoro::ThreadPoolExecutor &executor, int value) {
+    co_await executor.schedule();
+    co_return value;
+}
+
+QCoro::LazyTask<int> job(QCoro::ThreadPoolExecutor &executor, QThread *mainThread,
+                         std::atomic<int> &onMainThread, int value) {
+    int result = 0;
+    for (int i = 0; i < 3; ++i) {
+        result += co_await yieldingValue(executor, value);
+    }
+    if (QThread::currentThread() == mainThread) {
+        ++onMainThread;
+    }
+    co_return result;
+}
+
+QCoro::LazyTask<int> finishingJob(QCoro::ThreadPoolExecutor &executor,
+                                  const std::atomic<bool> &finish, int value) {
+    co_await executor.schedule();
+    while (!finish) {
+        std::this_thread::yield();
+    }
+    co_return value;
+}
+
+} // namespace
+
+class QCoroThreadPoolExecutorTest : public QCoro::TestObject<QCoroThreadPoolExecutorTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testRunsLazyTasks_coro(QCoro::TestContext) {
+        auto *mainThread = QThread::currentThread();
+        std::atomic<int> onMainThread{0};
+
+        QCoro::ThreadPoolExecutor executor(4);
+        QCORO_COMPARE(executor.threadCount(), 4u);
+
+        std::vector<QCoro::Task<int>> tasks;
+        for (int i = 0; i < 1000; ++i) {
+            tasks.push_back(executor.run(job(executor, mainThread, onMainThread, i)));
+        }
+
+        const auto results = co_await QCoro::whenAll(std::move(tasks));
+        co_await QCoro::resumeOn(mainThread);
+
+        int sum = 0;
+        for (const auto result : results) {
+            sum += result;
+        }
+        QCORO_COMPARE(sum, 3 * 999 * 1000 / 2);
+        QCORO_COMPARE(onMainThread.load(), 0);
+    }
+
+    QCoro::Task<> testResumeOnExecutor_coro(QCoro::TestContext) {
+        auto *mainThread = QThread::currentThread();
+
+        QCoro::ThreadPoolExecutor executor(2);
+        co_await QCoro::resumeOn(&executor);
+        QCORO_VERIFY(QThread::currentThread() != mainThread);
+
+        co_await QCoro::resumeOn(mainThread);
+        QCORO_COMPARE(QThread::currentThread(), mainThread);
+    }
+
+    QCoro::Task<> testLazyTaskIsReadyWhenFinishedInWorker_coro(QCoro::TestContext) {
+        QCoro::ThreadPoolExecutor executor(1);
+        std::atomic<bool> finish{false};
+
+        auto task = finishingJob(executor, finish, 42);
+        task.start();
+        QCORO_VERIFY(!task.isReady());
+
+        finish = true;
+        while (!task.isReady()) {
+            std::this_thread::yield();
+        }
+        // The result is visible once isReady() returns true
+        QCORO_COMPARE(co_await task, 42);
+    }
+
+private Q_SLOTS:
+    addTest(RunsLazyTasks)
+    addTest(ResumeOnExecutor)
+    addTest(LazyTaskIsReadyWhenFinishedInWorker)
+
+    void testDequeTakesEachItemOnce() {
+        constexpr std::size_t count = 100000;
+        QCoro::detail::WorkStealingDeque deque(4);
+        std::vector<std::atomic<int>> taken(count);
+        std::atomic<std::size_t> takenCount{0};
+        std::atomic<bool> stop{false};
+
+        const auto take = [&](QCORO_STD::coroutine_handle<> handle) {
+            if (handle) {
+                ++taken[reinterpret_cast<std::uintptr_t>(handle.address()) / 8 - 1];
+                ++takenCount;
+            }
+        };
+
+        std::vector<std::thread> thieves;
+        for (int i = 0; i < 3; ++i) {
+            thieves.emplace_back([&]() {
+                while (!stop) {
+                    take(deque.steal());
+                }
+            });
+        }
+
+        for (std::size_t i = 1; i <= count; ++i) {
+            deque.push(
+                QCORO_STD::coroutine_handle<>::from_address(reinterpret_cast<void *>(i * 8)));
+            if (i % 3 == 0) {
+                take(deque.pop());
+            }
+        }
+        while (takenCount < count) {
+            take(deque.pop());
+        }
+
+        stop = true;
+        for (auto &thief : thieves) {
+            thief.join();
+        }
+
+        for (const auto &item : taken) {
+            QCOMPARE(item.load(), 1);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroThreadPoolExecutorTest)
+
+#include "qcorothreadpoolexecutor.moc"
@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/timeout.h"
+
+#include <QElapsedTimer>
+
+#include <chrono>
+#include <stdexcept>
+
+class QCoroTimeoutTest : public QCoro::TestObject<QCoroTimeoutTest> {
+    Q_OBJECT
+
+private:
+    static QCoro::Task<int> delayedValue(std::chrono::milliseconds delay, int value) {
+        co_await QCoro::sleepFor(delay);
+        co_return value;
+    }
+
+    QCoro::Task<> testReturnsResultBeforeTimeout_coro(QCoro::TestContext) {
+        const auto result = co_await QCoro::withTimeout(delayedValue(10ms, 42), 1s);
+        static_assert(std::is_same_v<decltype(result), const std::optional<int>>);
+        QCORO_VERIFY(result.has_value());
+        QCORO_COMPARE(*result, 42);
+    }
+
+    QCoro::Task<> testTimesOut_coro(QCoro::TestContext) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        const auto result = co_await QCoro::withTimeout(delayedValue(1s, 42), 50ms);
+        QCORO_VERIFY(!result.has_value());
+        QCORO_VERIFY(elapsed.elapsed() < 1000);
+    }
+
+    QCoro::Task<> testVoidResult_coro(QCoro::TestContext) {
+        const auto task = []() -> QCoro::Task<> { co_await QCoro::sleepFor(10ms); };
+
+        const auto result = co_await QCoro::withTimeout(task(), 1s);
+        static_assert(std::is_same_v<decltype(result), const std::optional<std::monostate>>);
+        QCORO_VERIFY(result.has_value());
+    }
+
+    QCoro::Task<> testAwaitsLValueTask_coro(QCoro::TestContext) {
+        auto task = delayedValue(10ms, 42);
+
+        const auto result = co_await QCoro::withTimeout(task, 1s);
+        QCORO_COMPARE(result.value_or(0), 42);
+    }
+
+    QCoro::Task<> testCancelsOperationOnTimeout_coro(QCoro::TestContext) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        const auto result = co_await QCoro::withTimeout(QCoro::sleepFor(1s), 50ms);
+        QCORO_VERIFY(!result.has_value());
+        QCORO_VERIFY(elapsed.elapsed() < 1000);
+    }
+
+    QCoro::Task<> testDoesntSuspendIfReady_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        const auto result = co_await QCoro::withTimeout(QCoro::sleepFor(0ms), 1s);
+        QCORO_VERIFY(result.has_value());
+    }
+
+    QCoro::Task<> testRethrowsException_coro(QCoro::TestContext) {
+        const auto task = []() -> QCoro::Task<int> {
+            co_await QCoro::sleepFor(10ms);
+            throw std::runtime_error("Error");
+        };
+
+        bool thrown = false;
+        try {
+            co_await QCoro::withTimeout(task(), 1s);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        QCORO_VERIFY(thrown);
+    }
+
+    QCoro::Task<> testDeadline_coro(QCoro::TestContext) {
+        const auto deadline = std::chrono::steady_clock::now() + 50ms;
+
+        const auto first = co_await QCoro::withDeadline(delayedValue(10ms, 1), deadline);
+        QCORO_COMPARE(first.value_or(0), 1);
+
+        const auto second = co_await QCoro::withDeadline(delayedValue(1s, 2), deadline);
+        QCORO_VERIFY(!second.has_value());
+        QCORO_VERIFY(std::chrono::steady_clock::now() >= deadline);
+    }
+
+private Q_SLOTS:
+    addTest(ReturnsResultBeforeTimeout)
+    addTest(TimesOut)
+    addTest(VoidResult)
+    addTest(AwaitsLValueTask)
+    addTest(CancelsOperationOnTimeout)
+    addTest(DoesntSuspendIfReady)
+    addTest(RethrowsException)
+    addTest(Deadline)
+};
+
+QTEST_GUILESS_MAIN(QCoroTimeoutTest)
+
+#include "qcorotimeout.moc"
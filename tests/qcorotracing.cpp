@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/lazytask.h"
+#include "qcoro/timer.h"
+#include "qcoro/tracing.h"
+
+#include <QBuffer>
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace QCoro::detail;
+
+namespace {
+
+QCoro::Task<int> namedTimer() {
+    co_await QCoro::traceName("namedTimer");
+    QTimer timer;
+    timer.start(10ms);
+    co_await timer;
+    co_return 42;
+}
+
+QCoro::Task<int> immediate() {
+    co_return 42;
+}
+
+std::vector<TraceEvent> recordedEvents() {
+    std::vector<TraceEvent> events;
+    for (const auto &buffer : TraceRegistry::instance().buffers()) {
+        const auto snapshot = buffer->snapshot();
+        events.insert(events.end(), snapshot.begin(), snapshot.end());
+    }
+    return events;
+}
+
+std::vector<TraceEventType> eventTypes(const void *coroutine) {
+    std::vector<TraceEventType> types;
+    for (const auto &event : recordedEvents()) {
+        if (event.coroutine == coroutine) {
+            types.push_back(event.type);
+        }
+    }
+    return types;
+}
+
+const void *createdCoroutine(std::string_view name) {
+    for (const auto &event : recordedEvents()) {
+        if (event.type == TraceEventType::Created &&
+            std::string_view{event.name, event.nameLength} == name) {
+            return event.coroutine;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+class QCoroTracingTest : public QCoro::TestObject<QCoroTracingTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testRecordsSuspendedAwait_coro(QCoro::TestContext) {
+        QCoro::clearTrace();
+
+        const int result = co_await namedTimer();
+        QCORO_COMPARE(result, 42);
+
+        const auto *coroutine = createdCoroutine("QCoro::Task<int>");
+        QCORO_VERIFY(coroutine != nullptr);
+        const std::vector<TraceEventType> expected{
+            TraceEventType::Created, TraceEventType::Named, TraceEventType::Suspended,
+            TraceEventType::Resumed, TraceEventType::Finished, TraceEventType::Destroyed};
+        QCORO_VERIFY(eventTypes(coroutine) == expected);
+    }
+
+    QCoro::Task<> testExportsChromeTrace_coro(QCoro::TestContext) {
+        QCoro::clearTrace();
+
+        co_await namedTimer();
+
+        const auto trace = QCoro::chromeTrace();
+        QCORO_VERIFY(trace.startsWith(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+        QCORO_VERIFY(trace.endsWith("]}\n"));
+        QCORO_VERIFY(trace.contains(R"("name":"namedTimer","ph":"b")"));
+        QCORO_VERIFY(trace.contains(R"("name":"namedTimer","ph":"e")"));
+        QCORO_VERIFY(trace.contains(R"("args":{"type":"QCoro::Task<int>"})"));
+        QCORO_VERIFY(trace.contains(R"("name":"thread_name","ph":"M")"));
+        QCORO_COMPARE(trace.count(R"("ph":"b")"), trace.count(R"("ph":"e")"));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QCORO_VERIFY(QCoro::writeChromeTrace(&buffer));
+        QCORO_VERIFY(buffer.data().contains("namedTimer"));
+    }
+
+    QCoro::Task<> testReadyAwaitIsNotSuspended_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+        QCoro::clearTrace();
+
+        const int result = co_await immediate();
+        QCORO_COMPARE(result, 42);
+
+        const auto *coroutine = createdCoroutine("QCoro::Task<int>");
+        QCORO_VERIFY(coroutine != nullptr);
+        const std::vector<TraceEventType> expected{TraceEventType::Created,
+                                                   TraceEventType::Finished,
+                                                   TraceEventType::Destroyed};
+        QCORO_VERIFY(eventTypes(coroutine) == expected);
+    }
+
+    QCoro::Task<> testDisabledTracingRecordsNothing_coro(QCoro::TestContext) {
+        QCoro::clearTrace();
+        QCoro::setTracingEnabled(false);
+        QCORO_VERIFY(!QCoro::isTracingEnabled());
+
+        co_await namedTimer();
+
+        QCoro::setTracingEnabled(true);
+        QCORO_VERIFY(recordedEvents().empty());
+    }
+
+private Q_SLOTS:
+    addTest(RecordsSuspendedAwait)
+    addTest(ExportsChromeTrace)
+    addTest(ReadyAwaitIsNotSuspended)
+    addTest(DisabledTracingRecordsNothing)
+
+    void testRingBufferDropsOldestEvents() {
+        TraceBuffer buffer{4, 1};
+        for (int i = 0; i < 6; ++i) {
+            buffer.record(TraceEventType::Created, reinterpret_cast<const void *>(quintptr(i + 1)),
+                          {});
+        }
+        auto events = buffer.snapshot();
+        QCOMPARE(events.size(), std::size_t{4});
+        QCOMPARE(events.front().coroutine, reinterpret_cast<const void *>(quintptr(3)));
+        QCOMPARE(events.back().coroutine, reinterpret_cast<const void *>(quintptr(6)));
+
+        buffer.clear();
+        QVERIFY(buffer.snapshot().empty());
+        buffer.record(TraceEventType::Finished, nullptr, {});
+        QCOMPARE(buffer.snapshot().size(), std::size_t{1});
+    }
+
+    void testSnapshotWhileRecording() {
+        TraceBuffer buffer{64, 1};
+        std::atomic<bool> done{false};
+        std::thread writer([&buffer, &done]() {
+            for (quintptr i = 1; i <= 100'000; ++i) {
+                buffer.record(TraceEventType::Resumed, reinterpret_cast<const void *>(i), {});
+            }
+            done = true;
+        });
+
+        // Each snapshot must only contain consecutive, fully written events
+        bool consistent = true;
+        while (!done) {
+            const auto events = buffer.snapshot();
+            for (std::size_t i = 1; i < events.size(); ++i) {
+                consistent &= events[i].type == TraceEventType::Resumed &&
+                              reinterpret_cast<quintptr>(events[i].coroutine) ==
+                                  reinterpret_cast<quintptr>(events[i - 1].coroutine) + 1;
+            }
+        }
+        writer.join();
+
+        QVERIFY(consistent);
+        QCOMPARE(buffer.snapshot().size(), std::size_t{64});
+    }
+};
+
+QTEST_GUILESS_MAIN(QCoroTracingTest)
+
+#include "qcorotracing.moc"
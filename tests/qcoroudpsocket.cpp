@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/coro.h"
+
+#include <QNetworkDatagram>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+std::vector<QNetworkDatagram> makeDatagrams(int count, quint16 port) {
+    std::vector<QNetworkDatagram> datagrams;
+    for (int i = 0; i < count; ++i) {
+        datagrams.emplace_back(QByteArray::number(i),
+                               QHostAddress{QHostAddress::LocalHost}, port);
+    }
+    return datagrams;
+}
+
+} // namespace
+
+class QCoroUdpSocketTest : public QCoro::TestObject<QCoroUdpSocketTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testReceivesDatagrams_coro(QCoro::TestContext) {
+        QUdpSocket receiver;
+        QCORO_VERIFY(receiver.bind(QHostAddress::LocalHost));
+        QUdpSocket sender;
+
+        QTimer::singleShot(10ms, [&]() {
+            const auto datagrams = makeDatagrams(5, receiver.localPort());
+            qCoro(sender).sendDatagrams(datagrams);
+        });
+
+        std::vector<QNetworkDatagram> datagrams;
+        QByteArrayList received;
+        while (received.size() < 5) {
+            const auto count = co_await qCoro(receiver).receiveDatagrams(datagrams, 64, 10s);
+            QCORO_VERIFY(count > 0);
+            QCORO_COMPARE(datagrams.size(), count);
+            for (const auto &datagram : datagrams) {
+                received.push_back(datagram.data());
+            }
+        }
+
+        QCORO_COMPARE(received, (QByteArrayList{"0", "1", "2", "3", "4"}));
+    }
+
+    QCoro::Task<> testReceivesAtMostMaxBatch_coro(QCoro::TestContext) {
+        QUdpSocket receiver;
+        QCORO_VERIFY(receiver.bind(QHostAddress::LocalHost));
+        QUdpSocket sender;
+
+        const auto toSend = makeDatagrams(5, receiver.localPort());
+        QCORO_COMPARE(qCoro(sender).sendDatagrams(toSend), std::size_t{5});
+
+        std::vector<QNetworkDatagram> datagrams;
+        QCORO_COMPARE(co_await qCoro(receiver).receiveDatagrams(datagrams, 2, 10s), std::size_t{2});
+        QCORO_COMPARE(datagrams.size(), std::size_t{2});
+        QCORO_COMPARE(datagrams[0].data(), QByteArray{"0"});
+        QCORO_COMPARE(datagrams[1].data(), QByteArray{"1"});
+
+        const auto capacity = datagrams.capacity();
+        QCORO_COMPARE(co_await qCoro(receiver).receiveDatagrams(datagrams, 2, 10s), std::size_t{2});
+        QCORO_COMPARE(datagrams[0].data(), QByteArray{"2"});
+        QCORO_COMPARE(datagrams.capacity(), capacity);
+    }
+
+    QCoro::Task<> testReceiveTimeout_coro(QCoro::TestContext) {
+        QUdpSocket receiver;
+        QCORO_VERIFY(receiver.bind(QHostAddress::LocalHost));
+
+        std::vector<QNetworkDatagram> datagrams{QNetworkDatagram{"stale"}};
+        QCORO_COMPARE(co_await qCoro(receiver).receiveDatagrams(datagrams, 64, 100ms),
+                      std::size_t{0});
+        QCORO_VERIFY(datagrams.empty());
+    }
+
+    QCoro::Task<> testDoesntCoAwaitUnboundSocket_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        QUdpSocket socket;
+        std::vector<QNetworkDatagram> datagrams;
+        QCORO_COMPARE(co_await qCoro(socket).receiveDatagrams(datagrams), std::size_t{0});
+    }
+
+private Q_SLOTS:
+    addTest(ReceivesDatagrams)
+    addTest(ReceivesAtMostMaxBatch)
+    addTest(ReceiveTimeout)
+    addTest(DoesntCoAwaitUnboundSocket)
+};
+
+QTEST_GUILESS_MAIN(QCoroUdpSocketTest)
+
+#include "qcoroudpsocket.moc"
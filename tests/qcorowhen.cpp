@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2021 Daniel Vrátil <dvratil@kde.org>
+//
+// SPDX-License-Identifier: MIT
+
+#include "testobject.h"
+#include "qcoro/timer.h"
+#include "qcoro/whenall.h"
+#include "qcoro/whenany.h"
+
+#include <QElapsedTimer>
+
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+QCoro::Task<int> delayedValue(int value, std::chrono::milliseconds delay) {
+    QTimer timer;
+    timer.start(delay);
+    co_await timer;
+    co_return value;
+}
+
+QCoro::Task<int> immediateValue(int value) {
+    co_return value;
+}
+
+QCoro::Task<> delay(std::chrono::milliseconds delay) {
+    QTimer timer;
+    timer.start(delay);
+    co_await timer;
+}
+
+QCoro::Task<int> delayedThrow(std::chrono::milliseconds delay) {
+    QTimer timer;
+    timer.start(delay);
+    co_await timer;
+    throw std::runtime_error("Expected exception");
+}
+
+} // namespace
+
+class QCoroWhenTest : public QCoro::TestObject<QCoroWhenTest> {
+    Q_OBJECT
+
+private:
+    QCoro::Task<> testWhenAllRunsConcurrently_coro(QCoro::TestContext) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        const auto [first, second, third] =
+            co_await QCoro::whenAll(delayedValue(1, 200ms), delay(200ms), delayedValue(3, 100ms));
+
+        QCORO_VERIFY(elapsed.elapsed() < 400);
+        QCORO_COMPARE(first, 1);
+        QCORO_COMPARE(third, 3);
+    }
+
+    QCoro::Task<> testWhenAllRange_coro(QCoro::TestContext) {
+        std::vector<QCoro::Task<int>> tasks;
+        for (int i = 0; i < 5; ++i) {
+            tasks.push_back(delayedValue(i, std::chrono::milliseconds{(5 - i) * 20}));
+        }
+
+        const auto results = co_await QCoro::whenAll(std::move(tasks));
+        QCORO_COMPARE(results, (std::vector<int>{0, 1, 2, 3, 4}));
+    }
+
+    QCoro::Task<> testWhenAllDoesntSuspendOnFinished_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        auto first = immediateValue(1);
+        const auto [firstResult, secondResult] = co_await QCoro::whenAll(first, immediateValue(2));
+        QCORO_COMPARE(firstResult, 1);
+        QCORO_COMPARE(secondResult, 2);
+    }
+
+    QCoro::Task<> testWhenAllRethrows_coro(QCoro::TestContext) {
+        bool thrown = false;
+        try {
+            co_await QCoro::whenAll(delayedValue(1, 50ms), delayedThrow(10ms));
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        QCORO_VERIFY(thrown);
+    }
+
+    QCoro::Task<> testWhenAnyReturnsFirst_coro(QCoro::TestContext) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        const auto result = co_await QCoro::whenAny(delayedValue(1, 500ms), delayedValue(2, 50ms));
+
+        QCORO_VERIFY(elapsed.elapsed() < 400);
+        QCORO_COMPARE(result.index(), 1u);
+        QCORO_COMPARE(std::get<1>(result), 2);
+    }
+
+    QCoro::Task<> testWhenAnyRange_coro(QCoro::TestContext) {
+        std::vector<QCoro::Task<int>> tasks;
+        tasks.push_back(delayedValue(10, 300ms));
+        tasks.push_back(delayedValue(20, 20ms));
+        tasks.push_back(delayedValue(30, 300ms));
+
+        const auto [index, value] = co_await QCoro::whenAny(tasks);
+        QCORO_COMPARE(index, 1u);
+        QCORO_COMPARE(value, 20);
+
+        // Let the remaining tasks finish, they reference the vector
+        co_await QCoro::whenAll(tasks);
+    }
+
+private Q_SLOTS:
+    addTest(WhenAllRunsConcurrently)
+    addTest(WhenAllRange)
+    addTest(WhenAllDoesntSuspendOnFinished)
+    addTest(WhenAllRethrows)
+    addTest(WhenAnyReturnsFirst)
+    addTest(WhenAnyRange)
+};
+
+QTEST_GUILESS_MAIN(QCoroWhenTest)
+
+#include "qcorowhen.moc"
@@ -63,6 +63,69 @@ private:
         QCORO_VERIFY(reply.isValid());
     }
 
+    QCoro::Task<> testWaitsForReplies_coro(QCoro::TestContext) {
+        QDBusInterface iface(DBusServer::serviceName, DBusServer::objectPath,
+                             DBusServer::interfaceName);
+        QCORO_VERIFY(iface.isValid());
+
+        QList<QDBusPendingCall> calls;
+        for (int i = 0; i < 10; ++i) {
+            calls.push_back(iface.asyncCall(QStringLiteral("ping"), QString::number(i)));
+        }
+
+        const auto replies = co_await QCoro::waitForReplies(std::move(calls));
+
+        QCORO_COMPARE(replies.size(), 10);
+        for (int i = 0; i < replies.size(); ++i) {
+            QCORO_VERIFY(replies[i].isFinished());
+            const QDBusReply<QString> reply = replies[i].reply();
+            QCORO_COMPARE(reply.value(), QString::number(i));
+        }
+    }
+
+    QCoro::Task<> testDoesntWaitForFinishedReplies_coro(QCoro::TestContext test) {
+        QDBusInterface iface(DBusServer::serviceName, DBusServer::objectPath,
+                             DBusServer::interfaceName);
+        QCORO_VERIFY(iface.isValid());
+
+        const QList<QDBusPendingCall> calls = {iface.asyncCall(QStringLiteral("foo")),
+                                               iface.asyncCall(QStringLiteral("foo"))};
+        co_await QCoro::waitForReplies(calls);
+
+        test.setShouldNotSuspend();
+        co_await QCoro::waitForReplies(calls);
+    }
+
+    QCoro::Task<> testServesOverlappingDelayedReplies_coro(QCoro::TestContext) {
+        QDBusInterface iface(DBusServer::serviceName, DBusServer::objectPath,
+                             DBusServer::interfaceName);
+        QCORO_VERIFY(iface.isValid());
+
+        const QDBusPendingReply<QString> slow =
+            iface.asyncCall(QStringLiteral("delayedPing"), QStringLiteral("slow"), 500);
+        const QDBusPendingReply<QString> fast =
+            iface.asyncCall(QStringLiteral("delayedPing"), QStringLiteral("fast"), 10);
+
+        // The slow call doesn't block the server from replying to the fast one
+        co_await fast;
+        QCORO_COMPARE(fast.value(), QStringLiteral("fast"));
+        QCORO_VERIFY(!slow.isFinished());
+
+        co_await slow;
+        QCORO_COMPARE(slow.value(), QStringLiteral("slow"));
+    }
+
+    QCoro::Task<> testDelayedReplySendsError_coro(QCoro::TestContext) {
+        QDBusInterface iface(DBusServer::serviceName, DBusServer::objectPath,
+                             DBusServer::interfaceName);
+        QCORO_VERIFY(iface.isValid());
+
+        const QDBusReply<void> reply = co_await iface.asyncCall(QStringLiteral("delayedFail"), 10);
+        QCORO_VERIFY(!reply.isValid());
+        QCORO_COMPARE(reply.error().type(), QDBusError::Failed);
+        QCORO_COMPARE(reply.error().message(), QStringLiteral("Expected failure"));
+    }
+
 private Q_SLOTS:
     void initTestCase() {
         for (int i = 0; i < 10; ++i) {
@@ -87,6 +150,10 @@ private Q_SLOTS:
     addTest(ReturnsResult)
     addTest(DoesntBlockEventLoop)
     addTest(DoesntCoAwaitFinishedCall)
+    addTest(WaitsForReplies)
+    addTest(DoesntWaitForFinishedReplies)
+    addTest(ServesOverlappingDelayedReplies)
+    addTest(DelayedReplySendsError)
 };
 
 DBUS_TEST_MAIN(QCoroDBusPendingCallTest)
@@ -4,10 +4,32 @@
 
 #include "testobject.h"
 #include "qcoro/future.h"
+#include "qcoro/timer.h"
+#include "qcoro/whenall.h"
 
+#include <QCoreApplication>
+#include <QFutureInterface>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 
+#include <stdexcept>
 #include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+QCoro::Task<int> awaitValue(QFuture<int> future) {
+    co_return co_await future;
+}
+
+QCoro::DestroyableCoroutine awaitAndCount(QFuture<void> future, int &resumed) {
+    co_await std::move(future);
+    ++resumed;
+}
+
+} // namespace
 
 class QCoroFutureTest : public QCoro::TestObject<QCoroFutureTest> {
     Q_OBJECT
@@ -53,12 +75,166 @@ private:
         co_await future;
     }
 
+    QCoro::Task<> testResumesInAwaitingThread_coro(QCoro::TestContext) {
+        const auto *threadPoolThread = co_await QtConcurrent::run([] {
+            std::this_thread::sleep_for(10ms);
+            return QThread::currentThread();
+        });
+
+        QCORO_VERIFY(threadPoolThread != QThread::currentThread());
+        QCORO_COMPARE(QThread::currentThread(), QCoreApplication::instance()->thread());
+    }
+
+    QCoro::Task<> testAwaitsManyFutures_coro(QCoro::TestContext) {
+        std::vector<QFuture<int>> futures;
+        for (int i = 0; i < 1000; ++i) {
+            futures.push_back(QtConcurrent::run([i] { return i; }));
+        }
+
+        int sum = 0;
+        for (auto &future : futures) {
+            sum += co_await std::move(future);
+        }
+        QCORO_COMPARE(sum, 999 * 1000 / 2);
+    }
+
+    QCoro::Task<> testResumesAllAwaitersOfSharedFuture_coro(QCoro::TestContext) {
+        const auto future = QtConcurrent::run([] {
+            std::this_thread::sleep_for(50ms);
+            return 42;
+        });
+
+        const auto [first, second] =
+            co_await QCoro::whenAll(awaitValue(future), awaitValue(future));
+
+        QCORO_COMPARE(first, 42);
+        QCORO_COMPARE(second, 42);
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QCoro::Task<> testKeepsContinuationOfAwaitedFuture_coro(QCoro::TestContext) {
+        QFutureInterface<void> interface;
+        interface.reportStarted();
+        auto future = interface.future();
+        bool continued = false;
+        auto continuation =
+            future.then(QtFuture::Launch::Sync, [&continued](const QFuture<void> &) { continued = true; });
+        QTimer::singleShot(10ms, [&interface]() { interface.reportFinished(); });
+
+        co_await future;
+
+        QCORO_VERIFY(continued);
+        QCORO_VERIFY(continuation.isFinished());
+    }
+#endif
+
+    QCoro::Task<> testDestroyedAwaiterIsNotResumed_coro(QCoro::TestContext) {
+        QFutureInterface<void> interface;
+        interface.reportStarted();
+
+        int resumed = 0;
+        auto coroutine = awaitAndCount(interface.future(), resumed);
+        // Destroys the coroutine while it's suspended on the future
+        coroutine.destroy();
+
+        QTimer::singleShot(10ms, [&interface]() { interface.reportFinished(); });
+        QTimer timer;
+        timer.start(50ms);
+        co_await timer;
+
+        QCORO_COMPARE(resumed, 0);
+    }
+
+    QCoro::Task<> testResumesWhenCanceled_coro(QCoro::TestContext) {
+        QFutureInterface<void> interface;
+        interface.reportStarted();
+        QTimer::singleShot(10ms, [&interface]() {
+            interface.reportCanceled();
+            interface.reportFinished();
+        });
+
+        auto future = interface.future();
+        co_await future;
+
+        QCORO_VERIFY(future.isCanceled());
+    }
+
+    QCoro::Task<> testStreamsResults_coro(QCoro::TestContext) {
+        QList<int> values;
+        for (int i = 0; i < 100; ++i) {
+            values.push_back(i);
+        }
+        const auto future = QtConcurrent::mapped(values, [](int value) {
+            std::this_thread::sleep_for(1ms);
+            return value * 2;
+        });
+
+        QList<int> results;
+        QCORO_FOREACH(int result, QCoro::futureResults(future, 10)) {
+            results.push_back(result);
+        }
+
+        QCORO_COMPARE(results.size(), 100);
+        for (int i = 0; i < results.size(); ++i) {
+            QCORO_COMPARE(results[i], i * 2);
+        }
+    }
+
+    QCoro::Task<> testStreamsReportedResults_coro(QCoro::TestContext) {
+        QFutureInterface<int> interface;
+        interface.reportStarted();
+        QTimer::singleShot(10ms, [&interface]() { interface.reportResult(1); });
+        QTimer::singleShot(20ms, [&interface]() {
+            interface.reportResult(2);
+            interface.reportFinished();
+        });
+
+        const auto future = interface.future();
+        QList<int> results;
+        QList<bool> finished;
+        QCORO_FOREACH(int result, QCoro::futureResults(future)) {
+            results.push_back(result);
+            finished.push_back(future.isFinished());
+        }
+        QCORO_COMPARE(results, (QList<int>{1, 2}));
+        // The first result is yielded while the computation is still running
+        QCORO_COMPARE(finished, (QList<bool>{false, true}));
+    }
+
+    QCoro::Task<> testStreamRethrowsException_coro(QCoro::TestContext) {
+        auto future = QtConcurrent::run([]() -> int {
+            std::this_thread::sleep_for(10ms);
+            throw QUnhandledException{};
+        });
+
+        bool thrown = false;
+        try {
+            QCORO_FOREACH(int result, QCoro::futureResults(future)) {
+                Q_UNUSED(result);
+            }
+        } catch (const QUnhandledException &) {
+            thrown = true;
+        }
+        QCORO_VERIFY(thrown);
+    }
+
 private Q_SLOTS:
     addTest(Triggers)
     addTest(ReturnsResult)
     addTest(DoesntBlockEventLoop)
     addTest(DoesntCoAwaitFinishedFuture)
     addTest(DoesntCoAwaitCanceledFuture)
+    addTest(ResumesInAwaitingThread)
+    addTest(AwaitsManyFutures)
+    addTest(ResumesAllAwaitersOfSharedFuture)
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    addTest(KeepsContinuationOfAwaitedFuture)
+#endif
+    addTest(DestroyedAwaiterIsNotResumed)
+    addTest(ResumesWhenCanceled)
+    addTest(StreamsResults)
+    addTest(StreamsReportedResults)
+    addTest(StreamRethrowsException)
 };
 
 QTEST_GUILESS_MAIN(QCoroFutureTest)
@@ -5,6 +5,11 @@
 #include "testobject.h"
 #include "qcoro/timer.h"
 
+#include <QElapsedTimer>
+
+#include <chrono>
+#include <vector>
+
 class QCoroTimerTest : public QCoro::TestObject<QCoroTimerTest> {
     Q_OBJECT
 
@@ -47,11 +52,94 @@ private:
         co_await timer;
     }
 
+    QCoro::Task<> testResumesAwaitersInOrder_coro(QCoro::TestContext) {
+        QTimer timer;
+        timer.setInterval(100ms);
+        timer.setSingleShot(true);
+        timer.start();
+
+        std::vector<int> order;
+        const auto waiter = [&timer, &order](int id) -> QCoro::Task<> {
+            co_await timer;
+            order.push_back(id);
+        };
+
+        // All three are woken up by the same timeout and resumed in a single batch
+        auto first = waiter(1);
+        auto second = waiter(2);
+        auto third = waiter(3);
+
+        co_await timer;
+
+        QCORO_COMPARE(order, (std::vector<int>{1, 2, 3}));
+    }
+
+    QCoro::Task<> testSleepForTriggers_coro(QCoro::TestContext) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        co_await QCoro::sleepFor(100ms);
+
+        QCORO_VERIFY(elapsed.elapsed() >= 100);
+    }
+
+    QCoro::Task<> testSleepForDoesntSuspendForZero_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        co_await QCoro::sleepFor(0ms);
+    }
+
+    QCoro::Task<> testSleepUntilTriggers_coro(QCoro::TestContext) {
+        const auto deadline = std::chrono::steady_clock::now() + 100ms;
+
+        co_await QCoro::sleepUntil(deadline);
+
+        QCORO_VERIFY(std::chrono::steady_clock::now() >= deadline);
+    }
+
+    QCoro::Task<> testSleepUntilDoesntSuspendForPastDeadline_coro(QCoro::TestContext ctx) {
+        ctx.setShouldNotSuspend();
+
+        co_await QCoro::sleepUntil(std::chrono::steady_clock::now() - 1s);
+    }
+
+    QCoro::Task<> testSleepsResumeInDeadlineOrder_coro(QCoro::TestContext) {
+        std::vector<int> order;
+        const auto sleeper = [&order](int id, std::chrono::milliseconds duration)
+            -> QCoro::Task<> {
+            co_await QCoro::sleepFor(duration);
+            order.push_back(id);
+        };
+
+        auto third = sleeper(3, 150ms);
+        auto first = sleeper(1, 50ms);
+        auto second = sleeper(2, 100ms);
+
+        co_await third;
+
+        QCORO_COMPARE(order, (std::vector<int>{1, 2, 3}));
+    }
+
+    QCoro::Task<> testSleepDoesntBlockEventLoop_coro(QCoro::TestContext) {
+        QCoro::EventLoopChecker eventLoopResponsive;
+
+        co_await QCoro::sleepFor(500ms);
+
+        QCORO_VERIFY(eventLoopResponsive);
+    }
+
 private Q_SLOTS:
     addTest(Triggers)
     addTest(DoesntBlockEventLoop)
     addTest(DoesntCoAwaitInactiveTimer)
     addTest(DoesntCoAwaitNullTimer)
+    addTest(ResumesAwaitersInOrder)
+    addTest(SleepForTriggers)
+    addTest(SleepForDoesntSuspendForZero)
+    addTest(SleepUntilTriggers)
+    addTest(SleepUntilDoesntSuspendForPastDeadline)
+    addTest(SleepsResumeInDeadlineOrder)
+    addTest(SleepDoesntBlockEventLoop)
 };
 
 QTEST_GUILESS_MAIN(QCoroTimerTest)
@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: MIT
 
 #include "testdbusserver.h"
+#include "qcoro/dbus.h"
+#include "qcoro/timer.h"
 
 #include <QCoreApplication>
 #include <QDBusConnection>
@@ -10,6 +12,8 @@
 #include <QDebug>
 #include <QTimer>
 
+#include <chrono>
+#include <stdexcept>
 #include <thread>
 
 DBusServer::DBusServer() {
@@ -41,6 +45,24 @@ QString DBusServer::ping(const QString &ping) {
     return ping;
 }
 
+QString DBusServer::delayedPing(const QString &ping, int msecs) {
+    return QCoro::delayedDBusReply(*this, delayedPingImpl(ping, msecs));
+}
+
+void DBusServer::delayedFail(int msecs) {
+    QCoro::delayedDBusReply(*this, delayedFailImpl(msecs));
+}
+
+QCoro::Task<QString> DBusServer::delayedPingImpl(QString ping, int msecs) {
+    co_await QCoro::sleepFor(std::chrono::milliseconds{msecs});
+    co_return ping;
+}
+
+QCoro::Task<> DBusServer::delayedFailImpl(int msecs) {
+    co_await QCoro::sleepFor(std::chrono::milliseconds{msecs});
+    throw std::runtime_error("Expected failure");
+}
+
 void DBusServer::quit() {
     qApp->quit();
 }
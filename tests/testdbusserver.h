@@ -2,15 +2,18 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <QDBusContext>
 #include <QObject>
 
 #include <QString>
 
+#include "qcoro/task.h"
+
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
-class DBusServer : public QObject {
+class DBusServer : public QObject, protected QDBusContext {
     Q_OBJECT
 
 public:
@@ -30,7 +33,14 @@ public Q_SLOTS:
     void blockFor(int seconds);
     QString blockAndReturn(int seconds);
 
+    QString delayedPing(const QString &ping, int msecs);
+    void delayedFail(int msecs);
+
     void quit();
+
+private:
+    QCoro::Task<QString> delayedPingImpl(QString ping, int msecs);
+    QCoro::Task<> delayedFailImpl(int msecs);
 };
 
 // We must fork the DBus server into its own process due to QTBUG-92107 (asyncCall blocks if the
@@ -10,9 +10,12 @@
 #include <QTimer>
 #include <QVariant>
 
+#include "qcoro/impl/resume.h"
 #include "qcoro/task.h"
 
 #include <chrono>
+#include <exception>
+#include <utility>
 
 using namespace std::chrono_literals;
 
@@ -59,6 +62,75 @@ private:
     int mMinTicks = 10;
 };
 
+//! Sets the resume policy of the current thread, restores the previous one when destroyed.
+/*!
+ * Restores the policy even when a failed check returns from the test early, so that
+ * the following tests don't run with the wrong policy.
+ */
+class ScopedResumePolicy {
+public:
+    explicit ScopedResumePolicy(ResumePolicy policy) : mPrevious(resumePolicy()) {
+        setResumePolicy(policy);
+    }
+    Q_DISABLE_COPY(ScopedResumePolicy)
+
+    ~ScopedResumePolicy() {
+        setResumePolicy(mPrevious);
+    }
+
+private:
+    ResumePolicy mPrevious;
+};
+
+//! A coroutine that is destroyed by its owner, even if it's suspended.
+/*!
+ * Used to test that destroying a suspended coroutine (like destroying an AsyncGenerator
+ * does) doesn't leave dangling waiters behind.
+ */
+class DestroyableCoroutine {
+public:
+    //! Awaits the same types as Task<T> does.
+    struct promise_type : detail::PromiseBase {
+        DestroyableCoroutine get_return_object() noexcept {
+            return DestroyableCoroutine{
+                QCORO_STD::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        QCORO_STD::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+        QCORO_STD::suspend_always final_suspend() const noexcept {
+            return {};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept {
+            std::terminate();
+        }
+    };
+
+    explicit DestroyableCoroutine(QCORO_STD::coroutine_handle<promise_type> coroutine = {})
+        : mCoroutine(coroutine) {}
+    Q_DISABLE_COPY(DestroyableCoroutine)
+    DestroyableCoroutine(DestroyableCoroutine &&other) noexcept
+        : mCoroutine(std::exchange(other.mCoroutine, nullptr)) {}
+    DestroyableCoroutine &operator=(DestroyableCoroutine &&other) noexcept {
+        std::swap(mCoroutine, other.mCoroutine);
+        return *this;
+    }
+
+    ~DestroyableCoroutine() {
+        destroy();
+    }
+
+    void destroy() {
+        if (mCoroutine) {
+            std::exchange(mCoroutine, nullptr).destroy();
+        }
+    }
+
+private:
+    QCORO_STD::coroutine_handle<promise_type> mCoroutine;
+};
+
 template<typename TestClass>
 class TestObject : public QObject {
 protected:
@@ -66,7 +138,9 @@ protected:
         QEventLoop el;
         QTimer::singleShot(5s, &el, [&el]() mutable { el.exit(1); });
 
-        [[maybe_unused]] const auto result = (static_cast<TestClass *>(this)->*testFunction)(el);
+        // Don't hold on to the returned Task, so that the coroutine frame (and the TestContext
+        // in it) is destroyed as soon as the test coroutine finishes.
+        (static_cast<TestClass *>(this)->*testFunction)(el);
 
         bool testFinished = el.property("testFinished").toBool();
         const bool shouldNotSuspend = el.property("shouldNotSuspend").toBool();